@@ -1,75 +1,551 @@
-/*--------------------------------------------------------------------------*
- * OUFTI-1 OBC Embedded software
- * 2008-2009, University of Liege
- *--------------------------------------------------------------------------*
- * AX25_CRC.c
- * FCS operations of the AX.25 frame.
- * 
- *
- * Johan Hardy
- *--------------------------------------------------------------------------*/
-
-#include "AX25_CRC.h"
-
-/*--------------------------------------------------------------------------*
- * AX.25 FCS calculation (bitwise method).
- * CRC-16-CCITT G(x) = x16 + x12 + x5 + 1.
- * Polynom = 0x1021.
- *
- * PARAMETERS:
- * *buffer       pointer of the frame buffer.
- * size_frame    length of the frame (in bytes).
- *
- * RETURN:
- * the CRC with a final XORed operation.
- *--------------------------------------------------------------------------*/
-unsigned short AX25_computeCRC(char *buffer, unsigned short size_frame) {
-  unsigned int i, j;
-  unsigned short shiftRegister, outBit;
-  char byte;
-
-  // The last flag and the 2 bytes for FCS are removed.
-  size_frame = size_frame - 3;
-
-  // Initialization of the Shift Register to 0xFFFF
-  shiftRegister = 0xFFFF;
-
-  for(i=1 ; i<size_frame; i++) {  // The first flag is not calculated so i=1.
-    byte = buffer[i];
-
-    for(j=0; j<8; j++) {
-      outBit = shiftRegister & 0x0001;
-      shiftRegister >>= 0x01;  // Shift the register to the right.
-
-      if(outBit != (byte & 0x01)) {
-        shiftRegister ^= 0x8408;  // Mirrored polynom.
-        byte >>= 0x01;
-        continue;
-      }
-      byte >>= 0x01;
-    }
-  }
-  return shiftRegister ^ 0xFFFF;  // Final XOR.
-}
-
-/*--------------------------------------------------------------------------*
- * AX.25 FCS positioning.
- * Put the FCS in the right place in the frame. The FCS is sent MSB first
- * so we prepare the 15th bit of the CRC to be sent first.
- *
- * PARAMETERS:
- * *frame        pointer of the frame buffer.
- * size_frame    length of the frame (in bytes).
- *--------------------------------------------------------------------------*/
-void AX25_putCRC(char *frame, unsigned short size_frame) {
-  unsigned short crc;
-
-  // FCS calculation.
-  crc = AX25_computeCRC(frame, size_frame); 
-
-  // Put the FCS in the right place with the 15th bit to be sent first.
-  frame[size_frame - 3] = (crc & 0xff);
-  frame[size_frame - 2] = ((crc >> 8) & 0xff);
-}
-
-
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 OBC Embedded software
+ * 2008-2009, University of Liege
+ *--------------------------------------------------------------------------*
+ * AX25_CRC.c
+ * FCS operations of the AX.25 frame. The FCS can be computed in one shot on
+ * a whole frame or incrementally (init/update/final) while the frame is
+ * assembled. Several engines are available and the fastest one supported
+ * by the host is selected at runtime.
+ *
+ *
+ * Johan Hardy
+ *--------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Rx.h"
+
+#define AX25_CRC_MAX_BITS    (8 * AX25_FRAME_MAX_SIZE)
+#define AX25_CRC_NO_BIT      0xFFFF  // Empty entry of the syndrome tables.
+#define AX25_CRC_MAX_PAIRS   8192    // Max pairs of wrong bits on the air searched.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AX25_HAVE_CLMUL
+#include <immintrin.h>
+#endif
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the global variables for the FCS engines.
+ *--------------------------------------------------------------------------*/
+static unsigned short crcTable[8][256];  // Slicing tables (crcTable[0] is
+                                         // the classic byte table).
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+static unsigned char crcEngine = 0xFF;   // Selected engine (0xFF = none).
+static unsigned char crcClmulSupported;
+static unsigned short crcSyndrome[AX25_CRC_MAX_BITS];      // Syndrome of a wrong bit
+static unsigned short crcLineSyndrome[AX25_CRC_MAX_BITS];  // and of a wrong bit on the
+                                                           // air, by distance from the
+                                                           // end of the frame.
+static unsigned short crcBitTable[65536];   // Syndrome -> distance of a wrong bit.
+static unsigned short crcLineTable[65536];  // Syndrome -> distance of a wrong line bit.
+#ifdef AX25_HAVE_CLMUL
+static unsigned long long crcFold[4][2];  // Folding constants (128, 256,
+                                          // 384 and 512 bits).
+#endif
+
+/*--------------------------------------------------------------------------*
+ * Computation of x^exponent mod G(x) (normal bit order, G = 0x11021).
+ * Used to generate the folding constants of the CLMUL engine.
+ *--------------------------------------------------------------------------*/
+#ifdef AX25_HAVE_CLMUL
+static unsigned long long AX25_crcFoldConstant(unsigned int exponent) {
+  unsigned long remainder = 1;
+  unsigned long long constant = 0;
+  unsigned int i;
+
+  for(i=0; i<exponent; i++) {
+    remainder <<= 1;
+    if(remainder & 0x10000) remainder ^= 0x11021;
+  }
+
+  // Mirror the remainder in a 64-bit word (x^d goes to bit 63-d).
+  for(i=0; i<16; i++) {
+    if(remainder & (1UL << i)) constant |= 1ULL << (63 - i);
+  }
+  return constant;
+}
+#endif
+
+/*--------------------------------------------------------------------------*
+ * Building of the lookup tables and selection of the fastest engine
+ * supported by the host. Done once, by AX25_crcInitEngine.
+ *--------------------------------------------------------------------------*/
+static void AX25_crcBuildTables(void) {
+  unsigned int i, j;
+  unsigned short crc;
+
+  // Byte table : register contribution of a byte with a null register.
+  for(i=0; i<256; i++) {
+    crc = (unsigned short) i;
+    for(j=0; j<8; j++) {
+      if(crc & 0x0001) crc = (crc >> 1) ^ 0x8408;  // Mirrored polynom.
+      else crc >>= 1;
+    }
+    crcTable[0][i] = crc;
+  }
+
+  // Slicing tables : contribution of a byte followed by j null bytes.
+  for(i=0; i<256; i++) {
+    for(j=1; j<8; j++) {
+      crc = crcTable[j-1][i];
+      crcTable[j][i] = (crc >> 8) ^ crcTable[0][crc & 0xFF];
+    }
+  }
+
+  // Syndrome tables : register left (XOR AX25_CRC_GOOD) by a wrong bit at
+  // a distance d from the end of the frame, and by a wrong bit on the air,
+  // which the descrambler and the NRZI decoder turn into six wrong bits
+  // (0, 1, 12, 13, 17 and 18 bits after it). The CRC is linear, so the
+  // syndrome does not depend on the content of the frame.
+  for(i=0; i<65536; i++) {
+    crcBitTable[i] = AX25_CRC_NO_BIT;
+    crcLineTable[i] = AX25_CRC_NO_BIT;
+  }
+  crc = 0x8408;
+  for(i=0; i<AX25_CRC_MAX_BITS; i++) {
+    crcSyndrome[i] = crc;
+    crcBitTable[crc] = (unsigned short) i;
+    if(crc & 0x0001) crc = (crc >> 1) ^ 0x8408;
+    else crc >>= 1;
+  }
+  for(i=18; i<AX25_CRC_MAX_BITS; i++) {
+    crc = crcSyndrome[i] ^ crcSyndrome[i-1] ^ crcSyndrome[i-12] ^ crcSyndrome[i-13]
+        ^ crcSyndrome[i-17] ^ crcSyndrome[i-18];
+    crcLineSyndrome[i] = crc;
+    crcLineTable[crc] = (unsigned short) i;
+  }
+
+  crcClmulSupported = 0;
+#ifdef AX25_HAVE_CLMUL
+  // Folding by n bits : the low half is multiplied by x^(n+63) and the
+  // high half by x^(n-1) (the extra x comes from the mirrored product).
+  for(i=0; i<4; i++) {
+    crcFold[i][0] = AX25_crcFoldConstant(128 * (i + 1) + 63);
+    crcFold[i][1] = AX25_crcFoldConstant(128 * (i + 1) - 1);
+  }
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+    crcClmulSupported = 1;
+  }
+#endif
+
+  crcEngine = crcClmulSupported ? AX25_CRC_CLMUL : AX25_CRC_SLICE8;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the FCS engines. It is called on the first FCS
+ * computation and may be called from several threads at once : the tables
+ * are built by the first caller, the others wait for them.
+ *--------------------------------------------------------------------------*/
+void AX25_crcInitEngine(void) {
+  pthread_once(&crcOnce, AX25_crcBuildTables);
+}
+
+/*--------------------------------------------------------------------------*
+ * Selection of the FCS engine used by AX25_crcUpdate.
+ *
+ * PARAMETER:
+ * engine        AX25_CRC_BITWISE, AX25_CRC_TABLE, AX25_CRC_SLICE8 or
+ *               AX25_CRC_CLMUL.
+ *
+ * RETURNS:
+ * 1             if the engine is selected.
+ * 0             if the engine is not supported by the host.
+ *--------------------------------------------------------------------------*/
+char AX25_crcSetEngine(unsigned char engine) {
+  AX25_crcInitEngine();
+  if(engine > AX25_CRC_CLMUL) return 0;
+  if(engine == AX25_CRC_CLMUL && !crcClmulSupported) return 0;
+  crcEngine = engine;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * RETURN:
+ * the engine currently used by AX25_crcUpdate.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_crcGetEngine(void) {
+  AX25_crcInitEngine();
+  return crcEngine;
+}
+
+/*--------------------------------------------------------------------------*
+ * Incremental FCS calculation. The register is initialized with
+ * AX25_crcInit, updated with every piece of the frame (address, control,
+ * PID and info fields, flags excluded) and closed with AX25_crcFinal.
+ *--------------------------------------------------------------------------*/
+unsigned short AX25_crcInit(void) {
+  return AX25_CRC_INIT;
+}
+
+unsigned short AX25_crcFinal(unsigned short crc) {
+  return crc ^ 0xFFFF;  // Final XOR.
+}
+
+/*--------------------------------------------------------------------------*
+ * Update of the FCS register with the selected engine.
+ *
+ * PARAMETERS:
+ * crc           current value of the register.
+ * *data         pointer of the bytes to add.
+ * length        number of bytes.
+ *
+ * RETURN:
+ * the new value of the register.
+ *--------------------------------------------------------------------------*/
+unsigned short AX25_crcUpdate(unsigned short crc, const void *data, unsigned int length) {
+  AX25_crcInitEngine();
+
+  switch(crcEngine) {
+    case AX25_CRC_BITWISE: return AX25_crcUpdateBitwise(crc, data, length);
+    case AX25_CRC_TABLE:   return AX25_crcUpdateTable(crc, data, length);
+    case AX25_CRC_CLMUL:   return AX25_crcUpdateClmul(crc, data, length);
+    default:               return AX25_crcUpdateSlice8(crc, data, length);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * FCS engine : bitwise method.
+ * CRC-16-CCITT G(x) = x16 + x12 + x5 + 1.
+ * Polynom = 0x1021.
+ *--------------------------------------------------------------------------*/
+unsigned short AX25_crcUpdateBitwise(unsigned short crc, const void *data, unsigned int length) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  unsigned int i, j;
+  unsigned short shiftRegister, outBit;
+  unsigned char byte;
+
+  shiftRegister = crc;
+
+  for(i=0; i<length; i++) {
+    byte = bytes[i];
+
+    for(j=0; j<8; j++) {
+      outBit = shiftRegister & 0x0001;
+      shiftRegister >>= 0x01;  // Shift the register to the right.
+
+      if(outBit != (byte & 0x01)) {
+        shiftRegister ^= 0x8408;  // Mirrored polynom.
+      }
+      byte >>= 0x01;
+    }
+  }
+  return shiftRegister;
+}
+
+/*--------------------------------------------------------------------------*
+ * FCS engine : one table lookup per byte.
+ *--------------------------------------------------------------------------*/
+unsigned short AX25_crcUpdateTable(unsigned short crc, const void *data, unsigned int length) {
+  const unsigned char *bytes = (const unsigned char *) data;
+
+  AX25_crcInitEngine();
+
+  while(length--) {
+    crc = (crc >> 8) ^ crcTable[0][(crc ^ *bytes++) & 0xFF];
+  }
+  return crc;
+}
+
+/*--------------------------------------------------------------------------*
+ * FCS engine : slicing-by-8. The 16-bit register only overlaps the first
+ * two bytes of each block of eight, the six others are looked up directly.
+ *--------------------------------------------------------------------------*/
+unsigned short AX25_crcUpdateSlice8(unsigned short crc, const void *data, unsigned int length) {
+  const unsigned char *bytes = (const unsigned char *) data;
+
+  AX25_crcInitEngine();
+
+  while(length >= 8) {
+    crc = crcTable[7][(bytes[0] ^ crc) & 0xFF] ^
+          crcTable[6][(bytes[1] ^ (crc >> 8)) & 0xFF] ^
+          crcTable[5][bytes[2]] ^ crcTable[4][bytes[3]] ^
+          crcTable[3][bytes[4]] ^ crcTable[2][bytes[5]] ^
+          crcTable[1][bytes[6]] ^ crcTable[0][bytes[7]];
+    bytes += 8;
+    length -= 8;
+  }
+  while(length--) {
+    crc = (crc >> 8) ^ crcTable[0][(crc ^ *bytes++) & 0xFF];
+  }
+  return crc;
+}
+
+/*--------------------------------------------------------------------------*
+ * FCS engine : carry-less multiplication folding. Four 128-bit
+ * accumulators are folded 512 bits ahead, merged, and the remaining
+ * 16 bytes are reduced with the byte table. Short buffers and hosts
+ * without PCLMULQDQ use slicing-by-8.
+ *--------------------------------------------------------------------------*/
+#ifdef AX25_HAVE_CLMUL
+__attribute__((target("pclmul,sse4.1")))
+static __m128i AX25_crcFold(__m128i value, unsigned int distance) {
+  __m128i k = _mm_set_epi64x((long long) crcFold[distance][1],
+                             (long long) crcFold[distance][0]);
+  return _mm_xor_si128(_mm_clmulepi64_si128(value, k, 0x00),
+                       _mm_clmulepi64_si128(value, k, 0x11));
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static unsigned short AX25_crcClmulBlocks(unsigned short crc, const unsigned char *bytes, unsigned int length) {
+  __m128i x0, x1, x2, x3;
+  unsigned char rest[16];
+
+  x0 = _mm_loadu_si128((const __m128i *) (bytes));
+  x1 = _mm_loadu_si128((const __m128i *) (bytes + 16));
+  x2 = _mm_loadu_si128((const __m128i *) (bytes + 32));
+  x3 = _mm_loadu_si128((const __m128i *) (bytes + 48));
+  x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128(crc));  // Inject the register.
+  bytes += 64;
+  length -= 64;
+
+  while(length >= 64) {
+    x0 = _mm_xor_si128(AX25_crcFold(x0, 3), _mm_loadu_si128((const __m128i *) (bytes)));
+    x1 = _mm_xor_si128(AX25_crcFold(x1, 3), _mm_loadu_si128((const __m128i *) (bytes + 16)));
+    x2 = _mm_xor_si128(AX25_crcFold(x2, 3), _mm_loadu_si128((const __m128i *) (bytes + 32)));
+    x3 = _mm_xor_si128(AX25_crcFold(x3, 3), _mm_loadu_si128((const __m128i *) (bytes + 48)));
+    bytes += 64;
+    length -= 64;
+  }
+
+  // Merge the four accumulators.
+  x0 = _mm_xor_si128(_mm_xor_si128(AX25_crcFold(x0, 2), AX25_crcFold(x1, 1)),
+                     _mm_xor_si128(AX25_crcFold(x2, 0), x3));
+
+  while(length >= 16) {
+    x0 = _mm_xor_si128(AX25_crcFold(x0, 0), _mm_loadu_si128((const __m128i *) bytes));
+    bytes += 16;
+    length -= 16;
+  }
+
+  // The accumulator is congruent to the message : reduce it from a null
+  // register and go on with the tail.
+  _mm_storeu_si128((__m128i *) rest, x0);
+  crc = AX25_crcUpdateSlice8(0, rest, 16);
+  return AX25_crcUpdateSlice8(crc, bytes, length);
+}
+#endif
+
+unsigned short AX25_crcUpdateClmul(unsigned short crc, const void *data, unsigned int length) {
+  AX25_crcInitEngine();
+
+#ifdef AX25_HAVE_CLMUL
+  if(crcClmulSupported && length >= 64) {
+    return AX25_crcClmulBlocks(crc, (const unsigned char *) data, length);
+  }
+#endif
+  return AX25_crcUpdateSlice8(crc, data, length);
+}
+
+/*--------------------------------------------------------------------------*
+ * AX.25 FCS calculation on a whole frame buffer (flags included).
+ *
+ * PARAMETERS:
+ * *buffer       pointer of the frame buffer.
+ * size_frame    length of the frame (in bytes).
+ *
+ * RETURN:
+ * the CRC with a final XORed operation.
+ *--------------------------------------------------------------------------*/
+unsigned short AX25_computeCRC(char *buffer, unsigned short size_frame) {
+  // The first flag, the last flag and the 2 bytes for FCS are removed.
+  return AX25_crcFinal(AX25_crcUpdate(AX25_CRC_INIT, buffer + 1, size_frame - 4));
+}
+
+/*--------------------------------------------------------------------------*
+ * AX.25 FCS positioning.
+ * Put the FCS in the right place in the frame. The FCS is sent MSB first
+ * so we prepare the 15th bit of the CRC to be sent first.
+ *
+ * PARAMETERS:
+ * *frame        pointer of the frame buffer.
+ * size_frame    length of the frame (in bytes).
+ *--------------------------------------------------------------------------*/
+void AX25_putCRC(char *frame, unsigned short size_frame) {
+  unsigned short crc;
+
+  // FCS calculation.
+  crc = AX25_computeCRC(frame, size_frame);
+
+  // Put the FCS in the right place with the 15th bit to be sent first.
+  frame[size_frame - 3] = (crc & 0xff);
+  frame[size_frame - 2] = ((crc >> 8) & 0xff);
+}
+
+/*--------------------------------------------------------------------------*
+ * Check of a received frame (flags included), with correction of the
+ * wrong bits. See AX25_crcCorrect.
+ *
+ * PARAMETERS:
+ * *buffer       pointer of the frame buffer.
+ * size_frame    length of the frame (in bytes).
+ * maxErrors     max number of wrong bits on the air to correct (0 to 2, 2
+ *               for the short frames only).
+ *
+ * RETURN:
+ * the number of corrected bits (0 if the FCS matches), or
+ * AX25_CRC_UNCORRECTABLE.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_checkFrame(char *buffer, unsigned short size_frame, unsigned char maxErrors) {
+  if(size_frame < 4) return AX25_CRC_UNCORRECTABLE;
+  return AX25_crcCorrect(buffer + 1, size_frame - 2, maxErrors);
+}
+
+/*--------------------------------------------------------------------------*
+ * Inversion of the bits of a wrong pattern. The pattern is one bit, or the
+ * six bits of a wrong bit on the air (line), starting at a distance from
+ * the end of the frame.
+ *--------------------------------------------------------------------------*/
+static void AX25_crcFlip(unsigned char *bytes, unsigned int nbBits, unsigned int distance, char line) {
+  static const unsigned char linePattern[6] = {0, 1, 12, 13, 17, 18};
+  unsigned int i, position;
+
+  for(i=0; i<(line ? 6U : 1U); i++) {
+    position = nbBits - 1 - (distance - linePattern[i]);
+    bytes[position >> 3] ^= (unsigned char) (1 << (position & 7));
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Search of five consecutive ones around a wrong pattern. The bits of a
+ * frame are destuffed before the FCS check : the correction is only valid
+ * if no stuffed bit was inserted or removed around the wrong bits, neither
+ * in the received frame nor in the corrected one.
+ *--------------------------------------------------------------------------*/
+static char AX25_crcNearStuffing(const unsigned char *bytes, unsigned int nbBits, unsigned int distance, char line) {
+  unsigned int first, last, position, ones = 0;
+
+  last = nbBits - 1 - (line ? distance - 18 : distance);
+  first = nbBits - 1 - distance;
+  first = (first > 4) ? first - 4 : 0;
+  last = (last + 4 < nbBits) ? last + 4 : nbBits - 1;
+
+  for(position=first; position<=last; position++) {
+    if((bytes[position >> 3] >> (position & 7)) & 1) {
+      if(++ones == 5) return 1;
+    }
+    else ones = 0;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Correction of a received frame with its FCS syndrome. The syndrome of a
+ * single wrong bit, or of a single wrong bit on the air, is looked up in
+ * the syndrome tables. Two wrong bits on the air are searched by trying
+ * the first one at every distance and looking the second one up : the
+ * correction is refused if several pairs match. A 16 bits FCS cannot tell
+ * all the patterns apart, so a corrected frame is less certain than a
+ * frame with a matching FCS. The generator and the pattern of a wrong bit
+ * on the air are both multiples of x + 1, so the wrong bits on the air
+ * only reach 32768 syndromes, and a frame of n bits has about n * n / 2
+ * pairs : in a long frame, most syndromes of three wrong bits or more
+ * would match a pair. Two wrong bits are thus only searched in the frames
+ * with at most AX25_CRC_MAX_PAIRS pairs (18 bytes : S and U frames
+ * without digipeaters).
+ *
+ * PARAMETERS:
+ * *frame        pointer of the frame (flags excluded, FCS included).
+ * length        length of the frame (in bytes).
+ * maxErrors     max number of wrong bits on the air to correct (0 to 2, 2
+ *               for the short frames only).
+ *
+ * RETURN:
+ * the number of corrected bits (0 if the FCS matches), or
+ * AX25_CRC_UNCORRECTABLE.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_crcCorrect(char *frame, unsigned int length, unsigned char maxErrors) {
+  unsigned char *bytes = (unsigned char *) frame;
+  unsigned int nbBits = 8 * length, bit, line, first = 0, second = 0, found = 0;
+  unsigned short syndrome;
+
+  syndrome = AX25_crcUpdate(AX25_CRC_INIT, frame, length) ^ AX25_CRC_GOOD;
+  if(!syndrome) return 0;
+  if(!maxErrors || nbBits > AX25_CRC_MAX_BITS) return AX25_CRC_UNCORRECTABLE;
+
+  // One wrong bit, or one wrong bit on the air.
+  bit = crcBitTable[syndrome];
+  line = crcLineTable[syndrome];
+  if(bit < nbBits && line < nbBits) return AX25_CRC_UNCORRECTABLE;  // Ambiguous.
+  if(bit < nbBits || line < nbBits) {
+    first = (bit < nbBits) ? bit : line;
+    if(AX25_crcNearStuffing(bytes, nbBits, first, line < nbBits)) return AX25_CRC_UNCORRECTABLE;
+    AX25_crcFlip(bytes, nbBits, first, line < nbBits);
+    if(AX25_crcNearStuffing(bytes, nbBits, first, line < nbBits)) {
+      AX25_crcFlip(bytes, nbBits, first, line < nbBits);
+      return AX25_CRC_UNCORRECTABLE;
+    }
+    return 1;
+  }
+  if(maxErrors < 2 || nbBits < 20 || (nbBits - 18) * (nbBits - 19) / 2 > AX25_CRC_MAX_PAIRS) {
+    return AX25_CRC_UNCORRECTABLE;
+  }
+
+  // Two wrong bits on the air, at the distances 18 to nbBits - 1.
+  for(line=19; line<nbBits; line++) {
+    bit = crcLineTable[syndrome ^ crcLineSyndrome[line]];
+    if(bit < line) {
+      if(found++) return AX25_CRC_UNCORRECTABLE;  // Ambiguous.
+      first = line;
+      second = bit;
+    }
+  }
+  if(!found || AX25_crcNearStuffing(bytes, nbBits, first, 1) || AX25_crcNearStuffing(bytes, nbBits, second, 1)) {
+    return AX25_CRC_UNCORRECTABLE;
+  }
+  AX25_crcFlip(bytes, nbBits, first, 1);
+  AX25_crcFlip(bytes, nbBits, second, 1);
+  if(AX25_crcNearStuffing(bytes, nbBits, first, 1) || AX25_crcNearStuffing(bytes, nbBits, second, 1)) {
+    AX25_crcFlip(bytes, nbBits, first, 1);
+    AX25_crcFlip(bytes, nbBits, second, 1);
+    return AX25_CRC_UNCORRECTABLE;
+  }
+  return 2;
+}
+
+/*--------------------------------------------------------------------------*
+ * Self-check of the FCS engines. Every available engine is compared with
+ * the bitwise method on pseudo-random buffers of 0 to 1100 bytes, split in
+ * two incremental updates, and the check value of "123456789" is verified.
+ *
+ * RETURNS:
+ * 1             if all the engines agree.
+ * 0             otherwise.
+ *--------------------------------------------------------------------------*/
+char AX25_crcSelfTest(void) {
+  static unsigned char buffer[1100];
+  unsigned long seed = 0x12345678;
+  unsigned int i, length, split;
+  unsigned short reference, crc;
+
+  AX25_crcInitEngine();
+
+  if(AX25_crcFinal(AX25_crcUpdateBitwise(AX25_CRC_INIT, "123456789", 9)) != 0x906E) {
+    return 0;
+  }
+
+  for(i=0; i<sizeof(buffer); i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    buffer[i] = (unsigned char) (seed >> 16);
+  }
+
+  for(length=0; length<=sizeof(buffer); length += (length < 200) ? 1 : 37) {
+    split = length / 3;
+    reference = AX25_crcUpdateBitwise(AX25_CRC_INIT, buffer, length);
+
+    crc = AX25_crcUpdateTable(AX25_crcUpdateTable(AX25_CRC_INIT, buffer, split),
+                              buffer + split, length - split);
+    if(crc != reference) return 0;
+
+    crc = AX25_crcUpdateSlice8(AX25_crcUpdateSlice8(AX25_CRC_INIT, buffer, split),
+                               buffer + split, length - split);
+    if(crc != reference) return 0;
+
+    crc = AX25_crcUpdateClmul(AX25_crcUpdateClmul(AX25_CRC_INIT, buffer, split),
+                              buffer + split, length - split);
+    if(crc != reference) return 0;
+  }
+  return 1;
+}
@@ -1,7 +1,39 @@
-#ifndef AX25_CRC_H
-#define AX25_CRC_H
-
-unsigned short AX25_computeCRC(char *buffer, unsigned short size_frame);
-void AX25_putCRC(char *frame, unsigned short size_frame);
-
-#endif /* AX25_CRC_H */
+#ifndef AX25_CRC_H
+#define AX25_CRC_H
+
+// FCS specifications
+#define AX25_CRC_INIT        0xFFFF  // Initial value of the shift register.
+#define AX25_CRC_GOOD        0xF0B8  // Register value after a frame and its FCS.
+
+// FCS engines
+#define AX25_CRC_BITWISE     0x00  // Bit by bit (reference implementation).
+#define AX25_CRC_TABLE       0x01  // One 256-entry table lookup per byte.
+#define AX25_CRC_SLICE8      0x02  // Slicing-by-8, eight bytes per step.
+#define AX25_CRC_CLMUL       0x03  // Carry-less multiply folding (x86 PCLMULQDQ).
+
+// FCS correction
+#define AX25_CRC_UNCORRECTABLE 0xFF  // The frame cannot be corrected.
+
+// Frame status
+#define AX25_FRAME_FCS_BAD   0x00  // The FCS does not match.
+#define AX25_FRAME_FCS_OK    0x01  // The FCS matches.
+#define AX25_FRAME_FCS_FIXED 0x02  // The FCS matches after correction of wrong bits.
+
+unsigned short AX25_computeCRC(char *buffer, unsigned short size_frame);
+void AX25_putCRC(char *frame, unsigned short size_frame);
+unsigned char AX25_checkFrame(char *buffer, unsigned short size_frame, unsigned char maxErrors);
+
+void AX25_crcInitEngine(void);
+char AX25_crcSetEngine(unsigned char engine);
+unsigned char AX25_crcGetEngine(void);
+unsigned short AX25_crcInit(void);
+unsigned short AX25_crcUpdate(unsigned short crc, const void *data, unsigned int length);
+unsigned short AX25_crcFinal(unsigned short crc);
+unsigned short AX25_crcUpdateBitwise(unsigned short crc, const void *data, unsigned int length);
+unsigned short AX25_crcUpdateTable(unsigned short crc, const void *data, unsigned int length);
+unsigned short AX25_crcUpdateSlice8(unsigned short crc, const void *data, unsigned int length);
+unsigned short AX25_crcUpdateClmul(unsigned short crc, const void *data, unsigned int length);
+unsigned char AX25_crcCorrect(char *frame, unsigned int length, unsigned char maxErrors);
+char AX25_crcSelfTest(void);
+
+#endif /* AX25_CRC_H */
@@ -0,0 +1,320 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Capture.c
+ * Parallel decoding of raw bit captures. The descrambler synchronizes
+ * itself after 17 bits and the flags delimit the frames, so a capture can
+ * be cut in chunks decoded independently : every chunk starts to decode
+ * AX25_CAPTURE_OVERLAP bytes before its beginning, which is enough for
+ * the descrambler and for a whole frame, and keeps the frames whose end
+ * flag lies in the chunk. Every frame is thus kept once, by the chunk
+ * which would have seen it in a single pass.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AX25_Capture.h"
+#include "AX25_CRC.h"
+#include "AX25_RS.h"
+#include "AX25_Stream.h"
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the chunk structures. The frames of a chunk are copied
+ * in its arena, and only linked to it when all chunks are decoded.
+ *--------------------------------------------------------------------------*/
+typedef struct {
+  unsigned long long bitOffset;
+  unsigned int lengthFrame;
+  unsigned char status;
+  size_t offset;                 // Position of the frame in the arena.
+} AX25_CaptureEntry;
+
+struct AX25_CaptureChunk {
+  size_t start, end;             // Bytes of the capture owned by the chunk.
+  AX25_CaptureEntry *entries;
+  unsigned long nbEntries, maxEntries;
+  char *arena;
+  size_t arenaSize, arenaMax;
+  unsigned char failed;          // Out of memory.
+};
+
+typedef struct {
+  AX25_Capture *capture;
+  atomic_uint next;              // Next chunk to decode.
+} AX25_CaptureJob;
+
+/*--------------------------------------------------------------------------*
+ * Opening of a capture : the file is mapped in memory.
+ *
+ * PARAMETERS:
+ * *capture      pointer of the capture.
+ * *path         path of the capture file.
+ *
+ * RETURNS:
+ * 1             if the capture is ready.
+ * 0             if the file cannot be opened or mapped.
+ *--------------------------------------------------------------------------*/
+char AX25_captureOpen(AX25_Capture *capture, const char *path) {
+  struct stat st;
+  int fd;
+
+  memset(capture, 0, sizeof(*capture));
+  fd = open(path, O_RDONLY);
+  if(fd < 0) return 0;
+  if(fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return 0;
+  }
+
+  if(st.st_size > 0) {
+    capture->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(capture->map == MAP_FAILED) {
+      capture->map = NULL;
+      close(fd);
+      return 0;
+    }
+    capture->size = st.st_size;
+    madvise(capture->map, capture->size, MADV_SEQUENTIAL);
+  }
+  close(fd);  // The mapping stays valid.
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Copy of a frame of the ring in the chunk.
+ *--------------------------------------------------------------------------*/
+static char AX25_captureAppend(AX25_CaptureChunk *chunk, const AX25_FrameSlot *slot) {
+  AX25_CaptureEntry *entry;
+  void *p;
+
+  if(chunk->nbEntries == chunk->maxEntries) {
+    p = realloc(chunk->entries, (chunk->maxEntries ? 2 * chunk->maxEntries : 64) * sizeof(AX25_CaptureEntry));
+    if(!p) return 0;
+    chunk->entries = (AX25_CaptureEntry *) p;
+    chunk->maxEntries = chunk->maxEntries ? 2 * chunk->maxEntries : 64;
+  }
+  if(chunk->arenaSize + slot->lengthFrame > chunk->arenaMax) {
+    p = realloc(chunk->arena, chunk->arenaMax ? 2 * chunk->arenaMax : 64 * AX25_FRAME_MAX_SIZE);
+    if(!p) return 0;
+    chunk->arena = (char *) p;
+    chunk->arenaMax = chunk->arenaMax ? 2 * chunk->arenaMax : 64 * AX25_FRAME_MAX_SIZE;
+  }
+
+  entry = &chunk->entries[chunk->nbEntries++];
+  entry->bitOffset = slot->bitOffset;
+  entry->lengthFrame = slot->lengthFrame;
+  entry->status = slot->status;
+  entry->offset = chunk->arenaSize;
+  memcpy(chunk->arena + chunk->arenaSize, slot->frame, slot->lengthFrame);
+  chunk->arenaSize += slot->lengthFrame;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of a chunk. The receiver counts its bits from the beginning of
+ * the capture, so the position of the frames is absolute. The bits are
+ * given in pieces too short to fill the ring.
+ *--------------------------------------------------------------------------*/
+static void AX25_captureChunk(const AX25_Capture *capture, AX25_CaptureChunk *chunk) {
+  AX25_FrameSlot slots[AX25_CAPTURE_RING_SIZE];
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  size_t position, last, n;
+
+  // A chunk decodes past its end the longest FX.25 codeword (tag
+  // included), to complete the codewords which hold its last frames.
+  last = chunk->end;
+  if(capture->fx25) last = (capture->size - last > 8 + AX25_RS_SIZE) ? last + 8 + AX25_RS_SIZE : capture->size;
+
+  position = (chunk->start > AX25_CAPTURE_OVERLAP) ? chunk->start - AX25_CAPTURE_OVERLAP : 0;
+  AX25_ringInit(&ring, slots, AX25_CAPTURE_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetCorrection(&stream, capture->correction);
+  AX25_rxStreamSetFx25(&stream, capture->fx25);
+  stream.nbBits = 8ULL * position;
+
+  while(position < last) {
+    // A frame takes at least AX25_FRAME_MIN_SIZE - 1 bytes (shared flags).
+    n = (AX25_FRAME_MIN_SIZE - 1) * (AX25_CAPTURE_RING_SIZE - 2);
+    if(n > last - position) n = last - position;
+    AX25_rxStreamBits(&stream, capture->map + position, 8UL * n);
+    position += n;
+
+    while((slot = AX25_ringPeek(&ring)) != NULL) {
+      if(slot->bitOffset > 8ULL * chunk->start && slot->bitOffset <= 8ULL * chunk->end && !chunk->failed) {
+        if(!AX25_captureAppend(chunk, slot)) chunk->failed = 1;
+      }
+      AX25_ringRelease(&ring);
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Worker thread : decodes the next chunk until none is left.
+ *--------------------------------------------------------------------------*/
+static void *AX25_captureWorker(void *arg) {
+  AX25_CaptureJob *job = (AX25_CaptureJob *) arg;
+  unsigned int i;
+
+  while((i = atomic_fetch_add(&job->next, 1)) < job->capture->nbChunks) {
+    AX25_captureChunk(job->capture, &job->capture->chunks[i]);
+  }
+  return NULL;
+}
+
+/*--------------------------------------------------------------------------*
+ * Release of the index of a capture.
+ *--------------------------------------------------------------------------*/
+static void AX25_captureFreeIndex(AX25_Capture *capture) {
+  unsigned int i;
+
+  for(i=0; i<capture->nbChunks; i++) {
+    free(capture->chunks[i].entries);
+    free(capture->chunks[i].arena);
+  }
+  free(capture->chunks);
+  free(capture->frames);
+  capture->chunks = NULL;
+  capture->nbChunks = 0;
+  capture->frames = NULL;
+  capture->nbFrames = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of a capture. The capture is cut in chunks (at least 4 per
+ * thread, for the balance of the load) decoded in parallel, then the
+ * frames of the chunks are gathered in capture->frames, in the order of
+ * the capture.
+ *
+ * PARAMETERS:
+ * *capture      pointer of the capture.
+ * nbThreads     number of threads (0 : one per processor).
+ *
+ * RETURNS:
+ * 1             if the capture is decoded.
+ * 0             if the memory is insufficient.
+ *--------------------------------------------------------------------------*/
+char AX25_captureDecode(AX25_Capture *capture, unsigned int nbThreads) {
+  pthread_t threads[AX25_CAPTURE_MAX_THREADS];
+  AX25_CaptureJob job;
+  AX25_CaptureChunk *chunk;
+  size_t chunkSize;
+  unsigned long k;
+  unsigned int i, nbStarted;
+  long nbProcessors;
+
+  AX25_captureFreeIndex(capture);
+  if(!nbThreads) {
+    nbProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    nbThreads = (nbProcessors > 0) ? (unsigned int) nbProcessors : 1;
+  }
+  if(nbThreads > AX25_CAPTURE_MAX_THREADS) nbThreads = AX25_CAPTURE_MAX_THREADS;
+
+  chunkSize = (capture->size + 4 * nbThreads - 1) / (4 * nbThreads);
+  if(chunkSize < AX25_CAPTURE_MIN_CHUNK) chunkSize = AX25_CAPTURE_MIN_CHUNK;
+  capture->nbChunks = (unsigned int) ((capture->size + chunkSize - 1) / chunkSize);
+  capture->chunks = (AX25_CaptureChunk *) calloc(capture->nbChunks ? capture->nbChunks : 1, sizeof(AX25_CaptureChunk));
+  if(!capture->chunks) {
+    capture->nbChunks = 0;
+    return 0;
+  }
+  for(i=0; i<capture->nbChunks; i++) {
+    capture->chunks[i].start = i * chunkSize;
+    capture->chunks[i].end = (i + 1 == capture->nbChunks) ? capture->size : (i + 1) * chunkSize;
+  }
+
+  // The shared tables are built now rather than by the first frame of a worker.
+  AX25_crcInitEngine();
+  AX25_rsInit();
+
+  // The calling thread is one of the workers.
+  job.capture = capture;
+  atomic_init(&job.next, 0);
+  if(nbThreads > capture->nbChunks) nbThreads = capture->nbChunks ? capture->nbChunks : 1;
+  for(nbStarted=0; nbStarted+1<nbThreads; nbStarted++) {
+    if(pthread_create(&threads[nbStarted], NULL, AX25_captureWorker, &job)) break;
+  }
+  AX25_captureWorker(&job);
+  for(i=0; i<nbStarted; i++) pthread_join(threads[i], NULL);
+
+  // Gathering of the frames.
+  for(i=0; i<capture->nbChunks; i++) {
+    if(capture->chunks[i].failed) {
+      AX25_captureFreeIndex(capture);
+      return 0;
+    }
+    capture->nbFrames += capture->chunks[i].nbEntries;
+  }
+  capture->frames = (AX25_CaptureFrame *) malloc((capture->nbFrames ? capture->nbFrames : 1) * sizeof(AX25_CaptureFrame));
+  if(!capture->frames) {
+    AX25_captureFreeIndex(capture);
+    return 0;
+  }
+  capture->nbFrames = 0;
+  for(i=0; i<capture->nbChunks; i++) {
+    chunk = &capture->chunks[i];
+    for(k=0; k<chunk->nbEntries; k++) {
+      capture->frames[capture->nbFrames].bitOffset = chunk->entries[k].bitOffset;
+      capture->frames[capture->nbFrames].lengthFrame = chunk->entries[k].lengthFrame;
+      capture->frames[capture->nbFrames].status = chunk->entries[k].status;
+      capture->frames[capture->nbFrames].frame = chunk->arena + chunk->entries[k].offset;
+      capture->nbFrames++;
+    }
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Writing of the index of a decoded capture in a text file, one line per
+ * frame in the order of the capture : bit offset of the end flag, length
+ * (flags and FCS included) and FCS status (OK, FIX or BAD). The index is
+ * enough to extract a frame from the capture again without decoding it.
+ *
+ * PARAMETERS:
+ * *capture      pointer of the decoded capture.
+ * *path         path of the index file.
+ *
+ * RETURNS:
+ * 1             if the index is written.
+ * 0             if the file cannot be written.
+ *--------------------------------------------------------------------------*/
+char AX25_captureWriteIndex(const AX25_Capture *capture, const char *path) {
+  const AX25_CaptureFrame *frame;
+  unsigned long i;
+  FILE *file;
+  char ok;
+
+  file = fopen(path, "w");
+  if(!file) return 0;
+  for(i=0; i<capture->nbFrames; i++) {
+    frame = &capture->frames[i];
+    fprintf(file, "%llu %u %s\n", frame->bitOffset, frame->lengthFrame,
+            frame->status == AX25_FRAME_FCS_OK ? "OK" : frame->status == AX25_FRAME_FCS_FIXED ? "FIX" : "BAD");
+  }
+  ok = !ferror(file);
+  if(fclose(file)) ok = 0;
+  return ok;
+}
+
+/*--------------------------------------------------------------------------*
+ * Closing of a capture : the index and the mapping are released.
+ *
+ * PARAMETER:
+ * *capture      pointer of the capture.
+ *--------------------------------------------------------------------------*/
+void AX25_captureClose(AX25_Capture *capture) {
+  AX25_captureFreeIndex(capture);
+  if(capture->map) munmap(capture->map, capture->size);
+  capture->map = NULL;
+  capture->size = 0;
+}
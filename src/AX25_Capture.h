@@ -0,0 +1,43 @@
+#ifndef AX25_CAPTURE_H
+#define AX25_CAPTURE_H
+
+#include <stddef.h>
+
+#include "AX25_Rx.h"
+
+// Specifications
+#define AX25_CAPTURE_MAX_THREADS 64
+#define AX25_CAPTURE_MIN_CHUNK   (1UL << 20)  // Min bytes of capture per chunk.
+#define AX25_CAPTURE_OVERLAP     (2 * AX25_FRAME_MAX_SIZE)  // Bytes decoded before a chunk.
+#define AX25_CAPTURE_RING_SIZE   64
+
+// Frame found in a capture. The frame includes the flags and the FCS.
+typedef struct {
+  unsigned long long bitOffset;  // Position of the end flag in the capture.
+  unsigned int lengthFrame;
+  unsigned char status;          // AX25_FRAME_FCS_OK, _FIXED or _BAD.
+  const char *frame;
+} AX25_CaptureFrame;
+
+typedef struct AX25_CaptureChunk AX25_CaptureChunk;
+
+// Raw bit capture (bits from the demodulator, packed LSB first) mapped in
+// memory, and the index of its frames in the order of the capture.
+typedef struct {
+  unsigned char *map;
+  size_t size;                   // Bytes of the capture.
+  unsigned char correction;      // Max wrong bits on the air corrected
+                                 // (set before AX25_captureDecode).
+  unsigned char fx25;            // FX.25 codewords decoded (idem).
+  AX25_CaptureChunk *chunks;
+  unsigned int nbChunks;
+  AX25_CaptureFrame *frames;
+  unsigned long nbFrames;
+} AX25_Capture;
+
+char AX25_captureOpen(AX25_Capture *capture, const char *path);
+char AX25_captureDecode(AX25_Capture *capture, unsigned int nbThreads);
+char AX25_captureWriteIndex(const AX25_Capture *capture, const char *path);
+void AX25_captureClose(AX25_Capture *capture);
+
+#endif /* AX25_CAPTURE_H */
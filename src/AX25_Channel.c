@@ -0,0 +1,187 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Channel.c
+ * Simulated radio channel for the loopback tests of the codec : random
+ * bit errors, bursts of errors, bit slips of the clock recovery and
+ * polarity inversion, applied to a bitstream packed LSB first.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <string.h>
+
+#include "AX25_Channel.h"
+
+#define AX25_CHANNEL_NEVER   (~0ULL >> 1)  // Position of an impairment which never happens.
+
+/*--------------------------------------------------------------------------*
+ * Pseudo-random generator (xorshift64*), private to a channel so that a
+ * run can be reproduced from its seed, whatever the number of threads.
+ *
+ * PARAMETER:
+ * *channel      pointer of the channel.
+ *
+ * RETURN:
+ * 64 random bits.
+ *--------------------------------------------------------------------------*/
+uint64_t AX25_channelRandom(AX25_Channel *channel) {
+  channel->random ^= channel->random >> 12;
+  channel->random ^= channel->random << 25;
+  channel->random ^= channel->random >> 27;
+  return channel->random * 0x2545F4914F6CDD1DULL;
+}
+
+/*--------------------------------------------------------------------------*
+ * Number of bits before the next impairment of probability p per bit
+ * (geometric distribution).
+ *--------------------------------------------------------------------------*/
+static unsigned long long AX25_channelGap(AX25_Channel *channel, double p) {
+  double u, gap;
+
+  if(p <= 0) return AX25_CHANNEL_NEVER;
+  if(p >= 1) return 0;
+  u = ((AX25_channelRandom(channel) >> 11) + 1) * (1.0 / 9007199254740992.0);  // ]0, 1]
+  gap = log(u) / log1p(-p);
+  return (gap >= 1e18) ? AX25_CHANNEL_NEVER : (unsigned long long) gap;
+}
+
+/*--------------------------------------------------------------------------*
+ * Access to one bit of a packed buffer.
+ *--------------------------------------------------------------------------*/
+static unsigned int AX25_channelGetBit(const unsigned char *bits, unsigned long position) {
+  return (bits[position >> 3] >> (position & 7)) & 1;
+}
+
+static void AX25_channelPutBit(unsigned char *bits, unsigned long position, unsigned int bit) {
+  if(bit) bits[position >> 3] |= (unsigned char) (1 << (position & 7));
+  else bits[position >> 3] &= (unsigned char) ~(1 << (position & 7));
+}
+
+/*--------------------------------------------------------------------------*
+ * Copy of n bits from the input position "from" to the output position
+ * "to" : a byte at a time once the output is aligned.
+ *--------------------------------------------------------------------------*/
+static void AX25_channelCopy(unsigned char *out, unsigned long to, const unsigned char *in,
+                             unsigned long from, unsigned long n) {
+  unsigned int shift;
+
+  while(n && (to & 7)) {
+    AX25_channelPutBit(out, to++, AX25_channelGetBit(in, from++));
+    n--;
+  }
+  shift = from & 7;
+  if(!shift) {
+    memcpy(out + (to >> 3), in + (from >> 3), n >> 3);
+    to += n & ~7UL;
+    from += n & ~7UL;
+    n &= 7;
+  }
+  for(; n>=8; n-=8, to+=8, from+=8) {
+    out[to >> 3] = (unsigned char) ((in[from >> 3] >> shift) | (in[(from >> 3) + 1] << (8 - shift)));
+  }
+  while(n--) AX25_channelPutBit(out, to++, AX25_channelGetBit(in, from++));
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a channel.
+ *
+ * PARAMETERS:
+ * *channel      pointer of the channel.
+ * *params       pointer of the impairments.
+ * seed          seed of the generator.
+ *--------------------------------------------------------------------------*/
+void AX25_channelInit(AX25_Channel *channel, const AX25_ChannelParams *params, uint64_t seed) {
+  channel->params = *params;
+  channel->random = seed * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+  if(!channel->random) channel->random = 1;
+  channel->nbBitsIn = 0;
+  channel->nbBitsOut = 0;
+  channel->burstLeft = 0;
+  channel->nbErrors = 0;
+  channel->nbBursts = 0;
+  channel->nbSlips = 0;
+  channel->nextError = AX25_channelGap(channel, params->ber);
+  channel->nextBurst = AX25_channelGap(channel, params->burstRate);
+  channel->nextSlip = AX25_channelGap(channel, params->slipRate);
+}
+
+/*--------------------------------------------------------------------------*
+ * Transmission of a block of bits through the channel. The slips change
+ * the number of bits : a lost bit is not copied, a repeated bit is copied
+ * twice (or lost when the output is full).
+ *
+ * PARAMETERS:
+ * *channel      pointer of the channel.
+ * *in           pointer of the bits sent, packed LSB first.
+ * nbBits        number of bits sent.
+ * *out          pointer of the bits received (not the same buffer as in).
+ * maxBits       size of the output (in bits).
+ *
+ * RETURN:
+ * the number of bits received.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_channelBits(AX25_Channel *channel, const unsigned char *in, unsigned long nbBits,
+                               unsigned char *out, unsigned long maxBits) {
+  unsigned long long base;
+  unsigned long i = 0, nbOut = 0, end, n, p;
+  uint64_t random = 0;
+  unsigned int nbRandom = 0;
+
+  // Slips (positions in the input).
+  base = channel->nbBitsIn;
+  for(;;) {
+    end = (channel->nextSlip - base < nbBits) ? (unsigned long) (channel->nextSlip - base) : nbBits;
+    n = end - i;
+    if(n > maxBits - nbOut) n = maxBits - nbOut;
+    AX25_channelCopy(out, nbOut, in, i, n);
+    nbOut += n;
+    i += n;
+    if(i == nbBits || nbOut == maxBits) break;
+    if((AX25_channelRandom(channel) & 1) && nbOut < maxBits) {
+      AX25_channelPutBit(out, nbOut++, AX25_channelGetBit(in, i));  // Repeated.
+    }
+    else i++;  // Lost.
+    channel->nbSlips++;
+    channel->nextSlip += 1 + AX25_channelGap(channel, channel->params.slipRate);
+  }
+  channel->nbBitsIn += nbBits;
+  if(channel->nextSlip < channel->nbBitsIn) {  // Output full : the slip is skipped.
+    channel->nextSlip = channel->nbBitsIn + AX25_channelGap(channel, channel->params.slipRate);
+  }
+
+  // Bursts and errors (positions in the output).
+  base = channel->nbBitsOut;
+  p = 0;
+  for(;;) {
+    for(; channel->burstLeft && p<nbOut; p++, channel->burstLeft--) {
+      if(!nbRandom) {
+        random = AX25_channelRandom(channel);
+        nbRandom = 64;
+      }
+      if(random & 1) {
+        out[p >> 3] ^= (unsigned char) (1 << (p & 7));
+        channel->nbErrors++;
+      }
+      random >>= 1;
+      nbRandom--;
+    }
+    if(channel->nextBurst >= base + nbOut) break;
+    p = (unsigned long) (channel->nextBurst - base);
+    channel->burstLeft = channel->params.burstLength;
+    channel->nbBursts++;
+    channel->nextBurst += (channel->burstLeft ? channel->burstLeft : 1) + AX25_channelGap(channel, channel->params.burstRate);
+  }
+  while(channel->nextError < base + nbOut) {
+    p = (unsigned long) (channel->nextError - base);
+    out[p >> 3] ^= (unsigned char) (1 << (p & 7));
+    channel->nbErrors++;
+    channel->nextError += 1 + AX25_channelGap(channel, channel->params.ber);
+  }
+  channel->nbBitsOut += nbOut;
+
+  if(channel->params.invert) {
+    for(n=0; n<(nbOut + 7) / 8; n++) out[n] ^= 0xFF;
+  }
+  return nbOut;
+}
@@ -0,0 +1,37 @@
+#ifndef AX25_CHANNEL_H
+#define AX25_CHANNEL_H
+
+#include <stdint.h>
+
+// Impairments of a simulated radio channel, applied to the bits on the air
+// (after the scrambler, before the descrambler).
+typedef struct {
+  double ber;                  // Probability of a wrong bit.
+  double burstRate;            // Probability of a burst of errors at each bit.
+  unsigned int burstLength;    // Bits of a burst (each one wrong with a 1/2 probability).
+  double slipRate;             // Probability of a bit slip (a bit lost or repeated).
+  unsigned char invert;        // Polarity inversion (ADF7021 "Invert Data").
+} AX25_ChannelParams;
+
+// Simulated channel. The positions of the next impairments are drawn in
+// advance (geometric gaps), so the bits between them are copied as they
+// are. The channel is continuous from one block of bits to the next.
+typedef struct {
+  AX25_ChannelParams params;
+  uint64_t random;             // State of the generator.
+  unsigned long long nbBitsIn, nbBitsOut;
+  unsigned long long nextError;  // Output bit of the next error.
+  unsigned long long nextBurst;  // Output bit of the next burst.
+  unsigned long long nextSlip;   // Input bit of the next slip.
+  unsigned int burstLeft;        // Bits of the current burst not yet passed.
+  unsigned long nbErrors;        // Bits inverted (bursts included).
+  unsigned long nbBursts;
+  unsigned long nbSlips;
+} AX25_Channel;
+
+void AX25_channelInit(AX25_Channel *channel, const AX25_ChannelParams *params, uint64_t seed);
+uint64_t AX25_channelRandom(AX25_Channel *channel);
+unsigned long AX25_channelBits(AX25_Channel *channel, const unsigned char *in, unsigned long nbBits,
+                               unsigned char *out, unsigned long maxBits);
+
+#endif /* AX25_CHANNEL_H */
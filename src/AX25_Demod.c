@@ -0,0 +1,202 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Demod.c
+ * Software 9600 baud G3RUH demodulator for the recordings of the passes.
+ * It replaces the slicer and the clock recovery of the ADF7021 : the bits
+ * it produces are the ones the receiver gets from the transceiver. The
+ * data filter runs on SSE, four (or eight) outputs at a time.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <string.h>
+
+#include "AX25_Demod.h"
+
+#if defined(__GNUC__) && defined(__SSE__)
+#define AX25_HAVE_SSE
+#include <xmmintrin.h>
+#endif
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a demodulator.
+ *
+ * PARAMETERS:
+ * *demod        pointer of the demodulator.
+ * *stream       pointer of the receiver of the bits.
+ * sampleRate    sample rate of the recording (Hz).
+ * mode          AX25_DEMOD_AUDIO or AX25_DEMOD_IQ.
+ *
+ * RETURNS:
+ * 1             if the demodulator is ready.
+ * 0             if the sample rate is below 4 samples per bit.
+ *--------------------------------------------------------------------------*/
+char AX25_demodInit(AX25_Demod *demod, AX25_RxStream *stream, unsigned int sampleRate, unsigned char mode) {
+  unsigned int k;
+  float rate, cutoff, t, x, sum = 0;
+
+  if(sampleRate < 4 * AX25_DEMOD_BAUD) return 0;
+
+  memset(demod, 0, sizeof(*demod));
+  demod->stream = stream;
+  demod->mode = mode;
+
+  // Decimation down to 4 to 8 samples per bit.
+  demod->decimation = sampleRate / (4 * AX25_DEMOD_BAUD);
+  rate = (float) sampleRate / demod->decimation;
+  demod->dcGain = 1.0f / (rate * AX25_DEMOD_DC_TIME);
+  demod->clockStep = AX25_DEMOD_BAUD / rate;
+
+  // Data filter : low-pass at 0.75 times the bit rate, two bits long,
+  // Blackman window, unity gain at DC.
+  demod->nbTaps = (unsigned int) (2 * rate / AX25_DEMOD_BAUD) | 1;
+  cutoff = 0.75f * AX25_DEMOD_BAUD / rate;
+  for(k=0; k<demod->nbTaps; k++) {
+    t = k - (demod->nbTaps - 1) / 2.0f;
+    x = (float) k / (demod->nbTaps - 1);
+    demod->taps[k] = (t == 0) ? 2 * cutoff : sinf(2 * (float) M_PI * cutoff * t) / ((float) M_PI * t);
+    demod->taps[k] *= 0.42f - 0.5f * cosf(2 * (float) M_PI * x) + 0.08f * cosf(4 * (float) M_PI * x);
+    sum += demod->taps[k];
+  }
+  for(k=0; k<demod->nbTaps; k++) demod->taps[k] /= sum;
+
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Sends the sliced bits to the receiver.
+ *--------------------------------------------------------------------------*/
+static void AX25_demodPush(AX25_Demod *demod) {
+  AX25_RxStream *stream = demod->stream;
+
+  if(!demod->nbBits) return;
+  AX25_rxStreamWord(stream, AX25_rxDecodeWord(&stream->line, demod->bits, demod->nbBits), demod->nbBits);
+  demod->bits = 0;
+  demod->nbBits = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Data filter of the samples of the block : output[i] is the sum of
+ * taps[k] * input[i - k]. The history before the block lives in the
+ * AX25_DEMOD_MAX_TAPS first samples of input.
+ *--------------------------------------------------------------------------*/
+static void AX25_demodFilter(AX25_Demod *demod) {
+  const float *x = demod->input + AX25_DEMOD_MAX_TAPS;
+  float *y = demod->output, acc;
+  unsigned int i = 0, k, n = demod->nbInput;
+
+#ifdef AX25_HAVE_SSE
+  __m128 tap, acc0, acc1;
+
+  for(; i+8<=n; i+=8) {
+    acc0 = _mm_setzero_ps();
+    acc1 = _mm_setzero_ps();
+    for(k=0; k<demod->nbTaps; k++) {
+      tap = _mm_set1_ps(demod->taps[k]);
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(tap, _mm_loadu_ps(x + i - k)));
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(tap, _mm_loadu_ps(x + i + 4 - k)));
+    }
+    _mm_store_ps(y + i, acc0);
+    _mm_store_ps(y + i + 4, acc1);
+  }
+  for(; i+4<=n; i+=4) {
+    acc0 = _mm_setzero_ps();
+    for(k=0; k<demod->nbTaps; k++) acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_set1_ps(demod->taps[k]), _mm_loadu_ps(x + i - k)));
+    _mm_storeu_ps(y + i, acc0);
+  }
+#endif
+  for(; i<n; i++) {
+    acc = 0;
+    for(k=0; k<demod->nbTaps; k++) acc += demod->taps[k] * x[i - k];
+    y[i] = acc;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Bit clock and data slicer on the filtered samples of the block. The
+ * clock phase is 0 at a transition and the bit is sampled (interpolated
+ * between two samples) at half a period, when the phase reaches 0.5. At
+ * every zero crossing, the phase of the clock at the exact crossing time
+ * is pulled towards 0.
+ *--------------------------------------------------------------------------*/
+static void AX25_demodSlice(AX25_Demod *demod) {
+  const float *y = demod->output;
+  float value, previous = demod->lastValue, clock = demod->clock, step = demod->clockStep, back, phase;
+  unsigned int i;
+
+  for(i=0; i<demod->nbInput; i++) {
+    value = y[i];
+    clock += step;
+
+    if(clock >= 0.5f) {
+      back = (clock - 0.5f) / step;  // Sampling time, in samples before value.
+      demod->bits |= (uint64_t) (value - back * (value - previous) > 0) << demod->nbBits;
+      if(++demod->nbBits == 64) AX25_demodPush(demod);
+      clock -= 1.0f;
+    }
+
+    if((value > 0) != (previous > 0)) {
+      phase = clock - step * value / (value - previous);
+      if(phase < -0.5f) phase += 1.0f;
+      clock -= AX25_DEMOD_PLL_GAIN * phase;
+    }
+    previous = value;
+  }
+
+  demod->lastValue = previous;
+  demod->clock = clock;
+}
+
+/*--------------------------------------------------------------------------*
+ * Demodulation of samples.
+ *
+ * PARAMETERS:
+ * *demod        pointer of the demodulator.
+ * *samples      pointer of the samples (I and Q interleaved in IQ mode).
+ * nbSamples     number of samples (of I/Q pairs in IQ mode).
+ *--------------------------------------------------------------------------*/
+void AX25_demodSamples(AX25_Demod *demod, const float *samples, unsigned long nbSamples) {
+  float *x = demod->input + AX25_DEMOD_MAX_TAPS, value;
+  unsigned int stride = (demod->mode == AX25_DEMOD_IQ) ? 2 : 1;
+
+  demod->nbSamples += nbSamples;
+
+  while(nbSamples) {
+    // Decimation, FM discriminator and DC removal.
+    while(nbSamples && demod->nbInput < AX25_DEMOD_BLOCK) {
+      demod->accI += samples[0];
+      if(stride == 2) demod->accQ += samples[1];
+      samples += stride;
+      nbSamples--;
+      if(++demod->nbDecimated < demod->decimation) continue;
+      demod->nbDecimated = 0;
+
+      if(stride == 2) {
+        value = (demod->accQ * demod->lastI - demod->accI * demod->lastQ)
+              / (demod->accI * demod->accI + demod->accQ * demod->accQ + 1e-20f);
+        demod->lastI = demod->accI;
+        demod->lastQ = demod->accQ;
+      }
+      else value = demod->accI;
+      demod->accI = 0;
+      demod->accQ = 0;
+
+      value -= demod->dc;
+      demod->dc += demod->dcGain * value;
+      x[demod->nbInput++] = value;
+    }
+
+    AX25_demodFilter(demod);
+    AX25_demodSlice(demod);
+    memmove(demod->input, demod->input + demod->nbInput, AX25_DEMOD_MAX_TAPS * sizeof(float));
+    demod->nbInput = 0;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * End of the recording : the last sliced bits go to the receiver.
+ *--------------------------------------------------------------------------*/
+void AX25_demodFinish(AX25_Demod *demod) {
+  AX25_demodPush(demod);
+}
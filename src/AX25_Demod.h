@@ -0,0 +1,49 @@
+#ifndef AX25_DEMOD_H
+#define AX25_DEMOD_H
+
+#include <stdint.h>
+
+#include "AX25_Stream.h"
+
+// Demodulator specifications
+#define AX25_DEMOD_BAUD      9600  // G3RUH bit rate.
+#define AX25_DEMOD_MAX_TAPS  32    // Maximum length of the data filter.
+#define AX25_DEMOD_BLOCK     1024  // Samples filtered at once.
+#define AX25_DEMOD_DC_TIME   0.01f // Time constant of the DC removal (s).
+#define AX25_DEMOD_PLL_GAIN  0.1f  // Correction of the bit clock at a zero crossing.
+
+// Demodulator options
+#define AX25_DEMOD_AUDIO     0x00  // Real samples from the FM discriminator.
+#define AX25_DEMOD_IQ        0x01  // Complex samples (interleaved I and Q).
+
+// Software G3RUH demodulator : what the ADF7021 does on board, on recorded
+// samples. The samples are decimated (block average) to 4 to 8 samples per
+// bit, FM demodulated if they are IQ, freed of their DC offset and low-pass
+// filtered. A bit clock locked on the zero crossings samples the data
+// slicer, and the bits go to a streaming receiver. NRZI makes the receiver
+// insensitive to the polarity of the signal.
+typedef struct {
+  AX25_RxStream *stream;
+  unsigned char mode;
+  unsigned int decimation;     // Input samples per filtered sample.
+  unsigned int nbDecimated;    // Input samples in accI/accQ.
+  float accI, accQ;
+  float lastI, lastQ;          // Previous sample of the discriminator.
+  float dc, dcGain;
+  unsigned int nbTaps;
+  _Alignas(16) float taps[AX25_DEMOD_MAX_TAPS];
+  _Alignas(16) float input[AX25_DEMOD_MAX_TAPS + AX25_DEMOD_BLOCK];  // History + block.
+  _Alignas(16) float output[AX25_DEMOD_BLOCK];
+  unsigned int nbInput;        // Samples of the block in input.
+  float clock, clockStep;      // Bit clock phase (cycles), 0 at a transition.
+  float lastValue;             // Previous output of the filter.
+  uint64_t bits;               // Sliced bits waiting for the receiver.
+  unsigned int nbBits;
+  unsigned long long nbSamples;
+} AX25_Demod;
+
+char AX25_demodInit(AX25_Demod *demod, AX25_RxStream *stream, unsigned int sampleRate, unsigned char mode);
+void AX25_demodSamples(AX25_Demod *demod, const float *samples, unsigned long nbSamples);
+void AX25_demodFinish(AX25_Demod *demod);
+
+#endif /* AX25_DEMOD_H */
@@ -0,0 +1,437 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Digi.c
+ * Duplicate suppression and forwarding of the received frames. When
+ * several receivers hear the same frame, only the first copy received in
+ * the window goes further : to the gate (iGate, KISS clients...) and, when
+ * the next hop of its path is our call or one of our aliases, back to the
+ * Tx channels with the has-been-repeated bit set. The memory is allocated
+ * once at the creation.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "AX25_Digi.h"
+#include "AX25_CRC.h"
+#include "AX25_Rx.h"
+
+#define AX25_DUP_MULTIPLIER    0x9E3779B97F4A7C15ULL
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the digipeater structure.
+ *--------------------------------------------------------------------------*/
+struct AX25_Digi {
+  AX25_Address call;
+  AX25_Address aliases[AX25_DIGI_MAX_ALIASES];
+  unsigned int nbAliases;
+  char widePrefix[6];          // "WIDE" for the WIDEn-N paths ("" : none).
+  unsigned char maxHops;       // Highest n of the WIDEn-N paths.
+  uint32_t routes[AX25_DIGI_MAX_CHANNELS];  // Tx channels of every receiving channel.
+  AX25_DigiHandler tx, gate;
+  void *user;
+  AX25_DupCache dup;
+  AX25_DigiStats stats;
+};
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a duplicate cache.
+ *
+ * PARAMETERS:
+ * *cache        pointer of the cache.
+ * nbEntries     max number of keys in the window (1 to AX25_DUP_MAX_ENTRIES).
+ * window        time a key is kept (in the unit of the clock of the caller,
+ *               ns for AX25_statsClock).
+ *
+ * RETURNS:
+ * 1             if the cache is ready.
+ * 0             if nbEntries is out of range or if there is no memory.
+ *--------------------------------------------------------------------------*/
+char AX25_dupInit(AX25_DupCache *cache, unsigned int nbEntries, unsigned long long window) {
+  unsigned int size = 2;
+
+  if(!nbEntries || nbEntries > AX25_DUP_MAX_ENTRIES) return 0;
+  while(size < 2 * nbEntries) size <<= 1;  // Half full at most.
+  cache->table = (uint64_t *) calloc(size, sizeof(uint64_t));
+  cache->fifo = (AX25_DupEntry *) malloc((size_t) nbEntries * sizeof(AX25_DupEntry));
+  if(!cache->table || !cache->fifo) {
+    AX25_dupFree(cache);
+    return 0;
+  }
+  cache->mask = size - 1;
+  cache->nbEntries = nbEntries;
+  cache->head = 0;
+  cache->count = 0;
+  cache->window = window;
+  cache->nbLookups = 0;
+  cache->nbDuplicates = 0;
+  cache->nbExpired = 0;
+  cache->nbEvicted = 0;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Mixing of 8 bytes into a key.
+ *--------------------------------------------------------------------------*/
+static uint64_t AX25_dupMix(uint64_t key, uint64_t word) {
+  key = (key ^ word) * AX25_DUP_MULTIPLIER;
+  return key ^ (key >> 29);
+}
+
+static uint64_t AX25_dupHash(uint64_t key, const unsigned char *bytes, unsigned int length) {
+  uint64_t word;
+
+  for(; length>=8; length-=8, bytes+=8) {
+    memcpy(&word, bytes, 8);
+    key = AX25_dupMix(key, word);
+  }
+  if(length) {
+    word = 0;
+    memcpy(&word, bytes, length);
+    key = AX25_dupMix(key, word ^ ((uint64_t) length << 56));
+  }
+  return key;
+}
+
+/*--------------------------------------------------------------------------*
+ * Key of a frame : its source and destination addresses, its control
+ * field, PID and info field. The digipeaters are left out, so the copies
+ * repeated by other digipeaters (or by us) have the same key. The FCS is
+ * left out for the same reason : it covers the has-been-repeated bits.
+ *
+ * PARAMETERS:
+ * *frame        pointer of the frame (flags and FCS included).
+ * lengthFrame   length of the frame (in bytes).
+ *
+ * RETURN:
+ * the key (never 0).
+ *--------------------------------------------------------------------------*/
+uint64_t AX25_dupKey(const char *frame, unsigned int lengthFrame) {
+  const unsigned char *bytes = (const unsigned char *) frame + 1;
+  unsigned char addresses[2 * AX25_ADDRESS_SIZE];
+  unsigned int length, start;
+  uint64_t key;
+
+  length = (lengthFrame >= 4) ? lengthFrame - 4 : 0;  // Flags and FCS excluded.
+  if(length < 2 * AX25_ADDRESS_SIZE) return AX25_dupHash(AX25_DUP_MULTIPLIER, bytes, length) | 1;
+
+  // Callsigns and SSIDs only (the C bits and the end of the field are not kept).
+  memcpy(addresses, bytes, sizeof(addresses));
+  addresses[AX25_ADDRESS_SIZE - 1] &= 0x1E;
+  addresses[2 * AX25_ADDRESS_SIZE - 1] &= 0x1E;
+  for(start=AX25_ADDRESS_SIZE; start<length && !(bytes[start - 1] & 0x01); start+=AX25_ADDRESS_SIZE);
+  if(start > length) start = length;
+
+  key = AX25_dupHash(AX25_DUP_MULTIPLIER, addresses, sizeof(addresses));
+  key = AX25_dupHash(key, bytes + start, length - start);
+  key = AX25_dupMix(key, length - start);
+  return key ? key : 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Removal of a key from the table. The next keys of the cluster are moved
+ * back (no tombstone, the table never fills up with deleted keys).
+ *--------------------------------------------------------------------------*/
+static void AX25_dupRemove(AX25_DupCache *cache, uint64_t key) {
+  unsigned int i, j, home;
+
+  for(i=(unsigned int) key & cache->mask; cache->table[i] != key; i=(i + 1) & cache->mask) {
+    if(!cache->table[i]) return;
+  }
+  cache->table[i] = 0;
+  for(j=(i + 1) & cache->mask; cache->table[j]; j=(j + 1) & cache->mask) {
+    home = (unsigned int) cache->table[j] & cache->mask;
+    // The key at j may go to i if its home is not in ]i, j].
+    if(((j - home) & cache->mask) >= ((j - i) & cache->mask)) {
+      cache->table[i] = cache->table[j];
+      cache->table[j] = 0;
+      i = j;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Removal of the oldest key.
+ *--------------------------------------------------------------------------*/
+static void AX25_dupPop(AX25_DupCache *cache) {
+  AX25_dupRemove(cache, cache->fifo[cache->head].key);
+  if(++cache->head == cache->nbEntries) cache->head = 0;
+  cache->count--;
+}
+
+/*--------------------------------------------------------------------------*
+ * Check of a key. The keys older than the window are removed first. A new
+ * key is added with the time of its first reception : the copies received
+ * later do not extend the window.
+ *
+ * PARAMETERS:
+ * *cache        pointer of the cache.
+ * key           the key of the frame (see AX25_dupKey).
+ * now           the time of the reception (a monotonic clock).
+ *
+ * RETURNS:
+ * 1             if the key has been received in the window.
+ * 0             otherwise (the key is added).
+ *--------------------------------------------------------------------------*/
+char AX25_dupCheck(AX25_DupCache *cache, uint64_t key, unsigned long long now) {
+  unsigned int i;
+
+  while(cache->count && cache->fifo[cache->head].time + cache->window <= now) {
+    AX25_dupPop(cache);
+    cache->nbExpired++;
+  }
+
+  cache->nbLookups++;
+  for(i=(unsigned int) key & cache->mask; cache->table[i]; i=(i + 1) & cache->mask) {
+    if(cache->table[i] == key) {
+      cache->nbDuplicates++;
+      return 1;
+    }
+  }
+
+  if(cache->count == cache->nbEntries) {
+    AX25_dupPop(cache);
+    cache->nbEvicted++;
+    for(i=(unsigned int) key & cache->mask; cache->table[i]; i=(i + 1) & cache->mask);  // The cluster may have moved.
+  }
+  cache->table[i] = key;
+  i = cache->head + cache->count;
+  if(i >= cache->nbEntries) i -= cache->nbEntries;
+  cache->fifo[i].key = key;
+  cache->fifo[i].time = now;
+  cache->count++;
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Release of the memory of a duplicate cache.
+ *--------------------------------------------------------------------------*/
+void AX25_dupFree(AX25_DupCache *cache) {
+  free(cache->table);
+  free(cache->fifo);
+  cache->table = NULL;
+  cache->fifo = NULL;
+}
+
+/*--------------------------------------------------------------------------*
+ * Creation of a digipeater. By default, the frames are repeated on the
+ * channel which received them and the only aliases are the ones added.
+ *
+ * PARAMETERS:
+ * *call         pointer of the call of the digipeater.
+ * nbEntries     max number of frames in the window (see AX25_dupInit).
+ * window        time a frame is a duplicate (ns, 0 : AX25_DIGI_WINDOW).
+ * tx            handler of the frames to send (NULL : no digipeating).
+ * gate          handler of the first copy of every frame (NULL : none).
+ * *user         pointer given to the handlers.
+ *
+ * RETURN:
+ * the digipeater, or NULL if there is no memory.
+ *--------------------------------------------------------------------------*/
+AX25_Digi *AX25_digiCreate(const AX25_Address *call, unsigned int nbEntries, unsigned long long window,
+                           AX25_DigiHandler tx, AX25_DigiHandler gate, void *user) {
+  AX25_Digi *digi;
+  unsigned int i;
+
+  digi = (AX25_Digi *) calloc(1, sizeof(AX25_Digi));
+  if(!digi) return NULL;
+  if(!AX25_dupInit(&digi->dup, nbEntries, window ? window : AX25_DIGI_WINDOW)) {
+    free(digi);
+    return NULL;
+  }
+  digi->call = *call;
+  digi->call.bit7 = 0;
+  for(i=0; i<AX25_DIGI_MAX_CHANNELS; i++) digi->routes[i] = (uint32_t) 1 << i;
+  digi->tx = tx;
+  digi->gate = gate;
+  digi->user = user;
+  return digi;
+}
+
+/*--------------------------------------------------------------------------*
+ * Addition of an alias (RELAY, a satellite alias...) : the alias is
+ * replaced by our call when the frame is repeated.
+ *
+ * RETURN:
+ * 1 if OK, 0 if there are already AX25_DIGI_MAX_ALIASES aliases.
+ *--------------------------------------------------------------------------*/
+char AX25_digiAddAlias(AX25_Digi *digi, const AX25_Address *alias) {
+  if(digi->nbAliases == AX25_DIGI_MAX_ALIASES) return 0;
+  digi->aliases[digi->nbAliases++] = *alias;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Handling of the WIDEn-N paths : a hop prefix followed by n (1 to 7),
+ * with the hops left in the SSID. The SSID is decremented, the prefix is
+ * marked as repeated when it reaches 0 and our call is inserted before it
+ * (when there is room in the path).
+ *
+ * PARAMETERS:
+ * *digi         pointer of the digipeater.
+ * *prefix       the prefix ("WIDE"), up to 5 letters or digits.
+ * maxHops       highest n repeated (0 : no WIDEn-N path).
+ *
+ * RETURN:
+ * 1 if OK, 0 if the prefix is not valid.
+ *--------------------------------------------------------------------------*/
+char AX25_digiSetWide(AX25_Digi *digi, const char *prefix, unsigned char maxHops) {
+  unsigned int i;
+
+  for(i=0; prefix[i]; i++) {
+    if(i == sizeof(digi->widePrefix) - 1) return 0;
+    if(!((prefix[i] >= 'A' && prefix[i] <= 'Z') || (prefix[i] >= '0' && prefix[i] <= '9'))) return 0;
+    digi->widePrefix[i] = prefix[i];
+  }
+  digi->widePrefix[i] = '\0';
+  digi->maxHops = (maxHops > 7) ? 7 : maxHops;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Tx channels of the frames received on a channel.
+ *
+ * PARAMETERS:
+ * *digi         pointer of the digipeater.
+ * channel       the receiving channel.
+ * txChannels    mask of the Tx channels (bit n : channel n, 0 : none).
+ *
+ * RETURN:
+ * 1 if OK, 0 if the channel is out of range.
+ *--------------------------------------------------------------------------*/
+char AX25_digiSetRoute(AX25_Digi *digi, unsigned int channel, uint32_t txChannels) {
+  if(channel >= AX25_DIGI_MAX_CHANNELS) return 0;
+  digi->routes[channel] = txChannels;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Check of a WIDEn-N hop.
+ *--------------------------------------------------------------------------*/
+static char AX25_digiWide(const AX25_Digi *digi, const AX25_Address *hop) {
+  unsigned int length = (unsigned int) strlen(digi->widePrefix);
+  unsigned int n;
+
+  if(!length || !digi->maxHops || strncmp(hop->callsign, digi->widePrefix, length)) return 0;
+  if(hop->callsign[length] < '1' || hop->callsign[length] > '7' || hop->callsign[length + 1]) return 0;
+  n = (unsigned int) (hop->callsign[length] - '0');
+  return n <= digi->maxHops && hop->ssid >= 1 && hop->ssid <= n;
+}
+
+/*--------------------------------------------------------------------------*
+ * Preparation of the repeated frame : next hop marked as repeated (our
+ * call in place of an alias, or a WIDEn-N hop used) and new FCS.
+ *
+ * RETURN:
+ * the length of the repeated frame, 0 if it is not for us.
+ *--------------------------------------------------------------------------*/
+static unsigned int AX25_digiRepeat(AX25_Digi *digi, AX25_Path *path, const char *frame, unsigned int lengthFrame,
+                                    char *out) {
+  AX25_Address *hop;
+  unsigned int i, length, rest;
+  char alias = 0;
+
+  // Next hop : the first digipeater which has not repeated the frame.
+  for(i=0; i<path->nbDigipeaters && path->digipeaters[i].bit7; i++);
+  if(i == path->nbDigipeaters) return 0;
+  hop = &path->digipeaters[i];
+
+  if(AX25_addressEqual(hop, &digi->call)) alias = 1;
+  for(length=0; length<digi->nbAliases && !alias; length++) alias = AX25_addressEqual(hop, &digi->aliases[length]);
+  if(alias) {
+    *hop = digi->call;
+    hop->bit7 = 1;
+  }
+  else if(AX25_digiWide(digi, hop)) {
+    if(!--hop->ssid) hop->bit7 = 1;
+    if(path->nbDigipeaters < AX25_MAX_DIGIPEATERS && lengthFrame + AX25_ADDRESS_SIZE <= AX25_FRAME_MAX_SIZE) {
+      memmove(hop + 1, hop, (path->nbDigipeaters - i) * sizeof(AX25_Address));
+      *hop = digi->call;
+      hop->bit7 = 1;
+      path->nbDigipeaters++;
+    }
+    else digi->stats.nbUntraced++;
+  }
+  else return 0;
+
+  rest = lengthFrame - 2 - path->length;  // Control, PID, info and FCS, after the address field.
+  out[0] = 0x7E;
+  length = 1 + AX25_pathEncode((unsigned char *) out + 1, path);
+  memcpy(out + length, frame + 1 + path->length, rest);
+  length += rest;
+  out[length++] = 0x7E;
+  AX25_putCRC(out, (unsigned short) length);
+  return length;
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_digiInput is the main function : a frame received with a good FCS
+ * on a channel. Not thread-safe : the frames of all the receivers are
+ * given by one thread (or under a lock).
+ *
+ * PARAMETERS:
+ * *digi         pointer of the digipeater.
+ * channel       the receiving channel (0 to AX25_DIGI_MAX_CHANNELS - 1).
+ * *frame        pointer of the frame (flags and FCS included).
+ * lengthFrame   length of the frame (in bytes).
+ * now           the time of the reception (ns, AX25_statsClock).
+ *
+ * RETURN:
+ * what has been done (AX25_DIGI_xxx bits, 0 : nothing).
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_digiInput(AX25_Digi *digi, unsigned int channel, const char *frame, unsigned int lengthFrame,
+                             unsigned long long now) {
+  char out[AX25_FRAME_MAX_SIZE];
+  AX25_Path path;
+  unsigned char result = 0;
+  unsigned int length, i;
+
+  digi->stats.nbFrames++;
+  if(channel >= AX25_DIGI_MAX_CHANNELS || lengthFrame < AX25_FRAME_MIN_SIZE || lengthFrame > AX25_FRAME_MAX_SIZE ||
+     !AX25_pathParse(&path, frame + 1, lengthFrame - 4)) {
+    digi->stats.nbInvalid++;
+    return AX25_DIGI_INVALID;
+  }
+  if(AX25_dupCheck(&digi->dup, AX25_dupKey(frame, lengthFrame), now)) {
+    digi->stats.nbDuplicates++;
+    return AX25_DIGI_DUPLICATE;
+  }
+
+  if(digi->gate) {
+    digi->gate(digi->user, channel, frame, lengthFrame);
+    digi->stats.nbGated++;
+    result |= AX25_DIGI_GATED;
+  }
+
+  if(!digi->tx || !digi->routes[channel]) return result;
+  length = AX25_digiRepeat(digi, &path, frame, lengthFrame, out);
+  if(!length) {
+    digi->stats.nbNotForUs++;
+    return result;
+  }
+  for(i=0; i<AX25_DIGI_MAX_CHANNELS; i++) {
+    if(digi->routes[channel] & ((uint32_t) 1 << i)) digi->tx(digi->user, i, out, length);
+  }
+  digi->stats.nbRepeated++;
+  return result | AX25_DIGI_REPEATED;
+}
+
+/*--------------------------------------------------------------------------*
+ * Counters of a digipeater.
+ *--------------------------------------------------------------------------*/
+void AX25_digiGetStats(const AX25_Digi *digi, AX25_DigiStats *stats) {
+  *stats = digi->stats;
+  stats->nbExpired = digi->dup.nbExpired;
+  stats->nbEvicted = digi->dup.nbEvicted;
+}
+
+/*--------------------------------------------------------------------------*
+ * Destruction of a digipeater.
+ *--------------------------------------------------------------------------*/
+void AX25_digiDestroy(AX25_Digi *digi) {
+  if(!digi) return;
+  AX25_dupFree(&digi->dup);
+  free(digi);
+}
@@ -0,0 +1,78 @@
+#ifndef AX25_DIGI_H
+#define AX25_DIGI_H
+
+#include <stdint.h>
+
+#include "AX25_Frame.h"
+
+// Specifications
+#define AX25_DUP_MAX_ENTRIES   (1u << 20)
+#define AX25_DIGI_MAX_CHANNELS 32        // Channels of the routes (bits of a mask).
+#define AX25_DIGI_MAX_ALIASES  8
+#define AX25_DIGI_WINDOW       30000000000ULL  // Default window of the duplicates (30 s in ns).
+
+// Results of AX25_digiInput (bits).
+#define AX25_DIGI_INVALID      0x01  // Address field not valid.
+#define AX25_DIGI_DUPLICATE    0x02  // Already received in the window.
+#define AX25_DIGI_GATED        0x04  // Given to the gate handler.
+#define AX25_DIGI_REPEATED     0x08  // Given to the Tx handler.
+
+// Duplicate cache : keys of the frames received in the last window, in
+// an open addressing hash table (linear probing, half full at most) and
+// in a FIFO in the order of arrival. The oldest keys leave the FIFO and
+// the table at each access, so the expiry costs O(1) per frame. When the
+// FIFO is full, the oldest key leaves before its time.
+typedef struct {
+  uint64_t key;
+  unsigned long long time;
+} AX25_DupEntry;
+
+typedef struct {
+  uint64_t *table;             // Keys (0 : free).
+  unsigned int mask;
+  AX25_DupEntry *fifo;
+  unsigned int nbEntries;      // Size of the FIFO.
+  unsigned int head, count;
+  unsigned long long window;
+  unsigned long nbLookups;
+  unsigned long nbDuplicates;
+  unsigned long nbExpired;
+  unsigned long nbEvicted;     // Keys removed before the end of the window.
+} AX25_DupCache;
+
+// Handler of the frames to send (Tx channel) or to gate (receiving
+// channel). The frame includes its flags and its FCS and is valid during
+// the call.
+typedef void (*AX25_DigiHandler)(void *user, unsigned int channel, const char *frame, unsigned int lengthFrame);
+
+// Counters of a digipeater.
+typedef struct {
+  unsigned long nbFrames;
+  unsigned long nbInvalid;
+  unsigned long nbDuplicates;
+  unsigned long nbGated;
+  unsigned long nbRepeated;    // Frames repeated (once for all the Tx channels).
+  unsigned long nbNotForUs;    // Next hop neither our call nor an alias.
+  unsigned long nbUntraced;    // Repeated without our call (no room in the path).
+  unsigned long nbExpired;     // See AX25_DupCache.
+  unsigned long nbEvicted;
+} AX25_DigiStats;
+
+typedef struct AX25_Digi AX25_Digi;
+
+char AX25_dupInit(AX25_DupCache *cache, unsigned int nbEntries, unsigned long long window);
+uint64_t AX25_dupKey(const char *frame, unsigned int lengthFrame);
+char AX25_dupCheck(AX25_DupCache *cache, uint64_t key, unsigned long long now);
+void AX25_dupFree(AX25_DupCache *cache);
+
+AX25_Digi *AX25_digiCreate(const AX25_Address *call, unsigned int nbEntries, unsigned long long window,
+                           AX25_DigiHandler tx, AX25_DigiHandler gate, void *user);
+char AX25_digiAddAlias(AX25_Digi *digi, const AX25_Address *alias);
+char AX25_digiSetWide(AX25_Digi *digi, const char *prefix, unsigned char maxHops);
+char AX25_digiSetRoute(AX25_Digi *digi, unsigned int channel, uint32_t txChannels);
+unsigned char AX25_digiInput(AX25_Digi *digi, unsigned int channel, const char *frame, unsigned int lengthFrame,
+                             unsigned long long now);
+void AX25_digiGetStats(const AX25_Digi *digi, AX25_DigiStats *stats);
+void AX25_digiDestroy(AX25_Digi *digi);
+
+#endif /* AX25_DIGI_H */
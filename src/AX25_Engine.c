@@ -0,0 +1,307 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Engine.c
+ * Multi-channel receiving engine. Every channel owns a streaming receiver
+ * and its frame ring. The channels are sharded over a pool of worker threads
+ * (channel % nbWorkers) so that a channel is always decoded by the same
+ * thread and no lock is taken on the decoding path.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AX25_Engine.h"
+#include "AX25_CRC.h"
+#include "AX25_RS.h"
+#include "AX25_Stream.h"
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the engine structures.
+ *--------------------------------------------------------------------------*/
+typedef struct {
+  AX25_RxStream stream;
+  AX25_FrameRing ring;
+  AX25_FrameSlot slots[AX25_ENGINE_RING_SIZE];
+  AX25_Stats stats;             // Written by the worker of the channel only.
+} AX25_EngineChannel;
+
+struct AX25_Engine;
+
+typedef struct {
+  struct AX25_Engine *engine;
+  unsigned int index;
+  pthread_t thread;
+} AX25_EngineWorker;
+
+struct AX25_Engine {
+  AX25_EngineChannel *channels;
+  unsigned int nbChannels;
+  AX25_FrameHandler handler;
+  void *user;
+
+  AX25_EngineWorker workers[AX25_ENGINE_MAX_WORKERS];
+  unsigned int nbWorkers;
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;         // A new batch is available.
+  pthread_cond_t done;          // A worker has finished the batch.
+  unsigned long generation;     // Number of the current batch.
+  unsigned int nbRunning;       // Workers still processing the batch.
+  unsigned char stop;
+  const AX25_ChannelBlock *blocks;
+  unsigned int nbBlocks;
+};
+
+/*--------------------------------------------------------------------------*
+ * Decoding of a block of bits of one channel. The block is cut in pieces
+ * too short to fill the ring, and the frames are delivered to the handler
+ * after every piece.
+ *--------------------------------------------------------------------------*/
+static void AX25_engineDecode(AX25_Engine *engine, const AX25_ChannelBlock *block) {
+  AX25_EngineChannel *channel = &engine->channels[block->channel];
+  const unsigned char *bits = block->bits;
+  unsigned long nbBits = block->nbBits, n;
+  AX25_FrameSlot *slot;
+
+  while(nbBits) {
+    // A frame takes at least AX25_FRAME_MIN_SIZE - 1 bytes (shared flags).
+    n = 8UL * (AX25_FRAME_MIN_SIZE - 1) * (AX25_ENGINE_RING_SIZE - 2);
+    if(n > nbBits) n = nbBits;
+    AX25_rxStreamBits(&channel->stream, bits, n);
+    bits += n >> 3;
+    nbBits -= n;
+
+    while((slot = AX25_ringPeek(&channel->ring)) != NULL) {
+      AX25_statsDelivered(&channel->stats, slot->timestamp);
+      engine->handler(engine->user, block->channel, slot);
+      AX25_ringRelease(&channel->ring);
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Worker thread : waits for a batch, decodes the blocks of its channels
+ * (in order) and signals the end of its part.
+ *--------------------------------------------------------------------------*/
+static void *AX25_engineWorker(void *arg) {
+  AX25_EngineWorker *worker = (AX25_EngineWorker *) arg;
+  AX25_Engine *engine = worker->engine;
+  unsigned long generation = 0;
+  unsigned int i;
+
+  for(;;) {
+    pthread_mutex_lock(&engine->lock);
+    while(!engine->stop && engine->generation == generation) {
+      pthread_cond_wait(&engine->start, &engine->lock);
+    }
+    if(engine->stop) {
+      pthread_mutex_unlock(&engine->lock);
+      return NULL;
+    }
+    generation = engine->generation;
+    pthread_mutex_unlock(&engine->lock);
+
+    for(i=0; i<engine->nbBlocks; i++) {
+      // Blocks of unknown channels are ignored.
+      if(engine->blocks[i].channel < engine->nbChannels &&
+         engine->blocks[i].channel % engine->nbWorkers == worker->index) {
+        AX25_engineDecode(engine, &engine->blocks[i]);
+      }
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    if(--engine->nbRunning == 0) pthread_cond_signal(&engine->done);
+    pthread_mutex_unlock(&engine->lock);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Creation of an engine.
+ *
+ * PARAMETERS:
+ * nbChannels    number of receiving channels.
+ * nbWorkers     number of worker threads (1 to AX25_ENGINE_MAX_WORKERS).
+ * handler       function called for every frame received.
+ * *user         pointer given back to the handler.
+ *
+ * RETURN:
+ * the engine, or NULL if it cannot be created.
+ *--------------------------------------------------------------------------*/
+AX25_Engine *AX25_engineCreate(unsigned int nbChannels, unsigned int nbWorkers, AX25_FrameHandler handler, void *user) {
+  AX25_Engine *engine;
+  unsigned int i;
+
+  if(!nbChannels || !handler) return NULL;
+  if(nbWorkers < 1) nbWorkers = 1;
+  if(nbWorkers > AX25_ENGINE_MAX_WORKERS) nbWorkers = AX25_ENGINE_MAX_WORKERS;
+  if(nbWorkers > nbChannels) nbWorkers = nbChannels;
+
+  engine = (AX25_Engine *) calloc(1, sizeof(AX25_Engine));
+  if(!engine) return NULL;
+  engine->channels = (AX25_EngineChannel *) calloc(nbChannels, sizeof(AX25_EngineChannel));
+  if(!engine->channels) {
+    free(engine);
+    return NULL;
+  }
+  engine->nbChannels = nbChannels;
+  engine->handler = handler;
+  engine->user = user;
+  for(i=0; i<nbChannels; i++) {
+    AX25_ringInit(&engine->channels[i].ring, engine->channels[i].slots, AX25_ENGINE_RING_SIZE);
+    AX25_rxStreamInit(&engine->channels[i].stream, &engine->channels[i].ring);
+    AX25_statsInit(&engine->channels[i].stats);
+    AX25_rxStreamSetStats(&engine->channels[i].stream, &engine->channels[i].stats);
+  }
+
+  pthread_mutex_init(&engine->lock, NULL);
+  pthread_cond_init(&engine->start, NULL);
+  pthread_cond_init(&engine->done, NULL);
+
+  // The shared tables are built now rather than by the first frame of a worker.
+  AX25_crcInitEngine();
+  AX25_rsInit();
+  for(i=0; i<nbWorkers; i++) {
+    engine->workers[i].engine = engine;
+    engine->workers[i].index = i;
+    if(pthread_create(&engine->workers[i].thread, NULL, AX25_engineWorker, &engine->workers[i])) break;
+  }
+  engine->nbWorkers = i;
+  if(!engine->nbWorkers) {
+    AX25_engineDestroy(engine);
+    return NULL;
+  }
+  return engine;
+}
+
+/*--------------------------------------------------------------------------*
+ * Correction of the frames of all the channels (see AX25_crcCorrect). It
+ * must not be called while a batch is decoded.
+ *
+ * PARAMETERS:
+ * *engine       pointer of the engine.
+ * maxErrors     max number of wrong bits on the air to correct (0 : none).
+ *--------------------------------------------------------------------------*/
+void AX25_engineSetCorrection(AX25_Engine *engine, unsigned char maxErrors) {
+  unsigned int i;
+
+  for(i=0; i<engine->nbChannels; i++) AX25_rxStreamSetCorrection(&engine->channels[i].stream, maxErrors);
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of the FX.25 codewords of all the channels (see
+ * AX25_rxStreamSetFx25). It must not be called while a batch is decoded.
+ *
+ * PARAMETERS:
+ * *engine       pointer of the engine.
+ * enable        1 to decode FX.25, 0 for plain AX.25 only.
+ *--------------------------------------------------------------------------*/
+void AX25_engineSetFx25(AX25_Engine *engine, unsigned char enable) {
+  unsigned int i;
+
+  for(i=0; i<engine->nbChannels; i++) AX25_rxStreamSetFx25(&engine->channels[i].stream, enable);
+}
+
+/*--------------------------------------------------------------------------*
+ * Reception of the frames of all the channels straight into the frames of
+ * a pool (AX25_ENGINE_RING_SIZE frames per channel are held while
+ * decoding, plus the cache of each worker). It must be called before the
+ * first batch; the pool must outlive the engine.
+ *
+ * PARAMETERS:
+ * *engine       pointer of the engine.
+ * *pool         pointer of the pool.
+ *
+ * RETURNS:
+ * 1             if the channels use the pool.
+ * 0             if the ring size does not allow it.
+ *--------------------------------------------------------------------------*/
+char AX25_engineSetPool(AX25_Engine *engine, AX25_Pool *pool) {
+  AX25_EngineChannel *channel;
+  unsigned char correction, fx25;
+  unsigned int i;
+
+  for(i=0; i<engine->nbChannels; i++) {
+    channel = &engine->channels[i];
+    correction = channel->stream.correction;
+    fx25 = channel->stream.fx25;
+    AX25_ringClear(&channel->ring);
+    if(!AX25_ringInitPool(&channel->ring, pool, AX25_ENGINE_RING_SIZE)) return 0;
+    AX25_rxStreamInit(&channel->stream, &channel->ring);
+    AX25_rxStreamSetCorrection(&channel->stream, correction);
+    AX25_rxStreamSetFx25(&channel->stream, fx25);
+    AX25_rxStreamSetStats(&channel->stream, &channel->stats);
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Copy of the counters of a channel (see AX25_Stats.h). It may be called
+ * at any time, from any thread, even while a batch is decoded.
+ *
+ * PARAMETERS:
+ * *engine       pointer of the engine.
+ * channel       number of the channel.
+ * *snapshot     pointer of the copy.
+ *
+ * RETURNS:
+ * 1             if the copy is done.
+ * 0             if the channel does not exist.
+ *--------------------------------------------------------------------------*/
+char AX25_engineGetStats(AX25_Engine *engine, unsigned int channel, AX25_StatsSnapshot *snapshot) {
+  if(channel >= engine->nbChannels) return 0;
+  AX25_statsSnapshot(&engine->channels[channel].stats, snapshot);
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of a batch of blocks. The blocks of a channel are decoded in
+ * the order of the batch and blocks of unknown channels are ignored. The
+ * function returns when the whole batch is decoded, so the blocks can be
+ * reused by the caller.
+ *
+ * PARAMETERS:
+ * *engine       pointer of the engine.
+ * *blocks       pointer of the blocks to decode.
+ * nbBlocks      number of blocks.
+ *--------------------------------------------------------------------------*/
+void AX25_engineProcess(AX25_Engine *engine, const AX25_ChannelBlock *blocks, unsigned int nbBlocks) {
+  pthread_mutex_lock(&engine->lock);
+  engine->blocks = blocks;
+  engine->nbBlocks = nbBlocks;
+  engine->nbRunning = engine->nbWorkers;
+  engine->generation++;
+  pthread_cond_broadcast(&engine->start);
+  while(engine->nbRunning) pthread_cond_wait(&engine->done, &engine->lock);
+  pthread_mutex_unlock(&engine->lock);
+}
+
+/*--------------------------------------------------------------------------*
+ * Destruction of an engine : the workers are stopped and joined.
+ *
+ * PARAMETER:
+ * *engine       pointer of the engine.
+ *--------------------------------------------------------------------------*/
+void AX25_engineDestroy(AX25_Engine *engine) {
+  unsigned int i;
+
+  if(!engine) return;
+
+  pthread_mutex_lock(&engine->lock);
+  engine->stop = 1;
+  pthread_cond_broadcast(&engine->start);
+  pthread_mutex_unlock(&engine->lock);
+
+  for(i=0; i<engine->nbWorkers; i++) pthread_join(engine->workers[i].thread, NULL);
+
+  pthread_cond_destroy(&engine->done);
+  pthread_cond_destroy(&engine->start);
+  pthread_mutex_destroy(&engine->lock);
+  if(engine->channels) {
+    for(i=0; i<engine->nbChannels; i++) AX25_ringClear(&engine->channels[i].ring);
+  }
+  free(engine->channels);
+  free(engine);
+}
@@ -0,0 +1,33 @@
+#ifndef AX25_ENGINE_H
+#define AX25_ENGINE_H
+
+#include "AX25_Pool.h"
+
+// Specifications
+#define AX25_ENGINE_MAX_WORKERS  64  // Max number of worker threads.
+#define AX25_ENGINE_RING_SIZE    16  // Frame slots per channel.
+
+// Handler called (from a worker thread) for every frame received. The frame
+// includes the flags and the FCS, its status tells if the FCS matches. With
+// a pool (AX25_engineSetPool), the handler may keep the slot after it
+// returns with AX25_poolRetain.
+typedef void (*AX25_FrameHandler)(void *user, unsigned int channel, const AX25_FrameSlot *slot);
+
+// Block of bits from the demodulator of one channel, packed LSB first.
+typedef struct {
+  unsigned int channel;
+  const unsigned char *bits;
+  unsigned long nbBits;
+} AX25_ChannelBlock;
+
+typedef struct AX25_Engine AX25_Engine;
+
+AX25_Engine *AX25_engineCreate(unsigned int nbChannels, unsigned int nbWorkers, AX25_FrameHandler handler, void *user);
+void AX25_engineSetCorrection(AX25_Engine *engine, unsigned char maxErrors);
+void AX25_engineSetFx25(AX25_Engine *engine, unsigned char enable);
+char AX25_engineSetPool(AX25_Engine *engine, AX25_Pool *pool);
+char AX25_engineGetStats(AX25_Engine *engine, unsigned int channel, AX25_StatsSnapshot *snapshot);
+void AX25_engineProcess(AX25_Engine *engine, const AX25_ChannelBlock *blocks, unsigned int nbBlocks);
+void AX25_engineDestroy(AX25_Engine *engine);
+
+#endif /* AX25_ENGINE_H */
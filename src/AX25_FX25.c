@@ -0,0 +1,143 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_FX25.c
+ * FX.25 : forward error correction compatible with AX.25. The frame is
+ * sent as usual (flags, stuffed bits, flags) but inside the data part of a
+ * Reed-Solomon codeword, announced by a correlation tag. A receiver which
+ * ignores FX.25 sees the tag and the check bytes as noise between flags
+ * and still decodes the frame; an FX.25 receiver corrects the codeword
+ * before deframing it.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stddef.h>
+
+#include "AX25_FX25.h"
+#include "AX25_RS.h"
+
+/*--------------------------------------------------------------------------*
+ * Correlation tags of the FX.25 specification (tag 0x01 to 0x0B).
+ *--------------------------------------------------------------------------*/
+static const AX25_Fx25Code fx25Codes[AX25_FX25_NB_CODES] = {
+  {0xB74DB7DF8A532F3EULL, 255, 239},
+  {0x26FF60A600CC8FDEULL, 144, 128},
+  {0xC7DC0508F3D9B09EULL,  80,  64},
+  {0x8F056EB4369660EEULL,  48,  32},
+  {0x6E260B1AC5835FAEULL, 255, 223},
+  {0xFF94DC634F1CFF4EULL, 160, 128},
+  {0x1EB7B9CDBC09C00EULL,  96,  64},
+  {0xDBF869BD2DBB1776ULL,  64,  32},
+  {0x3ADB0C13DEAE2836ULL, 255, 191},
+  {0xAB69DB6A543188D6ULL, 192, 128},
+  {0x4A4ABEC4A724B796ULL, 128,  64}
+};
+
+/*--------------------------------------------------------------------------*
+ * RETURN:
+ * the code of a correlation tag (1 to AX25_FX25_NB_CODES), or NULL.
+ *--------------------------------------------------------------------------*/
+const AX25_Fx25Code *AX25_fx25Code(unsigned char tag) {
+  if(tag < 1 || tag > AX25_FX25_NB_CODES) return NULL;
+  return &fx25Codes[tag - 1];
+}
+
+/*--------------------------------------------------------------------------*
+ * Detection of a correlation tag in the last 64 bits received. The tags
+ * are at least 32 bits apart, so up to AX25_FX25_TAG_ERRORS wrong bits are
+ * accepted.
+ *
+ * PARAMETER:
+ * window        the last 64 decoded bits (the oldest one in bit 0).
+ *
+ * RETURN:
+ * the tag (1 to AX25_FX25_NB_CODES), or 0 if there is none.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_fx25Match(uint64_t window) {
+  unsigned char i;
+
+  for(i=0; i<AX25_FX25_NB_CODES; i++) {
+    if(__builtin_popcountll(window ^ fx25Codes[i].tag) <= AX25_FX25_TAG_ERRORS) return i + 1;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Selection of the shortest code able to carry a frame.
+ *
+ * PARAMETERS:
+ * nbDataBytes   bytes of the HDLC bitstream of the frame.
+ * nbCheck       check bytes (16, 32 or 64, 0 : any).
+ *
+ * RETURN:
+ * the tag of the code, or 0 if the frame is too long.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_fx25Select(unsigned int nbDataBytes, unsigned int nbCheck) {
+  unsigned char i, best = 0;
+
+  for(i=0; i<AX25_FX25_NB_CODES; i++) {
+    if(fx25Codes[i].k < nbDataBytes) continue;
+    if(nbCheck && fx25Codes[i].n - fx25Codes[i].k != (int) nbCheck) continue;
+    if(!best || fx25Codes[i].n < fx25Codes[best - 1].n) best = i + 1;
+  }
+  return best;
+}
+
+/*--------------------------------------------------------------------------*
+ * Size of the output buffer needed by AX25_fx25EncodeFrame.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_fx25EncodedSize(unsigned int nbDelayFlags, unsigned int nbTailFlags) {
+  return nbDelayFlags + 8 + AX25_RS_SIZE + nbTailFlags;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk encoding of a frame in FX.25 : TX_DELAY flags, correlation tag,
+ * codeword and TX_TAIL flags, NRZI encoded and scrambled. The codeword is
+ * not bit stuffed. The frame is not modified.
+ *
+ * PARAMETERS:
+ * *line          pointer of the line encoder.
+ * *buffer        pointer of the frame (flags included).
+ * lengthFrame    length of the frame (in bytes).
+ * nbCheck        check bytes (16, 32 or 64, 0 : the shortest codeword).
+ * nbDelayFlags   number of flags sent before the frame.
+ * nbTailFlags    number of flags sent after the frame.
+ * *out           pointer of the output buffer (see AX25_fx25EncodedSize).
+ *
+ * RETURN:
+ * the number of bits written in the output buffer, or 0 if the frame does
+ * not fit in a codeword (it must then be sent as plain AX.25).
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_fx25EncodeFrame(AX25_TxLine *line, const char *buffer, unsigned int lengthFrame, unsigned int nbCheck,
+                                   unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out) {
+  unsigned char codeword[2 * AX25_RS_SIZE], tag[8];
+  const AX25_Fx25Code *code;
+  AX25_TxWriter writer;
+  unsigned long nbBits, i;
+
+  // HDLC bitstream of the frame, without line encoding.
+  AX25_txWriterInit(&writer, NULL, codeword);
+  AX25_txWriterFlags(&writer, 1);
+  AX25_txWriterData(&writer, buffer + 1, lengthFrame - 2);
+  AX25_txWriterFlags(&writer, 1);
+  nbBits = AX25_txWriterFinish(&writer);
+
+  code = AX25_fx25Code(AX25_fx25Select((unsigned int) (nbBits + 7) / 8, nbCheck));
+  if(!code) return 0;
+
+  // Padding with flags, then check bytes.
+  for(i=nbBits; i<8UL*code->k; i++) {
+    if((0x7E >> ((i - nbBits) & 7)) & 1) codeword[i >> 3] |= (unsigned char) (1 << (i & 7));
+    else codeword[i >> 3] &= (unsigned char) ~(1 << (i & 7));
+  }
+  AX25_rsEncode(codeword, code->k, codeword + code->k, code->n - code->k);
+
+  for(i=0; i<8; i++) tag[i] = (unsigned char) (code->tag >> (8 * i));
+
+  AX25_txWriterInit(&writer, line, out);
+  AX25_txWriterFlags(&writer, nbDelayFlags);
+  AX25_txWriterRaw(&writer, tag, 64);
+  AX25_txWriterRaw(&writer, codeword, 8UL * code->n);
+  AX25_txWriterFlags(&writer, nbTailFlags);
+  return AX25_txWriterFinish(&writer);
+}
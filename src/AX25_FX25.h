@@ -0,0 +1,28 @@
+#ifndef AX25_FX25_H
+#define AX25_FX25_H
+
+#include <stdint.h>
+
+#include "AX25_Tx.h"
+
+// FX.25 specifications
+#define AX25_FX25_NB_CODES   11   // Correlation tags 0x01 to 0x0B.
+#define AX25_FX25_TAG_ERRORS 8    // Max wrong bits in a detected tag.
+
+// FX.25 code : a correlation tag (sent LSB first) announces a Reed-Solomon
+// codeword of n bytes, k of data (the HDLC bitstream of an AX.25 frame,
+// flags and stuffed bits included, padded with flags) and n - k of check.
+typedef struct {
+  uint64_t tag;
+  unsigned char n;
+  unsigned char k;
+} AX25_Fx25Code;
+
+const AX25_Fx25Code *AX25_fx25Code(unsigned char tag);
+unsigned char AX25_fx25Match(uint64_t window);
+unsigned char AX25_fx25Select(unsigned int nbDataBytes, unsigned int nbCheck);
+unsigned long AX25_fx25EncodedSize(unsigned int nbDelayFlags, unsigned int nbTailFlags);
+unsigned long AX25_fx25EncodeFrame(AX25_TxLine *line, const char *buffer, unsigned int lengthFrame, unsigned int nbCheck,
+                                   unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out);
+
+#endif /* AX25_FX25_H */
@@ -0,0 +1,333 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Frame.c
+ * Frame builder with any addresses, digipeater path, control and PID. The
+ * header of a frame is encoded once with the state of the FCS register
+ * after it : building a frame is then a copy of the info field and an FCS
+ * update over the info bytes only.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_Frame.h"
+#include "AX25_CRC.h"
+#include "AX25_Tx.h"
+
+/*--------------------------------------------------------------------------*
+ * Reading of an address written "CALL", "CALL-SSID" or, for a digipeater
+ * which has repeated the frame, "CALL-SSID*".
+ *
+ * PARAMETERS:
+ * *address      pointer of the address.
+ * *text         the address in text.
+ *
+ * RETURNS:
+ * 1             if the address is valid.
+ * 0             otherwise.
+ *--------------------------------------------------------------------------*/
+char AX25_addressParse(AX25_Address *address, const char *text) {
+  unsigned int i, ssid = 0;
+
+  for(i=0; text[i] && text[i] != '-' && text[i] != '*'; i++) {
+    if(i == 6) return 0;
+    if(!((text[i] >= 'A' && text[i] <= 'Z') || (text[i] >= 'a' && text[i] <= 'z') || (text[i] >= '0' && text[i] <= '9'))) return 0;
+    address->callsign[i] = (text[i] >= 'a' && text[i] <= 'z') ? (char) (text[i] - 'a' + 'A') : text[i];
+  }
+  if(!i) return 0;
+  address->callsign[i] = '\0';
+  text += i;
+
+  if(*text == '-') {
+    text++;
+    if(*text < '0' || *text > '9') return 0;
+    while(*text >= '0' && *text <= '9') ssid = 10 * ssid + (unsigned int) (*text++ - '0');
+    if(ssid > 15) return 0;
+  }
+  address->ssid = (unsigned char) ssid;
+  address->bit7 = 0;
+  if(*text == '*') {
+    address->bit7 = 1;
+    text++;
+  }
+  return *text == '\0';
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoding of an address field : callsign shifted by one bit and padded
+ * with spaces, then the SSID byte (the reserved bits are set to 1).
+ *--------------------------------------------------------------------------*/
+static void AX25_addressEncode(unsigned char *field, const AX25_Address *address, char last) {
+  unsigned int i;
+
+  for(i=0; i<6 && address->callsign[i]; i++) field[i] = (unsigned char) (address->callsign[i] << 1);
+  for(; i<6; i++) field[i] = ' ' << 1;
+  field[6] = (unsigned char) (0x60 | ((address->ssid & 0x0F) << 1) | (address->bit7 ? 0x80 : 0) | (last ? 0x01 : 0));
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of an address field (see AX25_addressEncode).
+ *
+ * RETURN:
+ * 1 if the callsign is made of letters and digits (padded with spaces),
+ * 0 otherwise.
+ *--------------------------------------------------------------------------*/
+static char AX25_addressDecode(AX25_Address *address, const unsigned char *field) {
+  unsigned int i, length = 0;
+  char c;
+
+  for(i=0; i<6; i++) {
+    c = (char) (field[i] >> 1);
+    if(c == ' ') continue;
+    if(length != i || !((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) return 0;
+    address->callsign[length++] = c;
+  }
+  if(!length) return 0;
+  address->callsign[length] = '\0';
+  address->ssid = (field[6] >> 1) & 0x0F;
+  address->bit7 = field[6] >> 7;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Comparison of two addresses (callsign and SSID, the bit 7 is ignored).
+ *
+ * RETURNS:
+ * 1             if it is the same station.
+ * 0             otherwise.
+ *--------------------------------------------------------------------------*/
+char AX25_addressEqual(const AX25_Address *a, const AX25_Address *b) {
+  return a->ssid == b->ssid && !strcmp(a->callsign, b->callsign);
+}
+
+/*--------------------------------------------------------------------------*
+ * Reading of the address field of a received frame : destination, source
+ * and up to AX25_MAX_DIGIPEATERS digipeaters, the last address has the
+ * bit 0 of its SSID byte set.
+ *
+ * PARAMETERS:
+ * *path         pointer of the addresses.
+ * *bytes        pointer of the frame (after the opening flag).
+ * length        length of the frame (flags excluded).
+ *
+ * RETURN:
+ * the length of the address field, or 0 if it is not valid.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_pathParse(AX25_Path *path, const char *bytes, unsigned int length) {
+  const unsigned char *fields = (const unsigned char *) bytes;
+  unsigned int i, nbAddresses;
+
+  for(nbAddresses=1; ; nbAddresses++) {
+    if(nbAddresses > 2 + AX25_MAX_DIGIPEATERS || AX25_ADDRESS_SIZE * nbAddresses > length) return 0;
+    if(fields[AX25_ADDRESS_SIZE * nbAddresses - 1] & 0x01) break;
+  }
+  if(nbAddresses < 2) return 0;
+
+  if(!AX25_addressDecode(&path->destination, fields) ||
+     !AX25_addressDecode(&path->source, fields + AX25_ADDRESS_SIZE)) return 0;
+  path->nbDigipeaters = nbAddresses - 2;
+  for(i=0; i<path->nbDigipeaters; i++) {
+    if(!AX25_addressDecode(&path->digipeaters[i], fields + AX25_ADDRESS_SIZE * (2 + i))) return 0;
+  }
+  path->length = AX25_ADDRESS_SIZE * nbAddresses;
+  return path->length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoding of an address field.
+ *
+ * PARAMETERS:
+ * *bytes        pointer of the address field.
+ * *path         pointer of the addresses.
+ *
+ * RETURN:
+ * the length of the address field, or 0 if there are too many digipeaters.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_pathEncode(unsigned char *bytes, const AX25_Path *path) {
+  unsigned int i;
+
+  if(path->nbDigipeaters > AX25_MAX_DIGIPEATERS) return 0;
+  AX25_addressEncode(bytes, &path->destination, 0);
+  AX25_addressEncode(bytes + AX25_ADDRESS_SIZE, &path->source, !path->nbDigipeaters);
+  for(i=0; i<path->nbDigipeaters; i++) {
+    AX25_addressEncode(bytes + AX25_ADDRESS_SIZE * (2 + i), &path->digipeaters[i], i + 1 == path->nbDigipeaters);
+  }
+  return AX25_ADDRESS_SIZE * (2 + path->nbDigipeaters);
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoding of a header. The PID is only present in the I and UI frames.
+ *
+ * RETURN:
+ * the length of the header, or 0 if there are too many digipeaters.
+ *--------------------------------------------------------------------------*/
+static unsigned int AX25_headerEncode(unsigned char *bytes, const AX25_Address *destination, const AX25_Address *source,
+                                      const AX25_Address *digipeaters, unsigned int nbDigipeaters,
+                                      unsigned char control, unsigned char pid) {
+  unsigned int i, length;
+
+  if(nbDigipeaters > AX25_MAX_DIGIPEATERS) return 0;
+
+  AX25_addressEncode(bytes, destination, 0);
+  AX25_addressEncode(bytes + AX25_ADDRESS_SIZE, source, !nbDigipeaters);
+  for(i=0; i<nbDigipeaters; i++) {
+    AX25_addressEncode(bytes + AX25_ADDRESS_SIZE * (2 + i), &digipeaters[i], i + 1 == nbDigipeaters);
+  }
+  length = AX25_ADDRESS_SIZE * (2 + nbDigipeaters);
+  bytes[length++] = control;
+  if(!(control & 0x01) || (control & 0xEF) == 0x03) bytes[length++] = pid;
+  return length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Preparation of a header.
+ *
+ * PARAMETERS:
+ * *header        pointer of the header.
+ * *destination   pointer of the destination address.
+ * *source        pointer of the source address.
+ * *digipeaters   pointer of the digipeater path (may be NULL if empty).
+ * nbDigipeaters  number of digipeaters (0 to AX25_MAX_DIGIPEATERS).
+ * control        control field (0x03 for a UI frame).
+ * pid            protocol identifier (0xF0 : no layer 3).
+ *
+ * RETURNS:
+ * 1              if the header is ready.
+ * 0              if there are too many digipeaters.
+ *--------------------------------------------------------------------------*/
+char AX25_headerInit(AX25_FrameHeader *header, const AX25_Address *destination, const AX25_Address *source,
+                     const AX25_Address *digipeaters, unsigned int nbDigipeaters,
+                     unsigned char control, unsigned char pid) {
+  header->length = AX25_headerEncode(header->bytes, destination, source, digipeaters, nbDigipeaters, control, pid);
+  if(!header->length) return 0;
+  header->crc = AX25_crcUpdate(AX25_CRC_INIT, header->bytes, header->length);
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a header cache.
+ *--------------------------------------------------------------------------*/
+void AX25_headerCacheInit(AX25_HeaderCache *cache) {
+  cache->nbHeaders = 0;
+  cache->next = 0;
+  cache->nbHits = 0;
+  cache->nbMisses = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Header of a frame, from the cache when it has already been used. The
+ * header is encoded to be looked up (a few bytes), its FCS is only
+ * computed when it is new. The oldest header is replaced when the cache is
+ * full.
+ *
+ * PARAMETERS:
+ * *cache         pointer of the cache.
+ * others         see AX25_headerInit.
+ *
+ * RETURN:
+ * the header (valid until AX25_HEADER_CACHE_SIZE other headers are added),
+ * or NULL if there are too many digipeaters.
+ *--------------------------------------------------------------------------*/
+const AX25_FrameHeader *AX25_headerCacheGet(AX25_HeaderCache *cache, const AX25_Address *destination,
+                                            const AX25_Address *source, const AX25_Address *digipeaters,
+                                            unsigned int nbDigipeaters, unsigned char control, unsigned char pid) {
+  unsigned char bytes[AX25_HEADER_MAX_SIZE];
+  AX25_FrameHeader *header;
+  unsigned int i, length;
+
+  length = AX25_headerEncode(bytes, destination, source, digipeaters, nbDigipeaters, control, pid);
+  if(!length) return NULL;
+
+  for(i=0; i<cache->nbHeaders; i++) {
+    header = &cache->headers[i];
+    if(header->length == length && !memcmp(header->bytes, bytes, length)) {
+      cache->nbHits++;
+      return header;
+    }
+  }
+
+  if(cache->nbHeaders < AX25_HEADER_CACHE_SIZE) header = &cache->headers[cache->nbHeaders++];
+  else {
+    header = &cache->headers[cache->next];
+    cache->next = (cache->next + 1) % AX25_HEADER_CACHE_SIZE;
+  }
+  memcpy(header->bytes, bytes, length);
+  header->length = length;
+  header->crc = AX25_crcUpdate(AX25_CRC_INIT, bytes, length);
+  cache->nbMisses++;
+  return header;
+}
+
+/*--------------------------------------------------------------------------*
+ * Building of a frame : flags, header, info field and FCS.
+ *
+ * PARAMETERS:
+ * *header            pointer of the header.
+ * *buffer            pointer of the buffer (AX25_FRAME_MAX_SIZE bytes).
+ * *info              pointer of the info field to transmit.
+ * lengthInfoField    length of the info field (in bytes). INFO_MAX_SIZE
+ *                    bytes always fit, whatever the header.
+ *
+ * RETURN:
+ * the length of the frame (in bytes), or 0 if it does not fit in
+ * AX25_FRAME_MAX_SIZE bytes.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_frameBuild(const AX25_FrameHeader *header, char *buffer, const char *info, unsigned int lengthInfoField) {
+  unsigned short crc;
+  unsigned int length;
+
+  if(lengthInfoField > AX25_FRAME_MAX_SIZE - 4 - header->length) return 0;
+
+  buffer[0] = 0x7E;
+  memcpy(buffer + 1, header->bytes, header->length);
+  memcpy(buffer + 1 + header->length, info, lengthInfoField);
+  length = 1 + header->length + lengthInfoField;
+
+  // The FCS register continues from its state after the header.
+  crc = AX25_crcFinal(AX25_crcUpdate(header->crc, info, lengthInfoField));
+  buffer[length++] = (char) (crc & 0xff);
+  buffer[length++] = (char) ((crc >> 8) & 0xff);
+  buffer[length++] = 0x7E;
+  return length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Building of a frame whose info field is made of several fragments. The
+ * fragments are copied once, straight into the frame, and the FCS runs
+ * over the info field in the frame.
+ *
+ * PARAMETERS:
+ * *header            pointer of the header.
+ * *buffer            pointer of the buffer (AX25_FRAME_MAX_SIZE bytes).
+ * *fragments         pointer of the fragments of the info field.
+ * nbFragments        number of fragments.
+ *
+ * RETURN:
+ * the length of the frame (in bytes), or 0 if it does not fit in
+ * AX25_FRAME_MAX_SIZE bytes.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_frameBuildv(const AX25_FrameHeader *header, char *buffer, const AX25_Fragment *fragments,
+                              unsigned int nbFragments) {
+  unsigned int i, length, lengthInfoField = 0;
+  unsigned short crc;
+
+  for(i=0; i<nbFragments; i++) {
+    if(fragments[i].length > AX25_FRAME_MAX_SIZE - 4 - header->length - lengthInfoField) return 0;
+    lengthInfoField += fragments[i].length;
+  }
+
+  buffer[0] = 0x7E;
+  memcpy(buffer + 1, header->bytes, header->length);
+  length = 1 + header->length;
+  for(i=0; i<nbFragments; i++) {
+    memcpy(buffer + length, fragments[i].data, fragments[i].length);
+    length += fragments[i].length;
+  }
+
+  crc = AX25_crcFinal(AX25_crcUpdate(header->crc, buffer + 1 + header->length, lengthInfoField));
+  buffer[length++] = (char) (crc & 0xff);
+  buffer[length++] = (char) ((crc >> 8) & 0xff);
+  buffer[length++] = 0x7E;
+  return length;
+}
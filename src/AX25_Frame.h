@@ -0,0 +1,67 @@
+#ifndef AX25_FRAME_H
+#define AX25_FRAME_H
+
+// Specifications
+#define AX25_ADDRESS_SIZE      7    // Callsign (6 bytes) and SSID byte.
+#define AX25_MAX_DIGIPEATERS   8
+#define AX25_HEADER_MAX_SIZE   (AX25_ADDRESS_SIZE * (2 + AX25_MAX_DIGIPEATERS) + 2)  // Addresses, control, PID.
+#define AX25_HEADER_CACHE_SIZE 16
+
+// Address of a station.
+typedef struct {
+  char callsign[7];            // Up to 6 characters, NUL terminated.
+  unsigned char ssid;          // 0 to 15.
+  unsigned char bit7;          // Bit 7 of the SSID byte : C bit (destination
+                               // and source) or H bit (digipeater).
+} AX25_Address;
+
+// Header of a frame (addresses, control, PID) encoded once, with the state
+// of the FCS register after it.
+typedef struct {
+  unsigned char bytes[AX25_HEADER_MAX_SIZE];
+  unsigned int length;
+  unsigned short crc;
+} AX25_FrameHeader;
+
+// Address field of a received frame. The path is the digipeaters, the H
+// bit (bit7) of the ones which have repeated the frame is set.
+typedef struct {
+  AX25_Address destination;
+  AX25_Address source;
+  AX25_Address digipeaters[AX25_MAX_DIGIPEATERS];
+  unsigned int nbDigipeaters;
+  unsigned int length;         // Bytes of the address field.
+} AX25_Path;
+
+// Fragment of an info field (scatter-gather).
+typedef struct {
+  const void *data;
+  unsigned int length;
+} AX25_Fragment;
+
+// Small cache of the headers in use, for callers sending to a few fixed
+// destinations without keeping the headers themselves.
+typedef struct {
+  AX25_FrameHeader headers[AX25_HEADER_CACHE_SIZE];
+  unsigned int nbHeaders;
+  unsigned int next;           // Next entry replaced when the cache is full.
+  unsigned long nbHits;
+  unsigned long nbMisses;
+} AX25_HeaderCache;
+
+char AX25_addressParse(AX25_Address *address, const char *text);
+char AX25_addressEqual(const AX25_Address *a, const AX25_Address *b);
+unsigned int AX25_pathParse(AX25_Path *path, const char *bytes, unsigned int length);
+unsigned int AX25_pathEncode(unsigned char *bytes, const AX25_Path *path);
+char AX25_headerInit(AX25_FrameHeader *header, const AX25_Address *destination, const AX25_Address *source,
+                     const AX25_Address *digipeaters, unsigned int nbDigipeaters,
+                     unsigned char control, unsigned char pid);
+void AX25_headerCacheInit(AX25_HeaderCache *cache);
+const AX25_FrameHeader *AX25_headerCacheGet(AX25_HeaderCache *cache, const AX25_Address *destination,
+                                            const AX25_Address *source, const AX25_Address *digipeaters,
+                                            unsigned int nbDigipeaters, unsigned char control, unsigned char pid);
+unsigned int AX25_frameBuild(const AX25_FrameHeader *header, char *buffer, const char *info, unsigned int lengthInfoField);
+unsigned int AX25_frameBuildv(const AX25_FrameHeader *header, char *buffer, const AX25_Fragment *fragments,
+                              unsigned int nbFragments);
+
+#endif /* AX25_FRAME_H */
@@ -0,0 +1,235 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_KISS.c
+ * KISS framing between the host and the TNCs : a frame is a type byte
+ * (port and command) and data between two FEND, with FEND and FESC
+ * escaped. The special bytes are rare in the data, so the encoder and the
+ * decoder look for them 16 bytes at a time (SSE2) and copy the runs
+ * between them at once.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_KISS.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define AX25_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*--------------------------------------------------------------------------*
+ * Search of the first byte equal to a or b.
+ *
+ * RETURN:
+ * pointer of the byte, or end if there is none.
+ *--------------------------------------------------------------------------*/
+static const unsigned char *AX25_kissScan(const unsigned char *p, const unsigned char *end, unsigned char a, unsigned char b) {
+#ifdef AX25_HAVE_SSE2
+  const __m128i va = _mm_set1_epi8((char) a);
+  const __m128i vb = _mm_set1_epi8((char) b);
+  __m128i bytes;
+  unsigned int mask;
+
+  while(end - p >= 16) {
+    bytes = _mm_loadu_si128((const __m128i *) p);
+    mask = (unsigned int) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, va), _mm_cmpeq_epi8(bytes, vb)));
+    if(mask) return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#endif
+  while(p < end && *p != a && *p != b) p++;
+  return p;
+}
+
+/*--------------------------------------------------------------------------*
+ * Size of the output buffer needed by AX25_kissEncode (worst case : every
+ * byte escaped).
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_kissEncodedSize(unsigned int length) {
+  return 2UL * length + 4;
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoding of a KISS frame : FEND, type byte, escaped data, FEND.
+ *
+ * PARAMETERS:
+ * port          port of the TNC (0 to 15).
+ * command       command (AX25_KISS_DATA for a frame, AX25_KISS_RETURN to
+ *               leave KISS).
+ * *data         pointer of the data (an AX.25 frame without flags nor FCS
+ *               for AX25_KISS_DATA).
+ * length        length of the data (in bytes).
+ * *out          pointer of the output buffer (see AX25_kissEncodedSize).
+ *
+ * RETURN:
+ * the number of bytes written in the output buffer.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_kissEncode(unsigned char port, unsigned char command, const unsigned char *data,
+                              unsigned int length, unsigned char *out) {
+  const unsigned char *end = data + length, *special;
+  unsigned char type;
+  unsigned long n = 0;
+
+  type = (command == AX25_KISS_RETURN) ? AX25_KISS_RETURN : (unsigned char) ((port << 4) | (command & 0x0F));
+
+  out[n++] = AX25_KISS_FEND;
+  if(type == AX25_KISS_FEND || type == AX25_KISS_FESC) {  // Port 12 or 13.
+    out[n++] = AX25_KISS_FESC;
+    out[n++] = (type == AX25_KISS_FEND) ? AX25_KISS_TFEND : AX25_KISS_TFESC;
+  }
+  else out[n++] = type;
+
+  while(data < end) {
+    special = AX25_kissScan(data, end, AX25_KISS_FEND, AX25_KISS_FESC);
+    memcpy(out + n, data, (size_t) (special - data));
+    n += (unsigned long) (special - data);
+    if(special == end) break;
+    out[n++] = AX25_KISS_FESC;
+    out[n++] = (*special == AX25_KISS_FEND) ? AX25_KISS_TFEND : AX25_KISS_TFESC;
+    data = special + 1;
+  }
+  out[n++] = AX25_KISS_FEND;
+  return n;
+}
+
+/*--------------------------------------------------------------------------*
+ * Removal of the escapes of a frame, in place. A FESC followed by another
+ * byte than TFEND or TFESC is dropped and the byte is kept.
+ *
+ * PARAMETERS:
+ * *data         pointer of the frame (without FEND).
+ * length        length of the frame (in bytes).
+ *
+ * RETURN:
+ * the length of the frame without escapes.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_kissUnescape(unsigned char *data, unsigned int length) {
+  const unsigned char *p = data, *end = data + length, *escape;
+  unsigned char *q = data;
+
+  while(p < end) {
+    escape = AX25_kissScan(p, end, AX25_KISS_FESC, AX25_KISS_FESC);
+    if(q != p) memmove(q, p, (size_t) (escape - p));
+    q += escape - p;
+    if(escape + 1 >= end) break;  // No escape left, or a FESC at the end.
+    if(escape[1] == AX25_KISS_TFEND) *q++ = AX25_KISS_FEND;
+    else if(escape[1] == AX25_KISS_TFESC) *q++ = AX25_KISS_FESC;
+    else *q++ = escape[1];
+    p = escape + 2;
+  }
+  return (unsigned int) (q - data);
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a streaming decoder.
+ *
+ * PARAMETERS:
+ * *decoder      pointer of the decoder.
+ * *buffer       pointer of the buffer of the frames.
+ * capacity      size of the buffer (in bytes, type byte included).
+ *--------------------------------------------------------------------------*/
+void AX25_kissDecoderInit(AX25_KissDecoder *decoder, unsigned char *buffer, unsigned int capacity) {
+  decoder->inFrame = 0;
+  decoder->escape = 0;
+  decoder->oversize = 0;
+  decoder->length = 0;
+  decoder->capacity = capacity;
+  decoder->buffer = buffer;
+  decoder->nbFrames = 0;
+  decoder->nbOversizes = 0;
+  decoder->nbBadEscapes = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Stocks bytes of the current frame.
+ *--------------------------------------------------------------------------*/
+static void AX25_kissStock(AX25_KissDecoder *decoder, const unsigned char *bytes, unsigned int n) {
+  if(decoder->oversize) return;
+  if(n > decoder->capacity - decoder->length) {
+    decoder->oversize = 1;
+    return;
+  }
+  memcpy(decoder->buffer + decoder->length, bytes, n);
+  decoder->length += n;
+}
+
+/*--------------------------------------------------------------------------*
+ * Handling of a FEND : the current frame (if any) is given to the handler
+ * and the next one begins.
+ *--------------------------------------------------------------------------*/
+static void AX25_kissEnd(AX25_KissDecoder *decoder, AX25_KissHandler handler, void *user) {
+  unsigned char type;
+
+  if(decoder->oversize) decoder->nbOversizes++;
+  else if(decoder->length) {
+    type = decoder->buffer[0];
+    if(type == AX25_KISS_RETURN) handler(user, 0, AX25_KISS_RETURN, decoder->buffer + 1, decoder->length - 1);
+    else handler(user, type >> 4, type & 0x0F, decoder->buffer + 1, decoder->length - 1);
+    decoder->nbFrames++;
+  }
+  decoder->inFrame = 1;
+  decoder->escape = 0;
+  decoder->oversize = 0;
+  decoder->length = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_kissDecode is the main function of the decoder. The bytes from the
+ * TNC can be given in blocks of any size, the frames may span several
+ * blocks. The bytes before the first FEND and the empty frames (FEND used
+ * as a separator) are ignored.
+ *
+ * PARAMETERS:
+ * *decoder      pointer of the decoder.
+ * *bytes        pointer of the bytes from the TNC.
+ * nbBytes       number of bytes.
+ * handler       function called for each frame.
+ * *user         pointer given to the handler.
+ *
+ * RETURN:
+ * the number of frames given to the handler.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_kissDecode(AX25_KissDecoder *decoder, const unsigned char *bytes, unsigned long nbBytes,
+                              AX25_KissHandler handler, void *user) {
+  const unsigned char *p = bytes, *end = bytes + nbBytes, *special;
+  unsigned long nbFrames = decoder->nbFrames;
+  unsigned char byte;
+
+  while(p < end) {
+    if(!decoder->inFrame) {
+      p = AX25_kissScan(p, end, AX25_KISS_FEND, AX25_KISS_FEND);
+      if(p == end) break;
+      AX25_kissEnd(decoder, handler, user);
+      p++;
+      continue;
+    }
+
+    if(decoder->escape) {
+      decoder->escape = 0;
+      byte = *p;
+      if(byte == AX25_KISS_FEND) {  // Escape not completed.
+        decoder->nbBadEscapes++;
+        continue;
+      }
+      if(byte == AX25_KISS_TFEND) byte = AX25_KISS_FEND;
+      else if(byte == AX25_KISS_TFESC) byte = AX25_KISS_FESC;
+      else decoder->nbBadEscapes++;
+      AX25_kissStock(decoder, &byte, 1);
+      p++;
+      continue;
+    }
+
+    // Run of data, up to the next special byte.
+    special = AX25_kissScan(p, end, AX25_KISS_FEND, AX25_KISS_FESC);
+    AX25_kissStock(decoder, p, (unsigned int) (special - p));
+    p = special;
+    if(p == end) break;
+
+    if(*p == AX25_KISS_FESC) decoder->escape = 1;
+    else AX25_kissEnd(decoder, handler, user);
+    p++;
+  }
+  return decoder->nbFrames - nbFrames;
+}
@@ -0,0 +1,47 @@
+#ifndef AX25_KISS_H
+#define AX25_KISS_H
+
+// KISS special bytes
+#define AX25_KISS_FEND        0xC0  // Frame end (and start).
+#define AX25_KISS_FESC        0xDB  // Escape.
+#define AX25_KISS_TFEND       0xDC  // FEND escaped.
+#define AX25_KISS_TFESC       0xDD  // FESC escaped.
+
+// KISS commands (low nibble of the type byte, the port is the high nibble)
+#define AX25_KISS_DATA        0x00
+#define AX25_KISS_TXDELAY     0x01
+#define AX25_KISS_PERSIST     0x02
+#define AX25_KISS_SLOTTIME    0x03
+#define AX25_KISS_TXTAIL      0x04
+#define AX25_KISS_FULLDUPLEX  0x05
+#define AX25_KISS_SETHARDWARE 0x06
+#define AX25_KISS_RETURN      0xFF  // Exit from KISS (all ports).
+
+// Handler called for every KISS frame decoded. The data (without the type
+// byte) is only valid during the call.
+typedef void (*AX25_KissHandler)(void *user, unsigned char port, unsigned char command,
+                                 const unsigned char *data, unsigned int length);
+
+// Streaming KISS decoder. The frames are unescaped into a buffer given by
+// the caller, so the decoder never allocates memory.
+typedef struct {
+  unsigned char inFrame;       // A FEND has been received.
+  unsigned char escape;        // The last byte was a FESC.
+  unsigned char oversize;      // The current frame does not fit : dropped.
+  unsigned int length;         // Bytes of the current frame (type byte included).
+  unsigned int capacity;
+  unsigned char *buffer;
+  unsigned long nbFrames;
+  unsigned long nbOversizes;
+  unsigned long nbBadEscapes;  // FESC followed by neither TFEND nor TFESC.
+} AX25_KissDecoder;
+
+unsigned long AX25_kissEncodedSize(unsigned int length);
+unsigned long AX25_kissEncode(unsigned char port, unsigned char command, const unsigned char *data,
+                              unsigned int length, unsigned char *out);
+unsigned int AX25_kissUnescape(unsigned char *data, unsigned int length);
+void AX25_kissDecoderInit(AX25_KissDecoder *decoder, unsigned char *buffer, unsigned int capacity);
+unsigned long AX25_kissDecode(AX25_KissDecoder *decoder, const unsigned char *bytes, unsigned long nbBytes,
+                              AX25_KissHandler handler, void *user);
+
+#endif /* AX25_KISS_H */
@@ -0,0 +1,688 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Link.c
+ * Connected mode of AX.25 v2.2 (one link between two stations) : SABM(E),
+ * UA, DISC, DM, I, RR, RNR, REJ and SREJ frames, modulo 8 or 128, T1 from
+ * the RTT measured on the acknowledgements, T2 and T3.
+ *
+ * With selective reject, the I frames received out of sequence are kept
+ * and only the missing ones are asked again : on a long link, a lost frame
+ * no longer costs a whole window. On T1, the last I frame is sent again as
+ * the poll, so that the other end asks for everything it is missing.
+ *
+ * The link has no thread nor clock : the received frames are given to
+ * AX25_linkFrame and AX25_linkPoll is called regularly (every 10 ms or so)
+ * for the timers, both with the current time.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_Link.h"
+#include "AX25_CRC.h"
+
+/*--------------------------------------------------------------------------*
+ * Default parameters.
+ *
+ * PARAMETERS:
+ * *params        pointer of the parameters.
+ * modulo128      1 for a modulo 128 link with selective reject, 0 for a
+ *                modulo 8 link with REJ (compatible with every TNC).
+ *--------------------------------------------------------------------------*/
+void AX25_linkDefaults(AX25_LinkParams *params, unsigned char modulo128) {
+  params->modulo128 = modulo128 ? 1 : 0;
+  params->srej = params->modulo128;
+  params->window = modulo128 ? 32 : 7;
+  params->paclen = INFO_MAX_SIZE;
+  params->retries = 10;
+  params->t1 = 3000;
+  params->t1Min = 100;
+  params->t1Max = 30000;
+  params->t2 = 50;
+  params->t3 = 180000;
+}
+
+/*--------------------------------------------------------------------------*
+ * Sequence numbers.
+ *--------------------------------------------------------------------------*/
+static unsigned int AX25_linkSeq(const AX25_Link *link, unsigned int n) {
+  return n & (link->modulus - 1u);
+}
+
+static unsigned int AX25_linkOutstanding(const AX25_Link *link) {
+  return AX25_linkSeq(link, link->vs - link->va);
+}
+
+/*--------------------------------------------------------------------------*
+ * Transmission of a frame : addresses of a command or of a response,
+ * control field (1 or 2 bytes), PID and info field of the I frames.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkEmit(AX25_Link *link, char command, const unsigned char *control, unsigned int lengthControl,
+                          const unsigned char *info, unsigned int lengthInfo) {
+  const AX25_FrameHeader *header = command ? &link->command : &link->response;
+  unsigned int length, start;
+  unsigned short crc;
+
+  link->frame[0] = 0x7E;
+  memcpy(link->frame + 1, header->bytes, header->length);
+  start = length = 1 + header->length;
+  memcpy(link->frame + length, control, lengthControl);
+  length += lengthControl;
+  if(info) {
+    link->frame[length++] = (char) AX25_LINK_PID;
+    memcpy(link->frame + length, info, lengthInfo);
+    length += lengthInfo;
+  }
+
+  crc = AX25_crcFinal(AX25_crcUpdate(header->crc, link->frame + start, length - start));
+  link->frame[length++] = (char) (crc & 0xff);
+  link->frame[length++] = (char) ((crc >> 8) & 0xff);
+  link->frame[length++] = 0x7E;
+  link->send(link->user, link->frame, length);
+}
+
+static void AX25_linkSendU(AX25_Link *link, char command, unsigned char control, unsigned char pf) {
+  control |= pf ? AX25_CTRL_PF : 0;
+  AX25_linkEmit(link, command, &control, 1, NULL, 0);
+}
+
+static void AX25_linkSendS(AX25_Link *link, char command, unsigned char type, unsigned int nr, unsigned char pf) {
+  unsigned char control[2];
+
+  if(link->modulus == 8) {
+    control[0] = (unsigned char) ((nr << 5) | (pf ? AX25_CTRL_PF : 0) | type);
+    AX25_linkEmit(link, command, control, 1, NULL, 0);
+  }
+  else {
+    control[0] = type;
+    control[1] = (unsigned char) ((nr << 1) | (pf ? 1 : 0));
+    AX25_linkEmit(link, command, control, 2, NULL, 0);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Transmission of the I frame N(S) = ns, kept in its slot. Its N(R)
+ * acknowledges the frames received.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkSendI(AX25_Link *link, unsigned int ns, unsigned char p) {
+  const AX25_LinkTxSlot *slot = &link->txSlots[ns];
+  unsigned char control[2];
+
+  if(link->modulus == 8) {
+    control[0] = (unsigned char) ((link->vr << 5) | (p ? AX25_CTRL_PF : 0) | (ns << 1));
+    AX25_linkEmit(link, 1, control, 1, slot->data, slot->length);
+  }
+  else {
+    control[0] = (unsigned char) (ns << 1);
+    control[1] = (unsigned char) ((link->vr << 1) | (p ? 1 : 0));
+    AX25_linkEmit(link, 1, control, 2, slot->data, slot->length);
+  }
+  link->ackPending = 0;
+  link->nbIFrames++;
+}
+
+static void AX25_linkResend(AX25_Link *link, unsigned int ns, unsigned char p) {
+  link->txSlots[ns].retransmitted = 1;
+  AX25_linkSendI(link, ns, p);
+  link->nbRetransmits++;
+}
+
+/*--------------------------------------------------------------------------*
+ * Supervisory response to the received frames : RR, or RNR when busy.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkSendAck(AX25_Link *link, char command, unsigned char pf) {
+  AX25_linkSendS(link, command, link->busy ? AX25_CTRL_RNR : AX25_CTRL_RR, link->vr, pf);
+  link->ackPending = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Timers.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkStartT1(AX25_Link *link, unsigned long long now) {
+  link->t1Expiry = now + link->t1;
+  link->t3Expiry = 0;
+}
+
+static void AX25_linkStopT1(AX25_Link *link, unsigned long long now) {
+  link->t1Expiry = 0;
+  link->t3Expiry = link->params.t3 ? now + link->params.t3 : 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * New RTT sample : T1 = SRTT + 4 * RTTVAR (Jacobson), within its bounds.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkRtt(AX25_Link *link, unsigned long long rtt) {
+  long delta;
+
+  if(!link->srtt) {
+    link->srtt = (unsigned long) (rtt << 3);
+    link->rttvar = (unsigned long) (rtt << 1);
+  }
+  else {
+    delta = (long) rtt - (long) (link->srtt >> 3);
+    link->srtt = (unsigned long) ((long) link->srtt + delta);
+    if(delta < 0) delta = -delta;
+    link->rttvar = (unsigned long) ((long) link->rttvar + delta - (long) (link->rttvar >> 2));
+  }
+  if(!link->srtt) link->srtt = 1;
+
+  link->t1 = (link->srtt >> 3) + link->rttvar;
+  if(link->t1 < link->params.t1Min) link->t1 = link->params.t1Min;
+  if(link->t1 > link->params.t1Max) link->t1 = link->params.t1Max;
+}
+
+/*--------------------------------------------------------------------------*
+ * Acknowledgement of the I frames up to N(R) - 1.
+ *
+ * RETURNS:
+ * 1             if N(R) is valid (V(A) <= N(R) <= V(S)).
+ * 0             otherwise.
+ *--------------------------------------------------------------------------*/
+static char AX25_linkAck(AX25_Link *link, unsigned int nr, unsigned long long now) {
+  unsigned int ns;
+  char sample = 1;
+
+  if(AX25_linkSeq(link, nr - link->va) > AX25_linkOutstanding(link)) return 0;
+  if(nr == link->va) return 1;
+
+  // RTT of the last frame acknowledged, unless one of the frames was sent
+  // again : its acknowledgement may then have waited for the others.
+  for(ns=link->va; ns!=nr; ns=AX25_linkSeq(link, ns + 1)) {
+    if(link->txSlots[ns].retransmitted) sample = 0;
+  }
+  if(sample) AX25_linkRtt(link, now - link->txSlots[AX25_linkSeq(link, nr - 1)].sent);
+  link->va = nr;
+  link->retry = 0;
+  if(!link->recovery) {
+    if(AX25_linkOutstanding(link)) AX25_linkStartT1(link, now);
+    else AX25_linkStopT1(link, now);
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initial state of the sequence variables (link established).
+ *--------------------------------------------------------------------------*/
+static void AX25_linkReset(AX25_Link *link, unsigned char modulus, unsigned long long now) {
+  unsigned int i;
+
+  link->modulus = modulus;
+  link->window = link->params.window;
+  if(link->window > (link->params.srej ? modulus / 2u : modulus - 1u)) {
+    link->window = link->params.srej ? modulus / 2u : modulus - 1u;
+  }
+  link->vs = link->va = link->vr = 0;
+  link->recovery = 0;
+  link->peerBusy = 0;
+  link->rejected = 0;
+  link->ackPending = 0;
+  link->retry = 0;
+  for(i=0; i<128; i++) {
+    link->rxSlots[i].present = 0;
+    link->rxSlots[i].requested = 0;
+  }
+  AX25_linkStopT1(link, now);
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a link, disconnected.
+ *
+ * PARAMETERS:
+ * *link          pointer of the link.
+ * *params        pointer of the parameters (see AX25_linkDefaults).
+ * *local         pointer of the address of this station.
+ * *remote        pointer of the address of the other station.
+ * *digipeaters   pointer of the path to the other station (may be NULL).
+ * nbDigipeaters  number of digipeaters.
+ * send           handler of the frames to transmit.
+ * receive        handler of the data received.
+ * *user          pointer given to the handlers.
+ *
+ * RETURNS:
+ * 1              if the link is ready.
+ * 0              if a parameter is not valid.
+ *--------------------------------------------------------------------------*/
+char AX25_linkInit(AX25_Link *link, const AX25_LinkParams *params, const AX25_Address *local,
+                   const AX25_Address *remote, const AX25_Address *digipeaters, unsigned int nbDigipeaters,
+                   AX25_LinkSend send, AX25_LinkReceive receive, void *user) {
+  AX25_Address path[AX25_MAX_DIGIPEATERS], destination = *remote, source = *local;
+  unsigned int i;
+
+  if(!params->window || params->window > (params->modulo128 ? 127u : 7u)) return 0;
+  if(!params->paclen || params->paclen > INFO_MAX_SIZE || !params->retries) return 0;
+  if(!params->t1Min || params->t1Min > params->t1Max) return 0;
+  if(nbDigipeaters > AX25_MAX_DIGIPEATERS) return 0;
+
+  for(i=0; i<nbDigipeaters; i++) {
+    path[i] = digipeaters[i];
+    path[i].bit7 = 0;
+  }
+
+  // Command : C bit of the destination set, response : C bit of the
+  // source set. The control field and the PID are added to each frame.
+  destination.bit7 = 1;
+  source.bit7 = 0;
+  AX25_headerInit(&link->command, &destination, &source, path, nbDigipeaters, AX25_CTRL_UA, 0);
+  destination.bit7 = 0;
+  source.bit7 = 1;
+  AX25_headerInit(&link->response, &destination, &source, path, nbDigipeaters, AX25_CTRL_UA, 0);
+  link->command.length--;
+  link->response.length--;
+  link->command.crc = AX25_crcUpdate(AX25_CRC_INIT, link->command.bytes, link->command.length);
+  link->response.crc = AX25_crcUpdate(AX25_CRC_INIT, link->response.bytes, link->response.length);
+
+  link->params = *params;
+  link->send = send;
+  link->receive = receive;
+  link->user = user;
+  link->state = AX25_LINK_DISCONNECTED;
+  link->busy = 0;
+  link->t1 = params->t1;
+  link->srtt = 0;
+  link->rttvar = 0;
+  link->queueHead = link->queueTail = 0;
+  link->nbIFrames = link->nbRetransmits = link->nbSrej = link->nbRej = 0;
+  link->nbTimeouts = link->nbDuplicates = link->nbBytes = 0;
+  AX25_linkReset(link, params->modulo128 ? 128 : 8, 0);
+  link->t3Expiry = 0;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Connection : SABM (modulo 8) or SABME (modulo 128), repeated on T1.
+ *--------------------------------------------------------------------------*/
+void AX25_linkConnect(AX25_Link *link, unsigned long long now) {
+  AX25_linkReset(link, link->params.modulo128 ? 128 : 8, now);
+  link->state = AX25_LINK_CONNECTING;
+  AX25_linkSendU(link, 1, link->params.modulo128 ? AX25_CTRL_SABME : AX25_CTRL_SABM, 1);
+  AX25_linkStartT1(link, now);
+}
+
+/*--------------------------------------------------------------------------*
+ * Disconnection : DISC, repeated on T1. The data not acknowledged yet is
+ * lost (see AX25_linkPending).
+ *--------------------------------------------------------------------------*/
+void AX25_linkDisconnect(AX25_Link *link, unsigned long long now) {
+  if(link->state == AX25_LINK_DISCONNECTED) return;
+  link->state = AX25_LINK_DISCONNECTING;
+  link->recovery = 0;
+  link->ackPending = 0;
+  link->retry = 0;
+  AX25_linkSendU(link, 1, AX25_CTRL_DISC, 1);
+  AX25_linkStartT1(link, now);
+}
+
+/*--------------------------------------------------------------------------*
+ * Data to send. It is cut into I frames of paclen bytes as the window
+ * opens.
+ *
+ * RETURN:
+ * the number of bytes queued (less than length when the queue is full).
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_linkSendData(AX25_Link *link, const void *data, unsigned int length) {
+  unsigned long room = AX25_LINK_QUEUE_SIZE - (link->queueTail - link->queueHead);
+  unsigned long offset, n;
+
+  if(length > room) length = (unsigned int) room;
+  offset = link->queueTail & (AX25_LINK_QUEUE_SIZE - 1);
+  n = AX25_LINK_QUEUE_SIZE - offset;
+  if(n > length) n = length;
+  memcpy(link->queue + offset, data, n);
+  memcpy(link->queue, (const unsigned char *) data + n, length - n);
+  link->queueTail += length;
+  return length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bytes queued or sent and not acknowledged yet.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_linkPending(const AX25_Link *link) {
+  unsigned long pending = link->queueTail - link->queueHead;
+  unsigned int ns;
+
+  for(ns=link->va; ns!=link->vs; ns=AX25_linkSeq(link, ns + 1)) pending += link->txSlots[ns].length;
+  return pending;
+}
+
+/*--------------------------------------------------------------------------*
+ * Busy condition of this station (no room for the data received) : the I
+ * frames are refused with RNR until it is cleared.
+ *--------------------------------------------------------------------------*/
+void AX25_linkSetBusy(AX25_Link *link, unsigned char busy) {
+  busy = busy ? 1 : 0;
+  if(busy == link->busy) return;
+  link->busy = busy;
+  if(link->state == AX25_LINK_CONNECTED) AX25_linkSendAck(link, 0, 0);
+}
+
+/*--------------------------------------------------------------------------*
+ * Transmission of the new I frames while the window is open.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkPush(AX25_Link *link, unsigned long long now) {
+  AX25_LinkTxSlot *slot;
+  unsigned long queued, offset, n;
+
+  while(link->state == AX25_LINK_CONNECTED && !link->recovery && !link->peerBusy &&
+        AX25_linkOutstanding(link) < link->window && link->queueTail != link->queueHead) {
+    slot = &link->txSlots[link->vs];
+    queued = link->queueTail - link->queueHead;
+    slot->length = queued < link->params.paclen ? (unsigned int) queued : link->params.paclen;
+    offset = link->queueHead & (AX25_LINK_QUEUE_SIZE - 1);
+    n = AX25_LINK_QUEUE_SIZE - offset;
+    if(n > slot->length) n = slot->length;
+    memcpy(slot->data, link->queue + offset, n);
+    memcpy(slot->data + n, link->queue, slot->length - n);
+    link->queueHead += slot->length;
+    slot->retransmitted = 0;
+    slot->sent = now;
+
+    AX25_linkSendI(link, link->vs, 0);
+    link->vs = AX25_linkSeq(link, link->vs + 1);
+    if(!link->t1Expiry) AX25_linkStartT1(link, now);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Answer to a poll : with selective reject, the missing frames are asked
+ * again first (the SREJ or the frames may have been lost), then RR or RNR
+ * with F=1.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkAnswerPoll(AX25_Link *link) {
+  AX25_LinkRxSlot *slot;
+  unsigned int d, last = 0;
+
+  if(link->params.srej) {
+    for(d=1; d<link->modulus/2u; d++) {
+      if(link->rxSlots[AX25_linkSeq(link, link->vr + d)].present) last = d;
+    }
+    for(d=0; d<last; d++) {
+      slot = &link->rxSlots[AX25_linkSeq(link, link->vr + d)];
+      if(!slot->present) {
+        AX25_linkSendS(link, 0, AX25_CTRL_SREJ, AX25_linkSeq(link, link->vr + d), 0);
+        slot->requested = 1;
+        link->nbSrej++;
+      }
+    }
+  }
+  AX25_linkSendAck(link, 0, 1);
+}
+
+/*--------------------------------------------------------------------------*
+ * Data given to the receive handler.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkDeliver(AX25_Link *link, const unsigned char *data, unsigned int length) {
+  if(length) link->receive(link->user, data, length);
+  link->nbBytes += length;
+}
+
+/*--------------------------------------------------------------------------*
+ * I frame received.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkIFrame(AX25_Link *link, unsigned int ns, unsigned char p, const unsigned char *info,
+                            unsigned int lengthInfo, unsigned long long now) {
+  AX25_LinkRxSlot *slot;
+  unsigned int d, s;
+
+  if(link->busy) {
+    if(p) AX25_linkAnswerPoll(link);
+    return;
+  }
+
+  d = AX25_linkSeq(link, ns - link->vr);
+  if(!d) {
+    AX25_linkDeliver(link, info, lengthInfo);
+    link->rxSlots[link->vr].requested = 0;
+    link->vr = AX25_linkSeq(link, link->vr + 1);
+    while(link->rxSlots[link->vr].present) {
+      slot = &link->rxSlots[link->vr];
+      AX25_linkDeliver(link, slot->data, slot->length);
+      slot->present = 0;
+      slot->requested = 0;
+      link->vr = AX25_linkSeq(link, link->vr + 1);
+    }
+    link->rejected = 0;
+    if(!link->ackPending) {
+      link->ackPending = 1;
+      link->t2Expiry = now + link->params.t2;
+    }
+  }
+  else if(link->params.srej && d < link->modulus/2u) {
+    // Kept until the missing frames before it are received.
+    slot = &link->rxSlots[ns];
+    if(slot->present) link->nbDuplicates++;
+    else {
+      slot->present = 1;
+      slot->length = lengthInfo;
+      memcpy(slot->data, info, lengthInfo);
+    }
+    for(s=link->vr; s!=ns && !p; s=AX25_linkSeq(link, s + 1)) {
+      if(!link->rxSlots[s].present && !link->rxSlots[s].requested) {
+        AX25_linkSendS(link, 0, AX25_CTRL_SREJ, s, 0);
+        link->rxSlots[s].requested = 1;
+        link->nbSrej++;
+      }
+    }
+  }
+  else if(!link->params.srej && d <= link->window) {
+    if(!link->rejected) {
+      AX25_linkSendS(link, 0, AX25_CTRL_REJ, link->vr, 0);
+      link->rejected = 1;
+      link->ackPending = 0;
+      link->nbRej++;
+    }
+  }
+  else link->nbDuplicates++;
+
+  if(p) AX25_linkAnswerPoll(link);
+}
+
+/*--------------------------------------------------------------------------*
+ * Supervisory frame received.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkSFrame(AX25_Link *link, char command, unsigned char type, unsigned int nr, unsigned char pf,
+                            unsigned long long now) {
+  unsigned int ns;
+
+  link->peerBusy = type == AX25_CTRL_RNR;
+  if(type == AX25_CTRL_REJ) {
+    for(ns=nr; ns!=link->vs; ns=AX25_linkSeq(link, ns + 1)) AX25_linkResend(link, ns, 0);
+  }
+  else if(type == AX25_CTRL_SREJ) {
+    if(AX25_linkSeq(link, nr - link->va) < AX25_linkOutstanding(link)) AX25_linkResend(link, nr, 0);
+  }
+
+  if(command) {
+    if(pf) AX25_linkAnswerPoll(link);
+  }
+  else if(pf && link->recovery) {
+    // End of the timer recovery. Without selective reject, everything
+    // from N(R) is sent again; with it, the other end has asked for the
+    // missing frames with SREJ.
+    link->recovery = 0;
+    link->retry = 0;
+    if(!link->params.srej && type != AX25_CTRL_REJ) {
+      for(ns=nr; ns!=link->vs; ns=AX25_linkSeq(link, ns + 1)) AX25_linkResend(link, ns, 0);
+    }
+    if(AX25_linkOutstanding(link)) AX25_linkStartT1(link, now);
+    else AX25_linkStopT1(link, now);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Unnumbered frame received.
+ *--------------------------------------------------------------------------*/
+static void AX25_linkUFrame(AX25_Link *link, unsigned char type, unsigned char pf, unsigned long long now) {
+  switch(type) {
+    case AX25_CTRL_SABM:
+    case AX25_CTRL_SABME:
+      if(link->state == AX25_LINK_DISCONNECTING) {
+        AX25_linkSendU(link, 0, AX25_CTRL_DM, pf);
+        break;
+      }
+      AX25_linkReset(link, type == AX25_CTRL_SABME ? 128 : 8, now);
+      link->state = AX25_LINK_CONNECTED;
+      AX25_linkSendU(link, 0, AX25_CTRL_UA, pf);
+      break;
+    case AX25_CTRL_DISC:
+      if(link->state == AX25_LINK_DISCONNECTED || link->state == AX25_LINK_CONNECTING) {
+        AX25_linkSendU(link, 0, AX25_CTRL_DM, pf);
+        break;
+      }
+      AX25_linkSendU(link, 0, AX25_CTRL_UA, pf);
+      link->state = AX25_LINK_DISCONNECTED;
+      link->t1Expiry = link->t3Expiry = 0;
+      link->ackPending = 0;
+      break;
+    case AX25_CTRL_UA:
+      if(link->state == AX25_LINK_CONNECTING) {
+        AX25_linkReset(link, link->modulus, now);
+        link->state = AX25_LINK_CONNECTED;
+      }
+      else if(link->state == AX25_LINK_DISCONNECTING) {
+        link->state = AX25_LINK_DISCONNECTED;
+        link->t1Expiry = link->t3Expiry = 0;
+      }
+      break;
+    case AX25_CTRL_DM:
+      if(link->state != AX25_LINK_DISCONNECTED) {
+        link->state = AX25_LINK_DISCONNECTED;
+        link->t1Expiry = link->t3Expiry = 0;
+        link->ackPending = 0;
+      }
+      break;
+    case AX25_CTRL_FRMR:
+      if(link->state == AX25_LINK_CONNECTED) AX25_linkConnect(link, now);
+      break;
+    default:
+      break;                   // UI, XID, TEST : not for the link.
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_linkFrame processes a frame received (with a good FCS). The frames
+ * of other stations are ignored.
+ *
+ * PARAMETERS:
+ * *link          pointer of the link.
+ * *frame         pointer of the frame (flags and FCS included).
+ * lengthFrame    length of the frame (in bytes).
+ * now            current time (in ms).
+ *--------------------------------------------------------------------------*/
+void AX25_linkFrame(AX25_Link *link, const char *frame, unsigned int lengthFrame, unsigned long long now) {
+  const unsigned char *bytes = (const unsigned char *) frame + 1;
+  unsigned int addresses, length, nr = 0, ns = 0, lengthControl = 1;
+  unsigned char control, pf;
+  char command;
+
+  if(lengthFrame < 4 + 2 * AX25_ADDRESS_SIZE + 1) return;
+  length = lengthFrame - 4;
+
+  // Addresses : from the other station to this one, through all the
+  // digipeaters.
+  for(addresses=AX25_ADDRESS_SIZE; addresses<=length && !(bytes[addresses - 1] & 0x01); addresses+=AX25_ADDRESS_SIZE);
+  if(addresses < 2 * AX25_ADDRESS_SIZE || addresses > AX25_ADDRESS_SIZE * (2 + AX25_MAX_DIGIPEATERS) ||
+     addresses >= length) return;
+  if(memcmp(bytes, link->command.bytes + AX25_ADDRESS_SIZE, AX25_ADDRESS_SIZE - 1) ||
+     ((bytes[AX25_ADDRESS_SIZE - 1] ^ link->command.bytes[2 * AX25_ADDRESS_SIZE - 1]) & 0x1E) ||
+     memcmp(bytes + AX25_ADDRESS_SIZE, link->command.bytes, AX25_ADDRESS_SIZE - 1) ||
+     ((bytes[2 * AX25_ADDRESS_SIZE - 1] ^ link->command.bytes[AX25_ADDRESS_SIZE - 1]) & 0x1E)) return;
+  if(addresses > 2 * AX25_ADDRESS_SIZE && !(bytes[addresses - 1] & 0x80)) return;  // Not repeated yet.
+  command = !(bytes[2 * AX25_ADDRESS_SIZE - 1] & 0x80) || (bytes[AX25_ADDRESS_SIZE - 1] & 0x80);
+
+  control = bytes[addresses];
+  if((control & 0x03) == 0x03) {
+    AX25_linkUFrame(link, control & (unsigned char) ~AX25_CTRL_PF, control & AX25_CTRL_PF, now);
+    AX25_linkPush(link, now);
+    return;
+  }
+
+  if(link->state != AX25_LINK_CONNECTED) {
+    pf = link->modulus == 8 ? (control & AX25_CTRL_PF) : (addresses + 1 < length && (bytes[addresses + 1] & 0x01));
+    if(command && pf) AX25_linkSendU(link, 0, AX25_CTRL_DM, 1);
+    return;
+  }
+  if(link->modulus == 8) {
+    pf = control & AX25_CTRL_PF;
+    nr = control >> 5;
+    ns = (control >> 1) & 0x07;
+  }
+  else {
+    if(addresses + 1 >= length) return;
+    lengthControl = 2;
+    pf = bytes[addresses + 1] & 0x01;
+    nr = bytes[addresses + 1] >> 1;
+    ns = control >> 1;
+  }
+  if(link->params.t3) link->t3Expiry = link->t1Expiry ? 0 : now + link->params.t3;
+
+  if(!(control & 0x01)) {
+    addresses += lengthControl + 1;  // PID
+    if(addresses > length || length - addresses > INFO_MAX_SIZE) return;
+    if(!AX25_linkAck(link, nr, now)) return;
+    AX25_linkIFrame(link, ns, pf, bytes + addresses, length - addresses, now);
+  }
+  else {
+    control &= 0x0F;
+    if(control != AX25_CTRL_SREJ && !AX25_linkAck(link, nr, now)) return;
+    AX25_linkSFrame(link, command, control, nr, pf, now);
+  }
+  AX25_linkPush(link, now);
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_linkPoll runs the timers and sends the new I frames. It must be
+ * called regularly.
+ *
+ * PARAMETERS:
+ * *link          pointer of the link.
+ * now            current time (in ms).
+ *--------------------------------------------------------------------------*/
+void AX25_linkPoll(AX25_Link *link, unsigned long long now) {
+  unsigned char modulo128 = link->modulus == 128;
+
+  if(link->t1Expiry && now >= link->t1Expiry) {
+    link->nbTimeouts++;
+    link->t1 = link->t1 * 2 < link->params.t1Max ? link->t1 * 2 : link->params.t1Max;
+    if(++link->retry > link->params.retries) {
+      // Link failure.
+      if(link->state == AX25_LINK_CONNECTED) AX25_linkSendU(link, 0, AX25_CTRL_DM, 0);
+      link->state = AX25_LINK_DISCONNECTED;
+      link->t1Expiry = link->t3Expiry = 0;
+      link->recovery = 0;
+      link->ackPending = 0;
+      return;
+    }
+
+    switch(link->state) {
+      case AX25_LINK_CONNECTING:
+        AX25_linkSendU(link, 1, modulo128 ? AX25_CTRL_SABME : AX25_CTRL_SABM, 1);
+        break;
+      case AX25_LINK_DISCONNECTING:
+        AX25_linkSendU(link, 1, AX25_CTRL_DISC, 1);
+        break;
+      case AX25_LINK_CONNECTED:
+        link->recovery = 1;
+        if(link->params.srej && AX25_linkOutstanding(link) && !link->peerBusy) {
+          AX25_linkResend(link, AX25_linkSeq(link, link->vs - 1), 1);
+        }
+        else AX25_linkSendAck(link, 1, 1);
+        break;
+      default:
+        break;
+    }
+    AX25_linkStartT1(link, now);
+  }
+
+  if(link->state != AX25_LINK_CONNECTED) return;
+
+  if(link->t3Expiry && !link->t1Expiry && now >= link->t3Expiry) {
+    link->recovery = 1;
+    link->retry = 0;
+    AX25_linkSendAck(link, 1, 1);
+    AX25_linkStartT1(link, now);
+  }
+
+  AX25_linkPush(link, now);
+  if(link->ackPending && now >= link->t2Expiry) AX25_linkSendAck(link, 0, 0);
+}
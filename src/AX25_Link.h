@@ -0,0 +1,116 @@
+#ifndef AX25_LINK_H
+#define AX25_LINK_H
+
+#include "AX25_Frame.h"
+#include "AX25_Tx.h"
+
+// Specifications
+#define AX25_LINK_QUEUE_SIZE   65536   // Bytes waiting to be sent (power of 2).
+#define AX25_LINK_PID          0xF0    // PID of the I frames (no layer 3).
+
+// States of a link
+#define AX25_LINK_DISCONNECTED  0x00
+#define AX25_LINK_CONNECTING    0x01   // SABM(E) sent, waiting for UA.
+#define AX25_LINK_CONNECTED     0x02
+#define AX25_LINK_DISCONNECTING 0x03   // DISC sent, waiting for UA.
+
+// Control fields (P/F bit cleared)
+#define AX25_CTRL_RR           0x01
+#define AX25_CTRL_RNR          0x05
+#define AX25_CTRL_REJ          0x09
+#define AX25_CTRL_SREJ         0x0D
+#define AX25_CTRL_SABM         0x2F
+#define AX25_CTRL_SABME        0x6F
+#define AX25_CTRL_DISC         0x43
+#define AX25_CTRL_DM           0x0F
+#define AX25_CTRL_UA           0x63
+#define AX25_CTRL_FRMR         0x87
+#define AX25_CTRL_PF           0x10    // P/F bit of a U frame or a modulo 8 I/S frame.
+
+// Handlers of a link : frame to transmit (flags and FCS included) and data
+// received in sequence.
+typedef void (*AX25_LinkSend)(void *user, const char *frame, unsigned int length);
+typedef void (*AX25_LinkReceive)(void *user, const unsigned char *data, unsigned int length);
+
+// Parameters of a link (see AX25_linkDefaults).
+typedef struct {
+  unsigned char modulo128;     // SABME : modulo 128 instead of 8.
+  unsigned char srej;          // Selective reject instead of go-back-N (REJ).
+  unsigned int window;         // k : I frames not acknowledged (up to 7 or 127).
+  unsigned int paclen;         // N1 : bytes of info per I frame (up to INFO_MAX_SIZE).
+  unsigned int retries;        // N2 : T1 expirations before the link fails.
+  unsigned long t1;            // First value of T1, before any RTT sample (ms).
+  unsigned long t1Min;         // Bounds of the adaptive T1 (ms).
+  unsigned long t1Max;
+  unsigned long t2;            // Delay of the acknowledgements (ms).
+  unsigned long t3;            // Idle time before the link is polled (ms).
+} AX25_LinkParams;
+
+// I frame sent and not acknowledged yet.
+typedef struct {
+  unsigned int length;
+  unsigned char retransmitted; // No RTT sample from it (Karn).
+  unsigned long long sent;     // Time of the first transmission (ms).
+  unsigned char data[INFO_MAX_SIZE];
+} AX25_LinkTxSlot;
+
+// I frame received out of sequence (selective reject).
+typedef struct {
+  unsigned char present;
+  unsigned char requested;     // SREJ sent for it.
+  unsigned int length;
+  unsigned char data[INFO_MAX_SIZE];
+} AX25_LinkRxSlot;
+
+typedef struct {
+  AX25_LinkParams params;
+  AX25_FrameHeader command;    // Addresses of the commands and of the
+  AX25_FrameHeader response;   // responses, with the FCS state after them.
+  AX25_LinkSend send;
+  AX25_LinkReceive receive;
+  void *user;
+
+  unsigned char state;
+  unsigned char modulus;       // 8 or 128.
+  unsigned int window;         // k, at most modulus / 2 with SREJ.
+  unsigned int vs, va, vr;     // Send, acknowledge and receive state variables.
+  unsigned char recovery;      // Timer recovery : waiting for a response F=1.
+  unsigned char peerBusy;      // RNR received.
+  unsigned char busy;          // RNR sent : the I frames are dropped.
+  unsigned char rejected;      // REJ sent, waiting for the frame V(R).
+  unsigned char ackPending;    // I frames to acknowledge at t2Expiry.
+  unsigned int retry;
+  unsigned long long t1Expiry, t2Expiry, t3Expiry;  // 0 : T1 or T3 stopped.
+
+  unsigned long t1;            // Current T1 (ms).
+  unsigned long srtt;          // Smoothed RTT (ms * 8), 0 before the first sample.
+  unsigned long rttvar;        // Mean deviation of the RTT (ms * 4).
+
+  unsigned char queue[AX25_LINK_QUEUE_SIZE];
+  unsigned long queueHead, queueTail;
+  AX25_LinkTxSlot txSlots[128];
+  AX25_LinkRxSlot rxSlots[128];
+  char frame[AX25_FRAME_MAX_SIZE];
+
+  unsigned long nbIFrames;     // I frames sent (retransmissions included).
+  unsigned long nbRetransmits;
+  unsigned long nbSrej;        // SREJ sent.
+  unsigned long nbRej;         // REJ sent.
+  unsigned long nbTimeouts;    // T1 expirations.
+  unsigned long nbDuplicates;  // I frames received twice.
+  unsigned long nbBytes;       // Bytes given to the receive handler.
+} AX25_Link;
+
+void AX25_linkDefaults(AX25_LinkParams *params, unsigned char modulo128);
+char AX25_linkInit(AX25_Link *link, const AX25_LinkParams *params, const AX25_Address *local,
+                   const AX25_Address *remote, const AX25_Address *digipeaters, unsigned int nbDigipeaters,
+                   AX25_LinkSend send, AX25_LinkReceive receive, void *user);
+void AX25_linkConnect(AX25_Link *link, unsigned long long now);
+void AX25_linkDisconnect(AX25_Link *link, unsigned long long now);
+unsigned int AX25_linkSendData(AX25_Link *link, const void *data, unsigned int length);
+unsigned long AX25_linkPending(const AX25_Link *link);
+void AX25_linkSetBusy(AX25_Link *link, unsigned char busy);
+void AX25_linkFrame(AX25_Link *link, const char *frame, unsigned int lengthFrame, unsigned long long now);
+void AX25_linkPoll(AX25_Link *link, unsigned long long now);
+
+#endif /* AX25_LINK_H */
@@ -0,0 +1,292 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Pool.c
+ * Pool of frame slots allocated once : a slab of cache-line aligned frames
+ * of AX25_FRAME_MAX_SIZE bytes, a lock-free free-list (Treiber stack with
+ * an ABA tag) and, in the pool, a small cache of free frames for every
+ * thread, so that most allocations and releases touch no shared cache
+ * line. The frames are reference counted : a frame given by the receiver
+ * can be kept by several consumers without copy, it goes back to the pool
+ * with its last release.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "AX25_Pool.h"
+
+#define AX25_POOL_EMPTY      0xFFFFFFFFu  // Index of the end of the free-list.
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the pool structures.
+ *--------------------------------------------------------------------------*/
+typedef struct {
+  _Alignas(64) AX25_FrameSlot slot;  // First : a slot is its frame.
+  atomic_uint refs;
+  atomic_uint next;             // Next free frame (free-list).
+  AX25_Pool *pool;
+} AX25_PoolFrame;
+
+// Cache of free frames of one thread.
+typedef struct {
+  _Alignas(64) unsigned int nbFrames;
+  unsigned int frames[AX25_POOL_CACHE_SIZE];
+  atomic_ulong nbAllocs;        // Written by its thread only.
+} AX25_PoolCache;
+
+struct AX25_Pool {
+  AX25_PoolFrame *frames;
+  unsigned int nbFrames;
+  _Alignas(64) _Atomic uint64_t head;  // Tag (high 32 bits) and index of the first free frame.
+  atomic_uint nbFree;
+  atomic_ulong nbAllocs;        // Allocations of the threads without a cache.
+  atomic_ulong nbFailures;
+  AX25_PoolCache caches[AX25_POOL_MAX_THREADS];
+};
+
+// Number of the cache of the thread in every pool (-1 : none yet, or more
+// than AX25_POOL_MAX_THREADS threads). The numbers of the threads which
+// have ended are given again, with the frames left in their caches.
+static _Thread_local int poolThread = -1;
+static atomic_ullong poolThreads;
+static pthread_key_t poolKey;
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+
+/*--------------------------------------------------------------------------*
+ * Free-list : push of a chain of frames (first to last, already linked)
+ * and pop of up to max frames, each with one CAS on the head. The tag of
+ * the head changes at every operation, so a head seen twice is known to be
+ * the same list.
+ *--------------------------------------------------------------------------*/
+static void AX25_poolPush(AX25_Pool *pool, unsigned int first, unsigned int last, unsigned int count) {
+  uint64_t head, next;
+
+  head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+  do {
+    atomic_store_explicit(&pool->frames[last].next, (unsigned int) head, memory_order_relaxed);
+    next = ((head >> 32) + 1) << 32 | first;
+  } while(!atomic_compare_exchange_weak_explicit(&pool->head, &head, next, memory_order_release, memory_order_relaxed));
+  atomic_fetch_add_explicit(&pool->nbFree, count, memory_order_relaxed);
+}
+
+static unsigned int AX25_poolPop(AX25_Pool *pool, unsigned int *frames, unsigned int max) {
+  uint64_t head, next;
+  unsigned int index, n;
+
+  head = atomic_load_explicit(&pool->head, memory_order_acquire);
+  do {
+    n = 0;
+    index = (unsigned int) head;
+    while(n < max && index != AX25_POOL_EMPTY) {
+      frames[n++] = index;
+      index = atomic_load_explicit(&pool->frames[index].next, memory_order_relaxed);
+    }
+    if(!n) return 0;
+    next = ((head >> 32) + 1) << 32 | index;
+  } while(!atomic_compare_exchange_weak_explicit(&pool->head, &head, next, memory_order_acquire, memory_order_acquire));
+  atomic_fetch_sub_explicit(&pool->nbFree, n, memory_order_relaxed);
+  return n;
+}
+
+/*--------------------------------------------------------------------------*
+ * End of a thread : its number is free again.
+ *--------------------------------------------------------------------------*/
+static void AX25_poolThreadEnd(void *arg) {
+  unsigned long long bit = 1ULL << ((unsigned long) arg - 1);
+
+  atomic_fetch_and(&poolThreads, ~bit);
+}
+
+static void AX25_poolKeyInit(void) {
+  pthread_key_create(&poolKey, AX25_poolThreadEnd);
+}
+
+/*--------------------------------------------------------------------------*
+ * Cache of this thread in a pool.
+ *
+ * RETURN:
+ * the cache, or NULL if all the numbers of threads are taken.
+ *--------------------------------------------------------------------------*/
+static AX25_PoolCache *AX25_poolCache(AX25_Pool *pool) {
+  unsigned long long threads;
+  int i;
+
+  if(poolThread < 0) {
+    pthread_once(&poolOnce, AX25_poolKeyInit);
+    threads = atomic_load(&poolThreads);
+    do {
+      if(!~threads) return NULL;
+      i = __builtin_ctzll(~threads);
+    } while(!atomic_compare_exchange_weak(&poolThreads, &threads, threads | (1ULL << i)));
+    poolThread = i;
+    pthread_setspecific(poolKey, (void *) (unsigned long) (i + 1));
+  }
+  return &pool->caches[poolThread];
+}
+
+/*--------------------------------------------------------------------------*
+ * Return of the last count frames of a cache to the pool.
+ *--------------------------------------------------------------------------*/
+static void AX25_poolDrain(AX25_Pool *pool, AX25_PoolCache *cache, unsigned int count) {
+  unsigned int i, first;
+
+  if(!count) return;
+  first = cache->nbFrames - count;
+  for(i=first; i+1<cache->nbFrames; i++) {
+    atomic_store_explicit(&pool->frames[cache->frames[i]].next, cache->frames[i + 1], memory_order_relaxed);
+  }
+  AX25_poolPush(pool, cache->frames[first], cache->frames[cache->nbFrames - 1], count);
+  cache->nbFrames = first;
+}
+
+/*--------------------------------------------------------------------------*
+ * Creation of a pool. Its memory is allocated here only.
+ *
+ * PARAMETERS:
+ * nbFrames      number of frames (1 to AX25_POOL_MAX_FRAMES). Each thread
+ *               may keep up to AX25_POOL_CACHE_SIZE free frames.
+ *
+ * RETURN:
+ * the pool, or NULL if it cannot be created.
+ *--------------------------------------------------------------------------*/
+AX25_Pool *AX25_poolCreate(unsigned int nbFrames) {
+  AX25_Pool *pool;
+  unsigned int i;
+
+  if(!nbFrames || nbFrames > AX25_POOL_MAX_FRAMES) return NULL;
+  pool = (AX25_Pool *) aligned_alloc(64, sizeof(AX25_Pool));
+  if(!pool) return NULL;
+  pool->frames = (AX25_PoolFrame *) aligned_alloc(64, (size_t) nbFrames * sizeof(AX25_PoolFrame));
+  if(!pool->frames) {
+    free(pool);
+    return NULL;
+  }
+
+  pool->nbFrames = nbFrames;
+  for(i=0; i<nbFrames; i++) {
+    atomic_init(&pool->frames[i].refs, 0);
+    atomic_init(&pool->frames[i].next, i + 1 < nbFrames ? i + 1 : AX25_POOL_EMPTY);
+    pool->frames[i].pool = pool;
+  }
+  atomic_init(&pool->head, 0);
+  atomic_init(&pool->nbFree, nbFrames);
+  atomic_init(&pool->nbAllocs, 0);
+  atomic_init(&pool->nbFailures, 0);
+  for(i=0; i<AX25_POOL_MAX_THREADS; i++) {
+    pool->caches[i].nbFrames = 0;
+    atomic_init(&pool->caches[i].nbAllocs, 0);
+  }
+  return pool;
+}
+
+/*--------------------------------------------------------------------------*
+ * Allocation of a frame, with one reference. It comes from the cache of
+ * the thread, refilled from the pool by batches.
+ *
+ * RETURN:
+ * the slot of the frame, or NULL if the pool is empty.
+ *--------------------------------------------------------------------------*/
+AX25_FrameSlot *AX25_poolAlloc(AX25_Pool *pool) {
+  AX25_PoolCache *cache = AX25_poolCache(pool);
+  AX25_PoolFrame *frame;
+  unsigned int index;
+
+  if(!cache) {
+    if(!AX25_poolPop(pool, &index, 1)) index = AX25_POOL_EMPTY;
+  }
+  else {
+    if(!cache->nbFrames) cache->nbFrames = AX25_poolPop(pool, cache->frames, AX25_POOL_BATCH);
+    index = cache->nbFrames ? cache->frames[--cache->nbFrames] : AX25_POOL_EMPTY;
+  }
+  if(index == AX25_POOL_EMPTY) {
+    atomic_fetch_add_explicit(&pool->nbFailures, 1, memory_order_relaxed);
+    return NULL;
+  }
+
+  frame = &pool->frames[index];
+  atomic_store_explicit(&frame->refs, 1, memory_order_relaxed);
+  if(!cache) atomic_fetch_add_explicit(&pool->nbAllocs, 1, memory_order_relaxed);
+  else atomic_store_explicit(&cache->nbAllocs, atomic_load_explicit(&cache->nbAllocs, memory_order_relaxed) + 1,
+                             memory_order_relaxed);
+  return &frame->slot;
+}
+
+/*--------------------------------------------------------------------------*
+ * New reference to a frame of a pool (the caller already holds one).
+ *--------------------------------------------------------------------------*/
+void AX25_poolRetain(AX25_FrameSlot *slot) {
+  atomic_fetch_add_explicit(&((AX25_PoolFrame *) slot)->refs, 1, memory_order_relaxed);
+}
+
+/*--------------------------------------------------------------------------*
+ * Release of a reference to a frame of a pool. After the last one, the
+ * frame goes to the cache of the thread (half of a full cache goes back to
+ * the pool).
+ *--------------------------------------------------------------------------*/
+void AX25_poolRelease(AX25_FrameSlot *slot) {
+  AX25_PoolFrame *frame = (AX25_PoolFrame *) slot;
+  AX25_Pool *pool = frame->pool;
+  AX25_PoolCache *cache;
+  unsigned int index;
+
+  // A single reference is the one of the caller : nobody else can change
+  // the count, which spares the atomic decrement.
+  if(atomic_load_explicit(&frame->refs, memory_order_acquire) != 1) {
+    if(atomic_fetch_sub_explicit(&frame->refs, 1, memory_order_release) != 1) return;
+    atomic_thread_fence(memory_order_acquire);
+  }
+
+  index = (unsigned int) (frame - pool->frames);
+  cache = AX25_poolCache(pool);
+  if(!cache) {
+    AX25_poolPush(pool, index, index, 1);
+    return;
+  }
+  if(cache->nbFrames == AX25_POOL_CACHE_SIZE) AX25_poolDrain(pool, cache, AX25_POOL_BATCH);
+  cache->frames[cache->nbFrames++] = index;
+}
+
+/*--------------------------------------------------------------------------*
+ * Number of references to a frame of a pool.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_poolRefs(const AX25_FrameSlot *slot) {
+  return atomic_load_explicit(&((AX25_PoolFrame *) slot)->refs, memory_order_relaxed);
+}
+
+/*--------------------------------------------------------------------------*
+ * Return of the cache of this thread to the pool (for the counters : the
+ * frames of a cache are never lost).
+ *--------------------------------------------------------------------------*/
+void AX25_poolFlushCache(AX25_Pool *pool) {
+  AX25_PoolCache *cache = AX25_poolCache(pool);
+
+  if(cache) AX25_poolDrain(pool, cache, cache->nbFrames);
+}
+
+/*--------------------------------------------------------------------------*
+ * Counters of a pool.
+ *--------------------------------------------------------------------------*/
+void AX25_poolGetStats(AX25_Pool *pool, AX25_PoolStats *stats) {
+  unsigned int i;
+
+  stats->nbFrames = pool->nbFrames;
+  stats->nbFree = atomic_load_explicit(&pool->nbFree, memory_order_relaxed);
+  stats->nbAllocs = atomic_load_explicit(&pool->nbAllocs, memory_order_relaxed);
+  for(i=0; i<AX25_POOL_MAX_THREADS; i++) {
+    stats->nbAllocs += atomic_load_explicit(&pool->caches[i].nbAllocs, memory_order_relaxed);
+  }
+  stats->nbFailures = atomic_load_explicit(&pool->nbFailures, memory_order_relaxed);
+}
+
+/*--------------------------------------------------------------------------*
+ * Destruction of a pool. No frame of it may be in use.
+ *--------------------------------------------------------------------------*/
+void AX25_poolDestroy(AX25_Pool *pool) {
+  if(!pool) return;
+  free(pool->frames);
+  free(pool);
+}
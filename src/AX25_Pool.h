@@ -0,0 +1,33 @@
+#ifndef AX25_POOL_H
+#define AX25_POOL_H
+
+#include <stdatomic.h>
+
+#include "AX25_Ring.h"
+
+// Specifications
+#define AX25_POOL_MAX_FRAMES   (1u << 20)
+#define AX25_POOL_MAX_THREADS  64    // Threads with a cache (the others use the free-list).
+#define AX25_POOL_CACHE_SIZE   32    // Free frames kept by each thread.
+#define AX25_POOL_BATCH        16    // Frames moved at once between a cache and the pool.
+
+// Counters of a pool.
+typedef struct {
+  unsigned int nbFrames;
+  unsigned int nbFree;           // In the pool, not in the caches of the threads.
+  unsigned long nbAllocs;
+  unsigned long nbFailures;      // Allocations with no frame left.
+} AX25_PoolStats;
+
+typedef struct AX25_Pool AX25_Pool;
+
+AX25_Pool *AX25_poolCreate(unsigned int nbFrames);
+AX25_FrameSlot *AX25_poolAlloc(AX25_Pool *pool);
+void AX25_poolRetain(AX25_FrameSlot *slot);
+void AX25_poolRelease(AX25_FrameSlot *slot);
+unsigned int AX25_poolRefs(const AX25_FrameSlot *slot);
+void AX25_poolFlushCache(AX25_Pool *pool);
+void AX25_poolGetStats(AX25_Pool *pool, AX25_PoolStats *stats);
+void AX25_poolDestroy(AX25_Pool *pool);
+
+#endif /* AX25_POOL_H */
@@ -0,0 +1,210 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Profile.cpp
+ * C interface of the codec specialized for the modem profiles (see
+ * AX25_Profile.hpp). The profile is chosen once per call : the encoder
+ * or the receiver of the profile then runs its own inner loop.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <new>
+
+#include "AX25_Profile.h"
+#include "AX25_Profile.hpp"
+
+namespace {
+
+// Handler of the C callers.
+struct ProfileHandler {
+  AX25_ProfileHandler handler;
+  void *user;
+
+  void operator()(const char *frame, unsigned int lengthFrame, unsigned char status) const {
+    handler(user, frame, lengthFrame, status);
+  }
+};
+
+template <class P> using ProfileDecoder = ax25::Decoder<P, ProfileHandler>;
+
+static_assert(sizeof(ax25::Encoder<ax25::G3ruh38400>) <= sizeof(AX25_ProfileTx::state), "AX25_ProfileTx too small");
+static_assert(sizeof(ProfileDecoder<ax25::G3ruh38400>) <= sizeof(AX25_ProfileRx::state), "AX25_ProfileRx too small");
+static_assert(sizeof(ProfileDecoder<ax25::Afsk1200>) <= sizeof(AX25_ProfileRx::state), "AX25_ProfileRx too small");
+static_assert(ax25::FcsBad == AX25_FRAME_FCS_BAD && ax25::FcsOk == AX25_FRAME_FCS_OK &&
+              ax25::FcsFixed == AX25_FRAME_FCS_FIXED, "AX25_FRAME_FCS_xxx and ax25::FrameStatus differ");
+
+template <class P>
+constexpr AX25_ProfileInfo profileInfo(const char *name) {
+  return { name, P::baud, P::scrambled, P::nrzi, P::msbFirst, P::txDelay, P::txTail, P::frameMaxSize };
+}
+
+const AX25_ProfileInfo profiles[AX25_PROFILE_COUNT] = {
+  profileInfo<ax25::G3ruh9600>("g3ruh9600"),
+  profileInfo<ax25::Afsk1200>("afsk1200"),
+  profileInfo<ax25::G3ruh19200>("g3ruh19200"),
+  profileInfo<ax25::G3ruh38400>("g3ruh38400"),
+};
+
+/*--------------------------------------------------------------------------*
+ * Call of f with the type of the profile (a value of the type).
+ *
+ * RETURN:
+ * 1 if the profile exists, 0 if not.
+ *--------------------------------------------------------------------------*/
+template <class F>
+char withProfile(unsigned char profile, F &&f) {
+  switch(profile) {
+    case AX25_PROFILE_G3RUH_9600: f(ax25::G3ruh9600()); return 1;
+    case AX25_PROFILE_AFSK_1200: f(ax25::Afsk1200()); return 1;
+    case AX25_PROFILE_G3RUH_19200: f(ax25::G3ruh19200()); return 1;
+    case AX25_PROFILE_G3RUH_38400: f(ax25::G3ruh38400()); return 1;
+    default: return 0;
+  }
+}
+
+}  // namespace
+
+/*--------------------------------------------------------------------------*
+ * Description of a profile.
+ *
+ * PARAMETER:
+ * profile       the profile (AX25_PROFILE_xxx).
+ *
+ * RETURN:
+ * the description, or NULL if the profile does not exist.
+ *--------------------------------------------------------------------------*/
+const AX25_ProfileInfo *AX25_profileInfo(unsigned char profile) {
+  return (profile < AX25_PROFILE_COUNT) ? &profiles[profile] : nullptr;
+}
+
+/*--------------------------------------------------------------------------*
+ * Size of the output buffer needed by AX25_profileTxEncodeFrame.
+ *
+ * PARAMETERS:
+ * profile       the profile (AX25_PROFILE_xxx).
+ * lengthFrame   length of the frame, flags included (in bytes).
+ * nbDelayFlags  number of flags sent before the frame.
+ * nbTailFlags   number of flags sent after the frame.
+ *
+ * RETURN:
+ * the size of the output buffer (in bytes), 0 if the profile does not
+ * exist.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_profileEncodedSize(unsigned char profile, unsigned int lengthFrame,
+                                      unsigned int nbDelayFlags, unsigned int nbTailFlags) {
+  unsigned long size = 0;
+
+  withProfile(profile, [&](auto p) {
+    size = ax25::Encoder<decltype(p)>::encodedSize(lengthFrame, nbDelayFlags, nbTailFlags);
+  });
+  return size;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the encoder of a profile.
+ *
+ * PARAMETERS:
+ * *tx           pointer of the encoder.
+ * profile       the profile (AX25_PROFILE_xxx).
+ *
+ * RETURN:
+ * 1 if OK, 0 if the profile does not exist.
+ *--------------------------------------------------------------------------*/
+char AX25_profileTxInit(AX25_ProfileTx *tx, unsigned char profile) {
+  tx->profile = profile;
+  return withProfile(profile, [&](auto p) {
+    new (tx->state) ax25::Encoder<decltype(p)>();
+  });
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoding of a frame built by AX25_buildUIFrame (flags included). The
+ * profile timing is AX25_profileInfo(profile)->txDelay and txTail.
+ *
+ * PARAMETERS:
+ * *tx           pointer of the encoder.
+ * *frame        pointer of the frame.
+ * lengthFrame   length of the frame, flags included (in bytes).
+ * nbDelayFlags  number of flags sent before the frame.
+ * nbTailFlags   number of flags sent after the frame.
+ * *out          pointer of the output buffer (see AX25_profileEncodedSize).
+ *
+ * RETURN:
+ * the number of bits written in the output buffer.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_profileTxEncodeFrame(AX25_ProfileTx *tx, const char *frame, unsigned int lengthFrame,
+                                        unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out) {
+  unsigned long nbBits = 0;
+
+  withProfile(tx->profile, [&](auto p) {
+    auto *encoder = std::launder(reinterpret_cast<ax25::Encoder<decltype(p)> *>(tx->state));
+    nbBits = encoder->encodeFrame(frame, lengthFrame, out, nbDelayFlags, nbTailFlags);
+  });
+  return nbBits;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the receiver of a profile.
+ *
+ * PARAMETERS:
+ * *rx           pointer of the receiver.
+ * profile       the profile (AX25_PROFILE_xxx).
+ * handler       function called for every frame received.
+ * *user         pointer given to the handler.
+ *
+ * RETURN:
+ * 1 if OK, 0 if the profile does not exist.
+ *--------------------------------------------------------------------------*/
+char AX25_profileRxInit(AX25_ProfileRx *rx, unsigned char profile, AX25_ProfileHandler handler, void *user) {
+  rx->profile = profile;
+  return withProfile(profile, [&](auto p) {
+    new (rx->state) ProfileDecoder<decltype(p)>(ProfileHandler{ handler, user });
+  });
+}
+
+/*--------------------------------------------------------------------------*
+ * Correction of the frames whose FCS does not match (G3RUH profiles only,
+ * see AX25_rxStreamSetCorrection).
+ *
+ * PARAMETERS:
+ * *rx           pointer of the receiver.
+ * maxErrors     max number of wrong bits on the air to correct (0 : none).
+ *--------------------------------------------------------------------------*/
+void AX25_profileRxSetCorrection(AX25_ProfileRx *rx, unsigned char maxErrors) {
+  withProfile(rx->profile, [&](auto p) {
+    std::launder(reinterpret_cast<ProfileDecoder<decltype(p)> *>(rx->state))->setCorrection(maxErrors);
+  });
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of the bits from the demodulator. The receiver can be fed with
+ * blocks of any size.
+ *
+ * PARAMETERS:
+ * *rx           pointer of the receiver.
+ * *bits         pointer of the packed bits (bit order of the profile).
+ * nbBits        number of bits.
+ *--------------------------------------------------------------------------*/
+void AX25_profileRxBits(AX25_ProfileRx *rx, const unsigned char *bits, unsigned long nbBits) {
+  withProfile(rx->profile, [&](auto p) {
+    std::launder(reinterpret_cast<ProfileDecoder<decltype(p)> *>(rx->state))->bits(bits, nbBits);
+  });
+}
+
+/*--------------------------------------------------------------------------*
+ * Counters of a receiver.
+ *
+ * PARAMETERS:
+ * *rx           pointer of the receiver.
+ * *counters     pointer of the structure to fill.
+ *--------------------------------------------------------------------------*/
+void AX25_profileRxCounters(const AX25_ProfileRx *rx, AX25_ProfileRxCounters *counters) {
+  withProfile(rx->profile, [&](auto p) {
+    auto *decoder = std::launder(reinterpret_cast<const ProfileDecoder<decltype(p)> *>(rx->state));
+    counters->nbBits = decoder->nbBits;
+    counters->nbFrames = decoder->nbFrames;
+    counters->nbAborts = decoder->nbAborts;
+    counters->nbOversizes = decoder->nbOversizes;
+    counters->nbCorrected = decoder->nbCorrected;
+  });
+}
@@ -0,0 +1,71 @@
+#ifndef AX25_PROFILE_H
+#define AX25_PROFILE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "AX25_CRC.h"
+
+// Modem profiles of the specialized codec (see AX25_Profile.hpp).
+#define AX25_PROFILE_G3RUH_9600   0x00  // 9600 bauds, G3RUH scrambler and NRZI (AX25_Tx and AX25_Rx).
+#define AX25_PROFILE_AFSK_1200    0x01  // 1200 bauds AFSK, NRZI without scrambler.
+#define AX25_PROFILE_G3RUH_19200  0x02  // 19200 bauds, G3RUH scrambler and NRZI.
+#define AX25_PROFILE_G3RUH_38400  0x03  // 38400 bauds, G3RUH scrambler and NRZI.
+#define AX25_PROFILE_COUNT        4
+
+// Description of a profile.
+typedef struct {
+  const char *name;
+  unsigned int baud;
+  unsigned char scrambled;     // G3RUH scrambler.
+  unsigned char nrzi;
+  unsigned char msbFirst;      // Bit order of the packed bits.
+  unsigned int txDelay;        // Flags before the frame.
+  unsigned int txTail;         // Flags after the frame.
+  unsigned int frameMaxSize;
+} AX25_ProfileInfo;
+
+// Handler called for every frame received. The frame includes its flags
+// and its FCS (status : AX25_FRAME_FCS_xxx) and is valid during the call.
+typedef void (*AX25_ProfileHandler)(void *user, const char *frame, unsigned int lengthFrame, unsigned char status);
+
+// Encoder and receiver of a profile. The state is the C++ object of the
+// profile and is only used through the functions below.
+typedef struct {
+  unsigned char profile;
+  uint64_t state[8];
+} AX25_ProfileTx;
+
+typedef struct {
+  unsigned char profile;
+  uint64_t state[64];
+} AX25_ProfileRx;
+
+// Counters of a receiver.
+typedef struct {
+  unsigned long long nbBits;
+  unsigned long nbFrames;
+  unsigned long nbAborts;
+  unsigned long nbOversizes;
+  unsigned long nbCorrected;
+} AX25_ProfileRxCounters;
+
+const AX25_ProfileInfo *AX25_profileInfo(unsigned char profile);
+unsigned long AX25_profileEncodedSize(unsigned char profile, unsigned int lengthFrame,
+                                      unsigned int nbDelayFlags, unsigned int nbTailFlags);
+char AX25_profileTxInit(AX25_ProfileTx *tx, unsigned char profile);
+unsigned long AX25_profileTxEncodeFrame(AX25_ProfileTx *tx, const char *frame, unsigned int lengthFrame,
+                                        unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out);
+char AX25_profileRxInit(AX25_ProfileRx *rx, unsigned char profile, AX25_ProfileHandler handler, void *user);
+void AX25_profileRxSetCorrection(AX25_ProfileRx *rx, unsigned char maxErrors);
+void AX25_profileRxBits(AX25_ProfileRx *rx, const unsigned char *bits, unsigned long nbBits);
+void AX25_profileRxCounters(const AX25_ProfileRx *rx, AX25_ProfileRxCounters *counters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AX25_PROFILE_H */
@@ -0,0 +1,457 @@
+#ifndef AX25_PROFILE_HPP
+#define AX25_PROFILE_HPP
+
+// Codec specialized at compile time for a modem profile (C++17, header
+// only). The line coding (scrambler, NRZI, bit order), the timing and the
+// frame limits are template parameters : the lookup tables are computed by
+// the compiler and the stages a profile does not use are removed, so every
+// profile gets its own inner loops without a test of the configuration.
+// The C callers use AX25_Profile.h.
+
+#include <array>
+#include <cstdint>
+
+extern "C" {
+#include "AX25_CRC.h"
+}
+
+namespace ax25 {
+
+// Modem profile. The scrambler is x^TapB + x^TapA + 1 (TapA = 0 : none),
+// the delay and the tail are given in ms and sent as flags.
+template <unsigned Baud, unsigned TapA, unsigned TapB, bool Nrzi, bool MsbFirst,
+          unsigned DelayMs, unsigned TailMs, unsigned InfoMax = 256>
+struct Profile {
+  static constexpr unsigned baud = Baud;
+  static constexpr unsigned tapA = TapA;
+  static constexpr unsigned tapB = TapB;
+  static constexpr bool scrambled = TapA != 0;
+  static constexpr bool nrzi = Nrzi;
+  static constexpr bool msbFirst = MsbFirst;  // Bit order of the packed bits (LSB first on the air buffers of AX25_Tx).
+  static constexpr unsigned txDelay = (DelayMs * Baud + 7999) / 8000;  // Flags before the frame.
+  static constexpr unsigned txTail = (TailMs * Baud + 7999) / 8000;    // Flags after the frame.
+  static constexpr unsigned infoMaxSize = InfoMax;
+  static constexpr unsigned frameMaxSize = 1 + 70 + 2 + 1 + InfoMax + 2 + 1;  // See AX25_FRAME_MAX_SIZE.
+  static constexpr unsigned frameMinSize = 19;                                // See AX25_FRAME_MIN_SIZE.
+  // The FCS correction of AX25_crcCorrect knows the wrong bits on the air of G3RUH only.
+  static constexpr bool airCorrection = TapA == 12 && TapB == 17 && Nrzi;
+
+  static_assert(!TapA || (TapA < TapB && TapB < 64), "taps of the scrambler out of order");
+  static_assert(Baud >= 8 && InfoMax >= 1, "unusable profile");
+};
+
+// Profiles of the ground station. G3ruh9600 is the profile of AX25_Tx and
+// AX25_Rx (TX_DELAY and TX_TAIL flags).
+using G3ruh9600 = Profile<9600, 12, 17, true, false, 250, 83>;
+using Afsk1200 = Profile<1200, 0, 0, true, false, 250, 83>;
+using G3ruh19200 = Profile<19200, 12, 17, true, false, 250, 83>;
+using G3ruh38400 = Profile<38400, 12, 17, true, false, 250, 83>;
+
+// Status of a frame received (same values as AX25_FRAME_FCS_xxx).
+enum FrameStatus : unsigned char { FcsBad = 0x00, FcsOk = 0x01, FcsFixed = 0x02 };
+
+namespace tables {
+
+// FCS table, one entry per byte (mirrored polynom 0x8408).
+constexpr std::array<uint16_t, 256> makeCrc() {
+  std::array<uint16_t, 256> table{};
+  for(unsigned i=0; i<256; i++) {
+    unsigned crc = i;
+    for(unsigned j=0; j<8; j++) crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    table[i] = (uint16_t) crc;
+  }
+  return table;
+}
+
+// Bytes with their bits in the reverse order.
+constexpr std::array<uint8_t, 256> makeReverse() {
+  std::array<uint8_t, 256> table{};
+  for(unsigned i=0; i<256; i++) {
+    unsigned reversed = 0;
+    for(unsigned j=0; j<8; j++) reversed |= ((i >> j) & 1) << (7 - j);
+    table[i] = (uint8_t) reversed;
+  }
+  return table;
+}
+
+// Bit stuffing, for every number of pending ones (0 to 7) and every byte
+// (LSB first) : bit 7 when the ones make a run of five (stuffed bit, flag
+// or abort), else the ones at the end of the byte.
+constexpr std::array<std::array<uint8_t, 256>, 8> makeStuffing() {
+  std::array<std::array<uint8_t, 256>, 8> table{};
+  for(unsigned ones=0; ones<8; ones++) {
+    for(unsigned byte=0; byte<256; byte++) {
+      unsigned run = ones, entry = (ones >= 5) ? 0x80 : 0;
+      for(unsigned i=0; i<8; i++) {
+        run = ((byte >> i) & 1) ? run + 1 : 0;
+        if(run >= 5) entry = 0x80;
+      }
+      table[ones][byte] = (uint8_t) (entry ? entry : run);
+    }
+  }
+  return table;
+}
+
+inline constexpr auto crc = makeCrc();
+inline constexpr auto reverse = makeReverse();
+inline constexpr auto stuffing = makeStuffing();
+
+}  // namespace tables
+
+/*--------------------------------------------------------------------------*
+ * FCS register after the bytes (initial value AX25_CRC_INIT, a frame with
+ * its FCS gives AX25_CRC_GOOD).
+ *--------------------------------------------------------------------------*/
+inline uint16_t crcUpdate(uint16_t crc, const char *data, unsigned length) {
+  const unsigned char *bytes = (const unsigned char *) data;
+
+  while(length--) crc = (uint16_t) ((crc >> 8) ^ tables::crc[(crc ^ *bytes++) & 0xFF]);
+  return crc;
+}
+
+// Load and store of up to 8 bytes of packed bits in the bit order of the
+// profile (the words are always LSB first).
+template <class P>
+inline uint64_t loadBits(const unsigned char *bits, unsigned nbBytes) {
+  uint64_t word = 0;
+
+  for(unsigned i=0; i<nbBytes; i++) {
+    if constexpr(P::msbFirst) word |= (uint64_t) tables::reverse[bits[i]] << (8 * i);
+    else word |= (uint64_t) bits[i] << (8 * i);
+  }
+  return word;
+}
+
+template <class P>
+inline void storeBits(unsigned char *bits, uint64_t word, unsigned nbBytes) {
+  for(unsigned i=0; i<nbBytes; i++) {
+    if constexpr(P::msbFirst) bits[i] = tables::reverse[(word >> (8 * i)) & 0xFF];
+    else bits[i] = (unsigned char) (word >> (8 * i));
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk encoder of a profile : bit stuffing, NRZI and scrambling of whole
+ * frames (see AX25_txEncodeFrame, bit-exact with it for G3ruh9600). The
+ * state of the line is kept from one frame to the next.
+ *--------------------------------------------------------------------------*/
+template <class P>
+class Encoder {
+ public:
+  Encoder() { reset(); }
+
+  void reset() {
+    history_ = ~(uint64_t) 0;
+    lastBit_ = 0;
+  }
+
+  // Size of the output buffer for a frame (worst case of bit stuffing).
+  static constexpr unsigned long encodedSize(unsigned lengthFrame, unsigned nbDelayFlags = P::txDelay,
+                                             unsigned nbTailFlags = P::txTail) {
+    unsigned long nbBits = 8UL * (lengthFrame - 2);
+    nbBits += nbBits / 5 + 8UL * (nbDelayFlags + nbTailFlags);
+    return (nbBits + 7) / 8;
+  }
+
+  /*------------------------------------------------------------------------*
+   * Encoding of a frame built by AX25_buildUIFrame (flags included) after
+   * nbDelayFlags flags and before nbTailFlags flags.
+   *
+   * PARAMETERS:
+   * *frame        pointer of the frame.
+   * lengthFrame   length of the frame, flags included (in bytes).
+   * *out          pointer of the output buffer (see encodedSize).
+   * nbDelayFlags  number of flags sent before the frame.
+   * nbTailFlags   number of flags sent after the frame.
+   *
+   * RETURN:
+   * the number of bits written in the output buffer.
+   *------------------------------------------------------------------------*/
+  unsigned long encodeFrame(const char *frame, unsigned lengthFrame, unsigned char *out,
+                            unsigned nbDelayFlags = P::txDelay, unsigned nbTailFlags = P::txTail) {
+    out_ = out;
+    nbBits_ = 0;
+    pending_ = 0;
+    nbPending_ = 0;
+    flags(nbDelayFlags);
+    data((const unsigned char *) frame + 1, lengthFrame - 2);  // Flags excluded.
+    flags(nbTailFlags);
+    return finish();
+  }
+
+ private:
+  // NRZI encoding and scrambling of a word (see AX25_txEncodeWord). The
+  // scrambler feeds back its output, so it goes TapA bits at a time.
+  uint64_t encodeWord(uint64_t bits, unsigned nbBits) {
+    uint64_t mask = (nbBits >= 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << nbBits) - 1);
+    uint64_t level = bits & mask;
+
+    if constexpr(P::nrzi) {  // A 0 makes a transition.
+      level = ~bits & mask;
+      level ^= level << 1;
+      level ^= level << 2;
+      level ^= level << 4;
+      level ^= level << 8;
+      level ^= level << 16;
+      level ^= level << 32;
+      level = (level ^ (0 - (uint64_t) lastBit_)) & mask;
+      lastBit_ = (unsigned char) ((level >> (nbBits - 1)) & 1);
+    }
+    if constexpr(P::scrambled) {
+      uint64_t scrambled = 0, history = history_, chunk;
+      unsigned n;
+
+      for(unsigned i=0; i<nbBits; i+=n) {
+        n = (nbBits - i > P::tapA) ? P::tapA : nbBits - i;
+        chunk = ((level >> i) ^ (history >> (64 - P::tapA)) ^ (history >> (64 - P::tapB))) & (((uint64_t) 1 << n) - 1);
+        scrambled |= chunk << i;
+        history = (history >> n) | (chunk << (64 - n));
+      }
+      history_ = history;
+      level = scrambled;
+    }
+    return level;
+  }
+
+  // Append up to 32 bits, every complete word is encoded and stored.
+  void put(uint64_t bits, unsigned nbBits) {
+    bits &= ((uint64_t) 1 << nbBits) - 1;
+    pending_ |= bits << nbPending_;
+    nbPending_ += nbBits;
+    if(nbPending_ >= 64) {
+      storeBits<P>(out_ + (nbBits_ >> 3), encodeWord(pending_, 64), 8);
+      nbBits_ += 64;
+      unsigned overflow = nbPending_ - 64;
+      pending_ = overflow ? bits >> (nbBits - overflow) : 0;
+      nbPending_ = overflow;
+    }
+  }
+
+  void flags(unsigned nbFlags) {
+    for(; nbFlags>=4; nbFlags-=4) put(0x7E7E7E7EUL, 32);
+    while(nbFlags--) put(0x7E, 8);
+  }
+
+  // Data with bit stuffing : a byte without a run of five ones (pending
+  // ones included) goes at once, the others bit by bit.
+  void data(const unsigned char *bytes, unsigned length) {
+    unsigned ones = 0, entry;
+
+    while(length--) {
+      entry = tables::stuffing[ones][*bytes];
+      if(!(entry & 0x80)) {
+        put(*bytes, 8);
+        ones = entry;
+      }
+      else {
+        for(unsigned i=0; i<8; i++) {
+          unsigned bit = (*bytes >> i) & 1;
+          put(bit, 1);
+          ones = bit ? ones + 1 : 0;
+          if(ones == 5) {
+            put(0, 1);  // Stuffed bit.
+            ones = 0;
+          }
+        }
+      }
+      bytes++;
+    }
+  }
+
+  unsigned long finish() {
+    if(nbPending_) {
+      storeBits<P>(out_ + (nbBits_ >> 3), encodeWord(pending_, nbPending_), (nbPending_ + 7) / 8);
+      nbBits_ += nbPending_;
+      pending_ = 0;
+      nbPending_ = 0;
+    }
+    return nbBits_;
+  }
+
+  uint64_t history_;           // Last bits sent, the most recent one in bit 63.
+  unsigned char lastBit_;      // NRZI level.
+  unsigned char *out_;
+  unsigned long nbBits_;
+  uint64_t pending_;
+  unsigned nbPending_;
+};
+
+/*--------------------------------------------------------------------------*
+ * Continuous receiver of a profile (see AX25_rxStreamBits, same frames
+ * and same counters for G3ruh9600, without FX.25). Every frame found is
+ * given to the handler, called as handler(frame, lengthFrame, status) :
+ * the frame includes its flags and its FCS and stays valid during the
+ * call only. The correction of wrong bits uses AX25_crcCorrect, the FCS
+ * engine has to be initialized (AX25_crcInitEngine).
+ *--------------------------------------------------------------------------*/
+template <class P, class Handler>
+class Decoder {
+ public:
+  explicit Decoder(Handler handler) : handler_(handler) { reset(); }
+
+  void reset() {
+    history_ = 0;
+    lastBit_ = 1;
+    hunting_ = true;
+    ones_ = 0;
+    nbAcc_ = 0;
+    acc_ = 0;
+    length_ = 0;
+    nbBits = 0;
+    nbFrames = 0;
+    nbAborts = 0;
+    nbOversizes = 0;
+    nbCorrected = 0;
+  }
+
+  // Max number of wrong bits on the air to correct (0 to 2, G3RUH only).
+  void setCorrection(unsigned char maxErrors) {
+    correction_ = P::airCorrection ? (maxErrors > 2 ? 2 : maxErrors) : 0;
+  }
+
+  /*------------------------------------------------------------------------*
+   * Decoding of the bits from the demodulator, 64 at a time. The receiver
+   * can be fed with blocks of any size.
+   *
+   * PARAMETERS:
+   * *bits         pointer of the packed bits (bit order of the profile).
+   * count         number of bits.
+   *------------------------------------------------------------------------*/
+  void bits(const unsigned char *bits, unsigned long count) {
+    while(count) {
+      unsigned n = (count >= 64) ? 64 : (unsigned) count;
+      deframe(decodeWord(loadBits<P>(bits, (n + 7) >> 3), n), n);
+      bits += 8;
+      count -= n;
+    }
+  }
+
+  unsigned long long nbBits;
+  unsigned long nbFrames;      // Frames given to the handler.
+  unsigned long nbAborts;
+  unsigned long nbOversizes;
+  unsigned long nbCorrected;   // Frames with wrong bits corrected.
+
+ private:
+  // Descrambling and NRZI decoding of a word (see AX25_rxDecodeWord).
+  uint64_t decodeWord(uint64_t bits, unsigned nbBits) {
+    uint64_t mask = (nbBits >= 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << nbBits) - 1);
+    uint64_t level = bits &= mask;
+
+    if constexpr(P::scrambled) {
+      level = bits ^ ((bits << P::tapA) | (history_ >> (64 - P::tapA)))
+                   ^ ((bits << P::tapB) | (history_ >> (64 - P::tapB)));
+      level &= mask;
+      history_ = (nbBits >= 64) ? bits : (history_ >> nbBits) | (bits << (64 - nbBits));
+    }
+    if constexpr(P::nrzi) {  // A 1 when the level does not change.
+      uint64_t decoded = ~(level ^ ((level << 1) | lastBit_)) & mask;
+      lastBit_ = (unsigned char) ((level >> (nbBits - 1)) & 1);
+      level = decoded;
+    }
+    return level;
+  }
+
+  // Deframing of a word a byte at a time (see AX25_rxStreamDeframe).
+  void deframe(uint64_t decoded, unsigned count) {
+    while(count) {
+      unsigned n = (count > 8) ? 8 : count;
+      unsigned byte = (unsigned) decoded & ((1U << n) - 1);
+      unsigned entry = tables::stuffing[ones_][byte];
+
+      if(n == 8 && !(entry & 0x80) && (hunting_ || length_ < capacity)) {
+        if(!hunting_) {  // A whole byte of data.
+          acc_ |= byte << nbAcc_;
+          frame_[1 + length_++] = (char) acc_;
+          acc_ >>= 8;
+        }
+        ones_ = (unsigned char) entry;
+        nbBits += 8;
+      }
+      else {
+        for(unsigned i=0; i<n; i++) bit((byte >> i) & 1);
+      }
+      decoded >>= n;
+      count -= n;
+    }
+  }
+
+  // Analysis of one decoded bit (see AX25_deframerBit).
+  void bit(unsigned value) {
+    nbBits++;
+    if(value) {
+      if(ones_ < 7) ones_++;
+      if(ones_ == 7) {  // Abort.
+        if(!hunting_ && length_) nbAborts++;
+        hunting_ = true;
+        return;
+      }
+      if(ones_ == 6) return;  // Flag or abort.
+    }
+    else {
+      if(ones_ == 6) {  // Flag.
+        if(!hunting_ && nbAcc_ == 6 && length_ + 2 >= P::frameMinSize) deliver();
+        hunting_ = false;
+        ones_ = 0;
+        nbAcc_ = 0;
+        acc_ = 0;
+        length_ = 0;
+        return;
+      }
+      unsigned stuffed = ones_ == 5;
+      ones_ = 0;
+      if(stuffed) return;
+    }
+    if(hunting_) return;
+
+    acc_ |= value << nbAcc_;
+    if(++nbAcc_ == 8) {
+      if(length_ >= capacity) {
+        hunting_ = true;
+        nbOversizes++;
+        return;
+      }
+      frame_[1 + length_++] = (char) acc_;
+      acc_ = 0;
+      nbAcc_ = 0;
+    }
+  }
+
+  void deliver() {
+    unsigned char status = FcsOk, errors;
+
+    if(crcUpdate(AX25_CRC_INIT, frame_ + 1, length_) != AX25_CRC_GOOD) {
+      status = FcsBad;
+      if constexpr(P::airCorrection) {
+        if(correction_) {
+          errors = AX25_crcCorrect(frame_ + 1, length_, correction_);
+          if(errors != AX25_CRC_UNCORRECTABLE) {
+            status = FcsFixed;
+            nbCorrected++;
+          }
+        }
+      }
+    }
+    frame_[0] = 0x7E;
+    frame_[length_ + 1] = 0x7E;
+    nbFrames++;
+    handler_(frame_, length_ + 2, status);
+  }
+
+  static constexpr unsigned capacity = P::frameMaxSize - 2;  // Flags excluded.
+
+  Handler handler_;
+  uint64_t history_;           // Last bits received, the most recent one in bit 63.
+  unsigned char lastBit_;
+  bool hunting_;               // Searching a flag.
+  unsigned char ones_;         // Consecutive ones (up to 7).
+  unsigned char correction_ = 0;
+  unsigned nbAcc_;
+  unsigned acc_;
+  unsigned length_;            // Bytes of the frame (flags excluded).
+  char frame_[P::frameMaxSize];
+};
+
+}  // namespace ax25
+
+#endif /* AX25_PROFILE_HPP */
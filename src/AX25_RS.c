@@ -0,0 +1,280 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_RS.c
+ * Reed-Solomon encoder and decoder of FX.25. The codes are shortened from
+ * RS(255, 255 - nbCheck) : a codeword of n bytes is a full codeword whose
+ * 255 - n first bytes are zeros (and not sent).
+ *
+ * The heavy parts, encoding and syndromes, are products of a vector of
+ * GF(256) elements by a scalar, added to another vector. On x86 they use
+ * PSHUFB : the product of a byte by a constant c is the XOR of c times its
+ * low nibble and of c times its high nibble, each looked up in a 16-byte
+ * table, 16 bytes at a time.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <string.h>
+
+#include "AX25_RS.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AX25_HAVE_SSSE3
+#include <immintrin.h>
+#endif
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the global variables of the GF(256) arithmetic.
+ *--------------------------------------------------------------------------*/
+static unsigned char rsExp[512];   // alpha^i (twice, to skip the modulo).
+static unsigned char rsLog[256];
+static unsigned char rsMulLow[256][16];   // c * x for x = 0 to 15.
+static unsigned char rsMulHigh[256][16];  // c * (x << 4) for x = 0 to 15.
+static unsigned char rsPower[AX25_RS_SIZE][AX25_RS_MAX_CHECK];  // alpha^((1+i)*d).
+static unsigned char rsGenerator[AX25_RS_MAX_CHECK / 16][AX25_RS_MAX_CHECK];
+                                   // Generators (16 to 64 roots), highest
+                                   // coefficients first, leading 1 excluded.
+static pthread_once_t rsOnce = PTHREAD_ONCE_INIT;
+static unsigned char rsSsse3Supported;
+
+/*--------------------------------------------------------------------------*
+ * Product of two elements of GF(256) by shift and add (used while the
+ * tables are built).
+ *--------------------------------------------------------------------------*/
+static unsigned char AX25_rsShiftMultiply(unsigned char a, unsigned char b) {
+  unsigned int product = 0;
+
+  while(b) {
+    if(b & 1) product ^= a;
+    b >>= 1;
+    a = (unsigned char) ((a << 1) ^ ((a & 0x80) ? 0x1D : 0));
+  }
+  return (unsigned char) product;
+}
+
+/*--------------------------------------------------------------------------*
+ * Product of two elements of GF(256) with the tables.
+ *--------------------------------------------------------------------------*/
+static unsigned char AX25_rsMul(unsigned char a, unsigned char b) {
+  return (a && b) ? rsExp[rsLog[a] + rsLog[b]] : 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Building of the tables. Done once, by AX25_rsInit.
+ *--------------------------------------------------------------------------*/
+static void AX25_rsBuildTables(void) {
+  unsigned char polynom[AX25_RS_MAX_CHECK + 1];
+  unsigned int i, j, x, g, nbRoots;
+
+  x = 1;
+  for(i=0; i<255; i++) {
+    rsExp[i] = (unsigned char) x;
+    rsExp[i + 255] = (unsigned char) x;
+    rsLog[x] = (unsigned char) i;
+    x <<= 1;
+    if(x & 0x100) x ^= 0x11D;
+  }
+  rsExp[510] = rsExp[0];
+  rsExp[511] = rsExp[1];
+
+  for(i=0; i<256; i++) {
+    for(j=0; j<16; j++) {
+      rsMulLow[i][j] = AX25_rsShiftMultiply((unsigned char) i, (unsigned char) j);
+      rsMulHigh[i][j] = AX25_rsShiftMultiply((unsigned char) i, (unsigned char) (j << 4));
+    }
+  }
+
+  for(i=0; i<AX25_RS_SIZE; i++) {
+    for(j=0; j<AX25_RS_MAX_CHECK; j++) rsPower[i][j] = rsExp[((1 + j) * i) % 255];
+  }
+
+  // Generator : product of (x - alpha^i) for i = 1 to nbRoots.
+  for(g=0; g<AX25_RS_MAX_CHECK/16; g++) {
+    nbRoots = 16 * (g + 1);
+    memset(polynom, 0, sizeof(polynom));
+    polynom[0] = 1;
+    for(i=1; i<=nbRoots; i++) {
+      for(j=i; j>0; j--) polynom[j] = polynom[j-1] ^ AX25_rsShiftMultiply(polynom[j], rsExp[i]);
+      polynom[0] = AX25_rsShiftMultiply(polynom[0], rsExp[i]);
+    }
+    for(j=0; j<nbRoots; j++) rsGenerator[g][j] = polynom[nbRoots - 1 - j];
+  }
+
+  rsSsse3Supported = 0;
+#ifdef AX25_HAVE_SSSE3
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("ssse3")) rsSsse3Supported = 1;
+#endif
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the tables. It is called by the encoder and the
+ * decoder and may be called from several threads at once : the tables are
+ * built by the first caller, the others wait for them.
+ *--------------------------------------------------------------------------*/
+void AX25_rsInit(void) {
+  pthread_once(&rsOnce, AX25_rsBuildTables);
+}
+
+/*--------------------------------------------------------------------------*
+ * Product of two elements of GF(256).
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_rsMultiply(unsigned char a, unsigned char b) {
+  AX25_rsInit();
+  return AX25_rsMul(a, b);
+}
+
+/*--------------------------------------------------------------------------*
+ * dst[i] += c * src[i] for i < length (length multiple of 16).
+ *--------------------------------------------------------------------------*/
+#ifdef AX25_HAVE_SSSE3
+__attribute__((target("ssse3")))
+static void AX25_rsMulAddSsse3(unsigned char *dst, const unsigned char *src, unsigned char c, unsigned int length) {
+  const __m128i low = _mm_loadu_si128((const __m128i *) rsMulLow[c]);
+  const __m128i high = _mm_loadu_si128((const __m128i *) rsMulHigh[c]);
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  __m128i value, product;
+  unsigned int i;
+
+  for(i=0; i<length; i+=16) {
+    value = _mm_loadu_si128((const __m128i *) (src + i));
+    product = _mm_xor_si128(_mm_shuffle_epi8(low, _mm_and_si128(value, mask)),
+                            _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(value, 4), mask)));
+    _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i *) (dst + i)), product));
+  }
+}
+#endif
+
+static void AX25_rsMulAdd(unsigned char *dst, const unsigned char *src, unsigned char c, unsigned int length) {
+  unsigned int i;
+
+  if(!c) return;
+#ifdef AX25_HAVE_SSSE3
+  if(rsSsse3Supported) {
+    AX25_rsMulAddSsse3(dst, src, c, length);
+    return;
+  }
+#endif
+  for(i=0; i<length; i++) dst[i] ^= rsMulLow[c][src[i] & 0x0F] ^ rsMulHigh[c][src[i] >> 4];
+}
+
+/*--------------------------------------------------------------------------*
+ * Systematic encoding : the check bytes are the remainder of the division
+ * of data(x) * x^nbCheck by the generator, computed by a shift register.
+ *
+ * PARAMETERS:
+ * *data         pointer of the data bytes.
+ * k             number of data bytes (k + nbCheck <= 255).
+ * *check        pointer of the check bytes (sent after the data).
+ * nbCheck       number of check bytes (16, 32, 48 or 64).
+ *--------------------------------------------------------------------------*/
+void AX25_rsEncode(const unsigned char *data, unsigned int k, unsigned char *check, unsigned int nbCheck) {
+  const unsigned char *generator;
+  unsigned char feedback;
+  unsigned int i;
+
+  AX25_rsInit();
+  generator = rsGenerator[nbCheck / 16 - 1];
+
+  memset(check, 0, nbCheck);
+  for(i=0; i<k; i++) {
+    feedback = data[i] ^ check[0];
+    memmove(check, check + 1, nbCheck - 1);
+    check[nbCheck - 1] = 0;
+    AX25_rsMulAdd(check, generator, feedback, nbCheck);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Evaluation of a polynom (coefficient i of x^i) in GF(256).
+ *--------------------------------------------------------------------------*/
+static unsigned char AX25_rsEvaluate(const unsigned char *polynom, unsigned int degree, unsigned char x) {
+  unsigned char value = polynom[degree];
+  unsigned int i;
+
+  for(i=degree; i>0; i--) value = AX25_rsMul(value, x) ^ polynom[i-1];
+  return value;
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of a codeword (errors only). The syndromes are the values of
+ * the codeword at the roots of the generator; the error locator comes from
+ * Berlekamp-Massey, its roots from a Chien search on the n positions of
+ * the codeword and the error values from the Forney formula.
+ *
+ * PARAMETERS:
+ * *codeword     pointer of the codeword (data then check bytes), corrected
+ *               in place.
+ * n             number of bytes of the codeword.
+ * nbCheck       number of check bytes (16, 32, 48 or 64).
+ *
+ * RETURN:
+ * the number of corrected bytes (0 if the codeword is valid), or
+ * AX25_RS_UNCORRECTABLE.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_rsDecode(unsigned char *codeword, unsigned int n, unsigned int nbCheck) {
+  unsigned char syndromes[AX25_RS_MAX_CHECK], lambda[AX25_RS_MAX_CHECK + 1], previous[AX25_RS_MAX_CHECK + 1];
+  unsigned char temp[AX25_RS_MAX_CHECK + 1], omega[AX25_RS_MAX_CHECK];
+  unsigned char positions[AX25_RS_MAX_CHECK / 2], values[AX25_RS_MAX_CHECK / 2];
+  unsigned char delta, lastDelta = 1, scale, xInverse, derivative, value, nbErrors = 0;
+  unsigned int i, j, r, shift = 1, degree = 0;
+
+  AX25_rsInit();
+
+  // Syndromes : S(i) = sum of c(m) * alpha^((1+i)*(n-1-m)).
+  memset(syndromes, 0, sizeof(syndromes));
+  for(i=0; i<n; i++) AX25_rsMulAdd(syndromes, rsPower[n - 1 - i], codeword[i], nbCheck);
+  for(i=0; i<nbCheck && !syndromes[i]; i++);
+  if(i == nbCheck) return 0;
+
+  // Berlekamp-Massey : error locator lambda(x) of degree "degree".
+  memset(lambda, 0, sizeof(lambda));
+  memset(previous, 0, sizeof(previous));
+  lambda[0] = 1;
+  previous[0] = 1;
+  for(r=0; r<nbCheck; r++) {
+    delta = syndromes[r];
+    for(i=1; i<=degree; i++) delta ^= AX25_rsMul(lambda[i], syndromes[r - i]);
+    if(!delta) {
+      shift++;
+      continue;
+    }
+    scale = rsExp[rsLog[delta] + 255 - rsLog[lastDelta]];
+    memcpy(temp, lambda, sizeof(lambda));
+    for(i=0; i+shift<=nbCheck; i++) lambda[i + shift] ^= AX25_rsMul(scale, previous[i]);
+    if(2 * degree <= r) {
+      degree = r + 1 - degree;
+      memcpy(previous, temp, sizeof(previous));
+      lastDelta = delta;
+      shift = 1;
+    }
+    else shift++;
+  }
+  if(degree > nbCheck / 2) return AX25_RS_UNCORRECTABLE;
+
+  // Error evaluator omega(x) = S(x) * lambda(x) mod x^nbCheck.
+  for(i=0; i<nbCheck; i++) {
+    omega[i] = 0;
+    for(j=0; j<=i && j<=degree; j++) omega[i] ^= AX25_rsMul(lambda[j], syndromes[i - j]);
+  }
+
+  // Chien search and Forney : the byte m has the locator alpha^(n-1-m).
+  for(i=0; i<n; i++) {
+    xInverse = rsExp[(255 - (n - 1 - i) % 255) % 255];
+    if(AX25_rsEvaluate(lambda, degree, xInverse)) continue;
+
+    derivative = 0;
+    for(j=1; j<=degree; j+=2) derivative ^= AX25_rsMul(lambda[j], rsExp[(rsLog[xInverse] * (j - 1)) % 255]);
+    value = AX25_rsEvaluate(omega, nbCheck - 1, xInverse);
+    if(!derivative || nbErrors == degree) return AX25_RS_UNCORRECTABLE;
+    positions[nbErrors] = (unsigned char) i;
+    values[nbErrors] = value ? rsExp[rsLog[value] + 255 - rsLog[derivative]] : 0;
+    nbErrors++;
+  }
+  if(nbErrors != degree) return AX25_RS_UNCORRECTABLE;  // Roots outside of the codeword.
+
+  // The codeword is only modified when the whole correction is known.
+  for(i=0; i<nbErrors; i++) codeword[positions[i]] ^= values[i];
+  return nbErrors;
+}
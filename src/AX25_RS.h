@@ -0,0 +1,15 @@
+#ifndef AX25_RS_H
+#define AX25_RS_H
+
+// Reed-Solomon code of FX.25 : GF(256) with the polynom x8+x4+x3+x2+1
+// (0x11D), first consecutive root alpha^1, codewords of up to 255 bytes.
+#define AX25_RS_SIZE          255   // Max bytes of a codeword.
+#define AX25_RS_MAX_CHECK     64    // Max check bytes of a codeword.
+#define AX25_RS_UNCORRECTABLE 0xFF  // The codeword cannot be corrected.
+
+void AX25_rsInit(void);
+unsigned char AX25_rsMultiply(unsigned char a, unsigned char b);
+void AX25_rsEncode(const unsigned char *data, unsigned int k, unsigned char *check, unsigned int nbCheck);
+unsigned char AX25_rsDecode(unsigned char *codeword, unsigned int n, unsigned int nbCheck);
+
+#endif /* AX25_RS_H */
@@ -0,0 +1,130 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Ring.c
+ * Lock-free single-producer / single-consumer ring of frame slots. The
+ * decoder writes a frame directly into the slot it will publish and the
+ * application reads it in place : frames go from one thread to the other
+ * without locks and without copies. With a pool, the frames are not
+ * copied either when the application keeps them.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stddef.h>
+
+#include "AX25_Ring.h"
+#include "AX25_Pool.h"
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a ring.
+ *
+ * PARAMETERS:
+ * *ring         pointer of the ring.
+ * *slots        pointer of the slots.
+ * nbSlots       number of slots (a power of two).
+ *
+ * RETURNS:
+ * 1             if the ring is ready.
+ * 0             if nbSlots is not a power of two.
+ *--------------------------------------------------------------------------*/
+char AX25_ringInit(AX25_FrameRing *ring, AX25_FrameSlot *slots, unsigned int nbSlots) {
+  if(!nbSlots || (nbSlots & (nbSlots - 1))) return 0;
+
+  ring->slots = slots;
+  ring->pool = NULL;
+  ring->mask = nbSlots - 1;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a ring whose slots are frames of a pool. The consumer
+ * keeps a frame beyond AX25_ringRelease with AX25_poolRetain.
+ *
+ * PARAMETERS:
+ * *ring         pointer of the ring.
+ * *pool         pointer of the pool.
+ * nbSlots       number of slots (a power of two, up to AX25_RING_MAX_SIZE).
+ *
+ * RETURNS:
+ * 1             if the ring is ready.
+ * 0             if nbSlots is not valid.
+ *--------------------------------------------------------------------------*/
+char AX25_ringInitPool(AX25_FrameRing *ring, AX25_Pool *pool, unsigned int nbSlots) {
+  unsigned int i;
+
+  if(nbSlots > AX25_RING_MAX_SIZE || !AX25_ringInit(ring, NULL, nbSlots)) return 0;
+  ring->pool = pool;
+  for(i=0; i<nbSlots; i++) ring->table[i] = NULL;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Release of the frames of a pool still held by a ring (frames acquired or
+ * not consumed), when neither side uses it any longer.
+ *--------------------------------------------------------------------------*/
+void AX25_ringClear(AX25_FrameRing *ring) {
+  unsigned int i;
+
+  if(!ring->pool) return;
+  for(i=0; i<=ring->mask; i++) {
+    if(ring->table[i]) AX25_poolRelease(ring->table[i]);
+    ring->table[i] = NULL;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Producer : slot to fill with the next frame. The same slot is returned
+ * until it is published.
+ *
+ * RETURN:
+ * the slot, or NULL if the ring is full (or its pool is empty).
+ *--------------------------------------------------------------------------*/
+AX25_FrameSlot *AX25_ringAcquire(AX25_FrameRing *ring) {
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  AX25_FrameSlot **entry;
+
+  if(head - atomic_load_explicit(&ring->tail, memory_order_acquire) > ring->mask) return NULL;
+  if(!ring->pool) return &ring->slots[head & ring->mask];
+
+  entry = &ring->table[head & ring->mask];
+  if(!*entry) *entry = AX25_poolAlloc(ring->pool);  // NULL : the pool is empty.
+  return *entry;
+}
+
+/*--------------------------------------------------------------------------*
+ * Producer : publication of the slot returned by AX25_ringAcquire.
+ *--------------------------------------------------------------------------*/
+void AX25_ringPublish(AX25_FrameRing *ring) {
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/*--------------------------------------------------------------------------*
+ * Consumer : oldest published frame.
+ *
+ * RETURN:
+ * the slot, or NULL if the ring is empty.
+ *--------------------------------------------------------------------------*/
+AX25_FrameSlot *AX25_ringPeek(AX25_FrameRing *ring) {
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  if(tail == atomic_load_explicit(&ring->head, memory_order_acquire)) return NULL;
+  return ring->pool ? ring->table[tail & ring->mask] : &ring->slots[tail & ring->mask];
+}
+
+/*--------------------------------------------------------------------------*
+ * Consumer : the slot returned by AX25_ringPeek goes back to the producer
+ * (with a pool, the reference of the ring to its frame is released).
+ *--------------------------------------------------------------------------*/
+void AX25_ringRelease(AX25_FrameRing *ring) {
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  if(ring->pool) {
+    AX25_poolRelease(ring->table[tail & ring->mask]);
+    ring->table[tail & ring->mask] = NULL;
+  }
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
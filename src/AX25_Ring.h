@@ -0,0 +1,43 @@
+#ifndef AX25_RING_H
+#define AX25_RING_H
+
+#include <stdatomic.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Rx.h"
+
+// Specifications
+#define AX25_RING_MAX_SIZE   64    // Max slots of a ring taking its frames from a pool.
+
+// Slot of a frame ring. The frame includes the flags and the FCS.
+typedef struct {
+  unsigned int lengthFrame;
+  unsigned char status;
+  unsigned long long bitOffset;  // Position of the end flag in the bitstream.
+  unsigned long long timestamp;  // Decoding of the end flag (AX25_statsClock, 0 : none).
+  char frame[AX25_FRAME_MAX_SIZE];
+} AX25_FrameSlot;
+
+// Single-producer / single-consumer ring of frame slots. The producer fills
+// a slot in place and publishes it, the consumer reads it in place and
+// releases it. head and tail live on separate cache lines. The slots are
+// either an array of the caller or frames of a pool, taken when a slot is
+// acquired and released with it (the consumer may keep a reference).
+typedef struct {
+  AX25_FrameSlot *slots;
+  struct AX25_Pool *pool;
+  AX25_FrameSlot *table[AX25_RING_MAX_SIZE];  // Frames of the pool (NULL : none yet).
+  unsigned int mask;
+  _Alignas(64) atomic_uint head;  // Next slot to publish (producer).
+  _Alignas(64) atomic_uint tail;  // Next slot to release (consumer).
+} AX25_FrameRing;
+
+char AX25_ringInit(AX25_FrameRing *ring, AX25_FrameSlot *slots, unsigned int nbSlots);
+char AX25_ringInitPool(AX25_FrameRing *ring, struct AX25_Pool *pool, unsigned int nbSlots);
+void AX25_ringClear(AX25_FrameRing *ring);
+AX25_FrameSlot *AX25_ringAcquire(AX25_FrameRing *ring);
+void AX25_ringPublish(AX25_FrameRing *ring);
+AX25_FrameSlot *AX25_ringPeek(AX25_FrameRing *ring);
+void AX25_ringRelease(AX25_FrameRing *ring);
+
+#endif /* AX25_RING_H */
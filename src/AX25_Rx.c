@@ -1,172 +1,302 @@
-/*--------------------------------------------------------------------------*
- * OUFTI-1 OBC Embedded software
- * 2008-2009, University of Liege
- *--------------------------------------------------------------------------*
- * AX25_Rx.c
- * Main functions to receive AX.25 UI frames. Included : bit stuffing, NRZI
- * decoding and descrambling. The implementation is compatible with G3RUH 
- * modem 9600 baud FSK.
- * 
- *
- * Johan Hardy
- *--------------------------------------------------------------------------*/
-
-#include "AX25_Rx.h"
-
-/*--------------------------------------------------------------------------*
- * Declaration of the global variables for Rx.
- *--------------------------------------------------------------------------*/
-unsigned char rxMode;
-unsigned char bitSetCounter;
-unsigned char lastBit;
-unsigned long shiftRegister;
-unsigned int byteCounter; 
-unsigned char bitCounter;
-unsigned char checkBitStuff;
-
-/*--------------------------------------------------------------------------*
-* ADF7021 configuration registers (see Excel file) - Freq = 434MHz
-*--------------------------------------------------------------------------*/
-char ADFR0[4] = { 0b01110000 , 0b10111100 , 0b01110011 , 0b00001010 };
-char ADFR1[4] = { 0b00010001 , 0b01010000 , 0b01000111 , 0b00000000 };
-char ADFR3[4] = { 0b11010011 , 0b00110000 , 0b10111000 , 0b00101001 };
-char ADFR4[4] = { 0b10010100 , 0b00001010 , 0b11010011 , 0b10000000 };  // Invert Data !!
-char ADFR5[4] = { 0b10110101 , 0b00011011 , 0b00000000 , 0b00000000 };
-char ADFR6[4] = { 0b00000110 , 0b00000000 , 0b00000000 , 0b00000000 };
-char ADFR8[4] = { 0b11011000 , 0b00000111 , 0b00000000 , 0b00000000 };
-
-/*--------------------------------------------------------------------------*
- * Initialization of the reception. The routine switches rxMode from 
- * RX_OFF to RX_FIRST_FLAG_MODE and resets the main variables.
- *--------------------------------------------------------------------------*/
-void AX25_rxInitCfg(void) {
-  rxMode = RX_FIRST_FLAG_MODE;
-  bitSetCounter = 0;
-  lastBit = 1;
-  byteCounter = 0;
-  bitCounter = 0;
-  checkBitStuff = 0;
-}
-
-/*--------------------------------------------------------------------------*
- * NRZI decoding and descrambling operations. The next bit to decode from 
- * the demodulator is first descrambled and then NRZI decoded. The polynom 
- * of the descrambler is D(x) = x17 + x12 + 1. The result of the NRZI decod-
- * ing and descrambling operations is returned.
- *
- * PARAMETER:
- * bit          the bit which has to be decoded.
- *
- * RETURN: 
- * char         the decoded bit.
- *--------------------------------------------------------------------------*/
-char AX25_rxBit(char bit) {
-  volatile char nextBit;
-
-  // Descramble the bit.
-  nextBit = bit ^ (((shiftRegister >> 11) & 1) ^ ((shiftRegister >> 16) & 1));
-
-  // NRZI decoding.
-  if(nextBit == lastBit) {  // If so we have a 1.
-    lastBit = nextBit;  // Refresh the lastBit received.
-    shiftRegister <<= 1;  // Shift the register to the left.
-    if(bit) shiftRegister |= 1;  // Update the input of the descrambler.
-    return 0x01;  // Return the decoded bit.
-  }
-  else {  // Otherwise we have a 0.
-    lastBit = nextBit;  // Refresh the lastBit received.
-    shiftRegister <<= 1;  // Shift the register to the left.
-    if(bit) shiftRegister |= 1;  // Update the input of the descrambler.
-    return 0x00;  // Return the decoded bit.
-  }
-}
-
-/*--------------------------------------------------------------------------*
- * This function checks if we have a stuffed bit after 5 ones. If the rxBit 
- * is a 0, it is a stuffed bit. In the other case, we have 6 ones (in other 
- * words, we have a flag).
- *
- * PARAMETER:
- * bit           the bit which has to be analyzed.
- *
- * RETURNS: 
- * 1             if we have a stuffed bit.
- * 0             if we have a flag.
- *--------------------------------------------------------------------------*/
-char AX25_checkBitStuffing(char bit) {
-  if(AX25_rxBit(bit) == 0x00) {  // Check if the rxBit is a 0.
-    checkBitStuff = 0;  // Clear the bit stuffing indicator.
-    bitSetCounter = 0;  // Clear the bit set counter.
-    return 1;  // If so, it is a stuffed bit.
-  }
-  else return 0;  // If not, we have a flag.
-}
-
-/*--------------------------------------------------------------------------*
- * AX25_analyzeNextBit is the main function. AX25_analyzeNextBit analyzes 
- * the next bit from the demodulator. This function includes bit stuffing, 
- * NRZI decoding and descrambling operations. First, the very first flag 
- * is detected. Then the next flags (for sync) are ignored. Finally, the 
- * data is decoded until we meet a flag.
- *
- * PARAMETERS:
- * *buffer         pointer of the buffer to stock the decoded AX.25 frame.
- * rxBit           the bit from the demodulator.
- *
- * RETURNS: 
- * 1             if the reception is still running.
- * 0             if we have a end-flag and the reception is over.
- *--------------------------------------------------------------------------*/
-char AX25_analyzeNextBit(char *buffer, char rxBit) {
-  if(rxMode == RX_FIRST_FLAG_MODE) {
-    buffer[byteCounter] >>= 1;  // Shift to the right.
-    if(AX25_rxBit(rxBit)) buffer[byteCounter] |= 0x80; // Stock the bit.
-    if(buffer[byteCounter] == 0x7E) {  // Check if we have a flag.
-      rxMode = RX_FLAGS_MODE;  // If so, go to ignoring flags mode.
-      byteCounter++;
-    }
-    return 1;
-  }
-
-  if(rxMode == RX_FLAGS_MODE) {
-    buffer[byteCounter] >>= 1;  // Shift to the right.
-    if(AX25_rxBit(rxBit)) buffer[byteCounter] |= 0x80;  // Stock the bit.
-    bitCounter++;  // Increment the bit counter.
-    if(bitCounter > 7) {  // Check if we have a byte.
-      bitCounter = 0;
-      if(buffer[byteCounter] != 0x7E) {  // If the byte is not a flag.
-        rxMode = RX_DATA_MODE;  // go to Rx Data mode. 
-        byteCounter++;
-      }
-    }
-    return 1;
-  }
-
-  if(rxMode == RX_DATA_MODE) {
-    if(checkBitStuff) {
-      if(AX25_checkBitStuffing(rxBit)) return 1;  // Stuffed bit detected.
-      else {  // If it is not a stuffed bit it is a flag.
-        buffer[byteCounter] = 0x7E; 
-        rxMode = RX_OFF;  // End of the frame go to off mode.
-        return 0;
-      }
-    }
-    if(AX25_rxBit(rxBit)) {  // Decode the next bit.
-      buffer[byteCounter] >>= 1;   // Shift to the right.
-      buffer[byteCounter] |= 0x80;  // Stock the bit.
-      bitSetCounter++;  // Count up every 1.
-      if(bitSetCounter >= 5) checkBitStuff = 1;  // Check the next bit
-                                                 // for bit stuffing.
-    }
-    else {  // We have a 0.
-      buffer[byteCounter] >>= 1;   // Shift to the right.
-      bitSetCounter = 0;  // Clear bit set counter.
-    }
-    bitCounter++;  // Increment the bit counter.
-    if(bitCounter > 7) {  // Check if we have a byte.
-      bitCounter = 0;
-      byteCounter++;
-    }
-    return 1;
-  }
-}
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 OBC Embedded software
+ * 2008-2009, University of Liege
+ *--------------------------------------------------------------------------*
+ * AX25_Rx.c
+ * Main functions to receive AX.25 UI frames. Included : bit stuffing, NRZI
+ * decoding and descrambling. The implementation is compatible with G3RUH 
+ * modem 9600 baud FSK. A bulk line decoder (descrambling and NRZI
+ * decoding of packed words of bits) is also provided.
+ * 
+ *
+ * Johan Hardy
+ *--------------------------------------------------------------------------*/
+
+#include "AX25_Rx.h"
+
+/*--------------------------------------------------------------------------*
+ * Context of the legacy (single channel) Rx functions.
+ *--------------------------------------------------------------------------*/
+static AX25_RxContext rxContext;
+
+/*--------------------------------------------------------------------------*
+* ADF7021 configuration registers (see Excel file) - Freq = 434MHz
+*--------------------------------------------------------------------------*/
+char rxADFR0[4] = { 0b01110000 , 0b10111100 , 0b01110011 , 0b00001010 };
+char rxADFR1[4] = { 0b00010001 , 0b01010000 , 0b01000111 , 0b00000000 };
+char rxADFR3[4] = { 0b11010011 , 0b00110000 , 0b10111000 , 0b00101001 };
+char rxADFR4[4] = { 0b10010100 , 0b00001010 , 0b11010011 , 0b10000000 };  // Invert Data !!
+char rxADFR5[4] = { 0b10110101 , 0b00011011 , 0b00000000 , 0b00000000 };
+char rxADFR6[4] = { 0b00000110 , 0b00000000 , 0b00000000 , 0b00000000 };
+char rxADFR8[4] = { 0b11011000 , 0b00000111 , 0b00000000 , 0b00000000 };
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the reception. The routine switches rxMode from 
+ * RX_OFF to RX_FIRST_FLAG_MODE and resets the main variables. The
+ * descrambler keeps running between frames : a context must be cleared
+ * (static or memset) before its first initialization.
+ *
+ * PARAMETER:
+ * *ctx          pointer of the Rx context (channel).
+ *--------------------------------------------------------------------------*/
+void AX25_rxInitCfg_r(AX25_RxContext *ctx) {
+  ctx->rxMode = RX_FIRST_FLAG_MODE;
+  ctx->bitSetCounter = 0;
+  ctx->line.lastBit = 1;
+  ctx->byteCounter = 0;
+  ctx->bitCounter = 0;
+  ctx->checkBitStuff = 0;
+}
+
+void AX25_rxInitCfg(void) {
+  AX25_rxInitCfg_r(&rxContext);
+}
+
+/*--------------------------------------------------------------------------*
+ * Counters of the state machine (flags, stuffed bits, frame lengths). The
+ * counters are kept by AX25_rxInitCfg.
+ *
+ * PARAMETERS:
+ * *ctx          pointer of the Rx context (channel).
+ * *stats        pointer of the counters (NULL : none).
+ *--------------------------------------------------------------------------*/
+void AX25_rxSetStats_r(AX25_RxContext *ctx, AX25_Stats *stats) {
+  ctx->stats = stats;
+}
+
+void AX25_rxSetStats(AX25_Stats *stats) {
+  AX25_rxSetStats_r(&rxContext, stats);
+}
+
+/*--------------------------------------------------------------------------*
+ * NRZI decoding and descrambling operations. The next bit to decode from 
+ * the demodulator is first descrambled and then NRZI decoded. The polynom 
+ * of the descrambler is D(x) = x17 + x12 + 1. The result of the NRZI decod-
+ * ing and descrambling operations is returned.
+ *
+ * PARAMETERS:
+ * *ctx         pointer of the Rx context (channel).
+ * bit          the bit which has to be decoded.
+ *
+ * RETURN: 
+ * char         the decoded bit.
+ *--------------------------------------------------------------------------*/
+char AX25_rxBit_r(AX25_RxContext *ctx, char bit) {
+  uint64_t history = ctx->line.history;
+  char nextBit, decoded;
+
+  // Descramble the bit (bit 63 of the history is the previous bit).
+  nextBit = bit ^ (char) (((history >> 52) ^ (history >> 47)) & 1);
+
+  // NRZI decoding : if nextBit == lastBit we have a 1, otherwise a 0.
+  decoded = (nextBit == ctx->line.lastBit);
+  ctx->line.lastBit = nextBit;  // Refresh the lastBit received.
+
+  // Update the input of the descrambler.
+  ctx->line.history = (history >> 1) | ((uint64_t) (bit & 1) << 63);
+  return decoded;  // Return the decoded bit.
+}
+
+char AX25_rxBit(char bit) {
+  return AX25_rxBit_r(&rxContext, bit);
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a bulk line decoder. The state is the same as the one
+ * of AX25_rxBit after AX25_rxInitCfg (descrambler cleared, last bit = 1).
+ *
+ * PARAMETER:
+ * *line         pointer of the line decoder.
+ *--------------------------------------------------------------------------*/
+void AX25_rxLineInit(AX25_RxLine *line) {
+  line->history = 0;
+  line->lastBit = 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk descrambling and NRZI decoding of a word of bits from the
+ * demodulator. The bits are packed LSB first (bit 0 is the oldest one).
+ * The descrambler D(x) = x17 + x12 + 1 is applied to the whole word with
+ * two shifted copies of the input, then the NRZI decoding compares every
+ * descrambled bit with the previous one. The result is bit-exact with
+ * AX25_rxBit.
+ *
+ * PARAMETERS:
+ * *line         pointer of the line decoder.
+ * bits          the bits from the demodulator.
+ * nbBits        number of bits in the word (1 to 64).
+ *
+ * RETURN:
+ * the decoded bits, packed LSB first.
+ *--------------------------------------------------------------------------*/
+uint64_t AX25_rxDecodeWord(AX25_RxLine *line, uint64_t bits, unsigned int nbBits) {
+  uint64_t mask, descrambled, decoded;
+
+  mask = (nbBits >= 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << nbBits) - 1);
+  bits &= mask;
+
+  // Descramble the word : bit n XOR bit n-12 XOR bit n-17.
+  descrambled = bits ^ ((bits << 12) | (line->history >> 52))
+                     ^ ((bits << 17) | (line->history >> 47));
+
+  // NRZI decoding : a 1 when the level does not change.
+  decoded = ~(descrambled ^ ((descrambled << 1) | line->lastBit)) & mask;
+
+  // Refresh the state of the line.
+  line->lastBit = (unsigned char) ((descrambled >> (nbBits - 1)) & 1);
+  if(nbBits >= 64) line->history = bits;
+  else line->history = (line->history >> nbBits) | (bits << (64 - nbBits));
+
+  return decoded;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk descrambling and NRZI decoding of a buffer of bits from the
+ * demodulator, packed LSB first. The input is processed 64 bits at a time.
+ * In and out may be the same buffer.
+ *
+ * PARAMETERS:
+ * *line         pointer of the line decoder.
+ * *in           pointer of the packed bits from the demodulator.
+ * *out          pointer of the buffer to stock the decoded bits.
+ * nbBits        number of bits to decode.
+ *--------------------------------------------------------------------------*/
+void AX25_rxDecodeBits(AX25_RxLine *line, const unsigned char *in, unsigned char *out, unsigned long nbBits) {
+  uint64_t word;
+  unsigned int i, nbBytes;
+
+  while(nbBits) {
+    nbBytes = (nbBits >= 64) ? 8 : (unsigned int) ((nbBits + 7) >> 3);
+
+    // Little endian load (a single load on most hosts).
+    word = 0;
+    for(i=0; i<nbBytes; i++) word |= (uint64_t) in[i] << (8 * i);
+
+    word = AX25_rxDecodeWord(line, word, (nbBits >= 64) ? 64 : (unsigned int) nbBits);
+
+    for(i=0; i<nbBytes; i++) out[i] = (unsigned char) (word >> (8 * i));
+
+    in += nbBytes;
+    out += nbBytes;
+    nbBits -= (nbBits >= 64) ? 64 : nbBits;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * This function checks if we have a stuffed bit after 5 ones. If the rxBit 
+ * is a 0, it is a stuffed bit. In the other case, we have 6 ones (in other 
+ * words, we have a flag).
+ *
+ * PARAMETERS:
+ * *ctx          pointer of the Rx context (channel).
+ * bit           the bit which has to be analyzed.
+ *
+ * RETURNS: 
+ * 1             if we have a stuffed bit.
+ * 0             if we have a flag.
+ *--------------------------------------------------------------------------*/
+char AX25_rxCheckBitStuffing_r(AX25_RxContext *ctx, char bit) {
+  if(AX25_rxBit_r(ctx, bit) == 0x00) {  // Check if the rxBit is a 0.
+    ctx->checkBitStuff = 0;  // Clear the bit stuffing indicator.
+    ctx->bitSetCounter = 0;  // Clear the bit set counter.
+    return 1;  // If so, it is a stuffed bit.
+  }
+  else return 0;  // If not, we have a flag.
+}
+
+char AX25_rxCheckBitStuffing(char bit) {
+  return AX25_rxCheckBitStuffing_r(&rxContext, bit);
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_analyzeNextBit is the main function. AX25_analyzeNextBit analyzes 
+ * the next bit from the demodulator. This function includes bit stuffing, 
+ * NRZI decoding and descrambling operations. First, the very first flag 
+ * is detected. Then the next flags (for sync) are ignored. Finally, the 
+ * data is decoded until we meet a flag. The end flag is stocked at
+ * buffer[byteCounter] (the frame is byteCounter + 1 bytes long).
+ *
+ * PARAMETERS:
+ * *ctx            pointer of the Rx context (channel).
+ * *buffer         pointer of the buffer to stock the decoded AX.25 frame
+ *                 (AX25_FRAME_MAX_SIZE bytes : a longer frame is dropped).
+ * rxBit           the bit from the demodulator.
+ *
+ * RETURNS: 
+ * 1             if the reception is still running.
+ * 0             if we have a end-flag and the reception is over.
+ *--------------------------------------------------------------------------*/
+char AX25_analyzeNextBit_r(AX25_RxContext *ctx, char *buffer, char rxBit) {
+  unsigned char *frame = (unsigned char *) buffer;  // Logical shifts.
+
+  if(ctx->rxMode == RX_FIRST_FLAG_MODE) {
+    frame[ctx->byteCounter] >>= 1;  // Shift to the right.
+    if(AX25_rxBit_r(ctx, rxBit)) frame[ctx->byteCounter] |= 0x80; // Stock the bit.
+    if(frame[ctx->byteCounter] == 0x7E) {  // Check if we have a flag.
+      ctx->rxMode = RX_FLAGS_MODE;  // If so, go to ignoring flags mode.
+      ctx->byteCounter++;
+      AX25_statsAdd(ctx->stats, AX25_STAT_FLAGS_HUNTED, 1);
+    }
+    return 1;
+  }
+
+  if(ctx->rxMode == RX_FLAGS_MODE) {
+    frame[ctx->byteCounter] >>= 1;  // Shift to the right.
+    if(AX25_rxBit_r(ctx, rxBit)) frame[ctx->byteCounter] |= 0x80;  // Stock the bit.
+    ctx->bitCounter++;  // Increment the bit counter.
+    if(ctx->bitCounter > 7) {  // Check if we have a byte.
+      ctx->bitCounter = 0;
+      if(frame[ctx->byteCounter] != 0x7E) {  // If the byte is not a flag.
+        ctx->rxMode = RX_DATA_MODE;  // go to Rx Data mode. 
+        ctx->byteCounter++;
+      }
+      else AX25_statsAdd(ctx->stats, AX25_STAT_FLAGS_SYNC, 1);
+    }
+    return 1;
+  }
+
+  if(ctx->rxMode == RX_DATA_MODE) {
+    if(ctx->checkBitStuff) {
+      if(AX25_rxCheckBitStuffing_r(ctx, rxBit)) {  // Stuffed bit detected.
+        AX25_statsAdd(ctx->stats, AX25_STAT_STUFF_REMOVED, 1);
+        return 1;
+      }
+      else {  // If it is not a stuffed bit it is a flag.
+        frame[ctx->byteCounter] = 0x7E; 
+        ctx->rxMode = RX_OFF;  // End of the frame go to off mode.
+        // Length only : the FCS is checked by the caller.
+        AX25_statsFrame(ctx->stats, 0xFF, ctx->byteCounter + 1);
+        return 0;
+      }
+    }
+    if(AX25_rxBit_r(ctx, rxBit)) {  // Decode the next bit.
+      frame[ctx->byteCounter] >>= 1;   // Shift to the right.
+      frame[ctx->byteCounter] |= 0x80;  // Stock the bit.
+      ctx->bitSetCounter++;  // Count up every 1.
+      if(ctx->bitSetCounter >= 5) ctx->checkBitStuff = 1;  // Check the next bit
+                                                           // for bit stuffing.
+    }
+    else {  // We have a 0.
+      frame[ctx->byteCounter] >>= 1;   // Shift to the right.
+      ctx->bitSetCounter = 0;  // Clear bit set counter.
+    }
+    ctx->bitCounter++;  // Increment the bit counter.
+    if(ctx->bitCounter > 7) {  // Check if we have a byte.
+      ctx->bitCounter = 0;
+      ctx->byteCounter++;
+      if(ctx->byteCounter == AX25_FRAME_MAX_SIZE - 1) {  // No room for the end flag :
+        ctx->rxMode = RX_FIRST_FLAG_MODE;                // the frame is dropped.
+        ctx->byteCounter = 0;
+        ctx->bitSetCounter = 0;
+        ctx->checkBitStuff = 0;
+        AX25_statsAdd(ctx->stats, AX25_STAT_OVERSIZES, 1);
+      }
+    }
+    return 1;
+  }
+  return 0;  // RX_OFF : the reception is over.
+}
+
+char AX25_analyzeNextBit(char *buffer, char rxBit) {
+  return AX25_analyzeNextBit_r(&rxContext, buffer, rxBit);
+}
@@ -1,18 +1,57 @@
-#ifndef AX25_RX_H
-#define AX25_RX_H
-
-// Specifications
-#define AX25_FRAME_MAX_SIZE  276  // Max number of bytes for an AX25 UI-frame. (1+14+1+1+256+2+1).
-
-// Rx Modes
-#define RX_OFF               0x00  // Receiver is off.
-#define RX_FIRST_FLAG_MODE   0x01  // First flag detection mode.
-#define RX_FLAGS_MODE        0x02  // Ignoring sync flags.
-#define RX_DATA_MODE         0x03  // Data decoder mode.
-
-void AX25_rxInitCfg(void);
-char AX25_rxBit(char bit);
-char AX25_checkBitStuffing(char bit);
-char AX25_analyzeNextBit(char *buffer, char rxBit);
-
-#endif /* AX25_RX_H */
+#ifndef AX25_RX_H
+#define AX25_RX_H
+
+#include <stdint.h>
+
+#include "AX25_Stats.h"
+
+// Specifications
+#define AX25_FRAME_MAX_SIZE  333  // Max number of bytes for an AX25 frame. (1+70+2+1+256+2+1) :
+                                  // 8 digipeaters and a 2-byte control field (modulo 128).
+#define AX25_FRAME_MIN_SIZE  19   // Min number of bytes for an AX25 frame. (1+14+1+2+1).
+
+// Rx Modes
+#define RX_OFF               0x00  // Receiver is off.
+#define RX_FIRST_FLAG_MODE   0x01  // First flag detection mode.
+#define RX_FLAGS_MODE        0x02  // Ignoring sync flags.
+#define RX_DATA_MODE         0x03  // Data decoder mode.
+
+// Line decoder state (descrambler and NRZI) of the bulk receive path.
+// The history holds the last received bits, the most recent one in bit 63.
+typedef struct {
+  uint64_t history;
+  unsigned char lastBit;
+} AX25_RxLine;
+
+// Rx context : state of one receiving channel.
+typedef struct {
+  unsigned char rxMode;
+  unsigned char bitSetCounter;
+  unsigned char bitCounter;
+  unsigned char checkBitStuff;
+  unsigned int byteCounter;
+  AX25_RxLine line;
+  AX25_Stats *stats;           // Counters of the channel (NULL : none).
+} AX25_RxContext;
+
+// ADF7021 configuration registers for Rx.
+extern char rxADFR0[4], rxADFR1[4], rxADFR3[4], rxADFR4[4];
+extern char rxADFR5[4], rxADFR6[4], rxADFR8[4];
+
+void AX25_rxInitCfg(void);
+char AX25_rxBit(char bit);
+char AX25_rxCheckBitStuffing(char bit);
+char AX25_analyzeNextBit(char *buffer, char rxBit);
+void AX25_rxSetStats(AX25_Stats *stats);
+
+void AX25_rxInitCfg_r(AX25_RxContext *ctx);
+char AX25_rxBit_r(AX25_RxContext *ctx, char bit);
+char AX25_rxCheckBitStuffing_r(AX25_RxContext *ctx, char bit);
+char AX25_analyzeNextBit_r(AX25_RxContext *ctx, char *buffer, char rxBit);
+void AX25_rxSetStats_r(AX25_RxContext *ctx, AX25_Stats *stats);
+
+void AX25_rxLineInit(AX25_RxLine *line);
+uint64_t AX25_rxDecodeWord(AX25_RxLine *line, uint64_t bits, unsigned int nbBits);
+void AX25_rxDecodeBits(AX25_RxLine *line, const unsigned char *in, unsigned char *out, unsigned long nbBits);
+
+#endif /* AX25_RX_H */
@@ -0,0 +1,216 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Samples.c
+ * Reader of the recordings of the passes (WAV or raw samples). Regular
+ * files are mapped in memory and read sequentially, so that a whole night
+ * of recordings is decoded without copies through the page cache. Pipes
+ * (path "-" for the standard input) are read through a buffer.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AX25_Samples.h"
+
+/*--------------------------------------------------------------------------*
+ * Little endian fields of the WAV header.
+ *--------------------------------------------------------------------------*/
+static unsigned int AX25_samplesLe16(const unsigned char *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned long AX25_samplesLe32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+/*--------------------------------------------------------------------------*
+ * Size of one frame (one sample of every channel) in bytes.
+ *--------------------------------------------------------------------------*/
+static size_t AX25_samplesFrameSize(const AX25_SampleFile *file) {
+  return file->channels * (file->format == AX25_SAMPLES_F32 ? 4 : 2);
+}
+
+/*--------------------------------------------------------------------------*
+ * Analysis of a WAV header. Only 16 bits PCM and 32 bits float samples
+ * are accepted (WAVE_FORMAT_EXTENSIBLE included).
+ *
+ * PARAMETERS:
+ * *file         pointer of the sample file (format, channels, sampleRate
+ *               are set).
+ * *header       pointer of the beginning of the file.
+ * size          bytes available at header.
+ * *dataSize     size of the data chunk, as written in the header.
+ *
+ * RETURN:
+ * the offset of the samples, or 0 if the header is not valid.
+ *--------------------------------------------------------------------------*/
+static size_t AX25_samplesParseWav(AX25_SampleFile *file, const unsigned char *header, size_t size, size_t *dataSize) {
+  size_t offset = 12, chunkSize;
+  unsigned int tag, bits;
+  char fmt = 0;
+
+  if(size < 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) return 0;
+
+  while(offset + 8 <= size) {
+    chunkSize = AX25_samplesLe32(header + offset + 4);
+
+    if(!memcmp(header + offset, "fmt ", 4)) {
+      if(chunkSize < 16 || offset + 8 + chunkSize > size) return 0;
+      tag = AX25_samplesLe16(header + offset + 8);
+      file->channels = AX25_samplesLe16(header + offset + 10);
+      file->sampleRate = AX25_samplesLe32(header + offset + 12);
+      bits = AX25_samplesLe16(header + offset + 22);
+      if(tag == 0xFFFE && chunkSize >= 40) tag = AX25_samplesLe16(header + offset + 32);
+
+      if(tag == 1 && bits == 16) file->format = AX25_SAMPLES_S16;
+      else if(tag == 3 && bits == 32) file->format = AX25_SAMPLES_F32;
+      else return 0;
+      fmt = 1;
+    }
+    else if(!memcmp(header + offset, "data", 4)) {
+      if(!fmt) return 0;
+      *dataSize = chunkSize;
+      return offset + 8;
+    }
+
+    offset += 8 + chunkSize + (chunkSize & 1);
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Streaming : fill of the read buffer.
+ *--------------------------------------------------------------------------*/
+static void AX25_samplesFill(AX25_SampleFile *file) {
+  ssize_t n;
+
+  while(!file->eof && file->nbBuffer < AX25_SAMPLES_BUFFER) {
+    n = read(file->fd, file->buffer + file->nbBuffer, AX25_SAMPLES_BUFFER - file->nbBuffer);
+    if(n <= 0) file->eof = 1;
+    else file->nbBuffer += n;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Opening of a sample file.
+ *
+ * PARAMETERS:
+ * *file         pointer of the sample file.
+ * *path         path of the file ("-" for the standard input).
+ * format        AX25_SAMPLES_WAV, or the format of a raw file.
+ * sampleRate    sample rate of a raw file (Hz).
+ * channels      channels of a raw file (1 : audio, 2 : IQ).
+ *
+ * RETURNS:
+ * 1             if the file is ready.
+ * 0             if the file cannot be opened or its format is not supported.
+ *--------------------------------------------------------------------------*/
+char AX25_samplesOpen(AX25_SampleFile *file, const char *path, unsigned char format, unsigned int sampleRate, unsigned int channels) {
+  struct stat st;
+  size_t offset = 0, dataSize = (size_t) -1;
+
+  file->fd = strcmp(path, "-") ? open(path, O_RDONLY) : 0;
+  if(file->fd < 0) return 0;
+
+  file->format = format;
+  file->channels = channels;
+  file->sampleRate = sampleRate;
+  file->map = NULL;
+  file->mapSize = 0;
+  file->nbBuffer = 0;
+  file->eof = 0;
+
+  if(!fstat(file->fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+    file->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if(file->map == MAP_FAILED) file->map = NULL;
+    else {
+      file->mapSize = st.st_size;
+      madvise(file->map, file->mapSize, MADV_SEQUENTIAL);
+    }
+  }
+
+  if(file->map) {
+    if(format == AX25_SAMPLES_WAV) offset = AX25_samplesParseWav(file, file->map, file->mapSize, &dataSize);
+    file->data = file->map + offset;
+    file->dataLeft = file->mapSize - offset;
+    if(dataSize && dataSize < file->dataLeft) file->dataLeft = dataSize;  // 0 : size unknown.
+  }
+  else {
+    AX25_samplesFill(file);
+    if(format == AX25_SAMPLES_WAV) {
+      offset = AX25_samplesParseWav(file, file->buffer, file->nbBuffer, &dataSize);
+      file->nbBuffer -= offset;
+      memmove(file->buffer, file->buffer + offset, file->nbBuffer);
+    }
+  }
+
+  if((format == AX25_SAMPLES_WAV && !offset) || file->format == AX25_SAMPLES_WAV
+     || !file->sampleRate || file->channels < 1 || file->channels > 2) {
+    AX25_samplesClose(file);
+    return 0;
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Conversion of the samples to floats.
+ *--------------------------------------------------------------------------*/
+static void AX25_samplesConvert(const AX25_SampleFile *file, const unsigned char *in, float *out, size_t nbSamples) {
+  size_t i;
+
+  if(file->format == AX25_SAMPLES_F32) memcpy(out, in, nbSamples * sizeof(float));
+  else for(i=0; i<nbSamples; i++) out[i] = (short) AX25_samplesLe16(in + 2 * i) * (1.0f / 32768.0f);
+}
+
+/*--------------------------------------------------------------------------*
+ * Reading of the next frames of samples.
+ *
+ * PARAMETERS:
+ * *file         pointer of the sample file.
+ * *out          pointer of the samples (nbFrames * channels floats).
+ * nbFrames      maximum number of frames to read.
+ *
+ * RETURN:
+ * the number of frames read (0 at the end of the file).
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_samplesRead(AX25_SampleFile *file, float *out, unsigned long nbFrames) {
+  size_t frameSize = AX25_samplesFrameSize(file), n, done = 0;
+
+  if(file->map) {
+    n = file->dataLeft / frameSize;
+    if(n > nbFrames) n = nbFrames;
+    AX25_samplesConvert(file, file->data, out, n * file->channels);
+    file->data += n * frameSize;
+    file->dataLeft -= n * frameSize;
+    return n;
+  }
+
+  while(done < nbFrames) {
+    if(file->nbBuffer < frameSize) {
+      AX25_samplesFill(file);
+      if(file->nbBuffer < frameSize) break;
+    }
+    n = file->nbBuffer / frameSize;
+    if(n > nbFrames - done) n = nbFrames - done;
+    AX25_samplesConvert(file, file->buffer, out + done * file->channels, n * file->channels);
+    file->nbBuffer -= n * frameSize;
+    memmove(file->buffer, file->buffer + n * frameSize, file->nbBuffer);
+    done += n;
+  }
+  return done;
+}
+
+/*--------------------------------------------------------------------------*
+ * Closing of a sample file.
+ *--------------------------------------------------------------------------*/
+void AX25_samplesClose(AX25_SampleFile *file) {
+  if(file->map) munmap(file->map, file->mapSize);
+  if(file->fd > 0) close(file->fd);
+  file->map = NULL;
+  file->fd = -1;
+}
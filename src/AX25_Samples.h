@@ -0,0 +1,34 @@
+#ifndef AX25_SAMPLES_H
+#define AX25_SAMPLES_H
+
+#include <stddef.h>
+
+// Sample formats
+#define AX25_SAMPLES_WAV     0x00  // WAV file, format read from the header.
+#define AX25_SAMPLES_S16     0x01  // Raw signed 16 bits, little endian.
+#define AX25_SAMPLES_F32     0x02  // Raw 32 bits float, little endian.
+
+#define AX25_SAMPLES_BUFFER  65536  // Read buffer when the file cannot be mapped.
+
+// Reader of a recorded sample file (audio or IQ). Regular files are mapped
+// in memory, pipes and terminals are read through a buffer. The samples
+// are returned as floats in [-1, 1[, channels interleaved.
+typedef struct {
+  int fd;
+  unsigned char format;        // AX25_SAMPLES_S16 or AX25_SAMPLES_F32.
+  unsigned int channels;       // 1 (audio) or 2 (IQ).
+  unsigned int sampleRate;
+  unsigned char *map;          // Mapped file (NULL when streaming).
+  size_t mapSize;
+  const unsigned char *data;   // Next sample byte.
+  size_t dataLeft;             // Sample bytes left (mapped file).
+  unsigned char buffer[AX25_SAMPLES_BUFFER];
+  size_t nbBuffer;             // Bytes waiting in buffer (streaming).
+  unsigned char eof;
+} AX25_SampleFile;
+
+char AX25_samplesOpen(AX25_SampleFile *file, const char *path, unsigned char format, unsigned int sampleRate, unsigned int channels);
+unsigned long AX25_samplesRead(AX25_SampleFile *file, float *out, unsigned long nbFrames);
+void AX25_samplesClose(AX25_SampleFile *file);
+
+#endif /* AX25_SAMPLES_H */
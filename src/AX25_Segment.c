@@ -0,0 +1,283 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Segment.c
+ * Payloads longer than INFO_MAX_SIZE : segmentation into UI (or I) frames
+ * with the segmenter of AX.25 v2.2 (PID 0x08), and reassembly on the
+ * receive side. The payload is given as fragments which are copied
+ * straight into the frames; the reassembly keeps one buffer per source
+ * and destination and drops the payloads whose segments stop coming.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_Segment.h"
+#include "AX25_CRC.h"
+
+/*--------------------------------------------------------------------------*
+ * Length of the address field of a header or of a frame (the last address
+ * has bit 0 of its SSID byte set).
+ *
+ * RETURN:
+ * the length (in bytes), or 0 if the field is not terminated.
+ *--------------------------------------------------------------------------*/
+static unsigned int AX25_segmentAddresses(const unsigned char *bytes, unsigned int length) {
+  unsigned int i;
+
+  for(i=AX25_ADDRESS_SIZE-1; i<length && i<AX25_ADDRESS_SIZE*(2+AX25_MAX_DIGIPEATERS); i+=AX25_ADDRESS_SIZE) {
+    if(bytes[i] & 0x01) return (i + 1 >= 2 * AX25_ADDRESS_SIZE) ? i + 1 : 0;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Preparation of the frames of a payload. A payload of INFO_MAX_SIZE bytes
+ * or less is sent in one frame with the header as it is; a longer one is
+ * cut into segments sent with the PID 0x08.
+ *
+ * PARAMETERS:
+ * *segmenter     pointer of the segmenter.
+ * *header        pointer of the header, with the PID of the payload.
+ * *fragments     pointer of the fragments of the payload (they must stay
+ *                valid until the last frame is built).
+ * nbFragments    number of fragments.
+ *
+ * RETURN:
+ * the number of frames, or 0 if the header has no PID or the payload is
+ * longer than AX25_SEGMENT_MAX_PAYLOAD bytes.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_segmenterInit(AX25_Segmenter *segmenter, const AX25_FrameHeader *header,
+                                const AX25_Fragment *fragments, unsigned int nbFragments) {
+  unsigned int i, addresses;
+
+  addresses = AX25_segmentAddresses(header->bytes, header->length);
+  if(!addresses || header->length != addresses + 2) return 0;
+
+  segmenter->length = 0;
+  for(i=0; i<nbFragments; i++) segmenter->length += fragments[i].length;
+  if(segmenter->length > AX25_SEGMENT_MAX_PAYLOAD) return 0;
+
+  segmenter->header = *header;
+  segmenter->pid = header->bytes[header->length - 1];
+  segmenter->fragments = fragments;
+  segmenter->nbFragments = nbFragments;
+  segmenter->fragment = 0;
+  segmenter->offset = 0;
+  segmenter->frame = 0;
+
+  if(segmenter->length <= INFO_MAX_SIZE) segmenter->nbFrames = 1;
+  else {
+    // The first segment carries the PID, the others one more byte :
+    // 1 + ceil((length - (INFO_MAX_SIZE - 2)) / (INFO_MAX_SIZE - 1)).
+    segmenter->nbFrames = 1 + (unsigned int) (segmenter->length / (INFO_MAX_SIZE - 1));
+    segmenter->header.bytes[header->length - 1] = AX25_PID_SEGMENT;
+    segmenter->header.crc = AX25_crcUpdate(AX25_CRC_INIT, segmenter->header.bytes, header->length);
+  }
+  return segmenter->nbFrames;
+}
+
+/*--------------------------------------------------------------------------*
+ * Building of the next frame of a payload.
+ *
+ * PARAMETERS:
+ * *segmenter     pointer of the segmenter.
+ * *buffer        pointer of the buffer (AX25_FRAME_MAX_SIZE bytes).
+ *
+ * RETURN:
+ * the length of the frame (in bytes), or 0 when all the frames are built.
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_segmenterNext(AX25_Segmenter *segmenter, char *buffer) {
+  const AX25_Fragment *fragment;
+  unsigned int info, length, room, n;
+  unsigned short crc;
+
+  if(segmenter->frame == segmenter->nbFrames) return 0;
+  if(segmenter->length <= INFO_MAX_SIZE) {
+    segmenter->frame++;
+    return AX25_frameBuildv(&segmenter->header, buffer, segmenter->fragments, segmenter->nbFragments);
+  }
+
+  buffer[0] = 0x7E;
+  memcpy(buffer + 1, segmenter->header.bytes, segmenter->header.length);
+  info = length = 1 + segmenter->header.length;
+  buffer[length++] = (char) ((segmenter->frame ? 0 : AX25_SEGMENT_FIRST) | (segmenter->nbFrames - 1 - segmenter->frame));
+  if(!segmenter->frame) buffer[length++] = (char) segmenter->pid;
+
+  // Bytes of the fragments, up to a full info field.
+  room = INFO_MAX_SIZE - (length - info);
+  while(room && segmenter->fragment < segmenter->nbFragments) {
+    fragment = &segmenter->fragments[segmenter->fragment];
+    n = fragment->length - segmenter->offset;
+    if(n > room) n = room;
+    memcpy(buffer + length, (const char *) fragment->data + segmenter->offset, n);
+    length += n;
+    room -= n;
+    segmenter->offset += n;
+    if(segmenter->offset == fragment->length) {
+      segmenter->fragment++;
+      segmenter->offset = 0;
+    }
+  }
+
+  crc = AX25_crcFinal(AX25_crcUpdate(segmenter->header.crc, buffer + info, length - info));
+  buffer[length++] = (char) (crc & 0xff);
+  buffer[length++] = (char) ((crc >> 8) & 0xff);
+  buffer[length++] = 0x7E;
+  segmenter->frame++;
+  return length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a reassembler.
+ *
+ * PARAMETERS:
+ * *reassembler   pointer of the reassembler.
+ * timeout        max time between two segments of a payload (in ms).
+ *--------------------------------------------------------------------------*/
+void AX25_reassemblerInit(AX25_Reassembler *reassembler, unsigned long timeout) {
+  unsigned int i;
+
+  for(i=0; i<AX25_REASSEMBLY_STREAMS; i++) reassembler->streams[i].active = 0;
+  reassembler->timeout = timeout;
+  reassembler->nbPayloads = 0;
+  reassembler->nbTimeouts = 0;
+  reassembler->nbDropped = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Drop of the payloads whose last segment is older than the timeout. It is
+ * done at every segment, and may be called when no frame comes.
+ *
+ * PARAMETERS:
+ * *reassembler   pointer of the reassembler.
+ * now            current time (in ms).
+ *--------------------------------------------------------------------------*/
+void AX25_reassemblerExpire(AX25_Reassembler *reassembler, unsigned long long now) {
+  AX25_ReassemblyStream *stream;
+  unsigned int i;
+
+  for(i=0; i<AX25_REASSEMBLY_STREAMS; i++) {
+    stream = &reassembler->streams[i];
+    if(stream->active && now - stream->last > reassembler->timeout) {
+      stream->active = 0;
+      reassembler->nbTimeouts++;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Stream of a payload (by destination and source), or a new one. When all
+ * the streams are in use, the oldest payload is dropped.
+ *--------------------------------------------------------------------------*/
+static AX25_ReassemblyStream *AX25_reassemblerStream(AX25_Reassembler *reassembler, const unsigned char *key, char create) {
+  AX25_ReassemblyStream *stream, *unused = NULL, *oldest = NULL;
+  unsigned int i;
+
+  for(i=0; i<AX25_REASSEMBLY_STREAMS; i++) {
+    stream = &reassembler->streams[i];
+    if(!stream->active) {
+      if(!unused) unused = stream;
+      continue;
+    }
+    if(!memcmp(stream->key, key, sizeof(stream->key))) return stream;
+    if(!oldest || stream->last < oldest->last) oldest = stream;
+  }
+  if(!create) return NULL;
+  if(!unused) {
+    unused = oldest;
+    reassembler->nbDropped++;
+  }
+  memcpy(unused->key, key, sizeof(unused->key));
+  unused->active = 0;
+  return unused;
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_reassemblerFrame is the main function of the reassembly : it is
+ * given every good frame received. The segments must arrive in order, a
+ * missing segment drops the payload.
+ *
+ * PARAMETERS:
+ * *reassembler   pointer of the reassembler.
+ * *frame         pointer of the frame (flags and FCS included).
+ * lengthFrame    length of the frame (in bytes).
+ * now            current time (in ms).
+ * **payload      where the pointer of the payload is written.
+ * *length        where the length of the payload is written.
+ * *pid           where the PID of the payload is written.
+ *
+ * RETURN:
+ * AX25_SEGMENT_NONE, _PENDING, _COMPLETE (the payload is valid until the
+ * next call) or _DROPPED.
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_reassemblerFrame(AX25_Reassembler *reassembler, const char *frame, unsigned int lengthFrame,
+                                    unsigned long long now, const unsigned char **payload,
+                                    unsigned int *length, unsigned char *pid) {
+  const unsigned char *bytes = (const unsigned char *) frame + 1;
+  unsigned char key[2 * AX25_ADDRESS_SIZE], control, segment;
+  AX25_ReassemblyStream *stream;
+  unsigned int addresses, lengthInfo;
+  const unsigned char *info;
+
+  if(lengthFrame < 4) return AX25_SEGMENT_NONE;
+  addresses = AX25_segmentAddresses(bytes, lengthFrame - 4);
+  if(!addresses || addresses + 2 > lengthFrame - 4) return AX25_SEGMENT_NONE;
+  control = bytes[addresses];
+  if(((control & 0x01) && (control & 0xEF) != 0x03) || bytes[addresses + 1] != AX25_PID_SEGMENT) return AX25_SEGMENT_NONE;
+
+  info = bytes + addresses + 2;
+  lengthInfo = lengthFrame - 4 - addresses - 2;
+  AX25_reassemblerExpire(reassembler, now);
+  if(!lengthInfo) {
+    reassembler->nbDropped++;
+    return AX25_SEGMENT_DROPPED;
+  }
+
+  // Callsigns and SSIDs (the C and H bits change along the way).
+  memcpy(key, bytes, sizeof(key));
+  key[AX25_ADDRESS_SIZE - 1] &= 0x1E;
+  key[2 * AX25_ADDRESS_SIZE - 1] &= 0x1E;
+
+  segment = info[0];
+  if(segment & AX25_SEGMENT_FIRST) {
+    if(lengthInfo < 2) {
+      reassembler->nbDropped++;
+      return AX25_SEGMENT_DROPPED;
+    }
+    stream = AX25_reassemblerStream(reassembler, key, 1);
+    if(stream->active) reassembler->nbDropped++;  // Previous payload not complete.
+    stream->active = 1;
+    stream->pid = info[1];
+    stream->length = 0;
+    info += 2;
+    lengthInfo -= 2;
+  }
+  else {
+    stream = AX25_reassemblerStream(reassembler, key, 0);
+    if(!stream || !stream->active || (segment & 0x7F) + 1 != stream->remaining ||
+       stream->length + lengthInfo - 1 > AX25_SEGMENT_MAX_PAYLOAD) {
+      if(stream && stream->active) {
+        stream->active = 0;
+        reassembler->nbDropped++;
+      }
+      reassembler->nbDropped++;
+      return AX25_SEGMENT_DROPPED;
+    }
+    info++;
+    lengthInfo--;
+  }
+
+  memcpy(stream->payload + stream->length, info, lengthInfo);
+  stream->length += lengthInfo;
+  stream->remaining = segment & 0x7F;
+  stream->last = now;
+  if(stream->remaining) return AX25_SEGMENT_PENDING;
+
+  stream->active = 0;
+  reassembler->nbPayloads++;
+  *payload = stream->payload;
+  *length = stream->length;
+  *pid = stream->pid;
+  return AX25_SEGMENT_COMPLETE;
+}
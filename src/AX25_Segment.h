@@ -0,0 +1,66 @@
+#ifndef AX25_SEGMENT_H
+#define AX25_SEGMENT_H
+
+#include "AX25_Frame.h"
+#include "AX25_Tx.h"
+
+// Segmentation of AX.25 v2.2 : the info field of each segment starts with
+// a byte holding the first-segment flag (bit 7) and the number of segments
+// still to come (bits 0 to 6); the first segment then carries the PID of
+// the payload.
+#define AX25_PID_SEGMENT         0x08
+#define AX25_SEGMENT_FIRST       0x80
+#define AX25_SEGMENT_MAX         128
+#define AX25_SEGMENT_MAX_PAYLOAD ((INFO_MAX_SIZE - 2) + (AX25_SEGMENT_MAX - 1) * (INFO_MAX_SIZE - 1))
+#define AX25_REASSEMBLY_STREAMS  8
+
+// Results of AX25_reassemblerFrame
+#define AX25_SEGMENT_NONE        0x00  // Not a segment.
+#define AX25_SEGMENT_PENDING     0x01  // Segment stored, the payload is not complete.
+#define AX25_SEGMENT_COMPLETE    0x02  // Last segment : the payload is complete.
+#define AX25_SEGMENT_DROPPED     0x03  // Segment out of sequence or invalid.
+
+// Segmenter : cuts a payload made of fragments into frames, without
+// gathering the fragments first.
+typedef struct {
+  AX25_FrameHeader header;     // Header of the frames (PID 0x08 when segmented).
+  unsigned char pid;           // PID of the payload.
+  const AX25_Fragment *fragments;
+  unsigned int nbFragments;
+  unsigned int fragment;       // Fragment being sent.
+  unsigned int offset;         // Bytes of this fragment already sent.
+  unsigned long length;        // Bytes of the payload.
+  unsigned int nbFrames;
+  unsigned int frame;          // Next frame.
+} AX25_Segmenter;
+
+// Payload being reassembled, from one source to one destination.
+typedef struct {
+  unsigned char active;
+  unsigned char key[2 * AX25_ADDRESS_SIZE];  // Destination and source.
+  unsigned char pid;
+  unsigned char remaining;     // Segments still expected.
+  unsigned long long last;     // Time of the last segment (ms).
+  unsigned int length;
+  unsigned char payload[AX25_SEGMENT_MAX_PAYLOAD];
+} AX25_ReassemblyStream;
+
+typedef struct {
+  AX25_ReassemblyStream streams[AX25_REASSEMBLY_STREAMS];
+  unsigned long timeout;       // Max time between two segments (ms).
+  unsigned long nbPayloads;
+  unsigned long nbTimeouts;    // Payloads dropped after the timeout.
+  unsigned long nbDropped;     // Segments and payloads dropped (sequence, room).
+} AX25_Reassembler;
+
+unsigned int AX25_segmenterInit(AX25_Segmenter *segmenter, const AX25_FrameHeader *header,
+                                const AX25_Fragment *fragments, unsigned int nbFragments);
+unsigned int AX25_segmenterNext(AX25_Segmenter *segmenter, char *buffer);
+
+void AX25_reassemblerInit(AX25_Reassembler *reassembler, unsigned long timeout);
+void AX25_reassemblerExpire(AX25_Reassembler *reassembler, unsigned long long now);
+unsigned char AX25_reassemblerFrame(AX25_Reassembler *reassembler, const char *frame, unsigned int lengthFrame,
+                                    unsigned long long now, const unsigned char **payload,
+                                    unsigned int *length, unsigned char *pid);
+
+#endif /* AX25_SEGMENT_H */
@@ -0,0 +1,111 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Stats.c
+ * Counters of the state machines of the codec : flags, stuffed bits,
+ * aborts, overruns, FCS status, frame lengths and decode latency. The
+ * counters are updated by the codec (see AX25_Stats.h) and read here.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <time.h>
+
+#include "AX25_Stats.h"
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the counters (all cleared). It must not be called
+ * while the codec updates them.
+ *
+ * PARAMETER:
+ * *stats        pointer of the counters.
+ *--------------------------------------------------------------------------*/
+void AX25_statsInit(AX25_Stats *stats) {
+  unsigned int i;
+
+  for(i=0; i<AX25_STAT_COUNTERS; i++) atomic_init(&stats->counters[i], 0);
+  for(i=0; i<AX25_STAT_LENGTH_BINS; i++) atomic_init(&stats->lengths[i], 0);
+  for(i=0; i<AX25_STAT_LATENCY_BINS; i++) atomic_init(&stats->latencies[i], 0);
+  atomic_init(&stats->latencySum, 0);
+  atomic_init(&stats->latencyMax, 0);
+}
+
+/*--------------------------------------------------------------------------*
+ * Copy of the counters, from any thread. Every counter is read atomically
+ * but the copy is not a single point in time : a frame may be counted in
+ * one counter and not yet in another one.
+ *
+ * PARAMETERS:
+ * *stats        pointer of the counters.
+ * *snapshot     pointer of the copy.
+ *--------------------------------------------------------------------------*/
+void AX25_statsSnapshot(const AX25_Stats *stats, AX25_StatsSnapshot *snapshot) {
+  unsigned int i;
+
+  for(i=0; i<AX25_STAT_COUNTERS; i++) {
+    snapshot->counters[i] = atomic_load_explicit(&stats->counters[i], memory_order_relaxed);
+  }
+  for(i=0; i<AX25_STAT_LENGTH_BINS; i++) {
+    snapshot->lengths[i] = atomic_load_explicit(&stats->lengths[i], memory_order_relaxed);
+  }
+  for(i=0; i<AX25_STAT_LATENCY_BINS; i++) {
+    snapshot->latencies[i] = atomic_load_explicit(&stats->latencies[i], memory_order_relaxed);
+  }
+  snapshot->latencySum = atomic_load_explicit(&stats->latencySum, memory_order_relaxed);
+  snapshot->latencyMax = atomic_load_explicit(&stats->latencyMax, memory_order_relaxed);
+}
+
+/*--------------------------------------------------------------------------*
+ * Sum of the copies of several channels.
+ *
+ * PARAMETERS:
+ * *total        pointer of the sum (cleared by the caller).
+ * *snapshot     pointer of the copy to add.
+ *--------------------------------------------------------------------------*/
+void AX25_statsMerge(AX25_StatsSnapshot *total, const AX25_StatsSnapshot *snapshot) {
+  unsigned int i;
+
+  for(i=0; i<AX25_STAT_COUNTERS; i++) total->counters[i] += snapshot->counters[i];
+  for(i=0; i<AX25_STAT_LENGTH_BINS; i++) total->lengths[i] += snapshot->lengths[i];
+  for(i=0; i<AX25_STAT_LATENCY_BINS; i++) total->latencies[i] += snapshot->latencies[i];
+  total->latencySum += snapshot->latencySum;
+  if(snapshot->latencyMax > total->latencyMax) total->latencyMax = snapshot->latencyMax;
+}
+
+/*--------------------------------------------------------------------------*
+ * Latency below which a given part of the frames were delivered, read in
+ * the histogram (upper bound of the bin).
+ *
+ * PARAMETERS:
+ * *snapshot     pointer of the copy.
+ * percentile    part of the frames (0 to 100).
+ *
+ * RETURN:
+ * the latency (ns), 0 if no frame was delivered.
+ *--------------------------------------------------------------------------*/
+unsigned long long AX25_statsLatencyPercentile(const AX25_StatsSnapshot *snapshot, double percentile) {
+  unsigned long long nbFrames = 0, count = 0, bound;
+  unsigned int i;
+
+  for(i=0; i<AX25_STAT_LATENCY_BINS; i++) nbFrames += snapshot->latencies[i];
+  if(!nbFrames) return 0;
+  for(i=0; i<AX25_STAT_LATENCY_BINS - 1; i++) {
+    count += snapshot->latencies[i];
+    if(count * 100.0 >= percentile * nbFrames) break;
+  }
+  bound = (1ULL << i) - 1;
+  if(i == AX25_STAT_LATENCY_BINS - 1 || bound > snapshot->latencyMax) return snapshot->latencyMax;
+  return bound;
+}
+
+/*--------------------------------------------------------------------------*
+ * Monotonic clock of the latencies.
+ *
+ * RETURN:
+ * the time (ns), never 0.
+ *--------------------------------------------------------------------------*/
+unsigned long long AX25_statsClock(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000000000ULL + (unsigned long long) now.tv_nsec + 1;
+}
@@ -0,0 +1,133 @@
+#ifndef AX25_STATS_H
+#define AX25_STATS_H
+
+#include <stdatomic.h>
+
+// Counters
+#define AX25_STAT_FLAGS_HUNTED    0   // Flags found while hunting (synchronization).
+#define AX25_STAT_FLAGS_SYNC      1   // Flags without frame once synchronized.
+#define AX25_STAT_STUFF_REMOVED   2   // Stuffed bits removed from the frames.
+#define AX25_STAT_ABORTS          3
+#define AX25_STAT_OVERSIZES       4   // Frames too long for the buffer.
+#define AX25_STAT_OVERRUNS        5   // Frames lost because the ring was full.
+#define AX25_STAT_FCS_OK          6
+#define AX25_STAT_FCS_BAD         7
+#define AX25_STAT_FCS_FIXED       8   // FCS matching after correction.
+#define AX25_STAT_DELIVERED       9   // Frames given to the consumer (latency).
+#define AX25_STAT_TX_FRAMES       10
+#define AX25_STAT_TX_DELAY_FLAGS  11  // Flags sent before the frames (TX_DELAY).
+#define AX25_STAT_TX_TAIL_FLAGS   12  // Flags sent after the frames (TX_TAIL).
+#define AX25_STAT_STUFF_INSERTED  13  // Stuffed bits inserted in the frames sent.
+#define AX25_STAT_COUNTERS        14
+
+// Histograms
+#define AX25_STAT_LENGTH_STEP     32  // Bytes per bin of the frame lengths (flags included).
+#define AX25_STAT_LENGTH_BINS     11  // Up to AX25_FRAME_MAX_SIZE (longer in the last bin).
+#define AX25_STAT_LATENCY_BINS    32  // Bin n : latency from 2^(n-1) to 2^n - 1 ns.
+
+// Counters of one channel. Every counter has a single writer (the thread
+// of the receiver or of the transmitter of the channel) : it is updated
+// with relaxed loads and stores, without locked instruction, and can be
+// read at any time by any thread (AX25_statsSnapshot). With AX25_NO_STATS
+// defined, the updates are compiled out and the counters stay at 0.
+typedef struct {
+  atomic_ulong counters[AX25_STAT_COUNTERS];
+  atomic_ulong lengths[AX25_STAT_LENGTH_BINS];
+  atomic_ulong latencies[AX25_STAT_LATENCY_BINS];
+  atomic_ullong latencySum;      // From the closing flag to the delivery (ns).
+  atomic_ullong latencyMax;
+} AX25_Stats;
+
+// Copy of the counters at a given time.
+typedef struct {
+  unsigned long counters[AX25_STAT_COUNTERS];
+  unsigned long lengths[AX25_STAT_LENGTH_BINS];
+  unsigned long latencies[AX25_STAT_LATENCY_BINS];
+  unsigned long long latencySum;
+  unsigned long long latencyMax;
+} AX25_StatsSnapshot;
+
+void AX25_statsInit(AX25_Stats *stats);
+void AX25_statsSnapshot(const AX25_Stats *stats, AX25_StatsSnapshot *snapshot);
+void AX25_statsMerge(AX25_StatsSnapshot *total, const AX25_StatsSnapshot *snapshot);
+unsigned long long AX25_statsLatencyPercentile(const AX25_StatsSnapshot *snapshot, double percentile);
+unsigned long long AX25_statsClock(void);
+
+/*--------------------------------------------------------------------------*
+ * Updates of the counters, called by the codec on its own thread. A NULL
+ * stats pointer disables them.
+ *--------------------------------------------------------------------------*/
+static inline void AX25_statsAdd(AX25_Stats *stats, unsigned int counter, unsigned long n) {
+#ifndef AX25_NO_STATS
+  atomic_ulong *value;
+
+  if(!stats || !n) return;
+  value = &stats->counters[counter];
+  atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + n, memory_order_relaxed);
+#else
+  (void) stats; (void) counter; (void) n;
+#endif
+}
+
+// Frame received : its FCS status (AX25_FRAME_FCS_xxx, other : not checked)
+// and its length.
+static inline void AX25_statsFrame(AX25_Stats *stats, unsigned char status, unsigned int lengthFrame) {
+#ifndef AX25_NO_STATS
+  static const unsigned char counters[3] = { AX25_STAT_FCS_BAD, AX25_STAT_FCS_OK, AX25_STAT_FCS_FIXED };
+  atomic_ulong *value;
+  unsigned int bin;
+
+  if(!stats) return;
+  if(status < 3) AX25_statsAdd(stats, counters[status], 1);
+  bin = lengthFrame / AX25_STAT_LENGTH_STEP;
+  if(bin >= AX25_STAT_LENGTH_BINS) bin = AX25_STAT_LENGTH_BINS - 1;
+  value = &stats->lengths[bin];
+  atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + 1, memory_order_relaxed);
+#else
+  (void) stats; (void) status; (void) lengthFrame;
+#endif
+}
+
+// Time stamp of a closing flag (0 without stats).
+static inline unsigned long long AX25_statsStamp(AX25_Stats *stats) {
+#ifndef AX25_NO_STATS
+  return stats ? AX25_statsClock() : 0;
+#else
+  (void) stats;
+  return 0;
+#endif
+}
+
+// Frame delivered to the consumer : latency since its closing flag.
+static inline void AX25_statsDelivered(AX25_Stats *stats, unsigned long long timestamp) {
+#ifndef AX25_NO_STATS
+  unsigned long long latency;
+  unsigned int bin;
+
+  if(!stats || !timestamp) return;
+  latency = AX25_statsClock() - timestamp;
+  bin = latency ? 64 - (unsigned int) __builtin_clzll(latency) : 0;
+  if(bin >= AX25_STAT_LATENCY_BINS) bin = AX25_STAT_LATENCY_BINS - 1;
+  atomic_store_explicit(&stats->latencies[bin],
+                        atomic_load_explicit(&stats->latencies[bin], memory_order_relaxed) + 1, memory_order_relaxed);
+  atomic_store_explicit(&stats->latencySum,
+                        atomic_load_explicit(&stats->latencySum, memory_order_relaxed) + latency, memory_order_relaxed);
+  if(latency > atomic_load_explicit(&stats->latencyMax, memory_order_relaxed)) {
+    atomic_store_explicit(&stats->latencyMax, latency, memory_order_relaxed);
+  }
+  AX25_statsAdd(stats, AX25_STAT_DELIVERED, 1);
+#else
+  (void) stats; (void) timestamp;
+#endif
+}
+
+// Frame encoded by a bulk transmitter (AX25_txEncodeFrame...).
+static inline void AX25_statsTxFrame(AX25_Stats *stats, unsigned int nbDelayFlags, unsigned int nbTailFlags,
+                                     unsigned long nbStuffed) {
+  AX25_statsAdd(stats, AX25_STAT_TX_FRAMES, 1);
+  AX25_statsAdd(stats, AX25_STAT_TX_DELAY_FLAGS, nbDelayFlags);
+  AX25_statsAdd(stats, AX25_STAT_TX_TAIL_FLAGS, nbTailFlags);
+  AX25_statsAdd(stats, AX25_STAT_STUFF_INSERTED, nbStuffed);
+}
+
+#endif /* AX25_STATS_H */
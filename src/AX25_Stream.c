@@ -0,0 +1,424 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_Stream.c
+ * Continuous receiver. Unlike AX25_analyzeNextBit, the receiver never
+ * leaves the bitstream : a flag closes a frame and opens the next one,
+ * aborts (seven ones) and oversized frames are dropped, and the frames
+ * are published into a lock-free frame ring.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "AX25_Stream.h"
+#include "AX25_CRC.h"
+#include "AX25_FX25.h"
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a deframer.
+ *
+ * PARAMETERS:
+ * *deframer     pointer of the deframer.
+ * *frame        pointer of the buffer for the first frame.
+ * capacity      size of the buffer (in bytes).
+ *--------------------------------------------------------------------------*/
+void AX25_deframerInit(AX25_Deframer *deframer, char *frame, unsigned int capacity) {
+  deframer->state = AX25_HDLC_HUNT;
+  deframer->ones = 0;
+  deframer->nbAcc = 0;
+  deframer->acc = 0;
+  deframer->length = 0;
+  deframer->lengthEnd = 0;
+  deframer->frame = frame;
+  deframer->capacity = capacity;
+  deframer->nbHunted = 0;
+  deframer->nbSync = 0;
+  deframer->nbStuffed = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Analysis of the next decoded bit. The ones are stocked as they arrive,
+ * except the sixth one which is either part of a flag or of an abort.
+ * When a flag is found, its first six bits (a 0 and five 1) are still in
+ * the accumulator : a frame is complete when exactly these six bits are
+ * left (the length of the frame is then lengthEnd). After an event, the
+ * caller may give a new buffer (frame and capacity) before the next bit.
+ *
+ * PARAMETERS:
+ * *deframer     pointer of the deframer.
+ * bit           the decoded bit.
+ *
+ * RETURN:
+ * the event (AX25_HDLC_NONE if nothing happened).
+ *--------------------------------------------------------------------------*/
+unsigned char AX25_deframerBit(AX25_Deframer *deframer, unsigned int bit) {
+  unsigned char event;
+
+  if(bit) {
+    if(deframer->ones < 7) deframer->ones++;  // Saturated : the ones of a squelched line never end.
+    if(deframer->ones == 7) {  // Abort.
+      event = (deframer->state == AX25_HDLC_FRAME && deframer->length) ? AX25_HDLC_ABORT : AX25_HDLC_NONE;
+      deframer->state = AX25_HDLC_HUNT;
+      return event;
+    }
+    if(deframer->ones == 6) return AX25_HDLC_NONE;  // Flag or abort.
+  }
+  else {
+    if(deframer->ones == 6) {  // Flag.
+      event = AX25_HDLC_FLAG;
+      if(deframer->state == AX25_HDLC_FRAME && deframer->nbAcc == 6 &&
+         deframer->length + 2 >= AX25_FRAME_MIN_SIZE) {
+        event = AX25_HDLC_END;
+        deframer->lengthEnd = deframer->length;
+      }
+#ifndef AX25_NO_STATS
+      else if(deframer->state == AX25_HDLC_FRAME) deframer->nbSync++;
+      else deframer->nbHunted++;
+#endif
+      deframer->state = AX25_HDLC_FRAME;
+      deframer->ones = 0;
+      deframer->nbAcc = 0;
+      deframer->acc = 0;
+      deframer->length = 0;
+      return event;
+    }
+    if(deframer->ones == 5) {  // Stuffed bit.
+      deframer->ones = 0;
+#ifndef AX25_NO_STATS
+      if(deframer->state == AX25_HDLC_FRAME) deframer->nbStuffed++;
+#endif
+      return AX25_HDLC_NONE;
+    }
+    deframer->ones = 0;
+  }
+
+  if(deframer->state != AX25_HDLC_FRAME) return AX25_HDLC_NONE;
+
+  // Stock the bit.
+  deframer->acc |= bit << deframer->nbAcc;
+  if(++deframer->nbAcc == 8) {
+    if(deframer->length >= deframer->capacity) {
+      deframer->state = AX25_HDLC_HUNT;
+      return AX25_HDLC_OVERSIZE;
+    }
+    deframer->frame[deframer->length++] = (char) deframer->acc;
+    deframer->acc = 0;
+    deframer->nbAcc = 0;
+  }
+  return AX25_HDLC_NONE;
+}
+
+/*--------------------------------------------------------------------------*
+ * Selection of the slot of the next frame : the slot at the head of the
+ * ring, or the scratch slot when the ring is full.
+ *--------------------------------------------------------------------------*/
+static void AX25_rxStreamNextSlot(AX25_RxStream *stream) {
+  stream->slot = AX25_ringAcquire(stream->ring);
+  if(!stream->slot) stream->slot = &stream->scratch;
+  stream->deframer.frame = stream->slot->frame + 1;  // After the opening flag.
+  stream->deframer.capacity = AX25_FRAME_MAX_SIZE - 2;
+}
+
+/*--------------------------------------------------------------------------*
+ * Handling of a deframer event. A complete frame gets its flags and its
+ * FCS status and is published, then a new slot is taken for the next one.
+ *--------------------------------------------------------------------------*/
+static void AX25_rxStreamEvent(AX25_RxStream *stream, unsigned char event) {
+  AX25_FrameSlot *slot = stream->slot;
+  unsigned int length;
+  unsigned char errors;
+
+  switch(event) {
+    case AX25_HDLC_END:
+      if(slot == &stream->scratch) {
+        stream->nbOverruns++;
+        AX25_statsAdd(stream->stats, AX25_STAT_OVERRUNS, 1);
+        break;
+      }
+      length = stream->deframer.lengthEnd;
+      slot->frame[0] = 0x7E;
+      slot->frame[length + 1] = 0x7E;
+      slot->lengthFrame = length + 2;
+      slot->bitOffset = stream->nbBits;
+      slot->timestamp = AX25_statsStamp(stream->stats);
+      errors = AX25_crcCorrect(slot->frame + 1, length, stream->correction);
+      if(errors == AX25_CRC_UNCORRECTABLE) slot->status = AX25_FRAME_FCS_BAD;
+      else if(errors) {
+        slot->status = AX25_FRAME_FCS_FIXED;
+        stream->nbCorrected++;
+      }
+      else slot->status = AX25_FRAME_FCS_OK;
+      AX25_statsFrame(stream->stats, slot->status, slot->lengthFrame);
+      AX25_ringPublish(stream->ring);
+      stream->nbFrames++;
+      break;
+    case AX25_HDLC_ABORT:
+      stream->nbAborts++;
+      AX25_statsAdd(stream->stats, AX25_STAT_ABORTS, 1);
+      break;
+    case AX25_HDLC_OVERSIZE:
+      stream->nbOversizes++;
+      AX25_statsAdd(stream->stats, AX25_STAT_OVERSIZES, 1);
+      break;
+    default:
+      if(slot != &stream->scratch) return;  // Keep the same slot.
+      break;
+  }
+  AX25_rxStreamNextSlot(stream);
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a streaming receiver.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * *ring         pointer of the ring receiving the frames.
+ *--------------------------------------------------------------------------*/
+void AX25_rxStreamInit(AX25_RxStream *stream, AX25_FrameRing *ring) {
+  AX25_rxLineInit(&stream->line);
+  AX25_deframerInit(&stream->deframer, NULL, 0);
+  stream->ring = ring;
+  stream->correction = 0;
+  stream->fx25 = 0;
+  stream->fx25Tag = 0;
+  stream->fx25Length = 0;
+  stream->fx25Window = 0;
+  stream->nbBits = 0;
+  stream->nbFrames = 0;
+  stream->nbAborts = 0;
+  stream->nbOversizes = 0;
+  stream->nbOverruns = 0;
+  stream->nbCorrected = 0;
+  stream->nbFx25Codewords = 0;
+  stream->nbFx25Corrected = 0;
+  stream->nbFx25Failed = 0;
+  stream->stats = NULL;
+  AX25_rxStreamNextSlot(stream);
+}
+
+/*--------------------------------------------------------------------------*
+ * Correction of the frames whose FCS does not match (see AX25_crcCorrect).
+ * The corrected frames are published with the AX25_FRAME_FCS_FIXED status.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * maxErrors     max number of wrong bits on the air to correct (0 : none).
+ *--------------------------------------------------------------------------*/
+void AX25_rxStreamSetCorrection(AX25_RxStream *stream, unsigned char maxErrors) {
+  stream->correction = (maxErrors > 2) ? 2 : maxErrors;
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of FX.25 codewords (see AX25_FX25.c). The codewords are not
+ * given to the deframer : when a correlation tag is found, the deframer
+ * goes back to hunting and the bits of the codeword are stocked until it
+ * is complete.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * enable        1 to decode FX.25, 0 for plain AX.25 only.
+ *--------------------------------------------------------------------------*/
+void AX25_rxStreamSetFx25(AX25_RxStream *stream, unsigned char enable) {
+  stream->fx25 = enable ? 1 : 0;
+  stream->fx25Tag = 0;
+  stream->fx25Length = 0;
+  stream->fx25Window = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Counters of the receiver (see AX25_Stats.h). They are updated by the
+ * thread feeding the receiver.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * *stats        pointer of the counters (NULL : none).
+ *--------------------------------------------------------------------------*/
+void AX25_rxStreamSetStats(AX25_RxStream *stream, AX25_Stats *stats) {
+  stream->stats = stats;
+}
+
+/*--------------------------------------------------------------------------*
+ * The flags and the stuffed bits are counted by the deframer itself and
+ * added to the counters of the receiver once per word.
+ *--------------------------------------------------------------------------*/
+static void AX25_rxStreamFlushStats(AX25_RxStream *stream) {
+#ifndef AX25_NO_STATS
+  AX25_Deframer *deframer = &stream->deframer;
+
+  AX25_statsAdd(stream->stats, AX25_STAT_FLAGS_HUNTED, deframer->nbHunted);
+  AX25_statsAdd(stream->stats, AX25_STAT_FLAGS_SYNC, deframer->nbSync);
+  AX25_statsAdd(stream->stats, AX25_STAT_STUFF_REMOVED, deframer->nbStuffed);
+  deframer->nbHunted = 0;
+  deframer->nbSync = 0;
+  deframer->nbStuffed = 0;
+#else
+  (void) stream;
+#endif
+}
+
+/*--------------------------------------------------------------------------*
+ * Deframing of a word of decoded bits (LSB first). The word is taken a
+ * byte at a time : when the byte, preceded by the pending ones, has no
+ * run of five ones, it holds neither flag nor stuffed bit nor abort and
+ * its bits are stocked at once.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * decoded       the decoded bits.
+ * nbBits        number of bits in the word (1 to 64).
+ *--------------------------------------------------------------------------*/
+static void AX25_rxStreamDeframe(AX25_RxStream *stream, uint64_t decoded, unsigned int nbBits) {
+  AX25_Deframer *deframer = &stream->deframer;
+  unsigned int byte, run, ones, i, n;
+  unsigned char event;
+
+  while(nbBits) {
+    n = (nbBits > 8) ? 8 : nbBits;
+    byte = (unsigned int) decoded & ((1U << n) - 1);
+    ones = (deframer->ones > 7) ? 7 : deframer->ones;
+
+    run = (byte << ones) | ((1U << ones) - 1);
+    run &= (run >> 1) & (run >> 2) & (run >> 3) & (run >> 4);
+
+    if(n == 8 && ones < 5 && !run &&
+       (deframer->state != AX25_HDLC_FRAME || deframer->length < deframer->capacity)) {
+      // Fast path : a whole byte of data (or of noise when hunting).
+      if(deframer->state == AX25_HDLC_FRAME) {
+        deframer->acc |= byte << deframer->nbAcc;
+        deframer->frame[deframer->length++] = (char) deframer->acc;
+        deframer->acc >>= 8;
+      }
+      ones = 0;
+      while((byte >> (7 - ones)) & 1) ones++;
+      deframer->ones = (unsigned char) ones;
+      stream->nbBits += 8;
+    }
+    else {
+      for(i=0; i<n; i++) {
+        stream->nbBits++;
+        event = AX25_deframerBit(deframer, (byte >> i) & 1);
+        if(event != AX25_HDLC_NONE) AX25_rxStreamEvent(stream, event);
+      }
+    }
+    decoded >>= n;
+    nbBits -= n;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Correction of a complete FX.25 codeword. Its data bytes (the bitstream
+ * of the frame, corrected or not) are then deframed as if they had been
+ * received in place of the codeword, so the frames keep their position in
+ * the stream. The check bytes are skipped.
+ *--------------------------------------------------------------------------*/
+static void AX25_rxStreamFx25Codeword(AX25_RxStream *stream) {
+  const AX25_Fx25Code *code = AX25_fx25Code(stream->fx25Tag);
+  unsigned long long end = stream->nbBits;
+  unsigned char errors;
+  uint64_t word;
+  unsigned int i, j, n;
+
+  errors = AX25_rsDecode(stream->fx25Codeword, code->n, code->n - code->k);
+  stream->nbFx25Codewords++;
+  if(errors == AX25_RS_UNCORRECTABLE) stream->nbFx25Failed++;
+  else if(errors) stream->nbFx25Corrected++;
+
+  stream->nbBits = end - 8ULL * code->n;
+  stream->deframer.state = AX25_HDLC_HUNT;
+  stream->deframer.ones = 0;
+  for(i=0; i<code->k; i+=8) {
+    n = (code->k - i >= 8) ? 8 : code->k - i;
+    word = 0;
+    for(j=0; j<n; j++) word |= (uint64_t) stream->fx25Codeword[i + j] << (8 * j);
+    AX25_rxStreamDeframe(stream, word, 8 * n);
+  }
+  stream->nbBits = end;
+  stream->deframer.state = AX25_HDLC_HUNT;
+  stream->deframer.ones = 0;
+
+  stream->fx25Tag = 0;
+  stream->fx25Length = 0;
+  stream->fx25Window = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Analysis of a word of decoded bits (LSB first). Without FX.25, the word
+ * goes straight to the deframer. With FX.25, each bit is also shifted in
+ * the window of the correlation tags, and the bits after a tag are stocked
+ * in the codeword.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * decoded       the decoded bits.
+ * nbBits        number of bits in the word (1 to 64).
+ *--------------------------------------------------------------------------*/
+void AX25_rxStreamWord(AX25_RxStream *stream, uint64_t decoded, unsigned int nbBits) {
+  const AX25_Fx25Code *code;
+  unsigned int i, n;
+
+  if(!stream->fx25) {
+    AX25_rxStreamDeframe(stream, decoded, nbBits);
+    AX25_rxStreamFlushStats(stream);
+    return;
+  }
+
+  while(nbBits) {
+    if(stream->fx25Tag) {
+      // Bits of a codeword.
+      code = AX25_fx25Code(stream->fx25Tag);
+      n = 8U * code->n - stream->fx25Length;
+      if(n > nbBits) n = nbBits;
+      for(i=0; i<n; i++, stream->fx25Length++) {
+        if((decoded >> i) & 1) stream->fx25Codeword[stream->fx25Length >> 3] |= (unsigned char) (1 << (stream->fx25Length & 7));
+      }
+      stream->nbBits += n;
+      if(stream->fx25Length == 8U * code->n) AX25_rxStreamFx25Codeword(stream);
+    }
+    else {
+      // Search of a tag, the bits up to the tag are deframed.
+      for(n=0; n<nbBits && !stream->fx25Tag; n++) {
+        stream->fx25Window = (stream->fx25Window >> 1) | ((decoded >> n) << 63);
+        stream->fx25Tag = AX25_fx25Match(stream->fx25Window);
+      }
+      AX25_rxStreamDeframe(stream, decoded, n);
+      if(stream->fx25Tag) {
+        stream->deframer.state = AX25_HDLC_HUNT;
+        stream->deframer.ones = 0;
+        stream->fx25Length = 0;
+        memset(stream->fx25Codeword, 0, sizeof(stream->fx25Codeword));
+      }
+    }
+    decoded = (n < 64) ? decoded >> n : 0;
+    nbBits -= n;
+  }
+  AX25_rxStreamFlushStats(stream);
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_rxStreamBits is the main function. The bits from the demodulator
+ * (packed LSB first) are descrambled and NRZI decoded 64 at a time and
+ * analyzed. The receiver can be fed with blocks of any size.
+ *
+ * PARAMETERS:
+ * *stream       pointer of the receiver.
+ * *bits         pointer of the bits from the demodulator.
+ * nbBits        number of bits.
+ *--------------------------------------------------------------------------*/
+void AX25_rxStreamBits(AX25_RxStream *stream, const unsigned char *bits, unsigned long nbBits) {
+  uint64_t word;
+  unsigned int i, n, nbBytes;
+
+  while(nbBits) {
+    n = (nbBits >= 64) ? 64 : (unsigned int) nbBits;
+    nbBytes = (n + 7) >> 3;
+
+    word = 0;
+    for(i=0; i<nbBytes; i++) word |= (uint64_t) bits[i] << (8 * i);
+
+    AX25_rxStreamWord(stream, AX25_rxDecodeWord(&stream->line, word, n), n);
+    bits += nbBytes;
+    nbBits -= n;
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef AX25_STREAM_H
+#define AX25_STREAM_H
+
+#include <stdint.h>
+
+#include "AX25_Rx.h"
+#include "AX25_Ring.h"
+#include "AX25_RS.h"
+
+// Deframer states
+#define AX25_HDLC_HUNT       0x00  // Looking for a flag.
+#define AX25_HDLC_FRAME      0x01  // Between two flags.
+
+// Deframer events
+#define AX25_HDLC_NONE       0x00  // Nothing happened.
+#define AX25_HDLC_FLAG       0x01  // Flag without frame (sync or runt).
+#define AX25_HDLC_END        0x02  // Flag closing a frame.
+#define AX25_HDLC_ABORT      0x03  // Seven ones : the frame is aborted.
+#define AX25_HDLC_OVERSIZE   0x04  // The frame does not fit in the buffer.
+
+// HDLC deframer on decoded bits : flag detection, removal of the stuffed
+// bits, aborts. A flag closes the current frame and opens the next one.
+typedef struct {
+  unsigned char state;
+  unsigned char ones;          // Consecutive ones received.
+  unsigned char nbAcc;         // Bits waiting in acc.
+  unsigned int acc;
+  unsigned int length;         // Bytes of the current frame.
+  unsigned int lengthEnd;      // Bytes of the frame closed by the last flag.
+  unsigned int capacity;
+  char *frame;                 // Where the bytes of the frame go.
+  unsigned long nbHunted;      // Flags and stuffed bits not yet added to
+  unsigned long nbSync;        // the counters of the receiver (without
+  unsigned long nbStuffed;     // AX25_NO_STATS).
+} AX25_Deframer;
+
+// Streaming receiver : line decoding, deframing and FCS check of a
+// continuous bitstream. The frames are written in place in the slots of
+// a frame ring (flags included) and published with their FCS status.
+typedef struct {
+  AX25_RxLine line;
+  AX25_Deframer deframer;
+  AX25_FrameRing *ring;
+  AX25_FrameSlot *slot;        // Slot being filled (ring or scratch).
+  AX25_FrameSlot scratch;      // Used when the ring is full.
+  unsigned char correction;    // Max wrong bits on the air corrected (0 to 2).
+  unsigned char fx25;          // FX.25 codewords are searched and decoded.
+  unsigned char fx25Tag;       // Tag of the codeword being received (0 : none).
+  unsigned int fx25Length;     // Bits of the codeword received.
+  uint64_t fx25Window;         // Last 64 decoded bits (correlation tags).
+  unsigned char fx25Codeword[AX25_RS_SIZE];
+  unsigned long long nbBits;   // Bits received.
+  unsigned long nbFrames;
+  unsigned long nbAborts;
+  unsigned long nbOversizes;
+  unsigned long nbOverruns;    // Frames lost because the ring was full.
+  unsigned long nbCorrected;   // Frames corrected with their FCS.
+  unsigned long nbFx25Codewords;
+  unsigned long nbFx25Corrected;  // Codewords with wrong bytes corrected.
+  unsigned long nbFx25Failed;     // Codewords which could not be corrected.
+  AX25_Stats *stats;           // Counters of the channel (NULL : none).
+} AX25_RxStream;
+
+void AX25_deframerInit(AX25_Deframer *deframer, char *frame, unsigned int capacity);
+unsigned char AX25_deframerBit(AX25_Deframer *deframer, unsigned int bit);
+
+void AX25_rxStreamInit(AX25_RxStream *stream, AX25_FrameRing *ring);
+void AX25_rxStreamSetCorrection(AX25_RxStream *stream, unsigned char maxErrors);
+void AX25_rxStreamSetFx25(AX25_RxStream *stream, unsigned char enable);
+void AX25_rxStreamSetStats(AX25_RxStream *stream, AX25_Stats *stats);
+void AX25_rxStreamBits(AX25_RxStream *stream, const unsigned char *bits, unsigned long nbBits);
+void AX25_rxStreamWord(AX25_RxStream *stream, uint64_t decoded, unsigned int nbBits);
+
+#endif /* AX25_STREAM_H */
@@ -0,0 +1,732 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * AX25_TNC.c
+ * Software TNC : a single thread serves KISS clients (TCP connections and
+ * pseudo-terminals) with one epoll loop. Each KISS port is a channel with
+ * its own line encoder and streaming receiver, fed by the file descriptors
+ * of a modem (bits packed LSB first) or looped back on itself.
+ *
+ * The writes are batched : the events of a loop only fill the output
+ * buffers, which are written once at the end of the loop. A client too
+ * slow to read loses frames instead of slowing the others down, and the
+ * clients are not read while a modem has too many bits waiting.
+ *
+ *--------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "AX25_TNC.h"
+#include "AX25_CRC.h"
+#include "AX25_KISS.h"
+#include "AX25_Stream.h"
+#include "AX25_Tx.h"
+
+#define AX25_TNC_MAX_EVENTS    64
+#define AX25_TNC_READ_SIZE     4096
+#define AX25_TNC_MAX_READS     16    // Reads of a client per event.
+#define AX25_TNC_TX_HIGH       (AX25_TNC_TX_BUFFER / 2)  // Clients paused above.
+#define AX25_TNC_TX_LOW        (AX25_TNC_TX_BUFFER / 4)  // Clients resumed below.
+
+// Kinds of file descriptors in the epoll set (high half of the event data).
+#define AX25_TNC_LISTEN        1
+#define AX25_TNC_CLIENT        2
+#define AX25_TNC_PORT          3
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the TNC structures.
+ *--------------------------------------------------------------------------*/
+typedef struct {
+  int fd;
+  int ptySlave;                 // Slave kept open (pseudo-terminal), or -1.
+  unsigned int events;          // Events registered in the epoll set.
+  AX25_KissDecoder kiss;
+  unsigned char frame[AX25_FRAME_MAX_SIZE];
+  unsigned int outStart, outEnd;
+  unsigned char out[AX25_TNC_CLIENT_BUFFER];
+} AX25_TncClient;
+
+typedef struct {
+  int rxFd, txFd;               // -1 when closed (or none).
+  unsigned char loopback;       // The bits sent are received by the port.
+  unsigned char looping;        // The bits of the output buffer are being received.
+  unsigned int txEvents;        // Events registered for txFd.
+  unsigned int nbDelayFlags, nbTailFlags;
+  AX25_TxLine line;
+  AX25_RxStream stream;
+  AX25_FrameRing ring;
+  AX25_FrameSlot slots[AX25_TNC_RING_SIZE];
+  AX25_Stats stats;             // Counters of the codec of the port.
+  unsigned int outStart, outEnd;
+  unsigned char out[AX25_TNC_TX_BUFFER];
+} AX25_TncPort;
+
+struct AX25_Tnc {
+  int epoll;
+  int listens[4];
+  unsigned int nbListens;
+  AX25_TncClient *clients[AX25_TNC_MAX_CLIENTS];
+  AX25_TncPort *ports[AX25_TNC_MAX_PORTS];
+  unsigned int nbPorts;
+  unsigned char paused;         // The clients are not read (Tx backpressure).
+  AX25_Digi *digi;              // Duplicate suppression and digipeating (NULL : none).
+  AX25_TncStats stats;
+};
+
+/*--------------------------------------------------------------------------*
+ * Registration of a file descriptor in the epoll set (events 0 : removal
+ * of the interest, the descriptor stays in the set).
+ *--------------------------------------------------------------------------*/
+static int AX25_tncWatch(AX25_Tnc *tnc, int op, int fd, unsigned int events, unsigned int kind, unsigned int index) {
+  struct epoll_event event;
+
+  event.events = events;
+  event.data.u64 = ((uint64_t) kind << 32) | index;
+  return epoll_ctl(tnc->epoll, op, fd, &event);
+}
+
+/*--------------------------------------------------------------------------*
+ * Update of the events of a client : read unless paused, write while
+ * bytes are waiting.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncClientEvents(AX25_Tnc *tnc, unsigned int index) {
+  AX25_TncClient *client = tnc->clients[index];
+  unsigned int events;
+
+  events = tnc->paused ? 0 : EPOLLIN;
+  if(client->outEnd != client->outStart) events |= EPOLLOUT;
+  if(events == client->events) return;
+  AX25_tncWatch(tnc, EPOLL_CTL_MOD, client->fd, events, AX25_TNC_CLIENT, index);
+  client->events = events;
+}
+
+/*--------------------------------------------------------------------------*
+ * Update of the events of a port. When the modem reads and writes the same
+ * descriptor, both interests are registered with it.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncPortEvents(AX25_Tnc *tnc, unsigned int index) {
+  AX25_TncPort *port = tnc->ports[index];
+  unsigned int events;
+
+  if(port->txFd < 0) return;
+  events = (port->outEnd != port->outStart) ? EPOLLOUT : 0;
+  if(port->txFd == port->rxFd) events |= EPOLLIN;
+  if(events == port->txEvents) return;
+  AX25_tncWatch(tnc, EPOLL_CTL_MOD, port->txFd, events, AX25_TNC_PORT, index);
+  port->txEvents = events;
+}
+
+/*--------------------------------------------------------------------------*
+ * Removal of a client.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncCloseClient(AX25_Tnc *tnc, unsigned int index) {
+  AX25_TncClient *client = tnc->clients[index];
+
+  epoll_ctl(tnc->epoll, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  if(client->ptySlave >= 0) close(client->ptySlave);
+  free(client);
+  tnc->clients[index] = NULL;
+  tnc->stats.nbClients--;
+}
+
+/*--------------------------------------------------------------------------*
+ * Addition of a client (non-blocking descriptor).
+ *
+ * RETURN:
+ * the index of the client, or -1 if there is no room.
+ *--------------------------------------------------------------------------*/
+static int AX25_tncAddClient(AX25_Tnc *tnc, int fd, int ptySlave) {
+  AX25_TncClient *client;
+  unsigned int i;
+
+  for(i=0; i<AX25_TNC_MAX_CLIENTS && tnc->clients[i]; i++);
+  if(i == AX25_TNC_MAX_CLIENTS) return -1;
+
+  client = (AX25_TncClient *) malloc(sizeof(AX25_TncClient));
+  if(!client) return -1;
+  client->fd = fd;
+  client->ptySlave = ptySlave;
+  client->events = tnc->paused ? 0 : EPOLLIN;
+  client->outStart = 0;
+  client->outEnd = 0;
+  AX25_kissDecoderInit(&client->kiss, client->frame, sizeof(client->frame));
+  if(AX25_tncWatch(tnc, EPOLL_CTL_ADD, fd, client->events, AX25_TNC_CLIENT, i) < 0) {
+    free(client);
+    return -1;
+  }
+  tnc->clients[i] = client;
+  tnc->stats.nbClients++;
+  return (int) i;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bytes waiting in an output buffer are moved to its beginning when the
+ * room left at its end is too small.
+ *
+ * RETURN:
+ * 1 if n bytes can be appended, 0 otherwise.
+ *--------------------------------------------------------------------------*/
+static char AX25_tncRoom(unsigned char *out, unsigned int size, unsigned int *start, unsigned int *end, unsigned long n) {
+  if(size - *end >= n) return 1;
+  if(size - (*end - *start) < n) return 0;
+  memmove(out, out + *start, *end - *start);
+  *end -= *start;
+  *start = 0;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * A frame received on a port is given to all the clients in KISS (without
+ * flags nor FCS).
+ *--------------------------------------------------------------------------*/
+static void AX25_tncGive(AX25_Tnc *tnc, unsigned int index, const char *frame, unsigned int lengthFrame) {
+  unsigned char kiss[2 * AX25_FRAME_MAX_SIZE + 4];
+  AX25_TncClient *client;
+  unsigned long n;
+  unsigned int i;
+
+  n = AX25_kissEncode((unsigned char) index, AX25_KISS_DATA, (const unsigned char *) frame + 1, lengthFrame - 4, kiss);
+  for(i=0; i<AX25_TNC_MAX_CLIENTS; i++) {
+    client = tnc->clients[i];
+    if(!client) continue;
+    if(!AX25_tncRoom(client->out, AX25_TNC_CLIENT_BUFFER, &client->outStart, &client->outEnd, n)) {
+      tnc->stats.nbClientDrops++;
+      continue;
+    }
+    memcpy(client->out + client->outEnd, kiss, n);
+    client->outEnd += (unsigned int) n;
+  }
+  tnc->stats.nbRxFrames++;
+}
+
+/*--------------------------------------------------------------------------*
+ * Frames received on a port : the good ones are given to the clients, or
+ * to the digipeater when it is enabled (the clients then get the first
+ * copy of every frame only, whatever the port). The slot is released
+ * before : a frame repeated on another looped back port comes back here.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncDeliver(AX25_Tnc *tnc, unsigned int index) {
+  char frame[AX25_FRAME_MAX_SIZE];
+  AX25_TncPort *port = tnc->ports[index];
+  AX25_FrameSlot *slot;
+  unsigned int lengthFrame;
+  unsigned char status;
+
+  while((slot = AX25_ringPeek(&port->ring)) != NULL) {
+    AX25_statsDelivered(&port->stats, slot->timestamp);
+    status = slot->status;
+    lengthFrame = slot->lengthFrame;
+    if(status != AX25_FRAME_FCS_BAD) {
+      if(!tnc->digi) AX25_tncGive(tnc, index, slot->frame, lengthFrame);
+      else memcpy(frame, slot->frame, lengthFrame);
+    }
+    AX25_ringRelease(&port->ring);
+    if(status != AX25_FRAME_FCS_BAD && tnc->digi) AX25_digiInput(tnc->digi, index, frame, lengthFrame, AX25_statsClock());
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of bits from the modem of a port, in pieces too short to fill
+ * the ring.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncReceive(AX25_Tnc *tnc, unsigned int index, const unsigned char *bits, unsigned long nbBits) {
+  AX25_TncPort *port = tnc->ports[index];
+  unsigned long n;
+
+  while(nbBits) {
+    // A frame takes at least AX25_FRAME_MIN_SIZE - 1 bytes (shared flags).
+    n = 8UL * (AX25_FRAME_MIN_SIZE - 1) * (AX25_TNC_RING_SIZE - 2);
+    if(n > nbBits) n = nbBits;
+    AX25_rxStreamBits(&port->stream, bits, n);
+    bits += n >> 3;
+    nbBits -= n;
+    AX25_tncDeliver(tnc, index);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Reception of the frames waiting in the output buffer of a looped back
+ * port, each one after its number of bits, in order. A frame sent while
+ * they are received (repeated by the digipeater) is appended to the buffer
+ * and received after them, so the bits never change under the receiver.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncLoop(AX25_Tnc *tnc, unsigned int index) {
+  AX25_TncPort *port = tnc->ports[index];
+  unsigned long nbBits;
+
+  port->looping = 1;
+  while(port->outStart != port->outEnd) {
+    memcpy(&nbBits, port->out + port->outStart, sizeof(nbBits));
+    AX25_tncReceive(tnc, index, port->out + port->outStart + sizeof(nbBits), nbBits);
+    port->outStart += (unsigned int) (sizeof(nbBits) + (nbBits + 7) / 8);
+  }
+  port->outStart = port->outEnd = 0;
+  port->looping = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoding of a frame from a client (without flags nor FCS) for a port.
+ * The bits are rounded up to a whole byte : the padding falls in the tail
+ * flags and the receiver is synchronized again by the next TX_DELAY. A
+ * looped back port receives the bits exactly, without the padding.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncTransmit(AX25_Tnc *tnc, unsigned int index, const unsigned char *data, unsigned int length) {
+  char frame[AX25_FRAME_MAX_SIZE];
+  AX25_TncPort *port = tnc->ports[index];
+  unsigned int lengthFrame = length + 4;
+  unsigned long size, nbBits, header;
+
+  if((port->txFd < 0 && !port->loopback) || lengthFrame > AX25_FRAME_MAX_SIZE || lengthFrame < AX25_FRAME_MIN_SIZE) {
+    tnc->stats.nbTxDrops++;
+    return;
+  }
+  frame[0] = frame[lengthFrame - 1] = 0x7E;
+  memcpy(frame + 1, data, length);
+  AX25_putCRC(frame, (unsigned short) lengthFrame);
+
+  // The bytes being received on a looped back port are never moved.
+  size = AX25_txEncodedSize(lengthFrame, port->nbDelayFlags, port->nbTailFlags);
+  header = port->loopback ? sizeof(nbBits) : 0;
+  if(port->loopback ? AX25_TNC_TX_BUFFER - port->outEnd < header + size
+                    : !AX25_tncRoom(port->out, AX25_TNC_TX_BUFFER, &port->outStart, &port->outEnd, size)) {
+    tnc->stats.nbTxDrops++;
+    return;
+  }
+  nbBits = AX25_txEncodeFrame(&port->line, frame, lengthFrame, port->nbDelayFlags, port->nbTailFlags,
+                              port->out + port->outEnd + header);
+  tnc->stats.nbTxFrames++;
+  // The bits beyond the flags and the frame are the stuffed bits.
+  AX25_statsTxFrame(&port->stats, port->nbDelayFlags, port->nbTailFlags,
+                    nbBits - 8UL * (port->nbDelayFlags + port->nbTailFlags + lengthFrame - 2));
+
+  if(port->loopback) {
+    memcpy(port->out + port->outEnd, &nbBits, header);
+    port->outEnd += (unsigned int) (header + (nbBits + 7) / 8);
+    if(!port->looping) AX25_tncLoop(tnc, index);
+    return;
+  }
+  port->outEnd += (unsigned int) ((nbBits + 7) / 8);
+  if(port->outEnd - port->outStart > AX25_TNC_TX_HIGH) tnc->paused = 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Handler of the KISS frames from the clients. TXDELAY and TXTAIL are
+ * given in 10 ms units; the other parameters are meaningless here.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncKiss(void *user, unsigned char port, unsigned char command, const unsigned char *data, unsigned int length) {
+  AX25_Tnc *tnc = (AX25_Tnc *) user;
+  unsigned int nbFlags;
+
+  if(port >= tnc->nbPorts) {
+    if(command == AX25_KISS_DATA) tnc->stats.nbTxDrops++;
+    return;
+  }
+  switch(command) {
+    case AX25_KISS_DATA:
+      AX25_tncTransmit(tnc, port, data, length);
+      break;
+    case AX25_KISS_TXDELAY:
+    case AX25_KISS_TXTAIL:
+      if(!length) break;
+      nbFlags = data[0] * AX25_TNC_BAUD / 800;
+      if(nbFlags < 1) nbFlags = 1;  // The opening (or closing) flag.
+      if(command == AX25_KISS_TXDELAY) tnc->ports[port]->nbDelayFlags = nbFlags;
+      else tnc->ports[port]->nbTailFlags = nbFlags;
+      break;
+    default:
+      break;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Events of a listening socket : new TCP clients.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncAccept(AX25_Tnc *tnc, int listen) {
+  int fd, one = 1;
+
+  while((fd = accept4(listen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if(AX25_tncAddClient(tnc, fd, -1) < 0) close(fd);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Events of a client : KISS frames to decode, room to write or hang-up.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncClientEvent(AX25_Tnc *tnc, unsigned int index, unsigned int events) {
+  unsigned char bytes[AX25_TNC_READ_SIZE];
+  AX25_TncClient *client = tnc->clients[index];
+  unsigned int i;
+  ssize_t n;
+
+  if(!client) return;
+  if(tnc->paused) {
+    // Hang-ups are reported even without interest.
+    if((events & (EPOLLHUP | EPOLLERR)) && client->ptySlave < 0) AX25_tncCloseClient(tnc, index);
+    return;
+  }
+  // A few reads per event, so a busy client does not starve the others.
+  for(i=0; i<AX25_TNC_MAX_READS && !tnc->paused; i++) {
+    n = read(client->fd, bytes, sizeof(bytes));
+    if(n > 0) {
+      AX25_kissDecode(&client->kiss, bytes, (unsigned long) n, AX25_tncKiss, tnc);
+      if(n < (ssize_t) sizeof(bytes)) return;
+      continue;
+    }
+    if(n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if(client->ptySlave < 0) AX25_tncCloseClient(tnc, index);
+    return;  // The slave of a pseudo-terminal is kept open.
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Events of a port : bits from the modem, room to write bits.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncPortEvent(AX25_Tnc *tnc, unsigned int index, unsigned int events) {
+  unsigned char bits[AX25_TNC_READ_SIZE];
+  AX25_TncPort *port = tnc->ports[index];
+  ssize_t n;
+
+  if((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && port->rxFd >= 0) {
+    n = read(port->rxFd, bits, sizeof(bits));
+    if(n > 0) AX25_tncReceive(tnc, index, bits, 8UL * (unsigned long) n);
+    else if(n == 0 || (errno != EAGAIN && errno != EINTR)) {
+      // End of the bits (the modem is gone) : the port is closed.
+      epoll_ctl(tnc->epoll, EPOLL_CTL_DEL, port->rxFd, NULL);
+      close(port->rxFd);
+      if(port->txFd == port->rxFd) port->txFd = -1;
+      port->rxFd = -1;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Batched writes, once per loop : the bytes waiting for the clients and
+ * the bits waiting for the modems.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncFlush(AX25_Tnc *tnc) {
+  AX25_TncClient *client;
+  AX25_TncPort *port;
+  unsigned int i;
+  char paused;
+  ssize_t n;
+
+  for(i=0; i<tnc->nbPorts; i++) {
+    port = tnc->ports[i];
+    if(port->txFd < 0 || port->outEnd == port->outStart) continue;
+    n = write(port->txFd, port->out + port->outStart, port->outEnd - port->outStart);
+    if(n > 0) port->outStart += (unsigned int) n;
+    else if(n < 0 && errno != EAGAIN && errno != EINTR) {
+      tnc->stats.nbTxDrops++;
+      port->outStart = port->outEnd;  // The modem is gone.
+    }
+    if(port->outStart == port->outEnd) port->outStart = port->outEnd = 0;
+  }
+
+  // Backpressure : the clients are read again once the modems caught up.
+  paused = 0;
+  for(i=0; i<tnc->nbPorts; i++) {
+    port = tnc->ports[i];
+    if(port->outEnd - port->outStart > (tnc->paused ? AX25_TNC_TX_LOW : AX25_TNC_TX_HIGH)) paused = 1;
+  }
+  tnc->paused = paused;
+  for(i=0; i<tnc->nbPorts; i++) AX25_tncPortEvents(tnc, i);
+
+  for(i=0; i<AX25_TNC_MAX_CLIENTS; i++) {
+    client = tnc->clients[i];
+    if(!client) continue;
+    if(client->outEnd != client->outStart) {
+      n = (client->ptySlave >= 0) ? write(client->fd, client->out + client->outStart, client->outEnd - client->outStart)
+                                  : send(client->fd, client->out + client->outStart, client->outEnd - client->outStart, MSG_NOSIGNAL);
+      if(n > 0) client->outStart += (unsigned int) n;
+      else if(n < 0 && errno != EAGAIN && errno != EINTR) {
+        if(client->ptySlave < 0) {
+          AX25_tncCloseClient(tnc, i);
+          continue;
+        }
+        client->outStart = client->outEnd;
+      }
+      if(client->outStart == client->outEnd) client->outStart = client->outEnd = 0;
+    }
+    AX25_tncClientEvents(tnc, i);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Creation of a TNC, without port nor client.
+ *
+ * RETURN:
+ * the TNC, or NULL if it cannot be created.
+ *--------------------------------------------------------------------------*/
+AX25_Tnc *AX25_tncCreate(void) {
+  AX25_Tnc *tnc;
+
+  tnc = (AX25_Tnc *) calloc(1, sizeof(AX25_Tnc));
+  if(!tnc) return NULL;
+  tnc->epoll = epoll_create1(EPOLL_CLOEXEC);
+  if(tnc->epoll < 0) {
+    free(tnc);
+    return NULL;
+  }
+  AX25_crcInitEngine();
+  return tnc;
+}
+
+/*--------------------------------------------------------------------------*
+ * Listening for KISS clients on TCP.
+ *
+ * PARAMETERS:
+ * *tnc          pointer of the TNC.
+ * *address      IPv4 address to listen on (NULL : 127.0.0.1).
+ * port          TCP port.
+ *
+ * RETURN:
+ * 0 if the TNC listens, -1 otherwise (see errno).
+ *--------------------------------------------------------------------------*/
+int AX25_tncListen(AX25_Tnc *tnc, const char *address, unsigned short port) {
+  struct sockaddr_in socketAddress;
+  int fd, one = 1;
+
+  if(tnc->nbListens == sizeof(tnc->listens) / sizeof(tnc->listens[0])) {
+    errno = EMFILE;
+    return -1;
+  }
+  memset(&socketAddress, 0, sizeof(socketAddress));
+  socketAddress.sin_family = AF_INET;
+  socketAddress.sin_port = htons(port);
+  if(inet_pton(AF_INET, address ? address : "127.0.0.1", &socketAddress.sin_addr) != 1) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(fd < 0) return -1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if(bind(fd, (struct sockaddr *) &socketAddress, sizeof(socketAddress)) < 0 || listen(fd, 16) < 0 ||
+     AX25_tncWatch(tnc, EPOLL_CTL_ADD, fd, EPOLLIN, AX25_TNC_LISTEN, tnc->nbListens) < 0) {
+    close(fd);
+    return -1;
+  }
+  tnc->listens[tnc->nbListens++] = fd;
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Creation of a pseudo-terminal in raw mode : the application opens its
+ * slave as it would open the serial port of a TNC.
+ *
+ * PARAMETERS:
+ * *tnc          pointer of the TNC.
+ * *name         where the path of the slave is written.
+ * size          size of name (in bytes).
+ *
+ * RETURN:
+ * 0 if the pseudo-terminal is ready, -1 otherwise.
+ *--------------------------------------------------------------------------*/
+int AX25_tncOpenPty(AX25_Tnc *tnc, char *name, size_t size) {
+  struct termios attributes;
+  int master, slave;
+
+  master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if(master < 0) return -1;
+  if(grantpt(master) < 0 || unlockpt(master) < 0 || ptsname_r(master, name, size) != 0) {
+    close(master);
+    return -1;
+  }
+  // The slave stays open, so the master never sees a hang-up.
+  slave = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if(slave < 0) {
+    close(master);
+    return -1;
+  }
+  if(tcgetattr(slave, &attributes) == 0) {
+    cfmakeraw(&attributes);
+    tcsetattr(slave, TCSANOW, &attributes);
+  }
+  if(AX25_tncAddClient(tnc, master, slave) < 0) {
+    close(slave);
+    close(master);
+    return -1;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Addition of a KISS port (ports are numbered from 0 in the order they are
+ * added). The descriptors are made non-blocking and closed by
+ * AX25_tncDestroy; they may be the same (a socket to a modem).
+ *
+ * PARAMETERS:
+ * *tnc          pointer of the TNC.
+ * rxFd          bits from the demodulator, packed LSB first (-1 : none).
+ * txFd          where the line encoded bits are written (-1 : none).
+ *               Without any descriptor, the bits sent by the port are
+ *               looped back to its receiver.
+ *
+ * RETURN:
+ * the number of the port, or -1 if it cannot be added.
+ *--------------------------------------------------------------------------*/
+int AX25_tncAddPort(AX25_Tnc *tnc, int rxFd, int txFd) {
+  AX25_TncPort *port;
+  unsigned int index = tnc->nbPorts;
+
+  if(index == AX25_TNC_MAX_PORTS) return -1;
+  port = (AX25_TncPort *) calloc(1, sizeof(AX25_TncPort));
+  if(!port) return -1;
+
+  port->rxFd = rxFd;
+  port->txFd = txFd;
+  port->loopback = (rxFd < 0 && txFd < 0);
+  port->nbDelayFlags = TX_DELAY;
+  port->nbTailFlags = TX_TAIL;
+  AX25_txLineInit(&port->line);
+  AX25_ringInit(&port->ring, port->slots, AX25_TNC_RING_SIZE);
+  AX25_rxStreamInit(&port->stream, &port->ring);
+  AX25_statsInit(&port->stats);
+  AX25_rxStreamSetStats(&port->stream, &port->stats);
+
+  if(rxFd >= 0) {
+    fcntl(rxFd, F_SETFL, fcntl(rxFd, F_GETFL) | O_NONBLOCK);
+    if(AX25_tncWatch(tnc, EPOLL_CTL_ADD, rxFd, EPOLLIN, AX25_TNC_PORT, index) < 0) {
+      free(port);
+      return -1;
+    }
+  }
+  if(txFd >= 0 && txFd != rxFd) {
+    fcntl(txFd, F_SETFL, fcntl(txFd, F_GETFL) | O_NONBLOCK);
+    if(AX25_tncWatch(tnc, EPOLL_CTL_ADD, txFd, 0, AX25_TNC_PORT, index) < 0) {
+      if(rxFd >= 0) epoll_ctl(tnc->epoll, EPOLL_CTL_DEL, rxFd, NULL);
+      free(port);
+      return -1;
+    }
+  }
+  port->txEvents = (txFd == rxFd) ? EPOLLIN : 0;
+
+  tnc->ports[index] = port;
+  tnc->nbPorts++;
+  return (int) index;
+}
+
+/*--------------------------------------------------------------------------*
+ * Handlers of the digipeater : the repeated frames are sent on their
+ * port, the first copy of every frame is given to the clients.
+ *--------------------------------------------------------------------------*/
+static void AX25_tncDigiTx(void *user, unsigned int channel, const char *frame, unsigned int lengthFrame) {
+  AX25_Tnc *tnc = (AX25_Tnc *) user;
+
+  if(channel >= tnc->nbPorts) return;
+  AX25_tncTransmit(tnc, channel, (const unsigned char *) frame + 1, lengthFrame - 4);
+}
+
+static void AX25_tncDigiGate(void *user, unsigned int channel, const char *frame, unsigned int lengthFrame) {
+  AX25_tncGive((AX25_Tnc *) user, channel, frame, lengthFrame);
+}
+
+/*--------------------------------------------------------------------------*
+ * Enabling of the duplicate suppression and of the digipeater : the frames
+ * heard on several ports (or repeated by other digipeaters) are given once
+ * to the clients, and the frames whose next hop is the call (or an alias,
+ * or a WIDEn-N hop, see AX25_Digi.h) are repeated on their port.
+ *
+ * PARAMETERS:
+ * *tnc          pointer of the TNC.
+ * *call         pointer of the call of the digipeater.
+ * nbEntries     max number of frames in the window.
+ * window        time a frame is a duplicate (ns, 0 : AX25_DIGI_WINDOW).
+ *
+ * RETURN:
+ * the digipeater (to add aliases and routes, destroyed with the TNC), or
+ * NULL if it cannot be created.
+ *--------------------------------------------------------------------------*/
+AX25_Digi *AX25_tncEnableDigi(AX25_Tnc *tnc, const AX25_Address *call, unsigned int nbEntries, unsigned long long window) {
+  if(tnc->digi) return NULL;
+  tnc->digi = AX25_digiCreate(call, nbEntries, window, AX25_tncDigiTx, AX25_tncDigiGate, tnc);
+  return tnc->digi;
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_tncRun is the main function : one turn of the event loop, then the
+ * batched writes. It is called in a loop by the application.
+ *
+ * PARAMETERS:
+ * *tnc          pointer of the TNC.
+ * timeout       max time to wait for an event (in ms, -1 : no limit).
+ *
+ * RETURN:
+ * the number of events handled, or -1 on error (see errno).
+ *--------------------------------------------------------------------------*/
+int AX25_tncRun(AX25_Tnc *tnc, int timeout) {
+  struct epoll_event events[AX25_TNC_MAX_EVENTS];
+  unsigned int kind, index;
+  int i, n;
+
+  n = epoll_wait(tnc->epoll, events, AX25_TNC_MAX_EVENTS, timeout);
+  if(n < 0) return (errno == EINTR) ? 0 : -1;
+
+  for(i=0; i<n; i++) {
+    kind = (unsigned int) (events[i].data.u64 >> 32);
+    index = (unsigned int) events[i].data.u64;
+    switch(kind) {
+      case AX25_TNC_LISTEN: AX25_tncAccept(tnc, tnc->listens[index]); break;
+      case AX25_TNC_CLIENT: AX25_tncClientEvent(tnc, index, events[i].events); break;
+      case AX25_TNC_PORT: AX25_tncPortEvent(tnc, index, events[i].events); break;
+      default: break;
+    }
+  }
+  AX25_tncFlush(tnc);
+  return n;
+}
+
+/*--------------------------------------------------------------------------*
+ * Copy of the counters of a TNC.
+ *--------------------------------------------------------------------------*/
+void AX25_tncGetStats(const AX25_Tnc *tnc, AX25_TncStats *stats) {
+  *stats = tnc->stats;
+}
+
+/*--------------------------------------------------------------------------*
+ * Copy of the counters of the codec of a port (see AX25_Stats.h).
+ *
+ * RETURN:
+ * 1 if the copy is done, 0 if the port does not exist.
+ *--------------------------------------------------------------------------*/
+char AX25_tncGetPortStats(const AX25_Tnc *tnc, unsigned int port, AX25_StatsSnapshot *snapshot) {
+  if(port >= tnc->nbPorts) return 0;
+  AX25_statsSnapshot(&tnc->ports[port]->stats, snapshot);
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Destruction of a TNC : the clients, the ports and their descriptors are
+ * closed.
+ *--------------------------------------------------------------------------*/
+void AX25_tncDestroy(AX25_Tnc *tnc) {
+  unsigned int i;
+
+  if(!tnc) return;
+  for(i=0; i<AX25_TNC_MAX_CLIENTS; i++) {
+    if(tnc->clients[i]) AX25_tncCloseClient(tnc, i);
+  }
+  for(i=0; i<tnc->nbPorts; i++) {
+    if(tnc->ports[i]->rxFd >= 0) close(tnc->ports[i]->rxFd);
+    if(tnc->ports[i]->txFd >= 0 && tnc->ports[i]->txFd != tnc->ports[i]->rxFd) close(tnc->ports[i]->txFd);
+    free(tnc->ports[i]);
+  }
+  for(i=0; i<tnc->nbListens; i++) close(tnc->listens[i]);
+  AX25_digiDestroy(tnc->digi);
+  close(tnc->epoll);
+  free(tnc);
+}
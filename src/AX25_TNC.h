@@ -0,0 +1,38 @@
+#ifndef AX25_TNC_H
+#define AX25_TNC_H
+
+#include <stddef.h>
+
+#include "AX25_Digi.h"
+#include "AX25_Stats.h"
+
+// Specifications
+#define AX25_TNC_MAX_CLIENTS   64
+#define AX25_TNC_MAX_PORTS     16        // KISS ports (high nibble of the type byte).
+#define AX25_TNC_CLIENT_BUFFER 65536     // Bytes waiting to be written to a client.
+#define AX25_TNC_TX_BUFFER     65536     // Bytes of bits waiting to be written to a modem.
+#define AX25_TNC_RING_SIZE     16        // Frame slots per port.
+#define AX25_TNC_BAUD          9600      // For the KISS TXDELAY and TXTAIL (10 ms units).
+
+// Counters of a TNC.
+typedef struct {
+  unsigned int nbClients;        // Clients connected (pseudo-terminals included).
+  unsigned long nbRxFrames;      // Frames received and given to the clients.
+  unsigned long nbTxFrames;      // Frames from the clients encoded for a port.
+  unsigned long nbClientDrops;   // Frames not given to a client too slow.
+  unsigned long nbTxDrops;       // Frames not sent (unknown port, too long...).
+} AX25_TncStats;
+
+typedef struct AX25_Tnc AX25_Tnc;
+
+AX25_Tnc *AX25_tncCreate(void);
+int AX25_tncListen(AX25_Tnc *tnc, const char *address, unsigned short port);
+int AX25_tncOpenPty(AX25_Tnc *tnc, char *name, size_t size);
+int AX25_tncAddPort(AX25_Tnc *tnc, int rxFd, int txFd);
+AX25_Digi *AX25_tncEnableDigi(AX25_Tnc *tnc, const AX25_Address *call, unsigned int nbEntries, unsigned long long window);
+int AX25_tncRun(AX25_Tnc *tnc, int timeout);
+void AX25_tncGetStats(const AX25_Tnc *tnc, AX25_TncStats *stats);
+char AX25_tncGetPortStats(const AX25_Tnc *tnc, unsigned int port, AX25_StatsSnapshot *snapshot);
+void AX25_tncDestroy(AX25_Tnc *tnc);
+
+#endif /* AX25_TNC_H */
@@ -1,247 +1,689 @@
-/*--------------------------------------------------------------------------*
- * OUFTI-1 OBC Embedded software
- * 2008-2009, University of Liege
- *--------------------------------------------------------------------------*
- * AX25_Tx.c
- * Main functions to transmit AX.25 UI frames. Included : bit stuffing, NRZI
- * encoding, scrambling, sync pattern and tail of the frame. The implementa-
- * tion is compatible with G3RUH modem 9600 baud FSK.
- * 
- *
- * Johan Hardy
- *--------------------------------------------------------------------------*/
-
-#include "AX25_Tx.h"
-#include "AX25_CRC.h"
-
-/*--------------------------------------------------------------------------*
- * Declaration of the global variables for Tx.
- *--------------------------------------------------------------------------*/
-unsigned char bitToSend;
-unsigned char lastBit;
-unsigned char txMode;
-unsigned long shiftRegister;
-unsigned char bitSetCounter;
-unsigned int nbFlagToSend; 
-unsigned int byteCounter; 
-unsigned char bitCounter;
-unsigned int lengthFrame;
-
-/*--------------------------------------------------------------------------*
-* ADF7021 configuration registers (see Excel file) - Freq = 434MHz
-*--------------------------------------------------------------------------*/
-char ADFR0[4] = { 0b11000000 , 0b11011111 , 0b01110011 , 0b00000010 };
-char ADFR1[4] = { 0b10010001 , 0b01010000 , 0b01000111 , 0b00000000 };
-char ADFR2[4] = { 0b10000010 , 0b00110000 , 0b11000000 , 0b00000001 };
-char ADFR3[4] = { 0b10010011 , 0b01001000 , 0b10111100 , 0b00101001 };
-char ADFR8[4] = { 0b00011000 , 0b00000001 , 0b00000000 , 0b00000000 };
-
-/*--------------------------------------------------------------------------*
- * AX.25 TX header : < Address | Control |  PID   > 
- *                   < 14bytes |  1byte  | 1byte  >
- *
- *   - Address : Destination = ON4ULG, SSID = 0x60
- *   - Address : Source = OUFTI1, SSID = 0x61
- *
- *  NB : Characters coded in standard ASCII 7-bits with LSB (HDLC extension
- *      bit) set to 0. Except for the last SSID (means that's the last byte).
- *
- *   - Control : 0x03 (type of frame : UI frame)
- *   - PID     : 0xF0 (no layer 3 protocol implemented)
- *--------------------------------------------------------------------------*/
-static const unsigned char AX25_TxHeader[16] = { 
-  'O' << 1, 'N' << 1, '4' << 1, 'U' << 1, 'L' << 1, 'G' << 1, 0x60, 
-  'O' << 1, 'U' << 1, 'F' << 1, 'T' << 1, 'I' << 1, '1' << 1, 0x61, 
-  0x03, 0xF0 
-};
-
-/*--------------------------------------------------------------------------*
- * Preparation of the frame (Layer 2). Assembling the info field with the 
- * header, the two flags and the FCS in the buffer.
- *
- * PARAMETERS:
- * *buffer            pointer of the buffer.
- * *info              pointer of the info field to transmit.
- * lengthInfoField    length of the info field (in bytes).
- *--------------------------------------------------------------------------*/
-void AX25_prepareUIFrame(char *buffer, char *info, unsigned int lengthInfoField) {
-  int i;
-
-  // Check the size of *info.
-  if(lengthInfoField > INFO_MAX_SIZE) {
-    lengthInfoField = INFO_MAX_SIZE;
-  }
-
-  // Set the length of the frame to lengthInfoField + 20 bytes (address + 
-  // control + PID + FCS + 2 flags).
-  lengthFrame = (unsigned int) (lengthInfoField + 20);
-
-  // Put flags at the right place in the buffer.
-  buffer[0] = buffer[lengthFrame-1] = 0x7E;
-
-  // Add the header in the buffer.
-  for(i=1; i < (lengthFrame - lengthInfoField - 3); i++) {
-    buffer[i] = AX25_TxHeader[i-1];
-  }
-
-  // Add the info field in the buffer.
-  for(i=17; i < (lengthFrame - 3); i++) {
-    buffer[i] = *info;
-    info++;
-  }
-
-  // Calculation and insertion of the FCS in the buffer.
-  AX25_putCRC(buffer, lengthFrame);
-}
-
-/*--------------------------------------------------------------------------*
- * Initialization of the transmission. The routine switches txMode from 
- * TX_OFF to TX_DELAY_FLAG and resets the main variables.
- *--------------------------------------------------------------------------*/
-void AX25_txInitCfg(void) {
-  txMode = TX_DELAY_FLAG;
-  nbFlagToSend = TX_DELAY;
-  bitToSend = 0;
-  lastBit = 0;
-  shiftRegister = 0;
-  bitSetCounter = 0;
-  byteCounter = 0; 
-  bitCounter = 0;
-  lengthFrame = 0;
-}
-
-/*--------------------------------------------------------------------------*
- * NRZI encoding and scrambling operations. The next bit to send from the
- * buffer is first NRZI encoded and then scrambled. The polynom of the
- * scrambler is S(x) = x17 + x12 + 1. The result of the NRZI and scrambling
- * operations is bitToSend (input of the modulator).
- *
- * PARAMETERS:
- * bit              next bit from the buffer to send.
- *--------------------------------------------------------------------------*/
-void AX25_txBit(char bit){
-  volatile char firstXorScrambler;
-
-  // First XOR of the scrambler : bit17 XOR bit12.
-  firstXorScrambler = ((shiftRegister >> 11) & 1) ^ ((shiftRegister >> 16) & 1);
-
-  // NRZI encoding : if bit is a 0 -> make a transistion.
-  //                 if bit is a 1 -> no transition.
-  if(!bit) {
-    if(lastBit == 0) {
-      bitToSend = 1 ^ firstXorScrambler;
-      firstXorScrambler ^= 0;
-      lastBit = 1;  // Refresh the last bit sent.
-    }
-    else {
-      bitToSend = 0 ^ firstXorScrambler;
-      firstXorScrambler ^= 1;
-      lastBit = 0;  // Refresh the last bit sent.
-    }
-    bitSetCounter = 0;  // If bit=0 reset bitSetCounter for bit stuffing.
-    shiftRegister <<= 1;  // Shift the register of the scrambler to the left.
-    if(firstXorScrambler) shiftRegister |= 1;  // Scrambling operation.
-  }
-  else {
-    if(lastBit == 0) {
-      bitToSend = 0 ^ firstXorScrambler;
-      firstXorScrambler ^= 1;
-      lastBit = 0;  // Refresh the last bit sent.
-    }
-    else {
-      bitToSend = 1 ^ firstXorScrambler;
-      firstXorScrambler ^= 0;
-      lastBit = 1;  // Refresh the last bit sent.
-    }
-    bitSetCounter++;  // If bit=1 increment bitSetCounter for bit stuffing.
-    shiftRegister <<= 1;  // Shift the register of the scrambler to the left.
-    if(firstXorScrambler) shiftRegister |= 1;  // Scrambling operation.
-  }
-}   
-
-/*--------------------------------------------------------------------------*
- * This function checks if we must insert a 0 (bit stuffing).
- *
- * RETURN:
- * 1       if there is a stuffed bit.
- * 0       if not.
- *--------------------------------------------------------------------------*/    
-char AX25_checkBitStuffing(void) {
-  volatile char firstXorScrambler;
-
-  if(bitSetCounter >= 5) {  // If we have 5 ones -> stuff a 0.
-    // First XOR of the scrambler : bit17 XOR bit12.
-    firstXorScrambler = ((shiftRegister >> 11) & 1) ^ ((shiftRegister >> 16) & 1);
-    
-    // NRZI encoding : inertion of a 0 -> make a transistion.
-    if(lastBit == 0) {
-      bitToSend = 1 ^ firstXorScrambler;
-      firstXorScrambler ^= 0;
-      lastBit = 1;  // Refresh the last bit sent.
-    }
-    else {
-      bitToSend = 0 ^ firstXorScrambler;
-      firstXorScrambler ^= 1;
-      lastBit = 0;  // Refresh the last bit sent.
-    }
-    bitSetCounter = 0;  // A 0 is inserted so reset the counter.
-    shiftRegister <<= 1;  // Shift the register of the scrambler to the left.
-    if(firstXorScrambler) shiftRegister |= 1;  // Scrambling operation.
-    return 1;
-  }
-  return 0;
-}
-
-/*--------------------------------------------------------------------------*
- * AX25_prepareNextBitToSend is the main function. AX25_prepareNextBitToSend
- * prepares the next bit to send to the modulator. This function includes
- * bit stuffing, NRZI encoding and scrambling operations. First, the flags 
- * are sent for delaying and synchronizing the TNC. Then the data are sent.
- * Finally, flags are sent for delimiting the frame.
- *
- * PARAMETERS:
- * *buffer    pointer of the buffer.        
- *
- * RETURN:
- * 1       if there are still bits to send.
- * 0       when all bits are sent.
- *--------------------------------------------------------------------------*/   
-char AX25_prepareNextBitToSend(char *buffer) {
-  if(txMode != TX_DATA_MODE) {  // If txMode is not TX_DATA_MODE.
-    AX25_txBit(buffer[byteCounter] & 1);  // Fetch the bit and encode it.
-    bitCounter++;
-    buffer[byteCounter] >>= 1;  // Prepare the next bit of the buffer.
-    if(bitCounter > 7) {
-      bitCounter = 0;  // A byte is sent. Reset the bitCounter.
-      nbFlagToSend--;
-      if(!nbFlagToSend) {  // Check if there are still flags to send.
-        if(txMode == TX_DELAY_FLAG) {
-          txMode = TX_DATA_MODE;  // The flags are sent : go to TX_DATA_MODE.
-          byteCounter++;  // Next byte to send.
-          return 1;
-        }
-        else {
-          txMode = TX_OFF;  // Frame is sent : go to TX_OFF.
-          return 0;
-        }
-      }
-      else buffer[byteCounter] = 0x7E;  // Reload flag in the buffer.
-    }
-    return 1;
-  }
-  else {
-    if(AX25_checkBitStuffing()) return 1;
-    AX25_txBit(buffer[byteCounter] & 1);  // Fetch the bit and encode it.
-    bitCounter++;
-    buffer[byteCounter] >>= 1;  // Prepare the next bit of the buffer.
-    if(bitCounter > 7) {
-      bitCounter = 0;  // A byte is sent. Reset the bitCounter.
-      byteCounter++;  // Next byte to send.
-      if(byteCounter == lengthFrame-1) {  // Check if all the data are sent.
-        txMode = TX_TAIL_MODE;  // If so : go to TX_TAIL_MODE.
-        nbFlagToSend = TX_TAIL;
-      }
-    }
-    return 1;
-  }
-}
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 OBC Embedded software
+ * 2008-2009, University of Liege
+ *--------------------------------------------------------------------------*
+ * AX25_Tx.c
+ * Main functions to transmit AX.25 UI frames. Included : bit stuffing, NRZI
+ * encoding, scrambling, sync pattern and tail of the frame. The implementa-
+ * tion is compatible with G3RUH modem 9600 baud FSK. A bulk encoder turns
+ * a whole frame into a packed bitstream without modifying the frame.
+ * 
+ *
+ * Johan Hardy
+ *--------------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "AX25_Tx.h"
+#include "AX25_CRC.h"
+#include "AX25_Frame.h"
+
+/*--------------------------------------------------------------------------*
+ * Declaration of the global variables for Tx. bitToSend is the output of
+ * the legacy (single channel) functions.
+ *--------------------------------------------------------------------------*/
+unsigned char bitToSend;
+static AX25_TxContext txContext;
+
+/*--------------------------------------------------------------------------*
+* ADF7021 configuration registers (see Excel file) - Freq = 434MHz
+*--------------------------------------------------------------------------*/
+char txADFR0[4] = { 0b11000000 , 0b11011111 , 0b01110011 , 0b00000010 };
+char txADFR1[4] = { 0b10010001 , 0b01010000 , 0b01000111 , 0b00000000 };
+char txADFR2[4] = { 0b10000010 , 0b00110000 , 0b11000000 , 0b00000001 };
+char txADFR3[4] = { 0b10010011 , 0b01001000 , 0b10111100 , 0b00101001 };
+char txADFR8[4] = { 0b00011000 , 0b00000001 , 0b00000000 , 0b00000000 };
+
+/*--------------------------------------------------------------------------*
+ * AX.25 TX header : < Address | Control |  PID   > 
+ *                   < 14bytes |  1byte  | 1byte  >
+ *
+ *   - Address : Destination = ON4ULG, SSID = 0x60
+ *   - Address : Source = OUFTI1, SSID = 0x61
+ *
+ *  NB : Characters coded in standard ASCII 7-bits with LSB (HDLC extension
+ *      bit) set to 0. Except for the last SSID (means that's the last byte).
+ *
+ *   - Control : 0x03 (type of frame : UI frame)
+ *   - PID     : 0xF0 (no layer 3 protocol implemented)
+ *
+ *  The state of the FCS register after the header is precomputed, so the
+ *  header is constant and shared by all the threads.
+ *--------------------------------------------------------------------------*/
+static const AX25_FrameHeader txHeader = {
+  { 'O' << 1, 'N' << 1, '4' << 1, 'U' << 1, 'L' << 1, 'G' << 1, 0x60,
+    'O' << 1, 'U' << 1, 'F' << 1, 'T' << 1, 'I' << 1, '1' << 1, 0x61,
+    0x03, 0xF0 },
+  16,
+  0xB14A  // AX25_crcUpdate(AX25_CRC_INIT, header, 16).
+};
+
+/*--------------------------------------------------------------------------*
+ * Preparation of the frame (Layer 2). Assembling the info field with the 
+ * header, the two flags and the FCS in the buffer.
+ *
+ * PARAMETERS:
+ * *buffer            pointer of the buffer.
+ * *info              pointer of the info field to transmit.
+ * lengthInfoField    length of the info field (in bytes).
+ *
+ * RETURN:
+ * the length of the frame (in bytes).
+ *--------------------------------------------------------------------------*/
+unsigned int AX25_buildUIFrame(char *buffer, const char *info, unsigned int lengthInfoField) {
+  // Check the size of *info.
+  if(lengthInfoField > INFO_MAX_SIZE) {
+    lengthInfoField = INFO_MAX_SIZE;
+  }
+  return AX25_frameBuild(&txHeader, buffer, info, lengthInfoField);
+}
+
+/*--------------------------------------------------------------------------*
+ * Preparation of the frame to send with the Tx state machine.
+ *
+ * PARAMETERS:
+ * *ctx               pointer of the Tx context (channel).
+ * *buffer            pointer of the buffer.
+ * *info              pointer of the info field to transmit.
+ * lengthInfoField    length of the info field (in bytes).
+ *--------------------------------------------------------------------------*/
+void AX25_prepareUIFrame_r(AX25_TxContext *ctx, char *buffer, char *info, unsigned int lengthInfoField) {
+  ctx->lengthFrame = AX25_buildUIFrame(buffer, info, lengthInfoField);
+}
+
+void AX25_prepareUIFrame(char *buffer, char *info, unsigned int lengthInfoField) {
+  AX25_prepareUIFrame_r(&txContext, buffer, info, lengthInfoField);
+}
+
+/*--------------------------------------------------------------------------*
+ * Number of flags sent before and after the frames. The timing is kept by
+ * AX25_txInitCfg. 0 selects the default value (TX_DELAY or TX_TAIL).
+ *
+ * PARAMETERS:
+ * *ctx          pointer of the Tx context (channel).
+ * nbDelayFlags  number of flags before the frame.
+ *               Ex : delay = 250 ms at 9600 baud -> 0,25 * 9600 / 8 = 300.
+ * nbTailFlags   number of flags after the frame.
+ *--------------------------------------------------------------------------*/
+void AX25_txSetTiming_r(AX25_TxContext *ctx, unsigned int nbDelayFlags, unsigned int nbTailFlags) {
+  ctx->txDelay = nbDelayFlags;
+  ctx->txTail = nbTailFlags;
+}
+
+void AX25_txSetTiming(unsigned int nbDelayFlags, unsigned int nbTailFlags) {
+  AX25_txSetTiming_r(&txContext, nbDelayFlags, nbTailFlags);
+}
+
+/*--------------------------------------------------------------------------*
+ * Counters of the state machine (flags, stuffed bits, frames sent). The
+ * counters are kept by AX25_txInitCfg.
+ *
+ * PARAMETERS:
+ * *ctx          pointer of the Tx context (channel).
+ * *stats        pointer of the counters (NULL : none).
+ *--------------------------------------------------------------------------*/
+void AX25_txSetStats_r(AX25_TxContext *ctx, AX25_Stats *stats) {
+  ctx->stats = stats;
+}
+
+void AX25_txSetStats(AX25_Stats *stats) {
+  AX25_txSetStats_r(&txContext, stats);
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of the transmission. The routine switches txMode from 
+ * TX_OFF to TX_DELAY_FLAG and resets the main variables. The timing and
+ * the counters are kept : a context must be cleared (static or memset)
+ * before its first initialization.
+ *
+ * PARAMETER:
+ * *ctx          pointer of the Tx context (channel).
+ *--------------------------------------------------------------------------*/
+void AX25_txInitCfg_r(AX25_TxContext *ctx) {
+  ctx->txMode = TX_DELAY_FLAG;
+  ctx->nbFlagToSend = ctx->txDelay ? ctx->txDelay : TX_DELAY;
+  ctx->burst = NULL;
+  ctx->nbBurstFrames = 0;
+  ctx->burstIndex = 0;
+  ctx->bitToSend = 0;
+  ctx->bitSetCounter = 0;
+  ctx->byteCounter = 0;
+  ctx->bitCounter = 0;
+  ctx->lengthFrame = 0;
+  AX25_txLineInit(&ctx->line);
+}
+
+void AX25_txInitCfg(void) {
+  AX25_txInitCfg_r(&txContext);
+  bitToSend = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * NRZI encoding and scrambling operations. The next bit to send from the
+ * buffer is first NRZI encoded and then scrambled. The polynom of the
+ * scrambler is S(x) = x17 + x12 + 1. The result of the NRZI and scrambling
+ * operations is bitToSend (input of the modulator).
+ *
+ * PARAMETERS:
+ * *ctx             pointer of the Tx context (channel).
+ * bit              next bit from the buffer to send.
+ *--------------------------------------------------------------------------*/
+void AX25_txBit_r(AX25_TxContext *ctx, char bit) {
+  uint64_t history = ctx->line.history;
+
+  // NRZI encoding : if bit is a 0 -> make a transition.
+  //                 if bit is a 1 -> no transition.
+  if(!bit) {
+    ctx->line.lastBit ^= 1;
+    ctx->bitSetCounter = 0;  // If bit=0 reset bitSetCounter for bit stuffing.
+  }
+  else ctx->bitSetCounter++;  // If bit=1 increment bitSetCounter for bit stuffing.
+
+  // Scrambling : XOR with the bits sent 12 and 17 bits ago (bit 63 of the
+  // history is the previous bit sent).
+  ctx->bitToSend = ctx->line.lastBit ^ (unsigned char) (((history >> 52) ^ (history >> 47)) & 1);
+  ctx->line.history = (history >> 1) | ((uint64_t) ctx->bitToSend << 63);
+}
+
+void AX25_txBit(char bit) {
+  AX25_txBit_r(&txContext, bit);
+  bitToSend = txContext.bitToSend;
+}
+
+/*--------------------------------------------------------------------------*
+ * This function checks if we must insert a 0 (bit stuffing).
+ *
+ * PARAMETER:
+ * *ctx    pointer of the Tx context (channel).
+ *
+ * RETURN:
+ * 1       if there is a stuffed bit.
+ * 0       if not.
+ *--------------------------------------------------------------------------*/
+char AX25_txCheckBitStuffing_r(AX25_TxContext *ctx) {
+  if(ctx->bitSetCounter >= 5) {  // If we have 5 ones -> stuff a 0.
+    AX25_txBit_r(ctx, 0);  // A 0 is inserted so the counter is reset.
+    AX25_statsAdd(ctx->stats, AX25_STAT_STUFF_INSERTED, 1);
+    return 1;
+  }
+  return 0;
+}
+
+char AX25_txCheckBitStuffing(void) {
+  char stuffed = AX25_txCheckBitStuffing_r(&txContext);
+  bitToSend = txContext.bitToSend;
+  return stuffed;
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_prepareNextBitToSend is the main function. AX25_prepareNextBitToSend
+ * prepares the next bit to send to the modulator. This function includes
+ * bit stuffing, NRZI encoding and scrambling operations. First, the flags 
+ * are sent for delaying and synchronizing the TNC. Then the data are sent.
+ * Finally, flags are sent for delimiting the frame. The bit to send is
+ * ctx->bitToSend (bitToSend for the legacy function).
+ *
+ * PARAMETERS:
+ * *ctx       pointer of the Tx context (channel).
+ * *buffer    pointer of the buffer.
+ *
+ * RETURN:
+ * 1       if there are still bits to send.
+ * 0       when all bits are sent.
+ *--------------------------------------------------------------------------*/
+char AX25_prepareNextBitToSend_r(AX25_TxContext *ctx, char *buffer) {
+  if(ctx->txMode != TX_DATA_MODE) {  // If txMode is not TX_DATA_MODE.
+    // The last byte of the frame may end with 5 ones : stuff a 0 before
+    // the first flag of the tail.
+    if(ctx->txMode == TX_TAIL_MODE && ctx->bitCounter == 0 && AX25_txCheckBitStuffing_r(ctx)) return 1;
+    AX25_txBit_r(ctx, buffer[ctx->byteCounter] & 1);  // Fetch the bit and encode it.
+    ctx->bitCounter++;
+    buffer[ctx->byteCounter] >>= 1;  // Prepare the next bit of the buffer.
+    if(ctx->bitCounter > 7) {
+      ctx->bitCounter = 0;  // A byte is sent. Reset the bitCounter.
+      ctx->nbFlagToSend--;
+      AX25_statsAdd(ctx->stats, ctx->txMode == TX_DELAY_FLAG ? AX25_STAT_TX_DELAY_FLAGS : AX25_STAT_TX_TAIL_FLAGS, 1);
+      if(!ctx->nbFlagToSend) {  // Check if there are still flags to send.
+        if(ctx->txMode == TX_DELAY_FLAG) {
+          ctx->txMode = TX_DATA_MODE;  // The flags are sent : go to TX_DATA_MODE.
+          ctx->byteCounter++;  // Next byte to send.
+          return 1;
+        }
+        else {
+          ctx->txMode = TX_OFF;  // Frame is sent : go to TX_OFF.
+          return 0;
+        }
+      }
+      else buffer[ctx->byteCounter] = 0x7E;  // Reload flag in the buffer.
+    }
+    return 1;
+  }
+  else {
+    if(AX25_txCheckBitStuffing_r(ctx)) return 1;
+    AX25_txBit_r(ctx, buffer[ctx->byteCounter] & 1);  // Fetch the bit and encode it.
+    ctx->bitCounter++;
+    buffer[ctx->byteCounter] >>= 1;  // Prepare the next bit of the buffer.
+    if(ctx->bitCounter > 7) {
+      ctx->bitCounter = 0;  // A byte is sent. Reset the bitCounter.
+      ctx->byteCounter++;  // Next byte to send.
+      if(ctx->byteCounter == ctx->lengthFrame-1) {  // Check if all the data are sent.
+        ctx->txMode = TX_TAIL_MODE;  // If so : go to TX_TAIL_MODE.
+        ctx->nbFlagToSend = ctx->txTail ? ctx->txTail : TX_TAIL;
+        AX25_statsAdd(ctx->stats, AX25_STAT_TX_FRAMES, 1);
+      }
+    }
+    return 1;
+  }
+}
+
+char AX25_prepareNextBitToSend(char *buffer) {
+  char running = AX25_prepareNextBitToSend_r(&txContext, buffer);
+  bitToSend = txContext.bitToSend;
+  return running;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a burst : several frames sent with a single TX_DELAY
+ * preamble, separated by a single shared flag and followed by a single
+ * TX_TAIL. The frames are read in place and are not modified, the queue
+ * must stay valid until the burst is sent.
+ *
+ * PARAMETERS:
+ * *ctx          pointer of the Tx context (channel).
+ * *frames       pointer of the frames (built by AX25_buildUIFrame).
+ * nbFrames      number of frames.
+ *--------------------------------------------------------------------------*/
+void AX25_txInitBurst_r(AX25_TxContext *ctx, const AX25_TxFrame *frames, unsigned int nbFrames) {
+  AX25_txInitCfg_r(ctx);
+  ctx->burst = frames;
+  ctx->nbBurstFrames = nbFrames;
+  if(!nbFrames) ctx->txMode = TX_OFF;
+}
+
+/*--------------------------------------------------------------------------*
+ * AX25_prepareNextBurstBit_r prepares the next bit of a burst. The flags
+ * are generated (the frames are not modified) : TX_DELAY flags, the first
+ * frame, one flag, the next frame, ... and TX_TAIL flags. The bit to send
+ * is ctx->bitToSend.
+ *
+ * PARAMETER:
+ * *ctx    pointer of the Tx context (channel).
+ *
+ * RETURN:
+ * 1       if there are still bits to send.
+ * 0       when all bits are sent.
+ *--------------------------------------------------------------------------*/
+char AX25_prepareNextBurstBit_r(AX25_TxContext *ctx) {
+  const AX25_TxFrame *current;
+
+  if(ctx->txMode == TX_OFF) return 0;
+
+  if(ctx->txMode != TX_DATA_MODE) {  // Preamble, shared flag or tail.
+    // A 0 is stuffed when the frame before the flag ends with 5 ones.
+    if(ctx->bitCounter == 0 && AX25_txCheckBitStuffing_r(ctx)) return 1;
+    AX25_txBit_r(ctx, (0x7E >> ctx->bitCounter) & 1);
+    if(++ctx->bitCounter > 7) {
+      ctx->bitCounter = 0;  // A flag is sent.
+      AX25_statsAdd(ctx->stats, ctx->txMode == TX_DELAY_FLAG ? AX25_STAT_TX_DELAY_FLAGS : AX25_STAT_TX_TAIL_FLAGS, 1);
+      if(!--ctx->nbFlagToSend) {
+        if(ctx->txMode == TX_TAIL_MODE) {
+          ctx->txMode = TX_OFF;  // Burst is sent : go to TX_OFF.
+          return 0;
+        }
+        ctx->txMode = TX_DATA_MODE;  // Next frame, after its opening flag.
+        ctx->byteCounter = 1;
+      }
+    }
+    return 1;
+  }
+
+  if(AX25_txCheckBitStuffing_r(ctx)) return 1;
+  current = &ctx->burst[ctx->burstIndex];
+  AX25_txBit_r(ctx, (current->frame[ctx->byteCounter] >> ctx->bitCounter) & 1);
+  if(++ctx->bitCounter > 7) {
+    ctx->bitCounter = 0;  // A byte is sent.
+    if(++ctx->byteCounter == current->lengthFrame - 1) {  // Closing flag.
+      AX25_statsAdd(ctx->stats, AX25_STAT_TX_FRAMES, 1);
+      if(++ctx->burstIndex < ctx->nbBurstFrames) {
+        ctx->txMode = TX_DELAY_FLAG;  // One flag shared by the two frames.
+        ctx->nbFlagToSend = 1;
+      }
+      else {
+        ctx->txMode = TX_TAIL_MODE;
+        ctx->nbFlagToSend = ctx->txTail ? ctx->txTail : TX_TAIL;
+      }
+    }
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a bulk line encoder. The state is the same as the one
+ * of AX25_txBit after AX25_txInitCfg (scrambler cleared, last bit = 0).
+ * The history holds the bits sent while the register of AX25_txBit holds
+ * their complement, hence the history is set to ones.
+ *
+ * PARAMETER:
+ * *line         pointer of the line encoder.
+ *--------------------------------------------------------------------------*/
+void AX25_txLineInit(AX25_TxLine *line) {
+  line->history = ~(uint64_t) 0;
+  line->lastBit = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * NRZI encoding and scrambling of a word of bits (LSB first). The NRZI
+ * levels are the prefix XOR of the inverted bits (a 0 makes a transition).
+ * The scrambler S(x) = x17 + x12 + 1 feeds back its own output, so it is
+ * computed 12 bits at a time : a bit never depends on the output of the
+ * 11 previous ones. The result is bit-exact with AX25_txBit.
+ *
+ * PARAMETERS:
+ * *line         pointer of the line encoder.
+ * bits          the bits to send.
+ * nbBits        number of bits in the word (1 to 64).
+ *
+ * RETURN:
+ * the bits for the modulator, packed LSB first.
+ *--------------------------------------------------------------------------*/
+static uint64_t AX25_txEncodeWord(AX25_TxLine *line, uint64_t bits, unsigned int nbBits) {
+  uint64_t mask, level, scrambled, history, chunk;
+  unsigned int i, n;
+
+  mask = (nbBits >= 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << nbBits) - 1);
+
+  // NRZI encoding : if bit is a 0 -> make a transition.
+  level = ~bits & mask;
+  level ^= level << 1;
+  level ^= level << 2;
+  level ^= level << 4;
+  level ^= level << 8;
+  level ^= level << 16;
+  level ^= level << 32;
+  if(line->lastBit) level = ~level;
+  level &= mask;
+  line->lastBit = (unsigned char) ((level >> (nbBits - 1)) & 1);
+
+  // Scrambling : bit n XOR sent bit n-12 XOR sent bit n-17.
+  scrambled = 0;
+  history = line->history;
+  for(i=0; i<nbBits; i+=n) {
+    n = (nbBits - i > 12) ? 12 : nbBits - i;
+    chunk = ((level >> i) ^ (history >> 52) ^ (history >> 47)) & (((uint64_t) 1 << n) - 1);
+    scrambled |= chunk << i;
+    history = (history >> n) | (chunk << (64 - n));
+  }
+  line->history = history;
+
+  return scrambled;
+}
+
+/*--------------------------------------------------------------------------*
+ * Append up to 32 bits (LSB first) to the writer. Every complete 64-bit
+ * word is line encoded and stored.
+ *--------------------------------------------------------------------------*/
+static void AX25_txWriterPut(AX25_TxWriter *writer, uint64_t bits, unsigned int nbBits) {
+  uint64_t word;
+  unsigned char *out;
+  unsigned int i, overflow;
+
+  bits &= ((uint64_t) 1 << nbBits) - 1;
+  writer->pending |= bits << writer->nbPending;
+  writer->nbPending += nbBits;
+
+  if(writer->nbPending >= 64) {
+    word = writer->line ? AX25_txEncodeWord(writer->line, writer->pending, 64) : writer->pending;
+    out = writer->out + (writer->nbBits >> 3);
+    for(i=0; i<8; i++) out[i] = (unsigned char) (word >> (8 * i));
+    writer->nbBits += 64;
+
+    overflow = writer->nbPending - 64;
+    writer->pending = overflow ? bits >> (nbBits - overflow) : 0;
+    writer->nbPending = overflow;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Append one bit of data with bit stuffing : a 0 is inserted right after
+ * every fifth consecutive 1.
+ *--------------------------------------------------------------------------*/
+static void AX25_txWriterStuffBit(AX25_TxWriter *writer, unsigned int bit) {
+  AX25_txWriterPut(writer, bit, 1);
+  if(!bit) {
+    writer->bitSetCounter = 0;
+    return;
+  }
+  if(++writer->bitSetCounter >= 5) {
+    AX25_txWriterPut(writer, 0, 1);  // Stuffed bit.
+    writer->bitSetCounter = 0;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Initialization of a bulk writer.
+ *
+ * PARAMETERS:
+ * *writer       pointer of the writer.
+ * *line         pointer of the line encoder (kept between frames), or NULL
+ *               to keep the bits as they are (HDLC bitstream, see FX.25).
+ * *out          pointer of the output buffer (see AX25_txEncodedSize).
+ *--------------------------------------------------------------------------*/
+void AX25_txWriterInit(AX25_TxWriter *writer, AX25_TxLine *line, unsigned char *out) {
+  writer->line = line;
+  writer->out = out;
+  writer->nbBits = 0;
+  writer->pending = 0;
+  writer->nbPending = 0;
+  writer->bitSetCounter = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Append flags (no bit stuffing).
+ *
+ * PARAMETERS:
+ * *writer       pointer of the writer.
+ * nbFlags       number of flags to send.
+ *--------------------------------------------------------------------------*/
+void AX25_txWriterFlags(AX25_TxWriter *writer, unsigned int nbFlags) {
+  while(nbFlags >= 4) {
+    AX25_txWriterPut(writer, 0x7E7E7E7EUL, 32);
+    nbFlags -= 4;
+  }
+  while(nbFlags--) AX25_txWriterPut(writer, 0x7E, 8);
+  writer->bitSetCounter = 0;  // A flag ends with a 0.
+}
+
+/*--------------------------------------------------------------------------*
+ * Append data bytes with bit stuffing. The data is taken 32 bits at a
+ * time : when the word, preceded by the pending ones, has no run of five
+ * ones, no bit has to be stuffed and the whole word is appended at once.
+ *
+ * PARAMETERS:
+ * *writer       pointer of the writer.
+ * *data         pointer of the bytes to send (LSB first).
+ * length        number of bytes.
+ *--------------------------------------------------------------------------*/
+void AX25_txWriterData(AX25_TxWriter *writer, const char *data, unsigned int length) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  uint64_t word, run;
+  unsigned int i, ones;
+
+  while(length >= 4) {
+    word = (uint64_t) bytes[0] | ((uint64_t) bytes[1] << 8) |
+           ((uint64_t) bytes[2] << 16) | ((uint64_t) bytes[3] << 24);
+    ones = writer->bitSetCounter;
+    run = (word << ones) | (((uint64_t) 1 << ones) - 1);
+    run &= (run >> 1) & (run >> 2) & (run >> 3) & (run >> 4);
+
+    if(!run) {  // No stuffed bit in this word.
+      AX25_txWriterPut(writer, word, 32);
+      ones = 0;
+      while((word >> (31 - ones)) & 1) ones++;
+      writer->bitSetCounter = (unsigned char) ones;
+    }
+    else {
+      for(i=0; i<32; i++) AX25_txWriterStuffBit(writer, (unsigned int) (word >> i) & 1);
+    }
+    bytes += 4;
+    length -= 4;
+  }
+
+  while(length--) {
+    for(i=0; i<8; i++) AX25_txWriterStuffBit(writer, (*bytes >> i) & 1);
+    bytes++;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Append raw bits (LSB first) without bit stuffing.
+ *
+ * PARAMETERS:
+ * *writer       pointer of the writer.
+ * *bits         pointer of the packed bits.
+ * nbBits        number of bits.
+ *--------------------------------------------------------------------------*/
+void AX25_txWriterRaw(AX25_TxWriter *writer, const unsigned char *bits, unsigned long nbBits) {
+  uint64_t word;
+
+  while(nbBits >= 32) {
+    word = (uint64_t) bits[0] | ((uint64_t) bits[1] << 8) |
+           ((uint64_t) bits[2] << 16) | ((uint64_t) bits[3] << 24);
+    AX25_txWriterPut(writer, word, 32);
+    bits += 4;
+    nbBits -= 32;
+  }
+  while(nbBits >= 8) {
+    AX25_txWriterPut(writer, *bits++, 8);
+    nbBits -= 8;
+  }
+  if(nbBits) AX25_txWriterPut(writer, *bits, (unsigned int) nbBits);
+  writer->bitSetCounter = 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Line encoding of the last pending bits (copied as they are without line
+ * encoder). The unused bits of the last byte are cleared.
+ *
+ * PARAMETER:
+ * *writer       pointer of the writer.
+ *
+ * RETURN:
+ * the number of bits written in the output buffer.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_txWriterFinish(AX25_TxWriter *writer) {
+  uint64_t word;
+  unsigned char *out;
+  unsigned int i;
+
+  if(writer->nbPending) {
+    word = writer->line ? AX25_txEncodeWord(writer->line, writer->pending, writer->nbPending) : writer->pending;
+    out = writer->out + (writer->nbBits >> 3);
+    for(i=0; i<(writer->nbPending + 7) / 8; i++) out[i] = (unsigned char) (word >> (8 * i));
+    writer->nbBits += writer->nbPending;
+    writer->pending = 0;
+    writer->nbPending = 0;
+  }
+  return writer->nbBits;
+}
+
+/*--------------------------------------------------------------------------*
+ * Size of the output buffer needed by AX25_txEncodeFrame (worst case of
+ * bit stuffing : one stuffed bit every five bits).
+ *
+ * PARAMETERS:
+ * lengthFrame   length of the frame, flags included (in bytes).
+ * nbDelayFlags  number of flags sent before the frame.
+ * nbTailFlags   number of flags sent after the frame.
+ *
+ * RETURN:
+ * the size of the output buffer (in bytes).
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_txEncodedSize(unsigned int lengthFrame, unsigned int nbDelayFlags, unsigned int nbTailFlags) {
+  unsigned long nbBits;
+
+  nbBits = 8UL * (lengthFrame - 2);
+  nbBits += nbBits / 5 + 8UL * (nbDelayFlags + nbTailFlags);
+  return (nbBits + 7) / 8;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk encoding of a frame prepared by AX25_prepareUIFrame : TX_DELAY
+ * flags, the frame with bit stuffing and TX_TAIL flags, NRZI encoded and
+ * scrambled. The frame is not modified and can be sent again. The line
+ * encoder keeps its state so that frames can be encoded back to back.
+ *
+ * PARAMETERS:
+ * *line          pointer of the line encoder.
+ * *buffer        pointer of the frame (flags included).
+ * lengthFrame    length of the frame (in bytes).
+ * nbDelayFlags   number of flags sent before the frame (TX_DELAY).
+ * nbTailFlags    number of flags sent after the frame (TX_TAIL).
+ * *out           pointer of the output buffer (see AX25_txEncodedSize).
+ *
+ * RETURN:
+ * the number of bits written in the output buffer.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_txEncodeFrame(AX25_TxLine *line, const char *buffer, unsigned int lengthFrame,
+                                 unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out) {
+  AX25_TxWriter writer;
+
+  AX25_txWriterInit(&writer, line, out);
+  AX25_txWriterFlags(&writer, nbDelayFlags);
+  AX25_txWriterData(&writer, buffer + 1, lengthFrame - 2);  // Flags excluded.
+  AX25_txWriterFlags(&writer, nbTailFlags);
+  return AX25_txWriterFinish(&writer);
+}
+
+/*--------------------------------------------------------------------------*
+ * Size of the output buffer needed by AX25_txEncodeBurst.
+ *
+ * PARAMETERS:
+ * *frames       pointer of the frames.
+ * nbFrames      number of frames.
+ * nbDelayFlags  number of flags sent before the first frame.
+ * nbTailFlags   number of flags sent after the last frame.
+ *
+ * RETURN:
+ * the size of the output buffer (in bytes).
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_txBurstEncodedSize(const AX25_TxFrame *frames, unsigned int nbFrames,
+                                      unsigned int nbDelayFlags, unsigned int nbTailFlags) {
+  unsigned long nbBits = 0;
+  unsigned int i;
+
+  for(i=0; i<nbFrames; i++) nbBits += 8UL * (frames[i].lengthFrame - 2);
+  nbBits += nbBits / 5 + 8UL * (nbDelayFlags + nbTailFlags + nbFrames);
+  return (nbBits + 7) / 8;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk encoding of a burst : one preamble of nbDelayFlags flags, the
+ * frames separated by one shared flag, and one tail of nbTailFlags flags.
+ * The frames are not modified.
+ *
+ * PARAMETERS:
+ * *line          pointer of the line encoder.
+ * *frames        pointer of the frames (built by AX25_buildUIFrame).
+ * nbFrames       number of frames.
+ * nbDelayFlags   number of flags sent before the first frame.
+ * nbTailFlags    number of flags sent after the last frame.
+ * *out           pointer of the output buffer (see AX25_txBurstEncodedSize).
+ *
+ * RETURN:
+ * the number of bits written in the output buffer.
+ *--------------------------------------------------------------------------*/
+unsigned long AX25_txEncodeBurst(AX25_TxLine *line, const AX25_TxFrame *frames, unsigned int nbFrames,
+                                 unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out) {
+  AX25_TxWriter writer;
+  unsigned int i;
+
+  AX25_txWriterInit(&writer, line, out);
+  AX25_txWriterFlags(&writer, nbDelayFlags);
+  for(i=0; i<nbFrames; i++) {
+    if(i) AX25_txWriterFlags(&writer, 1);  // Shared flag.
+    AX25_txWriterData(&writer, frames[i].frame + 1, frames[i].lengthFrame - 2);
+  }
+  AX25_txWriterFlags(&writer, nbTailFlags);
+  return AX25_txWriterFinish(&writer);
+}
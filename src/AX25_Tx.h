@@ -1,23 +1,104 @@
-#ifndef AX25_TX_H
-#define AX25_TX_H
-
-// Specifications
-#define INFO_MAX_SIZE        256  // Max number of bytes for Info field. (256 is the default value).
-#define AX25_FRAME_MAX_SIZE  276  // Max number of bytes for an AX25 UI-frame. (1+14+1+1+256+2+1).
-#define TX_DELAY             300  // Number of flags to be sent before the frame.
-                                  // Ex : delay = 250 ms hence TX_DELAY = 0,25 * 9600 / 8 = 300 flags.
-#define TX_TAIL              100  // Idem but for the tail of the frame.
-
-// Tx Modes
-#define TX_OFF         0x00  // Off mode (Tx off).
-#define TX_DELAY_FLAG  0x01  // Synchronization mode (sending flags).
-#define TX_DATA_MODE   0x02  // Data transmission mode.
-#define TX_TAIL_MODE   0x03  // Tail mode (send flags after the frame).
-
-void AX25_prepareUIFrame(char *buffer, char *info, unsigned int length_info_field);
-void AX25_txInitCfg(void);
-void AX25_txBit(char bit);
-char AX25_checkBitStuffing(void);
-char AX25_prepareNextBitToSend(char *buffer);
-
-#endif /* AX25_TX_H */
+#ifndef AX25_TX_H
+#define AX25_TX_H
+
+#include <stdint.h>
+
+#include "AX25_Stats.h"
+
+// Specifications
+#define INFO_MAX_SIZE        256  // Max number of bytes for Info field. (256 is the default value).
+#define AX25_FRAME_MAX_SIZE  333  // Max number of bytes for an AX25 frame. (1+70+2+1+256+2+1) :
+                                  // 8 digipeaters and a 2-byte control field (modulo 128).
+#define TX_DELAY             300  // Number of flags to be sent before the frame.
+                                  // Ex : delay = 250 ms hence TX_DELAY = 0,25 * 9600 / 8 = 300 flags.
+#define TX_TAIL              100  // Idem but for the tail of the frame.
+                                  // TX_DELAY and TX_TAIL are the defaults of AX25_txSetTiming.
+
+// Tx Modes
+#define TX_OFF         0x00  // Off mode (Tx off).
+#define TX_DELAY_FLAG  0x01  // Synchronization mode (sending flags).
+#define TX_DATA_MODE   0x02  // Data transmission mode.
+#define TX_TAIL_MODE   0x03  // Tail mode (send flags after the frame).
+
+// Line encoder state (NRZI and scrambler) of the bulk transmit path.
+// The history holds the last bits sent, the most recent one in bit 63.
+typedef struct {
+  uint64_t history;
+  unsigned char lastBit;
+} AX25_TxLine;
+
+// Bulk bitstream writer. Bits are bit stuffed when needed, NRZI encoded,
+// scrambled and packed LSB first (bit 0 of out[0] is sent first).
+typedef struct {
+  AX25_TxLine *line;
+  unsigned char *out;
+  unsigned long nbBits;        // Number of bits written in out.
+  uint64_t pending;            // Bits waiting for the line encoder.
+  unsigned int nbPending;
+  unsigned char bitSetCounter; // Consecutive ones (bit stuffing).
+} AX25_TxWriter;
+
+// Frame of a burst, prepared by AX25_buildUIFrame (flags included).
+typedef struct {
+  const char *frame;
+  unsigned int lengthFrame;
+} AX25_TxFrame;
+
+// Tx context : state of one transmitting channel.
+typedef struct {
+  unsigned char txMode;
+  unsigned char bitToSend;     // Input of the modulator.
+  unsigned char bitSetCounter;
+  unsigned char bitCounter;
+  unsigned int nbFlagToSend;
+  unsigned int byteCounter;
+  unsigned int lengthFrame;
+  unsigned int txDelay;        // Flags before the frame (0 = TX_DELAY).
+  unsigned int txTail;         // Flags after the frame (0 = TX_TAIL).
+  const AX25_TxFrame *burst;   // Frames of the burst being sent.
+  unsigned int nbBurstFrames;
+  unsigned int burstIndex;
+  AX25_TxLine line;
+  AX25_Stats *stats;           // Counters of the channel (NULL : none).
+} AX25_TxContext;
+
+// Output of the legacy Tx functions.
+extern unsigned char bitToSend;
+
+// ADF7021 configuration registers for Tx.
+extern char txADFR0[4], txADFR1[4], txADFR2[4], txADFR3[4], txADFR8[4];
+
+unsigned int AX25_buildUIFrame(char *buffer, const char *info, unsigned int lengthInfoField);
+void AX25_prepareUIFrame(char *buffer, char *info, unsigned int length_info_field);
+void AX25_txInitCfg(void);
+void AX25_txSetTiming(unsigned int nbDelayFlags, unsigned int nbTailFlags);
+void AX25_txSetStats(AX25_Stats *stats);
+void AX25_txBit(char bit);
+char AX25_txCheckBitStuffing(void);
+char AX25_prepareNextBitToSend(char *buffer);
+
+void AX25_prepareUIFrame_r(AX25_TxContext *ctx, char *buffer, char *info, unsigned int lengthInfoField);
+void AX25_txInitCfg_r(AX25_TxContext *ctx);
+void AX25_txSetTiming_r(AX25_TxContext *ctx, unsigned int nbDelayFlags, unsigned int nbTailFlags);
+void AX25_txSetStats_r(AX25_TxContext *ctx, AX25_Stats *stats);
+void AX25_txInitBurst_r(AX25_TxContext *ctx, const AX25_TxFrame *frames, unsigned int nbFrames);
+char AX25_prepareNextBurstBit_r(AX25_TxContext *ctx);
+void AX25_txBit_r(AX25_TxContext *ctx, char bit);
+char AX25_txCheckBitStuffing_r(AX25_TxContext *ctx);
+char AX25_prepareNextBitToSend_r(AX25_TxContext *ctx, char *buffer);
+
+void AX25_txLineInit(AX25_TxLine *line);
+void AX25_txWriterInit(AX25_TxWriter *writer, AX25_TxLine *line, unsigned char *out);
+void AX25_txWriterFlags(AX25_TxWriter *writer, unsigned int nbFlags);
+void AX25_txWriterData(AX25_TxWriter *writer, const char *data, unsigned int length);
+void AX25_txWriterRaw(AX25_TxWriter *writer, const unsigned char *bits, unsigned long nbBits);
+unsigned long AX25_txWriterFinish(AX25_TxWriter *writer);
+unsigned long AX25_txEncodedSize(unsigned int lengthFrame, unsigned int nbDelayFlags, unsigned int nbTailFlags);
+unsigned long AX25_txEncodeFrame(AX25_TxLine *line, const char *buffer, unsigned int lengthFrame,
+                                 unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out);
+unsigned long AX25_txBurstEncodedSize(const AX25_TxFrame *frames, unsigned int nbFrames,
+                                      unsigned int nbDelayFlags, unsigned int nbTailFlags);
+unsigned long AX25_txEncodeBurst(AX25_TxLine *line, const AX25_TxFrame *frames, unsigned int nbFrames,
+                                 unsigned int nbDelayFlags, unsigned int nbTailFlags, unsigned char *out);
+
+#endif /* AX25_TX_H */
@@ -0,0 +1,19 @@
+#ifndef AX25_TEST_H
+#define AX25_TEST_H
+
+#include <stdio.h>
+
+// Checks of the tests : a failed check is printed and the test goes on,
+// its exit status is the number of failed checks (0 : passed).
+static unsigned int testFailures;
+
+#define TEST_CHECK(condition) do { \
+    if(!(condition)) { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      testFailures++; \
+    } \
+  } while(0)
+
+#define TEST_END() (testFailures ? (fprintf(stderr, "%u checks failed\n", testFailures), 1) : 0)
+
+#endif /* AX25_TEST_H */
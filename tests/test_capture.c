@@ -0,0 +1,231 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_capture.c
+ * Parallel decoding of raw bit captures : a generated capture of several
+ * chunks gives the frames of a single pass of the streaming receiver,
+ * every frame once and in order, whatever the number of threads, clean
+ * or with wrong bits. The index written in a file is read back.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AX25_Capture.h"
+#include "AX25_Stream.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_SIZE              (6 * AX25_CAPTURE_MIN_CHUNK + 12345)
+#define TEST_BURST             64    // Frames per burst.
+#define TEST_MAX_FRAMES        (TEST_SIZE / 16)
+
+// Frames of the single pass, the reference of the capture decoder. The
+// frames are copied in an arena (they come from the bits of the capture).
+typedef struct {
+  unsigned long long bitOffset;
+  unsigned int lengthFrame;
+  unsigned char status;
+  const char *frame;
+} TestFrame;
+
+static unsigned char capture[TEST_SIZE];
+static char arena[2 * TEST_SIZE];
+static TestFrame reference[TEST_MAX_FRAMES];
+static unsigned long nbReference, nbSent;
+
+/*--------------------------------------------------------------------------*
+ * Info field of a frame : its number, then bytes of the number.
+ *--------------------------------------------------------------------------*/
+static unsigned int testInfo(char *info, unsigned long number) {
+  unsigned int i, length = 4 + (number * 97) % (INFO_MAX_SIZE - 3);
+
+  for(i=0; i<length; i++) info[i] = (char) (number * 7 + i);
+  for(i=0; i<4; i++) info[i] = (char) (number >> (8 * i));
+  return length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Capture of bursts of numbered frames. Every burst is cut to a whole
+ * number of bytes (the descrambler resynchronizes in the delay flags).
+ *--------------------------------------------------------------------------*/
+static void testGenerate(void) {
+  static char frames[TEST_BURST][AX25_FRAME_MAX_SIZE];
+  static unsigned char bits[TEST_BURST * (AX25_FRAME_MAX_SIZE + 16) * 2];
+  AX25_TxFrame burst[TEST_BURST];
+  char info[INFO_MAX_SIZE];
+  unsigned long size = 0, nbBytes;
+  unsigned int f, nbDelayFlags;
+  AX25_TxLine line;
+
+  AX25_txLineInit(&line);
+  for(;;) {
+    for(f=0; f<TEST_BURST; f++) {
+      burst[f].frame = frames[f];
+      burst[f].lengthFrame = AX25_buildUIFrame(frames[f], info, testInfo(info, nbSent + f));
+    }
+    nbDelayFlags = 4 + nbSent % 11;
+    nbBytes = AX25_txEncodeBurst(&line, burst, TEST_BURST, nbDelayFlags, 2, bits) / 8;
+    if(size + nbBytes > TEST_SIZE) break;
+    memcpy(capture + size, bits, nbBytes);
+    size += nbBytes;
+    nbSent += TEST_BURST;
+  }
+  memset(capture + size, 0x55, TEST_SIZE - size);  // Idle line.
+}
+
+/*--------------------------------------------------------------------------*
+ * Single pass of the streaming receiver over the capture, by pieces as
+ * short as the ones of the capture decoder.
+ *--------------------------------------------------------------------------*/
+static void testReference(unsigned char correction) {
+  AX25_FrameSlot slots[AX25_CAPTURE_RING_SIZE];
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  size_t position, n, arenaSize = 0;
+
+  AX25_ringInit(&ring, slots, AX25_CAPTURE_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetCorrection(&stream, correction);
+  nbReference = 0;
+  for(position=0; position<TEST_SIZE; position+=n) {
+    n = (AX25_FRAME_MIN_SIZE - 1) * (AX25_CAPTURE_RING_SIZE - 2);
+    if(n > TEST_SIZE - position) n = TEST_SIZE - position;
+    AX25_rxStreamBits(&stream, capture + position, 8UL * n);
+    while((slot = AX25_ringPeek(&ring)) != NULL) {
+      if(nbReference < TEST_MAX_FRAMES && arenaSize + slot->lengthFrame <= sizeof(arena)) {
+        reference[nbReference].bitOffset = slot->bitOffset;
+        reference[nbReference].lengthFrame = slot->lengthFrame;
+        reference[nbReference].status = slot->status;
+        reference[nbReference].frame = arena + arenaSize;
+        memcpy(arena + arenaSize, slot->frame, slot->lengthFrame);
+        arenaSize += slot->lengthFrame;
+      }
+      else TEST_CHECK(0);
+      nbReference++;
+      AX25_ringRelease(&ring);
+    }
+  }
+  TEST_CHECK(stream.nbOverruns == 0);
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of the capture file with nbThreads threads, against the
+ * reference.
+ *--------------------------------------------------------------------------*/
+static void testDecode(const char *path, unsigned int nbThreads, unsigned char correction) {
+  AX25_Capture decoded;
+  unsigned long i, nbWrong = 0;
+
+  TEST_CHECK(AX25_captureOpen(&decoded, path));
+  TEST_CHECK(decoded.size == TEST_SIZE);
+  decoded.correction = correction;
+  TEST_CHECK(AX25_captureDecode(&decoded, nbThreads));
+  TEST_CHECK(decoded.nbChunks > 1);
+  TEST_CHECK(decoded.nbFrames == nbReference);
+  for(i=0; i<decoded.nbFrames && i<nbReference; i++) {
+    if(decoded.frames[i].bitOffset != reference[i].bitOffset || decoded.frames[i].status != reference[i].status
+       || decoded.frames[i].lengthFrame != reference[i].lengthFrame
+       || memcmp(decoded.frames[i].frame, reference[i].frame, reference[i].lengthFrame)) {
+      nbWrong++;
+    }
+  }
+  TEST_CHECK(nbWrong == 0);
+  AX25_captureClose(&decoded);
+}
+
+/*--------------------------------------------------------------------------*
+ * Writing of the capture in a file.
+ *--------------------------------------------------------------------------*/
+static char testWrite(const char *path) {
+  FILE *file = fopen(path, "wb");
+  char ok;
+
+  if(!file) return 0;
+  ok = (fwrite(capture, 1, TEST_SIZE, file) == TEST_SIZE);
+  if(fclose(file)) ok = 0;
+  return ok;
+}
+
+/*--------------------------------------------------------------------------*
+ * Index of the capture written in a file and read back.
+ *--------------------------------------------------------------------------*/
+static void testIndex(const char *path, const char *indexPath) {
+  unsigned long long bitOffset;
+  unsigned int lengthFrame;
+  unsigned long i = 0, nbWrong = 0;
+  AX25_Capture decoded;
+  char status[4];
+  FILE *file;
+
+  TEST_CHECK(AX25_captureOpen(&decoded, path));
+  TEST_CHECK(AX25_captureDecode(&decoded, 2));
+  TEST_CHECK(AX25_captureWriteIndex(&decoded, indexPath));
+  file = fopen(indexPath, "r");
+  TEST_CHECK(file != NULL);
+  if(file) {
+    while(fscanf(file, "%llu %u %3s", &bitOffset, &lengthFrame, status) == 3) {
+      if(i >= decoded.nbFrames || bitOffset != decoded.frames[i].bitOffset || lengthFrame != decoded.frames[i].lengthFrame
+         || strcmp(status, "OK")) {
+        nbWrong++;
+      }
+      i++;
+    }
+    TEST_CHECK(feof(file));
+    fclose(file);
+  }
+  TEST_CHECK(i == decoded.nbFrames);
+  TEST_CHECK(nbWrong == 0);
+  AX25_captureClose(&decoded);
+  TEST_CHECK(!AX25_captureWriteIndex(&decoded, "/nonexistent/capture.idx"));
+}
+
+int main(void) {
+  char path[] = "/tmp/test_captureXXXXXX", indexPath[sizeof(path) + 4];
+  char info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE];
+  unsigned long i, nbWrong = 0, seed = 0x1F83D9AB;
+  unsigned int lengthFrame;
+  int fd;
+
+  AX25_crcInitEngine();
+  testGenerate();
+  fd = mkstemp(path);
+  TEST_CHECK(fd >= 0);
+  if(fd < 0) return TEST_END();
+  close(fd);
+  sprintf(indexPath, "%s.idx", path);
+
+  // Clean capture : every frame sent, once, in order.
+  testReference(0);
+  TEST_CHECK(nbReference == nbSent);
+  for(i=0; i<nbReference && i<nbSent; i++) {
+    lengthFrame = AX25_buildUIFrame(frame, info, testInfo(info, i));
+    if(reference[i].status != AX25_FRAME_FCS_OK || reference[i].lengthFrame != lengthFrame
+       || memcmp(reference[i].frame, frame, lengthFrame)) {
+      nbWrong++;
+    }
+  }
+  TEST_CHECK(nbWrong == 0);
+  TEST_CHECK(testWrite(path));
+  testDecode(path, 1, 0);
+  testDecode(path, 3, 0);
+  testDecode(path, 8, 0);
+  testIndex(path, indexPath);
+
+  // Wrong bits : bad and corrected frames are the same as well.
+  for(i=0; i<TEST_SIZE/20000; i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    capture[(seed >> 8) % TEST_SIZE] ^= (unsigned char) (1 << (seed & 7));
+  }
+  testReference(1);
+  TEST_CHECK(testWrite(path));
+  testDecode(path, 1, 1);
+  testDecode(path, 5, 1);
+
+  unlink(indexPath);
+  unlink(path);
+  return TEST_END();
+}
@@ -0,0 +1,140 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_crc.c
+ * FCS engines : self-check of the engines against the bitwise method,
+ * frames checked by every engine, correction of one wrong bit and of two
+ * wrong bits on the air (short frames only).
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+/*--------------------------------------------------------------------------*
+ * Wrong bit on the air at a distance from the end of a frame (flags
+ * excluded) : the descrambler and the NRZI decoder make six wrong bits.
+ *--------------------------------------------------------------------------*/
+static void testLineError(char *frame, unsigned int nbBits, unsigned int distance) {
+  static const unsigned char pattern[6] = {0, 1, 12, 13, 17, 18};
+  unsigned int i, position;
+
+  for(i=0; i<6; i++) {
+    position = nbBits - 1 - (distance - pattern[i]);
+    frame[position >> 3] ^= (char) (1 << (position & 7));
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Two wrong bits on the air. In a short frame (18 bytes, random content)
+ * they are flipped back, or the frame is left as it is (several pairs
+ * match, or a stuffed bit is near), never miscorrected, and three wrong
+ * bits on the air are mostly refused. A longer frame is never corrected
+ * as two wrong bits.
+ *--------------------------------------------------------------------------*/
+static void testPairs(const char *info) {
+  char frame[AX25_FRAME_MAX_SIZE], copy[AX25_FRAME_MAX_SIZE], received[AX25_FRAME_MAX_SIZE];
+  unsigned int i, length, lengthFrame, nbBits, first, second, third;
+  unsigned long seed = 0x5BE0CD19, nbCorrected = 0, nbRefused = 0, nbWrong = 0, nbAccepted = 0, nbRejected = 0;
+  unsigned char result;
+
+  lengthFrame = 1 + 18 + 1;
+  nbBits = 8 * 18;
+  for(i=0; i<8; i++) {
+    frame[0] = frame[lengthFrame - 1] = 0x7E;
+    for(length=1; length<lengthFrame-3; length++) {
+      seed = seed * 1103515245UL + 12345UL;
+      frame[length] = (char) (seed >> 16);
+    }
+    AX25_putCRC(frame, (unsigned short) lengthFrame);
+
+    for(first=19; first<nbBits; first++) {
+      for(second=18; second<first; second++) {
+        memcpy(copy, frame, lengthFrame);
+        testLineError(copy + 1, nbBits, first);
+        testLineError(copy + 1, nbBits, second);
+        TEST_CHECK(AX25_crcCorrect(copy + 1, lengthFrame - 2, 1) != 2);
+        result = AX25_crcCorrect(copy + 1, lengthFrame - 2, 2);
+        if(result == 2 && !memcmp(copy, frame, lengthFrame)) nbCorrected++;
+        else if(result == AX25_CRC_UNCORRECTABLE) nbRefused++;
+        else nbWrong++;
+
+        // A third one.
+        third = 18 + (first * 7 + second * 13 + i) % (nbBits - 18);
+        if(third == first || third == second) continue;
+        memcpy(copy, frame, lengthFrame);
+        testLineError(copy + 1, nbBits, first);
+        testLineError(copy + 1, nbBits, second);
+        testLineError(copy + 1, nbBits, third);
+        memcpy(received, copy, lengthFrame);
+        result = AX25_crcCorrect(copy + 1, lengthFrame - 2, 2);
+        if(result == AX25_CRC_UNCORRECTABLE) {
+          TEST_CHECK(!memcmp(copy, received, lengthFrame));
+          nbRejected++;
+        }
+        else nbAccepted++;
+      }
+    }
+  }
+  TEST_CHECK(nbWrong == 0);
+  TEST_CHECK(nbCorrected > 0);
+  TEST_CHECK(nbRejected > 10 * nbAccepted);
+
+  // Longer frames : two wrong bits are not searched.
+  for(length=1; length<=INFO_MAX_SIZE; length+=(length < 8) ? 1 : 31) {
+    lengthFrame = AX25_buildUIFrame(frame, info, length);
+    nbBits = 8 * (lengthFrame - 2);
+    for(first=19; first<nbBits; first+=7) {
+      memcpy(copy, frame, lengthFrame);
+      testLineError(copy + 1, nbBits, first);
+      testLineError(copy + 1, nbBits, 18 + first % (first - 18));
+      memcpy(received, copy, lengthFrame);
+      result = AX25_crcCorrect(copy + 1, lengthFrame - 2, 2);
+      TEST_CHECK(result != 2);
+      if(result == AX25_CRC_UNCORRECTABLE) TEST_CHECK(!memcmp(copy, received, lengthFrame));
+    }
+  }
+}
+
+int main(void) {
+  char info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE], copy[AX25_FRAME_MAX_SIZE];
+  unsigned int i, length, lengthFrame, bit, nbCorrected = 0;
+  unsigned char engine, previous;
+
+  TEST_CHECK(AX25_crcSelfTest());
+
+  for(i=0; i<sizeof(info); i++) info[i] = (char) (i * 31 + 5);
+  previous = AX25_crcGetEngine();
+  for(engine=AX25_CRC_BITWISE; engine<=AX25_CRC_CLMUL; engine++) {
+    if(!AX25_crcSetEngine(engine)) continue;  // Not supported by the processor.
+    TEST_CHECK(AX25_crcGetEngine() == engine);
+    for(length=0; length<=INFO_MAX_SIZE; length+=17) {
+      lengthFrame = AX25_buildUIFrame(frame, info, length);
+      TEST_CHECK(AX25_checkFrame(frame, (unsigned short) lengthFrame, 0) == 0);
+      frame[lengthFrame / 2] ^= 0x10;
+      TEST_CHECK(AX25_checkFrame(frame, (unsigned short) lengthFrame, 0) != 0);
+    }
+  }
+  TEST_CHECK(!AX25_crcSetEngine(AX25_CRC_CLMUL + 1));
+  AX25_crcSetEngine(previous);
+
+  // One wrong bit (address, info or FCS) is flipped back, unless it is
+  // next to a stuffed bit (then the frame is left as it is).
+  lengthFrame = AX25_buildUIFrame(frame, info, 64);
+  for(bit=0; bit<8 * (lengthFrame - 2); bit+=13) {
+    memcpy(copy, frame, lengthFrame);
+    copy[1 + bit / 8] ^= (char) (1 << (bit % 8));
+    TEST_CHECK(AX25_crcCorrect(copy + 1, lengthFrame - 2, 0) == AX25_CRC_UNCORRECTABLE);
+    if(AX25_crcCorrect(copy + 1, lengthFrame - 2, 1) == 1) {
+      TEST_CHECK(!memcmp(copy, frame, lengthFrame));
+      nbCorrected++;
+    }
+  }
+  TEST_CHECK(nbCorrected > 0);
+
+  testPairs(info);
+  return TEST_END();
+}
@@ -0,0 +1,212 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_demod.c
+ * Software G3RUH demodulator : bursts encoded by AX25_txEncodeBurst are
+ * turned into discriminator audio or IQ samples (any polarity, DC offset,
+ * noise, several sample rates), demodulated and received. Every frame
+ * comes back with a good FCS, in order. The audio goes through a WAV file
+ * and the sample reader as well.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Demod.h"
+#include "AX25_Samples.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_FRAMES            12
+#define TEST_DELAY_FLAGS       32    // Lock of the bit clock and of the descrambler.
+#define TEST_TAIL_FLAGS        4
+#define TEST_BLOCK             777   // Samples given at once (not a multiple of anything).
+#define TEST_RING_SIZE         32
+
+static char frames[TEST_FRAMES][AX25_FRAME_MAX_SIZE];
+static AX25_TxFrame burst[TEST_FRAMES];
+static unsigned char *bits;
+static unsigned long nbBits;
+
+/*--------------------------------------------------------------------------*
+ * Burst of TEST_FRAMES frames of various lengths, encoded on the line.
+ *--------------------------------------------------------------------------*/
+static void testBurst(void) {
+  char info[INFO_MAX_SIZE];
+  unsigned long seed = 0x3C6EF372;
+  unsigned int f, i, length;
+  AX25_TxLine line;
+
+  for(f=0; f<TEST_FRAMES; f++) {
+    length = 1 + (f * 53) % INFO_MAX_SIZE;
+    for(i=0; i<length; i++) {
+      seed = seed * 1103515245UL + 12345UL;
+      info[i] = (f % 4 == 3) ? (char) 0xFF : (char) (seed >> 16);  // Some frames : ones only.
+    }
+    info[0] = (char) f;
+    burst[f].frame = frames[f];
+    burst[f].lengthFrame = AX25_buildUIFrame(frames[f], info, length);
+  }
+  bits = calloc(AX25_txBurstEncodedSize(burst, TEST_FRAMES, TEST_DELAY_FLAGS, TEST_TAIL_FLAGS), 1);
+  AX25_txLineInit(&line);
+  nbBits = AX25_txEncodeBurst(&line, burst, TEST_FRAMES, TEST_DELAY_FLAGS, TEST_TAIL_FLAGS, bits);
+}
+
+/*--------------------------------------------------------------------------*
+ * Samples of the burst : NRZ level of the bits at the sample rate, smoothed
+ * (first order low-pass), with an offset and uniform noise. In IQ mode the
+ * level is the frequency deviation (phase step of the samples).
+ *
+ * RETURN:
+ * the number of samples (of frames of 2 floats in IQ mode).
+ *--------------------------------------------------------------------------*/
+static unsigned long testSamples(float *samples, unsigned int sampleRate, unsigned char mode, float polarity) {
+  unsigned long seed = 0x510E527F, n, nbSamples, bit;
+  float level = 0, phase = 0, target, noise;
+
+  nbSamples = (unsigned long) ((double) nbBits * sampleRate / AX25_DEMOD_BAUD);
+  for(n=0; n<nbSamples; n++) {
+    bit = (unsigned long) ((double) n * AX25_DEMOD_BAUD / sampleRate);
+    target = ((bits[bit >> 3] >> (bit & 7)) & 1) ? polarity : -polarity;
+    level += 0.5f * (target - level);
+    seed = seed * 1103515245UL + 12345UL;
+    noise = 0.2f * ((float) ((seed >> 16) & 0x7FFF) / 0x7FFF - 0.5f);
+    if(mode == AX25_DEMOD_IQ) {
+      phase += 0.5f * (level + noise);
+      samples[2 * n] = 0.8f * cosf(phase);
+      samples[2 * n + 1] = 0.8f * sinf(phase);
+    }
+    else samples[n] = 0.5f * level + 0.1f + 0.5f * noise;
+  }
+  return nbSamples;
+}
+
+/*--------------------------------------------------------------------------*
+ * Frames of the ring checked against the burst.
+ *--------------------------------------------------------------------------*/
+static void testReceived(AX25_FrameRing *ring, unsigned int *nbFrames, unsigned int *nbWrong) {
+  AX25_FrameSlot *slot;
+
+  while((slot = AX25_ringPeek(ring)) != NULL) {
+    if(*nbFrames >= TEST_FRAMES || slot->status != AX25_FRAME_FCS_OK || slot->lengthFrame != burst[*nbFrames].lengthFrame
+       || memcmp(slot->frame, burst[*nbFrames].frame, slot->lengthFrame)) {
+      (*nbWrong)++;
+    }
+    (*nbFrames)++;
+    AX25_ringRelease(ring);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Demodulation of samples given by blocks of TEST_BLOCK frames.
+ *--------------------------------------------------------------------------*/
+static void testDemod(const float *samples, unsigned long nbSamples, unsigned int sampleRate, unsigned char mode) {
+  static AX25_Demod demod;
+  AX25_FrameSlot slots[TEST_RING_SIZE];
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  unsigned int channels = (mode == AX25_DEMOD_IQ) ? 2 : 1, nbFrames = 0, nbWrong = 0;
+  unsigned long n, i;
+
+  AX25_ringInit(&ring, slots, TEST_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  TEST_CHECK(AX25_demodInit(&demod, &stream, sampleRate, mode));
+  for(i=0; i<nbSamples; i+=n) {
+    n = (nbSamples - i < TEST_BLOCK) ? nbSamples - i : TEST_BLOCK;
+    AX25_demodSamples(&demod, samples + i * channels, n);
+    testReceived(&ring, &nbFrames, &nbWrong);
+  }
+  AX25_demodFinish(&demod);
+  testReceived(&ring, &nbFrames, &nbWrong);
+  TEST_CHECK(nbFrames == TEST_FRAMES);
+  TEST_CHECK(nbWrong == 0);
+  TEST_CHECK(stream.nbOverruns == 0);
+}
+
+/*--------------------------------------------------------------------------*
+ * 16 bits WAV file of audio samples.
+ *--------------------------------------------------------------------------*/
+static void testPut(unsigned char *p, unsigned long value, unsigned int size) {
+  unsigned int i;
+
+  for(i=0; i<size; i++) p[i] = (unsigned char) (value >> (8 * i));
+}
+
+static char testWriteWav(const char *path, const float *samples, unsigned long nbSamples, unsigned int sampleRate) {
+  unsigned char header[44], sample[2];
+  unsigned long n;
+  FILE *file;
+
+  file = fopen(path, "wb");
+  if(!file) return 0;
+  memcpy(header, "RIFF", 4);
+  testPut(header + 4, 36 + 2 * nbSamples, 4);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  testPut(header + 16, 16, 4);
+  testPut(header + 20, 1, 2);                 // PCM
+  testPut(header + 22, 1, 2);                 // Mono
+  testPut(header + 24, sampleRate, 4);
+  testPut(header + 28, 2 * sampleRate, 4);
+  testPut(header + 32, 2, 2);
+  testPut(header + 34, 16, 2);
+  memcpy(header + 36, "data", 4);
+  testPut(header + 40, 2 * nbSamples, 4);
+  fwrite(header, 1, sizeof(header), file);
+  for(n=0; n<nbSamples; n++) {
+    testPut(sample, (unsigned long) (long) lrintf(samples[n] * 32767), 2);
+    fwrite(sample, 1, 2, file);
+  }
+  return !fclose(file);
+}
+
+int main(void) {
+  static const unsigned int rates[] = {38400, 44100, 48000, 96000, 192000};
+  char path[] = "/tmp/test_demodXXXXXX";
+  AX25_SampleFile file;
+  AX25_RxStream stream;
+  AX25_Demod demod;
+  unsigned long nbSamples, n, nbRead;
+  float *samples, *read;
+  unsigned int r;
+  int fd;
+
+  AX25_crcInitEngine();
+  TEST_CHECK(!AX25_demodInit(&demod, &stream, 4 * AX25_DEMOD_BAUD - 1, AX25_DEMOD_AUDIO));
+
+  testBurst();
+  samples = malloc(2 * sizeof(float) * ((unsigned long) ((double) nbBits * 192000 / AX25_DEMOD_BAUD) + 1));
+  for(r=0; r<sizeof(rates)/sizeof(rates[0]); r++) {
+    nbSamples = testSamples(samples, rates[r], AX25_DEMOD_AUDIO, 1.0f);
+    testDemod(samples, nbSamples, rates[r], AX25_DEMOD_AUDIO);
+    nbSamples = testSamples(samples, rates[r], AX25_DEMOD_AUDIO, -1.0f);
+    testDemod(samples, nbSamples, rates[r], AX25_DEMOD_AUDIO);
+    nbSamples = testSamples(samples, rates[r], AX25_DEMOD_IQ, 1.0f);
+    testDemod(samples, nbSamples, rates[r], AX25_DEMOD_IQ);
+  }
+
+  // Through a WAV file.
+  nbSamples = testSamples(samples, 48000, AX25_DEMOD_AUDIO, 1.0f);
+  read = malloc(sizeof(float) * nbSamples);
+  fd = mkstemp(path);
+  TEST_CHECK(fd >= 0);
+  if(fd >= 0) {
+    close(fd);
+    TEST_CHECK(testWriteWav(path, samples, nbSamples, 48000));
+    TEST_CHECK(AX25_samplesOpen(&file, path, AX25_SAMPLES_WAV, 0, 0));
+    TEST_CHECK(file.sampleRate == 48000 && file.channels == 1 && file.format == AX25_SAMPLES_S16);
+    for(nbRead=0; (n = AX25_samplesRead(&file, read + nbRead, TEST_BLOCK)) > 0; nbRead+=n);
+    AX25_samplesClose(&file);
+    TEST_CHECK(nbRead == nbSamples);
+    testDemod(read, nbRead, 48000, AX25_DEMOD_AUDIO);
+    unlink(path);
+  }
+
+  free(read);
+  free(samples);
+  free(bits);
+  return TEST_END();
+}
@@ -0,0 +1,214 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_digi.c
+ * Digipeater : the duplicate cache gives the answers of a plain list of
+ * the keys of the window (expiry and eviction of the oldest key included),
+ * with keys gathered in a few clusters of the table. A WIDE2-2 frame
+ * repeated by two digipeaters goes to CALL*,WIDE2-1 then to
+ * CALL*,CALL2*,WIDE2*, with a good FCS.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Digi.h"
+#include "AX25_Rx.h"
+#include "test.h"
+
+#define TEST_ENTRIES           50
+#define TEST_WINDOW            1000
+#define TEST_KEYS              300        // Keys used by the lookups.
+#define TEST_HOMES             5          // Home slots of the keys in the table.
+#define TEST_LOOKUPS           200000
+
+// Reference of the cache : the keys of the window, oldest first.
+typedef struct {
+  AX25_DupEntry entries[TEST_ENTRIES];
+  unsigned int count;
+  unsigned long nbDuplicates, nbExpired, nbEvicted;
+} TestModel;
+
+// Last frame given to a handler.
+typedef struct {
+  char frame[AX25_FRAME_MAX_SIZE];
+  unsigned int lengthFrame;
+  unsigned int nbFrames;
+} TestOutput;
+
+static unsigned long seed = 0x510E527F;
+
+static unsigned long testRandom(void) {
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) & 0x7FFF;
+}
+
+static void testModelRemove(TestModel *model) {
+  memmove(model->entries, model->entries + 1, --model->count * sizeof(AX25_DupEntry));
+}
+
+static char testModelCheck(TestModel *model, uint64_t key, unsigned long long now) {
+  unsigned int i;
+
+  while(model->count && model->entries[0].time + TEST_WINDOW <= now) {
+    testModelRemove(model);
+    model->nbExpired++;
+  }
+  for(i=0; i<model->count; i++) {
+    if(model->entries[i].key == key) {
+      model->nbDuplicates++;
+      return 1;
+    }
+  }
+  if(model->count == TEST_ENTRIES) {
+    testModelRemove(model);
+    model->nbEvicted++;
+  }
+  model->entries[model->count].key = key;
+  model->entries[model->count++].time = now;
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Lookups of keys which share TEST_HOMES home slots (long clusters, keys
+ * moved back at every removal), at times close enough for the window to
+ * be full sometimes and to expire other times.
+ *--------------------------------------------------------------------------*/
+static void testCache(void) {
+  uint64_t keys[TEST_KEYS], key;
+  unsigned long long now = 0;
+  unsigned long lookup, nbWrong = 0;
+  AX25_DupCache cache;
+  TestModel model;
+  unsigned int k;
+
+  TEST_CHECK(!AX25_dupInit(&cache, 0, TEST_WINDOW));
+  TEST_CHECK(!AX25_dupInit(&cache, AX25_DUP_MAX_ENTRIES + 1, TEST_WINDOW));
+  TEST_CHECK(AX25_dupInit(&cache, TEST_ENTRIES, TEST_WINDOW));
+  memset(&model, 0, sizeof(model));
+  for(k=0; k<TEST_KEYS; k++) {
+    key = ((uint64_t) (k + 1) << 32) | ((uint64_t) testRandom() << 8);
+    keys[k] = (key & ~(uint64_t) cache.mask) | (cache.mask - (k % TEST_HOMES) * 3);  // Last slots : the clusters wrap.
+  }
+
+  for(lookup=0; lookup<TEST_LOOKUPS; lookup++) {
+    now += (lookup % 1000 < 500) ? testRandom() % 4 : testRandom() % 64;  // Full window, then expiry.
+    k = (lookup % 3) ? (unsigned int) (testRandom() % 20) : (unsigned int) (testRandom() % TEST_KEYS);
+    if(AX25_dupCheck(&cache, keys[k], now) != testModelCheck(&model, keys[k], now)) nbWrong++;
+  }
+  TEST_CHECK(nbWrong == 0);
+  TEST_CHECK(cache.count == model.count);
+  TEST_CHECK(cache.nbLookups == TEST_LOOKUPS);
+  TEST_CHECK(cache.nbDuplicates == model.nbDuplicates && cache.nbDuplicates > 0);
+  TEST_CHECK(cache.nbExpired == model.nbExpired && cache.nbExpired > 0);
+  TEST_CHECK(cache.nbEvicted == model.nbEvicted && cache.nbEvicted > 0);
+
+  // The window is over : every key is new again.
+  now += TEST_WINDOW;
+  for(k=0; k<TEST_ENTRIES; k++) TEST_CHECK(!AX25_dupCheck(&cache, keys[k], now));
+  for(k=0; k<TEST_ENTRIES; k++) TEST_CHECK(AX25_dupCheck(&cache, keys[k], now));
+  AX25_dupFree(&cache);
+}
+
+static void testHandler(void *user, unsigned int channel, const char *frame, unsigned int lengthFrame) {
+  TestOutput *output = (TestOutput *) user;
+
+  (void) channel;
+  memcpy(output->frame, frame, lengthFrame);
+  output->lengthFrame = lengthFrame;
+  output->nbFrames++;
+}
+
+/*--------------------------------------------------------------------------*
+ * Check of the path of a repeated frame : the digipeaters expected (H bit
+ * in bit7) and the rest of the frame as it was sent.
+ *--------------------------------------------------------------------------*/
+static void testPath(TestOutput *output, const AX25_Address *digipeaters, unsigned int nbDigipeaters,
+                     const char *info, unsigned int length) {
+  AX25_Path path;
+  unsigned int i;
+
+  TEST_CHECK(output->nbFrames == 1);
+  TEST_CHECK(AX25_checkFrame(output->frame, (unsigned short) output->lengthFrame, 0) == 0);
+  TEST_CHECK(AX25_pathParse(&path, output->frame + 1, output->lengthFrame - 4));
+  TEST_CHECK(path.nbDigipeaters == nbDigipeaters);
+  for(i=0; i<nbDigipeaters && i<path.nbDigipeaters; i++) {
+    TEST_CHECK(AX25_addressEqual(&path.digipeaters[i], &digipeaters[i]));
+    TEST_CHECK(path.digipeaters[i].bit7 == digipeaters[i].bit7);
+  }
+  TEST_CHECK(output->lengthFrame == 1 + path.length + 2 + length + 3);
+  TEST_CHECK(!memcmp(output->frame + 1 + path.length + 2, info, length));
+}
+
+/*--------------------------------------------------------------------------*
+ * WIDE2-2 repeated by CALL then by CALL2, heard again by both.
+ *--------------------------------------------------------------------------*/
+static void testWide(void) {
+  AX25_Address call, call2, destination, source, expected[3];
+  TestOutput outputs[2], repeated;
+  char info[100], frame[AX25_FRAME_MAX_SIZE];
+  AX25_FrameHeader header;
+  AX25_DigiStats stats;
+  unsigned int lengthFrame, i;
+  AX25_Digi *digis[2];
+
+  AX25_addressParse(&call, "ON0UL");
+  AX25_addressParse(&call2, "ON0FTI-2");
+  memset(outputs, 0, sizeof(outputs));
+  digis[0] = AX25_digiCreate(&call, 64, 0, testHandler, NULL, &outputs[0]);
+  digis[1] = AX25_digiCreate(&call2, 64, 0, testHandler, NULL, &outputs[1]);
+  TEST_CHECK(digis[0] != NULL && digis[1] != NULL);
+  if(!digis[0] || !digis[1]) {
+    AX25_digiDestroy(digis[0]);
+    AX25_digiDestroy(digis[1]);
+    return;
+  }
+  TEST_CHECK(AX25_digiSetWide(digis[0], "WIDE", 2) && AX25_digiSetWide(digis[1], "WIDE", 2));
+
+  for(i=0; i<sizeof(info); i++) info[i] = (char) (i * 13);
+  AX25_addressParse(&destination, "APRS");
+  AX25_addressParse(&source, "ON0ULG-1");
+  AX25_addressParse(&expected[0], "WIDE2-2");
+  TEST_CHECK(AX25_headerInit(&header, &destination, &source, expected, 1, 0x03, 0xF0));
+  lengthFrame = AX25_frameBuild(&header, frame, info, sizeof(info));
+
+  // First hop : CALL*,WIDE2-1.
+  TEST_CHECK(AX25_digiInput(digis[0], 0, frame, lengthFrame, 0) == AX25_DIGI_REPEATED);
+  expected[0] = call;
+  expected[0].bit7 = 1;
+  AX25_addressParse(&expected[1], "WIDE2-1");
+  testPath(&outputs[0], expected, 2, info, sizeof(info));
+  repeated = outputs[0];
+
+  // Second hop : CALL*,CALL2*,WIDE2*.
+  TEST_CHECK(AX25_digiInput(digis[1], 0, repeated.frame, repeated.lengthFrame, 1) == AX25_DIGI_REPEATED);
+  expected[1] = call2;
+  expected[1].bit7 = 1;
+  AX25_addressParse(&expected[2], "WIDE2");
+  expected[2].bit7 = 1;
+  testPath(&outputs[1], expected, 3, info, sizeof(info));
+
+  // The copies heard back are duplicates, whatever their path.
+  TEST_CHECK(AX25_digiInput(digis[0], 0, outputs[1].frame, outputs[1].lengthFrame, 2) == AX25_DIGI_DUPLICATE);
+  TEST_CHECK(AX25_digiInput(digis[1], 0, frame, lengthFrame, 3) == AX25_DIGI_DUPLICATE);
+  TEST_CHECK(outputs[0].nbFrames == 1 && outputs[1].nbFrames == 1);
+
+  // After the window, the path is used up : nothing to repeat.
+  TEST_CHECK(AX25_digiInput(digis[0], 0, outputs[1].frame, outputs[1].lengthFrame, AX25_DIGI_WINDOW + 2) == 0);
+  AX25_digiGetStats(digis[0], &stats);
+  TEST_CHECK(stats.nbFrames == 3 && stats.nbRepeated == 1 && stats.nbDuplicates == 1);
+  TEST_CHECK(stats.nbNotForUs == 1 && stats.nbUntraced == 0 && stats.nbExpired == 1);
+  AX25_digiGetStats(digis[1], &stats);
+  TEST_CHECK(stats.nbFrames == 2 && stats.nbRepeated == 1 && stats.nbDuplicates == 1 && stats.nbInvalid == 0);
+
+  AX25_digiDestroy(digis[0]);
+  AX25_digiDestroy(digis[1]);
+}
+
+int main(void) {
+  AX25_crcInitEngine();
+  testCache();
+  testWide();
+  return TEST_END();
+}
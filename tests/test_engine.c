@@ -0,0 +1,136 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_engine.c
+ * Multi-channel engine : every channel gets its own frames, in order,
+ * whatever the number of workers, with the slots of the rings or of a
+ * pool (the frames kept by the handler included).
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Engine.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_CHANNELS          6
+#define TEST_FRAMES            40    // Frames per channel and per block.
+#define TEST_BLOCKS            3
+
+// Frames received on a channel (written by the worker of the channel only).
+typedef struct {
+  unsigned int nbFrames;
+  unsigned int nbWrong;
+  AX25_FrameSlot *kept;        // Last frame kept (pool only).
+} TestChannel;
+
+typedef struct {
+  TestChannel channels[TEST_CHANNELS];
+  char pool;
+} TestEngine;
+
+// Info field of a frame : the channel and the number of the frame.
+static unsigned int testInfo(char *info, unsigned int channel, unsigned int frame) {
+  unsigned int i, length = 1 + (channel * 37 + frame * 11) % 200;
+
+  for(i=0; i<length; i++) info[i] = (char) (channel + frame * 3 + i);
+  info[0] = (char) channel;
+  info[1 % length] = (char) frame;
+  return length;
+}
+
+static void testHandler(void *user, unsigned int channel, const AX25_FrameSlot *slot) {
+  TestEngine *test = (TestEngine *) user;
+  TestChannel *received = &test->channels[channel];
+  char info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE];
+  unsigned int lengthFrame;
+
+  lengthFrame = AX25_buildUIFrame(frame, info, testInfo(info, channel, received->nbFrames % TEST_FRAMES));
+  if(slot->status != AX25_FRAME_FCS_OK || slot->lengthFrame != lengthFrame || memcmp(slot->frame, frame, lengthFrame)) {
+    received->nbWrong++;
+  }
+  received->nbFrames++;
+  if(test->pool) {
+    if(received->kept) AX25_poolRelease(received->kept);
+    AX25_poolRetain((AX25_FrameSlot *) slot);
+    received->kept = (AX25_FrameSlot *) slot;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of TEST_BLOCKS blocks per channel.
+ *--------------------------------------------------------------------------*/
+static void testRun(unsigned int nbWorkers, AX25_Pool *pool) {
+  static char frames[TEST_CHANNELS][TEST_FRAMES][AX25_FRAME_MAX_SIZE];
+  static TestEngine test;
+  AX25_TxFrame burst[TEST_FRAMES];
+  AX25_ChannelBlock blocks[TEST_CHANNELS];
+  unsigned char *bits[TEST_CHANNELS];
+  AX25_StatsSnapshot snapshot;
+  char info[INFO_MAX_SIZE];
+  AX25_Engine *engine;
+  AX25_TxLine line;
+  unsigned int c, f, b;
+
+  memset(&test, 0, sizeof(test));
+  test.pool = (pool != NULL);
+  engine = AX25_engineCreate(TEST_CHANNELS, nbWorkers, testHandler, &test);
+  TEST_CHECK(engine != NULL);
+  if(!engine) return;
+  if(pool) TEST_CHECK(AX25_engineSetPool(engine, pool));
+
+  for(c=0; c<TEST_CHANNELS; c++) {
+    for(f=0; f<TEST_FRAMES; f++) {
+      burst[f].frame = frames[c][f];
+      burst[f].lengthFrame = AX25_buildUIFrame(frames[c][f], info, testInfo(info, c, f));
+    }
+    bits[c] = malloc(AX25_txBurstEncodedSize(burst, TEST_FRAMES, 8, 2));
+    AX25_txLineInit(&line);
+    blocks[c].channel = c;
+    blocks[c].bits = bits[c];
+    blocks[c].nbBits = AX25_txEncodeBurst(&line, burst, TEST_FRAMES, 8, 2, bits[c]) & ~7UL;
+  }
+  for(b=0; b<TEST_BLOCKS; b++) AX25_engineProcess(engine, blocks, TEST_CHANNELS);
+
+  for(c=0; c<TEST_CHANNELS; c++) {
+    // The descrambler resynchronizes in the delay flags of every block.
+    TEST_CHECK(test.channels[c].nbFrames == TEST_BLOCKS * TEST_FRAMES);
+    TEST_CHECK(test.channels[c].nbWrong == 0);
+    TEST_CHECK(AX25_engineGetStats(engine, c, &snapshot));
+#ifndef AX25_NO_STATS
+    TEST_CHECK(snapshot.counters[AX25_STAT_FCS_OK] == TEST_BLOCKS * TEST_FRAMES);
+#endif
+    if(test.channels[c].kept) {
+      TEST_CHECK(AX25_poolRefs(test.channels[c].kept) == 1);
+      AX25_poolRelease(test.channels[c].kept);
+    }
+    free(bits[c]);
+  }
+  TEST_CHECK(!AX25_engineGetStats(engine, TEST_CHANNELS, &snapshot));
+  AX25_engineDestroy(engine);
+}
+
+int main(void) {
+  AX25_PoolStats stats;
+  AX25_Pool *pool;
+
+  AX25_crcInitEngine();
+  TEST_CHECK(AX25_engineCreate(0, 1, testHandler, NULL) == NULL);
+  testRun(1, NULL);
+  testRun(4, NULL);
+  testRun(TEST_CHANNELS + 2, NULL);
+
+  // Every channel holds AX25_ENGINE_RING_SIZE frames and keeps one more.
+  pool = AX25_poolCreate(TEST_CHANNELS * (AX25_ENGINE_RING_SIZE + 1) + 16);
+  TEST_CHECK(pool != NULL);
+  if(pool) {
+    testRun(3, pool);
+    AX25_poolGetStats(pool, &stats);
+    TEST_CHECK(stats.nbFailures == 0);
+    AX25_poolDestroy(pool);
+  }
+  return TEST_END();
+}
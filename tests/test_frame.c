@@ -0,0 +1,141 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_frame.c
+ * Frames built from a header : AX25_frameBuild against AX25_frameBuildv,
+ * the header cache and the address paths.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Frame.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+/*--------------------------------------------------------------------------*
+ * The fragments of an info field give the frame of the whole info field,
+ * whatever the way it is cut.
+ *--------------------------------------------------------------------------*/
+static void testBuildv(const AX25_FrameHeader *header) {
+  char info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE], framev[AX25_FRAME_MAX_SIZE];
+  AX25_Fragment fragments[3];
+  unsigned int i, length, cut, lengthFrame;
+
+  for(i=0; i<sizeof(info); i++) info[i] = (char) (i * 7 + 0xC0);  // FEND, FESC and flags included.
+  for(length=0; length<=INFO_MAX_SIZE; length+=(length < 20) ? 1 : 59) {
+    lengthFrame = AX25_frameBuild(header, frame, info, length);
+    TEST_CHECK(lengthFrame == header->length + length + 4);
+    TEST_CHECK(AX25_checkFrame(frame, (unsigned short) lengthFrame, 0) == 0);
+    for(cut=0; cut<=length; cut+=(length / 4) + 1) {
+      fragments[0].data = info;
+      fragments[0].length = cut / 2;
+      fragments[1].data = info + cut / 2;
+      fragments[1].length = cut - cut / 2;
+      fragments[2].data = info + cut;
+      fragments[2].length = length - cut;
+      TEST_CHECK(AX25_frameBuildv(header, framev, fragments, 3) == lengthFrame);
+      TEST_CHECK(!memcmp(frame, framev, lengthFrame));
+    }
+    TEST_CHECK(AX25_frameBuildv(header, framev, fragments, 0) == header->length + 4);
+  }
+
+  // Too long for a frame.
+  fragments[0].data = info;
+  fragments[0].length = INFO_MAX_SIZE;
+  fragments[1].data = info;
+  fragments[1].length = AX25_FRAME_MAX_SIZE;
+  TEST_CHECK(AX25_frameBuildv(header, framev, fragments, 2) == 0);
+  TEST_CHECK(AX25_frameBuild(header, frame, info, AX25_FRAME_MAX_SIZE) == 0);
+}
+
+/*--------------------------------------------------------------------------*
+ * The cache gives the header of AX25_headerInit, and replaces the oldest
+ * one when it is full.
+ *--------------------------------------------------------------------------*/
+static void testHeaderCache(void) {
+  AX25_Address destination, source, digipeaters[AX25_MAX_DIGIPEATERS + 1];
+  static AX25_HeaderCache cache;
+  const AX25_FrameHeader *cached;
+  AX25_FrameHeader header;
+  unsigned int i;
+
+  AX25_addressParse(&destination, "APRS");
+  AX25_addressParse(&source, "ON0UL-3");
+  AX25_addressParse(&digipeaters[0], "WIDE2-2");
+  AX25_headerCacheInit(&cache);
+
+  AX25_headerInit(&header, &destination, &source, digipeaters, 1, 0x03, 0xF0);
+  cached = AX25_headerCacheGet(&cache, &destination, &source, digipeaters, 1, 0x03, 0xF0);
+  TEST_CHECK(cached && cached->length == header.length && cached->crc == header.crc);
+  TEST_CHECK(cached && !memcmp(cached->bytes, header.bytes, header.length));
+  TEST_CHECK(AX25_headerCacheGet(&cache, &destination, &source, digipeaters, 1, 0x03, 0xF0) == cached);
+  TEST_CHECK(cache.nbHits == 1 && cache.nbMisses == 1);
+
+  // Another PID is another header; no PID in a S frame.
+  TEST_CHECK(AX25_headerCacheGet(&cache, &destination, &source, digipeaters, 1, 0x03, 0xCC) != cached);
+  TEST_CHECK(AX25_headerCacheGet(&cache, &destination, &source, NULL, 0, 0x01, 0xF0)->length == 2 * AX25_ADDRESS_SIZE + 1);
+
+  for(i=0; i<AX25_HEADER_CACHE_SIZE; i++) {
+    source.ssid = (unsigned char) i;
+    AX25_headerCacheGet(&cache, &destination, &source, NULL, 0, 0x03, 0xF0);
+  }
+  TEST_CHECK(cache.nbHeaders == AX25_HEADER_CACHE_SIZE);
+  AX25_addressParse(&source, "ON0UL-3");
+  cached = AX25_headerCacheGet(&cache, &destination, &source, digipeaters, 1, 0x03, 0xF0);
+  TEST_CHECK(cached && cached->crc == header.crc);
+  TEST_CHECK(cache.nbMisses == 4 + AX25_HEADER_CACHE_SIZE);
+
+  TEST_CHECK(AX25_headerCacheGet(&cache, &destination, &source, digipeaters, AX25_MAX_DIGIPEATERS + 1, 0x03, 0xF0) == NULL);
+  TEST_CHECK(!AX25_headerInit(&header, &destination, &source, digipeaters, AX25_MAX_DIGIPEATERS + 1, 0x03, 0xF0));
+}
+
+/*--------------------------------------------------------------------------*
+ * Address field of a frame read back.
+ *--------------------------------------------------------------------------*/
+static void testPath(void) {
+  static const char *calls[] = { "ON1AA*", "RELAY", "WIDE2-1" };
+  AX25_Address destination, source, digipeaters[3];
+  unsigned char bytes[AX25_HEADER_MAX_SIZE];
+  AX25_FrameHeader header;
+  AX25_Path path;
+  unsigned int i;
+
+  AX25_addressParse(&destination, "APRS");
+  AX25_addressParse(&source, "ON0UL-15");
+  for(i=0; i<3; i++) TEST_CHECK(AX25_addressParse(&digipeaters[i], calls[i]));
+  TEST_CHECK(!AX25_addressParse(&source, "TOOLONG"));
+  TEST_CHECK(!AX25_addressParse(&source, "ON0UL-16"));
+  AX25_addressParse(&source, "ON0UL-15");
+
+  AX25_headerInit(&header, &destination, &source, digipeaters, 3, 0x03, 0xF0);
+  TEST_CHECK(AX25_pathParse(&path, (const char *) header.bytes, header.length) == 5 * AX25_ADDRESS_SIZE);
+  TEST_CHECK(AX25_addressEqual(&path.destination, &destination) && AX25_addressEqual(&path.source, &source));
+  TEST_CHECK(path.nbDigipeaters == 3);
+  for(i=0; i<3; i++) {
+    TEST_CHECK(AX25_addressEqual(&path.digipeaters[i], &digipeaters[i]));
+    TEST_CHECK(path.digipeaters[i].bit7 == digipeaters[i].bit7);
+  }
+  TEST_CHECK(AX25_pathEncode(bytes, &path) == path.length);
+  TEST_CHECK(!memcmp(bytes, header.bytes, path.length));
+
+  // Address field without end, or cut.
+  header.bytes[5 * AX25_ADDRESS_SIZE - 1] &= 0xFE;
+  TEST_CHECK(AX25_pathParse(&path, (const char *) header.bytes, header.length) == 0);
+  TEST_CHECK(AX25_pathParse(&path, (const char *) header.bytes, AX25_ADDRESS_SIZE) == 0);
+}
+
+int main(void) {
+  AX25_Address destination, source;
+  AX25_FrameHeader header;
+
+  AX25_crcInitEngine();
+  AX25_addressParse(&destination, "ON4ULG");
+  AX25_addressParse(&source, "OUFTI1");
+  AX25_headerInit(&header, &destination, &source, NULL, 0, 0x03, 0xF0);
+  testBuildv(&header);
+  testHeaderCache();
+  testPath();
+  return TEST_END();
+}
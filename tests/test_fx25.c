@@ -0,0 +1,193 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_fx25.c
+ * FX.25 : the Reed-Solomon decoder corrects up to nbCheck / 2 wrong bytes
+ * of every code, and frames encoded by AX25_fx25EncodeFrame with up to
+ * nbCheck / 2 wrong bytes in their codeword are received intact. A plain
+ * receiver still gets the frames without errors.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_FX25.h"
+#include "AX25_RS.h"
+#include "AX25_Rx.h"
+#include "AX25_Stream.h"
+#include "test.h"
+
+#define TEST_DELAY_FLAGS       4
+#define TEST_TAIL_FLAGS        2
+#define TEST_RING_SIZE         8
+
+static unsigned long seed = 0xA54FF53A;
+
+static unsigned char testRandom(void) {
+  seed = seed * 1103515245UL + 12345UL;
+  return (unsigned char) (seed >> 16);
+}
+
+/*--------------------------------------------------------------------------*
+ * nbErrors wrong bytes at distinct positions of a codeword.
+ *--------------------------------------------------------------------------*/
+static void testErrors(unsigned char *codeword, unsigned int n, unsigned int nbErrors) {
+  unsigned char wrong[AX25_RS_SIZE];
+  unsigned int i, position;
+  unsigned char value;
+
+  memset(wrong, 0, n);
+  for(i=0; i<nbErrors; i++) {
+    do position = (testRandom() | (testRandom() << 8)) % n; while(wrong[position]);
+    do value = testRandom(); while(!value);
+    codeword[position] ^= value;
+    wrong[position] = 1;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Reed-Solomon codewords of every FX.25 code with 0 to nbCheck / 2 + 1
+ * wrong bytes. Past nbCheck / 2, the codeword is either refused and left
+ * as it is, or decoded to another valid codeword.
+ *--------------------------------------------------------------------------*/
+static void testCodes(void) {
+  unsigned char codeword[AX25_RS_SIZE], original[AX25_RS_SIZE], received[AX25_RS_SIZE];
+  unsigned int tag, nbCheck, nbErrors, trial, i, nbRefused = 0;
+  const AX25_Fx25Code *code;
+  unsigned char result;
+
+  for(tag=1; tag<=AX25_FX25_NB_CODES; tag++) {
+    code = AX25_fx25Code((unsigned char) tag);
+    nbCheck = code->n - code->k;
+    for(trial=0; trial<4; trial++) {
+      for(i=0; i<code->k; i++) original[i] = testRandom();
+      AX25_rsEncode(original, code->k, original + code->k, nbCheck);
+      memcpy(codeword, original, code->n);
+      TEST_CHECK(AX25_rsDecode(codeword, code->n, nbCheck) == 0);
+
+      for(nbErrors=1; nbErrors<=nbCheck/2; nbErrors+=(nbErrors < 4) ? 1 : 5) {
+        memcpy(codeword, original, code->n);
+        testErrors(codeword, code->n, nbErrors);
+        TEST_CHECK(AX25_rsDecode(codeword, code->n, nbCheck) == nbErrors);
+        TEST_CHECK(!memcmp(codeword, original, code->n));
+      }
+      memcpy(codeword, original, code->n);
+      testErrors(codeword, code->n, nbCheck / 2);
+      TEST_CHECK(AX25_rsDecode(codeword, code->n, nbCheck) == nbCheck / 2);
+      TEST_CHECK(!memcmp(codeword, original, code->n));
+
+      memcpy(codeword, original, code->n);
+      testErrors(codeword, code->n, nbCheck / 2 + 1);
+      memcpy(received, codeword, code->n);
+      result = AX25_rsDecode(codeword, code->n, nbCheck);
+      if(result == AX25_RS_UNCORRECTABLE) {
+        TEST_CHECK(!memcmp(codeword, received, code->n));
+        nbRefused++;
+      }
+      else TEST_CHECK(AX25_rsDecode(codeword, code->n, nbCheck) == 0);
+    }
+  }
+  TEST_CHECK(nbRefused > 0);
+  TEST_CHECK(AX25_fx25Code(0) == NULL && AX25_fx25Code(AX25_FX25_NB_CODES + 1) == NULL);
+}
+
+/*--------------------------------------------------------------------------*
+ * Frame received by a stream, FX.25 or plain, from the line bits, or from
+ * the decoded bits with nbErrors wrong bytes in the codeword (nbErrors >
+ * 0, FX.25 only).
+ *
+ * RETURN:
+ * 1 if the frame is received once, intact, with a good FCS.
+ *--------------------------------------------------------------------------*/
+static char testReceive(const char *frame, unsigned int lengthFrame, const unsigned char *bits, unsigned long nbBits,
+                        unsigned char fx25, unsigned int nbErrors, AX25_RxStream *stream) {
+  static unsigned char decoded[TEST_DELAY_FLAGS + 8 + AX25_RS_SIZE + TEST_TAIL_FLAGS + 8];
+  AX25_FrameSlot slots[TEST_RING_SIZE], *slot;
+  unsigned int nbFrames = 0, nbGood = 0, n;
+  const AX25_Fx25Code *code;
+  AX25_FrameRing ring;
+  AX25_RxLine line;
+  unsigned long i;
+  uint64_t word;
+
+  AX25_ringInit(&ring, slots, TEST_RING_SIZE);
+  AX25_rxStreamInit(stream, &ring);
+  AX25_rxStreamSetFx25(stream, fx25);
+  if(!nbErrors) AX25_rxStreamBits(stream, bits, nbBits);
+  else {
+    // The tag follows the delay flags, then comes the codeword.
+    memset(decoded, 0, sizeof(decoded));
+    AX25_rxLineInit(&line);
+    AX25_rxDecodeBits(&line, bits, decoded, nbBits);
+    memcpy(&word, decoded + TEST_DELAY_FLAGS, 8);
+    code = AX25_fx25Code(AX25_fx25Match(word));
+    TEST_CHECK(code != NULL && code->tag == word);
+    if(!code) return 0;
+    testErrors(decoded + TEST_DELAY_FLAGS + 8, code->n, nbErrors);
+    for(i=0; i<nbBits; i+=n) {
+      n = (nbBits - i >= 64) ? 64 : (unsigned int) (nbBits - i);
+      memcpy(&word, decoded + i / 8, 8);
+      AX25_rxStreamWord(stream, (n < 64) ? word & ((1ULL << n) - 1) : word, n);
+    }
+  }
+  while((slot = AX25_ringPeek(&ring)) != NULL) {
+    if(slot->status == AX25_FRAME_FCS_OK && slot->lengthFrame == lengthFrame && !memcmp(slot->frame, frame, lengthFrame)) {
+      nbGood++;
+    }
+    nbFrames++;
+    AX25_ringRelease(&ring);
+  }
+  return nbFrames == 1 && nbGood == 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Frames of several lengths sent with 16, 32 and 64 check bytes.
+ *--------------------------------------------------------------------------*/
+static void testFrames(void) {
+  static const unsigned int checks[] = {0, 16, 32, 64};
+  static unsigned char bits[TEST_DELAY_FLAGS + 8 + AX25_RS_SIZE + TEST_TAIL_FLAGS];
+  char info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE];
+  unsigned int length, lengthFrame, c, nbCheck, nbErrors, i;
+  unsigned long nbBits;
+  AX25_RxStream stream;
+  AX25_TxLine line;
+
+  TEST_CHECK(AX25_fx25EncodedSize(TEST_DELAY_FLAGS, TEST_TAIL_FLAGS) <= sizeof(bits));
+  for(length=0; length<=INFO_MAX_SIZE; length+=(length < 64) ? 21 : 64) {
+    for(i=0; i<length; i++) info[i] = (char) ((i & 8) ? 0xFF : testRandom());  // Stuffed bits as well.
+    lengthFrame = AX25_buildUIFrame(frame, info, length);
+
+    for(c=0; c<sizeof(checks)/sizeof(checks[0]); c++) {
+      AX25_txLineInit(&line);
+      nbBits = AX25_fx25EncodeFrame(&line, frame, lengthFrame, checks[c], TEST_DELAY_FLAGS, TEST_TAIL_FLAGS, bits);
+      if(!nbBits) {
+        // Too long for the codes with these check bytes (191 data bytes
+        // at least).
+        TEST_CHECK(lengthFrame > 191);
+        continue;
+      }
+      TEST_CHECK((nbBits + 7) / 8 <= AX25_fx25EncodedSize(TEST_DELAY_FLAGS, TEST_TAIL_FLAGS));
+      nbCheck = checks[c] ? checks[c] : 16;
+
+      TEST_CHECK(testReceive(frame, lengthFrame, bits, nbBits, 0, 0, &stream));  // Plain receiver.
+      TEST_CHECK(testReceive(frame, lengthFrame, bits, nbBits, 1, 0, &stream));
+      TEST_CHECK(stream.nbFx25Codewords == 1 && stream.nbFx25Corrected == 0);
+      if(!checks[c]) continue;
+
+      for(nbErrors=1; nbErrors<=nbCheck/2; nbErrors+=(nbErrors < 3) ? 1 : 7) {
+        TEST_CHECK(testReceive(frame, lengthFrame, bits, nbBits, 1, nbErrors, &stream));
+        TEST_CHECK(stream.nbFx25Codewords == 1 && stream.nbFx25Corrected == 1 && stream.nbFx25Failed == 0);
+      }
+      TEST_CHECK(testReceive(frame, lengthFrame, bits, nbBits, 1, nbCheck / 2, &stream));
+      TEST_CHECK(stream.nbFx25Corrected == 1);
+    }
+  }
+}
+
+int main(void) {
+  AX25_crcInitEngine();
+  testCodes();
+  testFrames();
+  return TEST_END();
+}
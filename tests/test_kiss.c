@@ -0,0 +1,130 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_kiss.c
+ * KISS framing : encoding and streaming decoding, in blocks of any size,
+ * with the escapes, the oversized frames and the wrong escapes.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_KISS.h"
+#include "test.h"
+
+#define TEST_MAX_FRAMES        8
+
+// Frames given by the decoder.
+typedef struct {
+  unsigned int nbFrames;
+  unsigned char ports[TEST_MAX_FRAMES];
+  unsigned char commands[TEST_MAX_FRAMES];
+  unsigned int lengths[TEST_MAX_FRAMES];
+  unsigned char data[TEST_MAX_FRAMES][1024];
+} TestFrames;
+
+static void testHandler(void *user, unsigned char port, unsigned char command, const unsigned char *data,
+                        unsigned int length) {
+  TestFrames *frames = (TestFrames *) user;
+
+  if(frames->nbFrames == TEST_MAX_FRAMES || length > sizeof(frames->data[0])) return;
+  frames->ports[frames->nbFrames] = port;
+  frames->commands[frames->nbFrames] = command;
+  frames->lengths[frames->nbFrames] = length;
+  memcpy(frames->data[frames->nbFrames], data, length);
+  frames->nbFrames++;
+}
+
+/*--------------------------------------------------------------------------*
+ * Round trip of frames full of special bytes, on every port, given to
+ * the decoder in blocks of 1 to 37 bytes.
+ *--------------------------------------------------------------------------*/
+static void testRoundTrip(void) {
+  static const unsigned char specials[] = { AX25_KISS_FEND, AX25_KISS_FESC, AX25_KISS_TFEND, AX25_KISS_TFESC };
+  static unsigned char encoded[3 * (2 * 1000 + 4)];
+  static TestFrames frames;
+  unsigned char data[1000], buffer[1024];
+  AX25_KissDecoder decoder;
+  unsigned long n, i, block;
+  unsigned int port, k;
+
+  for(i=0; i<sizeof(data); i++) data[i] = (i % 5) ? (unsigned char) (i * 13) : specials[(i / 5) % 4];
+
+  for(port=0; port<16; port++) {
+    for(block=1; block<=37; block+=12) {
+      n = AX25_kissEncode((unsigned char) port, AX25_KISS_DATA, data, sizeof(data), encoded);
+      TEST_CHECK(n <= AX25_kissEncodedSize(sizeof(data)));
+      TEST_CHECK(encoded[0] == AX25_KISS_FEND && encoded[n - 1] == AX25_KISS_FEND);
+      for(i=1; i<n-1; i++) TEST_CHECK(encoded[i] != AX25_KISS_FEND);
+      n += AX25_kissEncode((unsigned char) port, AX25_KISS_TXDELAY, data, 1, encoded + n);
+      n += AX25_kissEncode(0, AX25_KISS_RETURN, NULL, 0, encoded + n);
+
+      memset(&frames, 0, sizeof(frames));
+      AX25_kissDecoderInit(&decoder, buffer, sizeof(buffer));
+      for(i=0; i<n; i+=block) {
+        AX25_kissDecode(&decoder, encoded + i, (n - i < block) ? n - i : block, testHandler, &frames);
+      }
+      TEST_CHECK(frames.nbFrames == 3 && decoder.nbFrames == 3 && decoder.nbBadEscapes == 0);
+      TEST_CHECK(frames.ports[0] == port && frames.commands[0] == AX25_KISS_DATA);
+      TEST_CHECK(frames.lengths[0] == sizeof(data) && !memcmp(frames.data[0], data, sizeof(data)));
+      TEST_CHECK(frames.ports[1] == port && frames.commands[1] == AX25_KISS_TXDELAY && frames.lengths[1] == 1);
+      TEST_CHECK(frames.commands[2] == AX25_KISS_RETURN && frames.lengths[2] == 0);
+    }
+  }
+
+  // In place.
+  n = AX25_kissEncode(0, AX25_KISS_DATA, data, sizeof(data), encoded);
+  k = AX25_kissUnescape(encoded + 2, (unsigned int) n - 3);
+  TEST_CHECK(k == sizeof(data) && !memcmp(encoded + 2, data, sizeof(data)));
+}
+
+/*--------------------------------------------------------------------------*
+ * Errors : bytes before the first FEND, empty frames, wrong escapes and
+ * frames larger than the buffer.
+ *--------------------------------------------------------------------------*/
+static void testErrors(void) {
+  static const unsigned char noise[] = { 0x12, 0xDB, 0x34, 0xC0, 0xC0, 0xC0, 0x00, 0x41, 0xDB, 0x42, 0xC0 };
+  static const unsigned char unfinished[] = { 0xC0, 0x00, 0x41, 0xDB, 0xC0, 0x00, 0x43, 0xC0 };
+  static const unsigned char tail[] = { 0x41, 0xDB, 0xDC, 0xDB, 0x7E, 0x42, 0xDB };
+  static TestFrames frames;
+  unsigned char buffer[8], data[16], encoded[2 * (2 * 16 + 4)];
+  AX25_KissDecoder decoder;
+  unsigned long n;
+  unsigned int i;
+
+  // A wrong escape keeps the byte.
+  memset(&frames, 0, sizeof(frames));
+  AX25_kissDecoderInit(&decoder, buffer, sizeof(buffer));
+  TEST_CHECK(AX25_kissDecode(&decoder, noise, sizeof(noise), testHandler, &frames) == 1);
+  TEST_CHECK(decoder.nbBadEscapes == 1);
+  TEST_CHECK(frames.lengths[0] == 2 && frames.data[0][0] == 0x41 && frames.data[0][1] == 0x42);
+
+  // A FESC before a FEND is dropped, the frame ends.
+  memset(&frames, 0, sizeof(frames));
+  AX25_kissDecoderInit(&decoder, buffer, sizeof(buffer));
+  TEST_CHECK(AX25_kissDecode(&decoder, unfinished, sizeof(unfinished), testHandler, &frames) == 2);
+  TEST_CHECK(decoder.nbBadEscapes == 1);
+  TEST_CHECK(frames.lengths[0] == 1 && frames.data[0][0] == 0x41);
+  TEST_CHECK(frames.lengths[1] == 1 && frames.data[1][0] == 0x43);
+
+  // Oversized frame : dropped, the next one is kept.
+  memset(&frames, 0, sizeof(frames));
+  AX25_kissDecoderInit(&decoder, buffer, sizeof(buffer));
+  for(i=0; i<sizeof(data); i++) data[i] = (unsigned char) i;
+  n = AX25_kissEncode(1, AX25_KISS_DATA, data, sizeof(data), encoded);
+  n += AX25_kissEncode(2, AX25_KISS_DATA, data, sizeof(buffer) - 1, encoded + n);
+  TEST_CHECK(AX25_kissDecode(&decoder, encoded, n, testHandler, &frames) == 1);
+  TEST_CHECK(decoder.nbOversizes == 1);
+  TEST_CHECK(frames.ports[0] == 2 && frames.lengths[0] == sizeof(buffer) - 1);
+
+  // FESC at the end of the data to unescape : dropped.
+  memcpy(data, tail, sizeof(tail));
+  TEST_CHECK(AX25_kissUnescape(data, sizeof(tail)) == 4);
+  TEST_CHECK(data[0] == 0x41 && data[1] == AX25_KISS_FEND && data[2] == 0x7E && data[3] == 0x42);
+}
+
+int main(void) {
+  testRoundTrip();
+  testErrors();
+  return TEST_END();
+}
@@ -0,0 +1,175 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_link.c
+ * Connected mode : the transfer of ax25_link between two stations, over a
+ * simulated link that loses frames in both directions, with SREJ, REJ and
+ * go-back-N. The data received is the data sent, byte for byte, once and
+ * in order, and the link is disconnected at the end.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Link.h"
+#include "test.h"
+
+#define TEST_BYTES             100000
+#define TEST_BAUD              9600
+#define TEST_DELAY             250        // One-way propagation delay (ms).
+#define TEST_QUEUE_SIZE        1024       // Frames in flight per direction.
+#define TEST_TIME_LIMIT        3600000    // One hour (ms).
+
+// One direction of the link.
+typedef struct {
+  unsigned long long arrival[TEST_QUEUE_SIZE];
+  unsigned int lengths[TEST_QUEUE_SIZE];
+  char frames[TEST_QUEUE_SIZE][AX25_FRAME_MAX_SIZE];
+  unsigned int head, tail;
+  unsigned long long free;     // End of the frame on the air (ms).
+  unsigned long nbFrames, nbLost;
+} TestChannel;
+
+typedef struct {
+  AX25_Link link;
+  TestChannel *channel;        // Channel of the frames sent.
+} TestStation;
+
+static TestStation stations[2];
+static TestChannel channels[2];
+static unsigned long long now;
+static unsigned long seed, loss;  // Loss : frames lost per 1000.
+static unsigned char received[TEST_BYTES];
+static unsigned long nbReceived, nbOver, nbBadFcs;
+
+/*--------------------------------------------------------------------------*
+ * Byte number i of the data transferred.
+ *--------------------------------------------------------------------------*/
+static unsigned char testByte(unsigned long i) {
+  return (unsigned char) ((i * 2654435761UL) >> 13);
+}
+
+static void testSend(void *user, const char *frame, unsigned int length) {
+  TestChannel *channel = ((TestStation *) user)->channel;
+  unsigned int slot;
+
+  if(channel->free < now) channel->free = now;
+  channel->free += (length * 8UL * 1000 + TEST_BAUD - 1) / TEST_BAUD;
+  channel->nbFrames++;
+  seed = seed * 1103515245UL + 12345UL;
+  if((seed >> 16) % 1000 < loss || channel->tail - channel->head == TEST_QUEUE_SIZE) {
+    channel->nbLost++;
+    return;
+  }
+  slot = channel->tail++ % TEST_QUEUE_SIZE;
+  channel->arrival[slot] = channel->free + TEST_DELAY;
+  channel->lengths[slot] = length;
+  memcpy(channel->frames[slot], frame, length);
+}
+
+static void testReceive(void *user, const unsigned char *data, unsigned int length) {
+  (void) user;
+  if(nbReceived + length > TEST_BYTES) {
+    nbOver += length;
+    return;
+  }
+  memcpy(received + nbReceived, data, length);
+  nbReceived += length;
+}
+
+static void testDeliver(TestChannel *channel, TestStation *station) {
+  unsigned int slot;
+
+  while(channel->head != channel->tail && channel->arrival[channel->head % TEST_QUEUE_SIZE] <= now) {
+    slot = channel->head++ % TEST_QUEUE_SIZE;
+    if(AX25_checkFrame(channel->frames[slot], (unsigned short) channel->lengths[slot], 0) != 0) nbBadFcs++;
+    else AX25_linkFrame(&station->link, channel->frames[slot], channel->lengths[slot], now);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Transfer of TEST_BYTES bytes from the first station to the second one,
+ * as ax25_link does it.
+ *--------------------------------------------------------------------------*/
+static void testTransfer(unsigned char modulo128, unsigned char srej, unsigned long lossPerMille, unsigned long lossSeed) {
+  AX25_Link *sender = &stations[0].link, *receiver = &stations[1].link;
+  AX25_Address addresses[2];
+  AX25_LinkParams params;
+  unsigned char chunk[4096];
+  unsigned long queued = 0, i;
+  unsigned int n;
+  char disconnecting = 0;
+
+  memset(channels, 0, sizeof(channels));
+  now = 0;
+  seed = lossSeed;
+  loss = lossPerMille;
+  nbReceived = nbOver = nbBadFcs = 0;
+
+  AX25_linkDefaults(&params, modulo128);
+  params.srej = srej;
+  AX25_addressParse(&addresses[0], "ON0ULG");
+  AX25_addressParse(&addresses[1], "ON0FTI-1");
+  for(i=0; i<2; i++) {
+    stations[i].channel = &channels[i];
+    TEST_CHECK(AX25_linkInit(&stations[i].link, &params, &addresses[i], &addresses[1 - i], NULL, 0,
+                             testSend, testReceive, &stations[i]));
+  }
+
+  AX25_linkConnect(sender, now);
+  for(; now<TEST_TIME_LIMIT; now++) {
+    testDeliver(&channels[0], &stations[1]);
+    testDeliver(&channels[1], &stations[0]);
+
+    if(sender->state == AX25_LINK_CONNECTED) {
+      while(queued < TEST_BYTES) {
+        n = (TEST_BYTES - queued < sizeof(chunk)) ? (unsigned int) (TEST_BYTES - queued) : (unsigned int) sizeof(chunk);
+        for(i=0; i<n; i++) chunk[i] = testByte(queued + i);
+        n = AX25_linkSendData(sender, chunk, n);
+        if(!n) break;
+        queued += n;
+      }
+      if(queued == TEST_BYTES && !AX25_linkPending(sender) && !disconnecting) {
+        AX25_linkDisconnect(sender, now);
+        disconnecting = 1;
+      }
+    }
+    else if(sender->state == AX25_LINK_DISCONNECTED) break;
+
+    AX25_linkPoll(sender, now);
+    AX25_linkPoll(receiver, now);
+  }
+
+  TEST_CHECK(now < TEST_TIME_LIMIT);
+  TEST_CHECK(disconnecting && sender->state == AX25_LINK_DISCONNECTED);
+  TEST_CHECK(nbReceived == TEST_BYTES && nbOver == 0 && nbBadFcs == 0);
+  for(i=0; i<nbReceived && received[i] == testByte(i); i++);
+  TEST_CHECK(i == TEST_BYTES);
+  TEST_CHECK(receiver->nbBytes == TEST_BYTES);
+
+  if(!lossPerMille) {
+    // Nothing lost : nothing sent twice.
+    TEST_CHECK(channels[0].nbLost == 0 && channels[1].nbLost == 0);
+    TEST_CHECK(sender->nbRetransmits == 0 && sender->nbTimeouts == 0);
+    TEST_CHECK(receiver->nbSrej == 0 && receiver->nbRej == 0 && receiver->nbDuplicates == 0);
+  }
+  else {
+    TEST_CHECK(channels[0].nbLost > 0);
+    TEST_CHECK(sender->nbRetransmits > 0);
+    TEST_CHECK(srej ? receiver->nbSrej > 0 : receiver->nbRej > 0);
+  }
+}
+
+int main(void) {
+  static const unsigned long losses[] = { 0, 20, 100 };
+  unsigned int l;
+
+  AX25_crcInitEngine();
+  for(l=0; l<sizeof(losses)/sizeof(losses[0]); l++) {
+    testTransfer(1, 1, losses[l], 0x6A09E667 + l);  // Modulo 128, SREJ.
+    testTransfer(0, 0, losses[l], 0xBB67AE85 + l);  // Modulo 8, REJ.
+    testTransfer(1, 0, losses[l], 0x3C6EF372 + l);  // Modulo 128, go-back-N.
+  }
+  return TEST_END();
+}
@@ -0,0 +1,95 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_pool.c
+ * Frame pool : references, exhaustion and caches of the threads.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "AX25_Pool.h"
+#include "test.h"
+
+#define TEST_FRAMES            256
+#define TEST_THREADS           4
+#define TEST_ROUNDS            20000
+
+/*--------------------------------------------------------------------------*
+ * One thread : allocations and releases, a few frames kept at a time.
+ *--------------------------------------------------------------------------*/
+static void *testWorker(void *arg) {
+  AX25_Pool *pool = (AX25_Pool *) arg;
+  AX25_FrameSlot *kept[8] = { 0 };
+  unsigned long *failures = calloc(1, sizeof(unsigned long));
+  unsigned int i, k;
+
+  for(i=0; i<TEST_ROUNDS; i++) {
+    k = i % 8;
+    if(kept[k]) AX25_poolRelease(kept[k]);
+    kept[k] = AX25_poolAlloc(pool);
+    if(!kept[k]) continue;
+    if(AX25_poolRefs(kept[k]) != 1) (*failures)++;
+    kept[k]->lengthFrame = i;
+  }
+  for(k=0; k<8; k++) if(kept[k]) AX25_poolRelease(kept[k]);
+  AX25_poolFlushCache(pool);
+  return failures;
+}
+
+int main(void) {
+  static AX25_FrameSlot *slots[TEST_FRAMES];
+  pthread_t threads[TEST_THREADS];
+  AX25_PoolStats stats;
+  AX25_FrameSlot *slot;
+  AX25_Pool *pool;
+  void *failures;
+  unsigned int i;
+
+  TEST_CHECK(AX25_poolCreate(0) == NULL);
+  TEST_CHECK(AX25_poolCreate(AX25_POOL_MAX_FRAMES + 1) == NULL);
+  pool = AX25_poolCreate(TEST_FRAMES);
+  TEST_CHECK(pool != NULL);
+  if(!pool) return TEST_END();
+
+  // Every frame once, then none.
+  for(i=0; i<TEST_FRAMES; i++) {
+    slots[i] = AX25_poolAlloc(pool);
+    TEST_CHECK(slots[i] != NULL);
+  }
+  TEST_CHECK(AX25_poolAlloc(pool) == NULL);
+  for(i=1; i<TEST_FRAMES; i++) TEST_CHECK(slots[i] != slots[i - 1]);
+
+  // References : the frame comes back after the last one.
+  slot = slots[0];
+  AX25_poolRetain(slot);
+  AX25_poolRetain(slot);
+  TEST_CHECK(AX25_poolRefs(slot) == 3);
+  AX25_poolRelease(slot);
+  AX25_poolRelease(slot);
+  TEST_CHECK(AX25_poolRefs(slot) == 1);
+  TEST_CHECK(AX25_poolAlloc(pool) == NULL);
+  AX25_poolRelease(slot);
+  TEST_CHECK(AX25_poolAlloc(pool) == slot);
+  for(i=0; i<TEST_FRAMES; i++) AX25_poolRelease(slots[i]);
+
+  AX25_poolFlushCache(pool);
+  AX25_poolGetStats(pool, &stats);
+  TEST_CHECK(stats.nbFrames == TEST_FRAMES && stats.nbFree == TEST_FRAMES);
+  TEST_CHECK(stats.nbAllocs == TEST_FRAMES + 1 && stats.nbFailures == 2);
+
+  // Threads sharing the pool, each one with its cache.
+  for(i=0; i<TEST_THREADS; i++) TEST_CHECK(!pthread_create(&threads[i], NULL, testWorker, pool));
+  for(i=0; i<TEST_THREADS; i++) {
+    pthread_join(threads[i], &failures);
+    TEST_CHECK(failures && *(unsigned long *) failures == 0);
+    free(failures);
+  }
+  AX25_poolGetStats(pool, &stats);
+  TEST_CHECK(stats.nbFree == TEST_FRAMES);
+  TEST_CHECK(stats.nbAllocs + stats.nbFailures == TEST_FRAMES + 3 + (unsigned long) TEST_THREADS * TEST_ROUNDS);
+
+  AX25_poolDestroy(pool);
+  return TEST_END();
+}
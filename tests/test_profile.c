@@ -0,0 +1,151 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_profile.c
+ * Codecs of the modem profiles : frames encoded by every profile, one
+ * after the other on the same line, are received intact and in order from
+ * blocks of any size. The G3RUH profiles send the bits of
+ * AX25_txEncodeFrame, and correct a wrong bit on the air.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_Profile.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_FRAMES            24
+#define TEST_DELAY_FLAGS       4     // Lock of the descrambler.
+#define TEST_TAIL_FLAGS        2
+#define TEST_MAX_BYTES         (TEST_FRAMES * (2 * AX25_FRAME_MAX_SIZE + TEST_DELAY_FLAGS + TEST_TAIL_FLAGS))
+#define TEST_WRONG_FRAME       7     // Frame of zeros with a wrong bit on the air.
+
+static char frames[TEST_FRAMES][AX25_FRAME_MAX_SIZE];
+static unsigned int lengths[TEST_FRAMES];
+static unsigned long starts[TEST_FRAMES + 1];  // First bit of every frame on the line.
+static unsigned char line[TEST_MAX_BYTES];
+static unsigned long nbLineBits;
+
+// Frames given by the receiver.
+typedef struct {
+  unsigned int nbFrames;
+  unsigned int nbWrong;
+  unsigned int nbFixed;
+} TestReceived;
+
+static unsigned char testBit(const unsigned char *bits, unsigned long i) {
+  return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bits appended to the line at any bit position.
+ *--------------------------------------------------------------------------*/
+static void testAppend(const unsigned char *bits, unsigned long nbBits) {
+  unsigned long i;
+
+  for(i=0; i<nbBits; i++, nbLineBits++) {
+    if(testBit(bits, i)) line[nbLineBits >> 3] |= (unsigned char) (1 << (nbLineBits & 7));
+  }
+}
+
+static void testHandler(void *user, const char *frame, unsigned int lengthFrame, unsigned char status) {
+  TestReceived *received = (TestReceived *) user;
+  unsigned int f = received->nbFrames;
+
+  if(f >= TEST_FRAMES || status == AX25_FRAME_FCS_BAD || lengthFrame != lengths[f] || memcmp(frame, frames[f], lengthFrame)) {
+    received->nbWrong++;
+  }
+  if(status == AX25_FRAME_FCS_FIXED) received->nbFixed++;
+  received->nbFrames++;
+}
+
+/*--------------------------------------------------------------------------*
+ * Reception of the line by blocks of 1 to 97 bits, each one copied from
+ * its first bit to a buffer of its own.
+ *--------------------------------------------------------------------------*/
+static void testReceive(unsigned char profile, unsigned char correction, TestReceived *received) {
+  unsigned char block[16];
+  AX25_ProfileRxCounters counters;
+  AX25_ProfileRx rx;
+  unsigned long i, j, n;
+
+  memset(received, 0, sizeof(*received));
+  TEST_CHECK(AX25_profileRxInit(&rx, profile, testHandler, received));
+  AX25_profileRxSetCorrection(&rx, correction);
+  for(i=0, n=1; i<nbLineBits; i+=n, n=(n % 97) + 1) {
+    if(n > nbLineBits - i) n = nbLineBits - i;
+    memset(block, 0, sizeof(block));
+    for(j=0; j<n; j++) block[j >> 3] |= (unsigned char) (testBit(line, i + j) << (j & 7));
+    AX25_profileRxBits(&rx, block, n);
+  }
+  AX25_profileRxCounters(&rx, &counters);
+  TEST_CHECK(counters.nbBits == nbLineBits);
+  TEST_CHECK(counters.nbFrames == TEST_FRAMES);
+  TEST_CHECK(counters.nbAborts == 0 && counters.nbOversizes == 0);
+  TEST_CHECK(counters.nbCorrected == received->nbFixed);
+}
+
+int main(void) {
+  static unsigned char bits[2 * AX25_FRAME_MAX_SIZE + TEST_DELAY_FLAGS + TEST_TAIL_FLAGS];
+  static unsigned char expected[sizeof(bits)];
+  char info[INFO_MAX_SIZE];
+  unsigned long seed = 0x9B05688C, nbBits, nbExpected, i;
+  const AX25_ProfileInfo *profileInfo;
+  unsigned int f, length;
+  unsigned char profile;
+  TestReceived received;
+  AX25_ProfileTx tx;
+  AX25_TxLine txLine;
+
+  AX25_crcInitEngine();
+  for(f=0; f<TEST_FRAMES; f++) {
+    length = (f * 71) % (INFO_MAX_SIZE + 1);
+    for(i=0; i<length; i++) {
+      seed = seed * 1103515245UL + 12345UL;
+      info[i] = (f % 4 == 1) ? (char) 0xFF : (char) (seed >> 16);  // Some frames : ones only.
+    }
+    // The wrong bits of the frame of zeros are pairs of ones (NRZI) : no
+    // stuffed bit nor flag is made or removed.
+    if(f == TEST_WRONG_FRAME) memset(info, 0, length);
+    lengths[f] = AX25_buildUIFrame(frames[f], info, length);
+  }
+  TEST_CHECK(AX25_profileInfo(AX25_PROFILE_COUNT) == NULL);
+  TEST_CHECK(!AX25_profileTxInit(&tx, AX25_PROFILE_COUNT));
+
+  for(profile=0; profile<AX25_PROFILE_COUNT; profile++) {
+    profileInfo = AX25_profileInfo(profile);
+    TEST_CHECK(profileInfo != NULL);
+    if(!profileInfo) continue;
+
+    // Frames one after the other : the state of the line is kept.
+    memset(line, 0, sizeof(line));
+    nbLineBits = 0;
+    TEST_CHECK(AX25_profileTxInit(&tx, profile));
+    AX25_txLineInit(&txLine);
+    for(f=0; f<TEST_FRAMES; f++) {
+      starts[f] = nbLineBits;
+      nbBits = AX25_profileTxEncodeFrame(&tx, frames[f], lengths[f], TEST_DELAY_FLAGS, TEST_TAIL_FLAGS, bits);
+      TEST_CHECK((nbBits + 7) / 8 <= AX25_profileEncodedSize(profile, lengths[f], TEST_DELAY_FLAGS, TEST_TAIL_FLAGS));
+      testAppend(bits, nbBits);
+      if(profileInfo->scrambled && profileInfo->nrzi && !profileInfo->msbFirst) {
+        nbExpected = AX25_txEncodeFrame(&txLine, frames[f], lengths[f], TEST_DELAY_FLAGS, TEST_TAIL_FLAGS, expected);
+        TEST_CHECK(nbBits == nbExpected);
+        for(i=0; i<nbBits && testBit(bits, i) == testBit(expected, i); i++);
+        TEST_CHECK(i == nbBits);
+      }
+    }
+    starts[f] = nbLineBits;
+    testReceive(profile, 0, &received);
+    TEST_CHECK(received.nbFrames == TEST_FRAMES && received.nbWrong == 0 && received.nbFixed == 0);
+
+    // One wrong bit on the air in the middle of the frame of zeros.
+    if(profileInfo->scrambled) {
+      i = (starts[TEST_WRONG_FRAME] + starts[TEST_WRONG_FRAME + 1]) / 2;
+      line[i >> 3] ^= (unsigned char) (1 << (i & 7));
+      testReceive(profile, 1, &received);
+      TEST_CHECK(received.nbFrames == TEST_FRAMES && received.nbWrong == 0 && received.nbFixed == 1);
+    }
+  }
+  return TEST_END();
+}
@@ -0,0 +1,180 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_rx.c
+ * Receive line decoder : the bit by bit descrambler and NRZI decoder and
+ * the bulk ones (AX25_rxDecodeWord, AX25_rxDecodeBits) against the
+ * original bit by bit decoder, on random bits cut in any way. The bit by
+ * bit receiver drops a frame too long and gets the next one.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_Rx.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_BITS              (64 * 1024 + 13)
+#define TEST_FRAME_BITS        (16 * 8 * AX25_FRAME_MAX_SIZE)
+
+static unsigned char in[(TEST_BITS + 7) / 8], reference[(TEST_BITS + 7) / 8], out[(TEST_BITS + 7) / 8];
+
+/*--------------------------------------------------------------------------*
+ * Original AX25_rxBit (descrambler register shifted to the left, D(x) =
+ * x17 + x12 + 1, then NRZI decoding), the reference of the tests.
+ *--------------------------------------------------------------------------*/
+static unsigned char refLastBit = 1;
+static unsigned long refShiftRegister;
+
+static char refRxBit(char bit) {
+  char nextBit;
+
+  nextBit = bit ^ (((refShiftRegister >> 11) & 1) ^ ((refShiftRegister >> 16) & 1));
+  refShiftRegister <<= 1;
+  if(bit) refShiftRegister |= 1;
+  if(nextBit == refLastBit) return 0x01;
+  refLastBit = nextBit;
+  return 0x00;
+}
+
+static unsigned char testBit(const unsigned char *bits, unsigned long i) {
+  return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bits of bytes sent LSB first, with bit stuffing or not, line encoded by
+ * the Tx context.
+ *--------------------------------------------------------------------------*/
+static AX25_TxContext txCtx;
+static unsigned char lineBits[TEST_FRAME_BITS];  // One bit per byte.
+static unsigned long nbLineBits;
+static unsigned int nbOnes;
+
+static void testSendBit(char bit) {
+  AX25_txBit_r(&txCtx, bit);
+  if(nbLineBits < TEST_FRAME_BITS) lineBits[nbLineBits++] = (unsigned char) txCtx.bitToSend;
+}
+
+static void testSendBytes(const unsigned char *bytes, unsigned int n, char stuffing) {
+  unsigned int i, j;
+  char bit;
+
+  for(i=0; i<n; i++) {
+    for(j=0; j<8; j++) {
+      bit = (char) ((bytes[i] >> j) & 1);
+      testSendBit(bit);
+      nbOnes = bit ? nbOnes + 1 : 0;
+      if(stuffing && nbOnes == 5) {
+        testSendBit(0);
+        nbOnes = 0;
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * A frame of ones too long for the buffer, then a good frame : the first
+ * one is dropped wherever its stuffed bits fall, the second one is
+ * received (no stuffed bit is expected from the dropped frame).
+ *--------------------------------------------------------------------------*/
+static void testOversize(void) {
+  static const unsigned char flags[8] = { 0x7E, 0x7E, 0x7E, 0x7E, 0x7E, 0x7E, 0x7E, 0x7E };
+  static unsigned char ones[AX25_FRAME_MAX_SIZE + 8];
+  static AX25_RxContext ctx;
+  char info[32], frame[AX25_FRAME_MAX_SIZE], buffer[AX25_FRAME_MAX_SIZE];
+  unsigned int lengthFrame, shift, i;
+  AX25_StatsSnapshot snapshot;
+  AX25_Stats stats;
+  unsigned long j;
+
+  memset(ones, 0xFF, sizeof(ones));
+  for(i=0; i<sizeof(info); i++) info[i] = (char) (i * 37);
+  lengthFrame = AX25_buildUIFrame(frame, info, sizeof(info));
+  for(shift=0; shift<6; shift++) {
+    memset(&txCtx, 0, sizeof(txCtx));
+    AX25_txInitCfg_r(&txCtx);
+    nbLineBits = 0;
+    nbOnes = 0;
+    testSendBytes(flags, sizeof(flags), 0);
+    for(i=0; i<shift; i++) testSendBit(0);  // The stuffed bits move in the bytes.
+    testSendBytes(ones, sizeof(ones), 1);
+    testSendBytes(flags, sizeof(flags), 0);
+    testSendBytes((const unsigned char *) frame + 1, lengthFrame - 2, 1);
+    testSendBytes(flags, 2, 0);
+
+    memset(&ctx, 0, sizeof(ctx));
+    AX25_statsInit(&stats);
+    AX25_rxSetStats_r(&ctx, &stats);
+    AX25_rxInitCfg_r(&ctx);
+    for(j=0; j<nbLineBits; j++) {
+      if(!AX25_analyzeNextBit_r(&ctx, buffer, (char) lineBits[j])) break;
+    }
+    TEST_CHECK(j < nbLineBits);
+    TEST_CHECK(!memcmp(buffer + 1, frame + 1, lengthFrame - 1));
+    AX25_statsSnapshot(&stats, &snapshot);
+#ifndef AX25_NO_STATS
+    TEST_CHECK(snapshot.counters[AX25_STAT_OVERSIZES] == 1);
+#endif
+  }
+}
+
+int main(void) {
+  static AX25_RxContext ctx;
+  unsigned long seed = 0x2545F491, i, j, n, nbErrors;
+  AX25_RxLine line;
+  uint64_t word;
+
+  for(i=0; i<sizeof(in); i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    in[i] = (unsigned char) (seed >> 16);
+  }
+  // Long runs of ones and zeros as well (flags, idle line).
+  memset(in + 100, 0xFF, 40);
+  memset(in + 300, 0x00, 40);
+  for(i=0; i<TEST_BITS; i++) {
+    if(refRxBit((char) testBit(in, i))) reference[i >> 3] |= (unsigned char) (1 << (i & 7));
+  }
+
+  // Bit by bit, with a context.
+  AX25_rxInitCfg_r(&ctx);
+  nbErrors = 0;
+  for(i=0; i<TEST_BITS; i++) {
+    if(AX25_rxBit_r(&ctx, (char) testBit(in, i)) != testBit(reference, i)) nbErrors++;
+  }
+  TEST_CHECK(nbErrors == 0);
+
+  // Words of 1 to 64 bits.
+  AX25_rxLineInit(&line);
+  nbErrors = 0;
+  for(i=0, n=1; i<TEST_BITS; i+=n, n=(n % 64) + 1) {
+    if(n > TEST_BITS - i) n = TEST_BITS - i;
+    word = 0;
+    for(j=0; j<n; j++) word |= (uint64_t) testBit(in, i + j) << j;
+    word = AX25_rxDecodeWord(&line, word, (unsigned int) n);
+    for(j=0; j<n; j++) {
+      if(((word >> j) & 1) != testBit(reference, i + j)) nbErrors++;
+    }
+    if(n < 64) TEST_CHECK((word >> n) == 0);
+  }
+  TEST_CHECK(nbErrors == 0);
+
+  // Buffers of any number of bytes, the last one partly used.
+  for(n=1; n<=41; n+=8) {
+    memset(out, 0, sizeof(out));
+    AX25_rxLineInit(&line);
+    for(i=0; i<TEST_BITS; i+=8*n) {
+      AX25_rxDecodeBits(&line, in + i / 8, out + i / 8, (TEST_BITS - i < 8 * n) ? TEST_BITS - i : 8 * n);
+    }
+    TEST_CHECK(!memcmp(out, reference, sizeof(out)));
+  }
+
+  // In place.
+  memcpy(out, in, sizeof(out));
+  AX25_rxLineInit(&line);
+  AX25_rxDecodeBits(&line, out, out, TEST_BITS);
+  TEST_CHECK(!memcmp(out, reference, sizeof(out)));
+
+  testOversize();
+  return TEST_END();
+}
@@ -0,0 +1,146 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_segment.c
+ * Segmentation : payloads cut into frames by the segmenter and put back
+ * together by the reassembler, with lost, repeated and late segments.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Segment.h"
+#include "test.h"
+
+#define TEST_TIMEOUT           1000  // ms
+
+static unsigned char payload[AX25_SEGMENT_MAX_PAYLOAD + 1];
+static char frames[AX25_SEGMENT_MAX][AX25_FRAME_MAX_SIZE];
+static unsigned int lengths[AX25_SEGMENT_MAX];
+static AX25_Reassembler reassembler;
+
+/*--------------------------------------------------------------------------*
+ * Frames of the first bytes of the payload, given in three fragments.
+ *
+ * RETURN:
+ * the number of frames (0 if the payload is refused).
+ *--------------------------------------------------------------------------*/
+static unsigned int testSegment(const AX25_FrameHeader *header, unsigned int length) {
+  AX25_Fragment fragments[3];
+  AX25_Segmenter segmenter;
+  unsigned int i, nbFrames;
+
+  fragments[0].data = payload;
+  fragments[0].length = length / 3;
+  fragments[1].data = payload + length / 3;
+  fragments[1].length = length / 2 - length / 3;
+  fragments[2].data = payload + length / 2;
+  fragments[2].length = length - length / 2;
+  nbFrames = AX25_segmenterInit(&segmenter, header, fragments, 3);
+  TEST_CHECK(nbFrames <= AX25_SEGMENT_MAX);
+  if(nbFrames > AX25_SEGMENT_MAX) return 0;
+  for(i=0; i<nbFrames; i++) {
+    lengths[i] = AX25_segmenterNext(&segmenter, frames[i]);
+    TEST_CHECK(lengths[i] > 0 && lengths[i] <= AX25_FRAME_MAX_SIZE);
+    TEST_CHECK(AX25_checkFrame(frames[i], (unsigned short) lengths[i], 0) == 0);
+  }
+  if(nbFrames) TEST_CHECK(AX25_segmenterNext(&segmenter, frames[0]) == 0);
+  return nbFrames;
+}
+
+/*--------------------------------------------------------------------------*
+ * Round trip : a payload of INFO_MAX_SIZE bytes or less is one frame that
+ * the reassembler leaves alone, a longer one comes back whole from the
+ * last segment.
+ *--------------------------------------------------------------------------*/
+static void testRoundTrip(const AX25_FrameHeader *header) {
+  static const unsigned int sizes[] = { 0, 1, 254, 255, 256, 257, 509, 510, 1000, AX25_SEGMENT_MAX_PAYLOAD };
+  const unsigned char *result;
+  unsigned int i, j, nbFrames, length;
+  unsigned char pid, status = AX25_SEGMENT_NONE;
+
+  AX25_reassemblerInit(&reassembler, TEST_TIMEOUT);
+  for(i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++) {
+    nbFrames = testSegment(header, sizes[i]);
+    TEST_CHECK(nbFrames == ((sizes[i] <= INFO_MAX_SIZE) ? 1 : (sizes[i] + INFO_MAX_SIZE - 1) / (INFO_MAX_SIZE - 1)));
+    if(sizes[i] <= INFO_MAX_SIZE) {
+      TEST_CHECK(nbFrames == 1 && lengths[0] == header->length + sizes[i] + 4);
+      TEST_CHECK(!memcmp(frames[0] + 1 + header->length, payload, sizes[i]));
+      TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[0], lengths[0], 0, &result, &length, &pid) == AX25_SEGMENT_NONE);
+      continue;
+    }
+    for(j=0; j<nbFrames; j++) {
+      TEST_CHECK((unsigned char) frames[j][header->length] == AX25_PID_SEGMENT);
+      status = AX25_reassemblerFrame(&reassembler, frames[j], lengths[j], j, &result, &length, &pid);
+      TEST_CHECK(status == ((j == nbFrames - 1) ? AX25_SEGMENT_COMPLETE : AX25_SEGMENT_PENDING));
+    }
+    if(status != AX25_SEGMENT_COMPLETE) continue;
+    TEST_CHECK(length == sizes[i] && !memcmp(result, payload, length));
+    TEST_CHECK(pid == header->bytes[header->length - 1]);
+  }
+  TEST_CHECK(reassembler.nbPayloads == 5 && reassembler.nbDropped == 0 && reassembler.nbTimeouts == 0);
+
+  // One byte too many.
+  TEST_CHECK(testSegment(header, AX25_SEGMENT_MAX_PAYLOAD + 1) == 0);
+}
+
+/*--------------------------------------------------------------------------*
+ * A lost or repeated segment drops the payload (and the segments after
+ * it), so does a segment coming after the timeout; the next payload from
+ * the same station is still reassembled.
+ *--------------------------------------------------------------------------*/
+static void testLost(const AX25_FrameHeader *header) {
+  const unsigned char *result;
+  unsigned int nbFrames, length;
+  unsigned char pid;
+
+  AX25_reassemblerInit(&reassembler, TEST_TIMEOUT);
+  nbFrames = testSegment(header, 1000);
+  TEST_CHECK(nbFrames == 4);
+  if(nbFrames != 4) return;
+
+  // Lost segment.
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[0], lengths[0], 0, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[2], lengths[2], 1, &result, &length, &pid) == AX25_SEGMENT_DROPPED);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[3], lengths[3], 2, &result, &length, &pid) == AX25_SEGMENT_DROPPED);
+  TEST_CHECK(reassembler.nbDropped == 3);
+
+  // Repeated segment.
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[0], lengths[0], 3, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[1], lengths[1], 4, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[1], lengths[1], 5, &result, &length, &pid) == AX25_SEGMENT_DROPPED);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[2], lengths[2], 6, &result, &length, &pid) == AX25_SEGMENT_DROPPED);
+  TEST_CHECK(reassembler.nbDropped == 6);
+
+  // First segment repeated : the payload starts again.
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[0], lengths[0], 7, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[0], lengths[0], 8, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(reassembler.nbDropped == 7);
+
+  // Late segment.
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[1], lengths[1], 9 + TEST_TIMEOUT, &result, &length, &pid) == AX25_SEGMENT_DROPPED);
+  TEST_CHECK(reassembler.nbTimeouts == 1 && reassembler.nbPayloads == 0);
+
+  // Whole payload.
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[0], lengths[0], 2000, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[1], lengths[1], 2001, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[2], lengths[2], 2002, &result, &length, &pid) == AX25_SEGMENT_PENDING);
+  TEST_CHECK(AX25_reassemblerFrame(&reassembler, frames[3], lengths[3], 2003, &result, &length, &pid) == AX25_SEGMENT_COMPLETE);
+  TEST_CHECK(length == 1000 && !memcmp(result, payload, length) && reassembler.nbPayloads == 1);
+}
+
+int main(void) {
+  AX25_Address destination, source;
+  AX25_FrameHeader header;
+  unsigned int i;
+
+  AX25_crcInitEngine();
+  for(i=0; i<sizeof(payload); i++) payload[i] = (unsigned char) (i * 7 + i / 251);
+  AX25_addressParse(&destination, "ON4ULG");
+  AX25_addressParse(&source, "OUFTI1");
+  AX25_headerInit(&header, &destination, &source, NULL, 0, 0x03, 0xF0);
+  testRoundTrip(&header);
+  testLost(&header);
+  return TEST_END();
+}
@@ -0,0 +1,172 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_tnc.c
+ * Software TNC : two KISS clients (pseudo-terminals) on a looped back
+ * port. Every frame sent by a client comes back to both of them, byte for
+ * byte, and the counters of the TNC and of the port match. With the
+ * digipeater, a WIDE2-2 frame is repeated on the port while it is being
+ * received : the repeated frame is received intact, after it, and is a
+ * duplicate.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AX25_Frame.h"
+#include "AX25_KISS.h"
+#include "AX25_TNC.h"
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_FRAMES            24
+#define TEST_CLIENTS           2
+#define TEST_MAX_BYTES         ((TEST_FRAMES + 2) * (2 * AX25_FRAME_MAX_SIZE + 4))
+#define TEST_MAX_TURNS         500   // Turns of the TNC waiting for the clients.
+
+// Bytes read by a client (the slave of its pseudo-terminal) and expected.
+typedef struct {
+  int fd;
+  unsigned long nbRead;
+  unsigned char read[TEST_MAX_BYTES];
+} TestClient;
+
+static TestClient clients[TEST_CLIENTS];
+static unsigned char expected[TEST_MAX_BYTES];
+static unsigned long nbExpected;
+
+/*--------------------------------------------------------------------------*
+ * Turns of the TNC until every client has read the bytes expected.
+ *
+ * RETURN:
+ * 1 if they did, 0 otherwise (timeout).
+ *--------------------------------------------------------------------------*/
+static char testRun(AX25_Tnc *tnc) {
+  unsigned int turn, c, nbDone;
+  ssize_t n;
+
+  for(turn=0; turn<TEST_MAX_TURNS; turn++) {
+    if(AX25_tncRun(tnc, 10) < 0) return 0;
+    nbDone = 0;
+    for(c=0; c<TEST_CLIENTS; c++) {
+      while(clients[c].nbRead < TEST_MAX_BYTES
+            && (n = read(clients[c].fd, clients[c].read + clients[c].nbRead, TEST_MAX_BYTES - clients[c].nbRead)) > 0) {
+        clients[c].nbRead += (unsigned long) n;
+      }
+      if(clients[c].nbRead >= nbExpected) nbDone++;
+    }
+    if(nbDone == TEST_CLIENTS) return 1;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * A frame (flags and FCS included) sent in KISS by a client on a port.
+ *--------------------------------------------------------------------------*/
+static void testSend(unsigned int client, unsigned char port, const char *frame, unsigned int lengthFrame) {
+  unsigned char kiss[2 * AX25_FRAME_MAX_SIZE + 4];
+  unsigned long n;
+
+  n = AX25_kissEncode(port, AX25_KISS_DATA, (const unsigned char *) frame + 1, lengthFrame - 4, kiss);
+  TEST_CHECK(write(clients[client].fd, kiss, n) == (ssize_t) n);
+}
+
+/*--------------------------------------------------------------------------*
+ * A frame received by the clients, as the TNC gives it (port 0).
+ *--------------------------------------------------------------------------*/
+static void testExpect(const char *frame, unsigned int lengthFrame) {
+  nbExpected += AX25_kissEncode(0, AX25_KISS_DATA, (const unsigned char *) frame + 1, lengthFrame - 4,
+                                expected + nbExpected);
+}
+
+int main(void) {
+  char name[64], info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE];
+  unsigned int f, c, i, length, lengthFrame;
+  AX25_Address call, destination, source, wide;
+  AX25_FrameHeader header;
+  AX25_StatsSnapshot snapshot;
+  AX25_DigiStats digiStats;
+  AX25_TncStats stats;
+  AX25_Digi *digi;
+  AX25_Tnc *tnc;
+
+  tnc = AX25_tncCreate();
+  TEST_CHECK(tnc != NULL);
+  if(!tnc) return TEST_END();
+  TEST_CHECK(AX25_tncAddPort(tnc, -1, -1) == 0);
+  for(c=0; c<TEST_CLIENTS; c++) {
+    clients[c].fd = -1;
+    TEST_CHECK(AX25_tncOpenPty(tnc, name, sizeof(name)) == 0);
+    clients[c].fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    TEST_CHECK(clients[c].fd >= 0);
+  }
+  if(clients[0].fd < 0 || clients[1].fd < 0) {
+    AX25_tncDestroy(tnc);
+    return TEST_END();
+  }
+
+  // Frames of every size, some full of ones (stuffed bits), sent by both
+  // clients in turn.
+  for(f=0; f<TEST_FRAMES; f++) {
+    length = (f * 67) % (INFO_MAX_SIZE + 1);
+    for(i=0; i<length; i++) info[i] = (f % 3 == 2) ? (char) 0xFF : (char) (f * 31 + i * 7);
+    lengthFrame = AX25_buildUIFrame(frame, info, length);
+    testSend(f % TEST_CLIENTS, 0, frame, lengthFrame);
+    testExpect(frame, lengthFrame);
+    TEST_CHECK(testRun(tnc));
+  }
+  // Unknown port : not sent.
+  testSend(0, 5, frame, lengthFrame);
+  TEST_CHECK(testRun(tnc));
+
+  // Digipeater : the clients get the WIDE2-2 frame once, as it was sent.
+  AX25_addressParse(&call, "TEST");
+  digi = AX25_tncEnableDigi(tnc, &call, 64, 0);
+  TEST_CHECK(digi != NULL);
+  if(digi) AX25_digiSetWide(digi, "WIDE", 2);
+  AX25_addressParse(&destination, "APRS");
+  AX25_addressParse(&source, "ON0UL-1");
+  AX25_addressParse(&wide, "WIDE2-2");
+  TEST_CHECK(AX25_headerInit(&header, &destination, &source, &wide, 1, 0x03, 0xF0));
+  lengthFrame = AX25_frameBuild(&header, frame, info, 100);
+  testSend(1, 0, frame, lengthFrame);
+  testExpect(frame, lengthFrame);
+  TEST_CHECK(testRun(tnc));
+
+  for(c=0; c<TEST_CLIENTS; c++) {
+    TEST_CHECK(clients[c].nbRead == nbExpected);
+    TEST_CHECK(!memcmp(clients[c].read, expected, nbExpected));
+  }
+
+  AX25_tncGetStats(tnc, &stats);
+  TEST_CHECK(stats.nbClients == TEST_CLIENTS);
+  TEST_CHECK(stats.nbRxFrames == TEST_FRAMES + 1);
+  TEST_CHECK(stats.nbTxFrames == TEST_FRAMES + 2);
+  TEST_CHECK(stats.nbClientDrops == 0);
+  TEST_CHECK(stats.nbTxDrops == 1);
+  if(digi) {
+    AX25_digiGetStats(digi, &digiStats);
+    TEST_CHECK(digiStats.nbFrames == 2 && digiStats.nbRepeated == 1 && digiStats.nbDuplicates == 1);
+    TEST_CHECK(digiStats.nbInvalid == 0 && digiStats.nbGated == 1);
+  }
+
+  // The counters of the codec : every frame sent is received with a good
+  // FCS, the repeated one included, and nothing else.
+  TEST_CHECK(!AX25_tncGetPortStats(tnc, 1, &snapshot));
+  TEST_CHECK(AX25_tncGetPortStats(tnc, 0, &snapshot));
+#ifndef AX25_NO_STATS
+  TEST_CHECK(snapshot.counters[AX25_STAT_TX_FRAMES] == TEST_FRAMES + 2);
+  TEST_CHECK(snapshot.counters[AX25_STAT_FCS_OK] == TEST_FRAMES + 2);
+  TEST_CHECK(snapshot.counters[AX25_STAT_DELIVERED] == TEST_FRAMES + 2);
+  TEST_CHECK(snapshot.counters[AX25_STAT_FCS_BAD] == 0 && snapshot.counters[AX25_STAT_FCS_FIXED] == 0);
+  TEST_CHECK(snapshot.counters[AX25_STAT_ABORTS] == 0);
+  TEST_CHECK(snapshot.counters[AX25_STAT_OVERSIZES] == 0 && snapshot.counters[AX25_STAT_OVERRUNS] == 0);
+  TEST_CHECK(snapshot.counters[AX25_STAT_STUFF_REMOVED] == snapshot.counters[AX25_STAT_STUFF_INSERTED]);
+#endif
+
+  for(c=0; c<TEST_CLIENTS; c++) close(clients[c].fd);
+  AX25_tncDestroy(tnc);
+  return TEST_END();
+}
@@ -0,0 +1,183 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * test_tx.c
+ * Transmit line encoder : the bulk encoders (AX25_txEncodeFrame and
+ * AX25_txEncodeBurst) against the bit by bit state machines
+ * (AX25_prepareNextBitToSend and AX25_prepareNextBurstBit_r), and
+ * AX25_txBit against the original bit by bit encoder.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "AX25_Tx.h"
+#include "test.h"
+
+#define TEST_BITS              (16 * 1024 + 5)
+#define TEST_MAX_BITS          (8 * (AX25_FRAME_MAX_SIZE + 16) * 2)
+#define TEST_BURST_FRAMES      6
+#define TEST_BURST_MAX_BITS    (TEST_BURST_FRAMES * TEST_MAX_BITS)
+
+/*--------------------------------------------------------------------------*
+ * Original AX25_txBit (NRZI encoding, then scrambler register shifted to
+ * the left, S(x) = x17 + x12 + 1), the reference of the line encoder.
+ *--------------------------------------------------------------------------*/
+static unsigned char refLastBit;
+static unsigned long refShiftRegister;
+
+static char refTxBit(char bit) {
+  char feedback, bitToSend;
+
+  feedback = ((refShiftRegister >> 11) & 1) ^ ((refShiftRegister >> 16) & 1);
+  if(!bit) refLastBit ^= 1;  // A 0 makes a transition.
+  bitToSend = (char) (refLastBit ^ feedback);
+  refShiftRegister <<= 1;
+  if(feedback ^ refLastBit ^ 1) refShiftRegister |= 1;
+  return bitToSend;
+}
+
+static unsigned char testBit(const unsigned char *bits, unsigned long i) {
+  return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bits of a frame sent by the bit by bit state machine (the frame is
+ * modified by the state machine, it is sent from a copy).
+ *
+ * RETURN:
+ * the number of bits.
+ *--------------------------------------------------------------------------*/
+static unsigned long testStateMachine(const char *frame, unsigned int lengthFrame, unsigned int nbDelayFlags,
+                                      unsigned int nbTailFlags, unsigned char *bits) {
+  static AX25_TxContext ctx;
+  char copy[AX25_FRAME_MAX_SIZE];
+  unsigned long nbBits = 0;
+  char running;
+
+  memcpy(copy, frame, lengthFrame);
+  memset(bits, 0, TEST_MAX_BITS / 8);
+  AX25_txSetTiming_r(&ctx, nbDelayFlags, nbTailFlags);
+  AX25_txInitCfg_r(&ctx);
+  ctx.lengthFrame = lengthFrame;
+  do {
+    running = AX25_prepareNextBitToSend_r(&ctx, copy);
+    if(nbBits < TEST_MAX_BITS && ctx.bitToSend) bits[nbBits >> 3] |= (unsigned char) (1 << (nbBits & 7));
+    nbBits++;
+  } while(running);
+  return nbBits;
+}
+
+/*--------------------------------------------------------------------------*
+ * Frames of every length, full of ones (bit stuffing) or random, sent by
+ * the bulk encoder and by the state machine.
+ *--------------------------------------------------------------------------*/
+static void testFrames(void) {
+  static unsigned char expected[TEST_MAX_BITS / 8], bits[TEST_MAX_BITS / 8];
+  char info[INFO_MAX_SIZE], frame[AX25_FRAME_MAX_SIZE], copy[AX25_FRAME_MAX_SIZE];
+  unsigned int i, length, lengthFrame, nbDelayFlags, nbTailFlags;
+  unsigned long seed = 0x9E3779B9, nbBits, nbExpected;
+  AX25_TxLine line;
+
+  for(length=0; length<=INFO_MAX_SIZE; length+=(length < 40) ? 1 : 23) {
+    for(i=0; i<length; i++) {
+      seed = seed * 1103515245UL + 12345UL;
+      info[i] = (length % 3) ? (char) (seed >> 16) : (char) 0xFF;  // Every third frame : ones only.
+    }
+    lengthFrame = AX25_buildUIFrame(frame, info, length);
+    nbDelayFlags = 1 + length % 7;
+    nbTailFlags = 1 + length % 3;
+    nbExpected = testStateMachine(frame, lengthFrame, nbDelayFlags, nbTailFlags, expected);
+
+    memcpy(copy, frame, lengthFrame);
+    memset(bits, 0, sizeof(bits));
+    AX25_txLineInit(&line);
+    nbBits = AX25_txEncodeFrame(&line, frame, lengthFrame, nbDelayFlags, nbTailFlags, bits);
+    TEST_CHECK(nbBits == nbExpected);
+    TEST_CHECK((nbBits + 7) / 8 <= AX25_txEncodedSize(lengthFrame, nbDelayFlags, nbTailFlags));
+    TEST_CHECK(!memcmp(bits, expected, (nbBits + 7) / 8));
+    TEST_CHECK(!memcmp(frame, copy, lengthFrame));  // The frame is left as it is.
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Bursts of 1 to TEST_BURST_FRAMES frames sent by the bulk encoder and by
+ * the burst state machine. A burst of one frame is also the frame sent by
+ * AX25_prepareNextBitToSend.
+ *--------------------------------------------------------------------------*/
+static void testBursts(void) {
+  static char frames[TEST_BURST_FRAMES][AX25_FRAME_MAX_SIZE];
+  static unsigned char expected[TEST_BURST_MAX_BITS / 8], bits[TEST_BURST_MAX_BITS / 8];
+  static AX25_TxContext ctx;
+  AX25_TxFrame burst[TEST_BURST_FRAMES];
+  char info[INFO_MAX_SIZE];
+  unsigned int i, j, nbFrames, length;
+  unsigned long seed = 0x6A09E667, nbBits, nbExpected;
+  AX25_TxLine line;
+  char running;
+
+  for(i=0; i<TEST_BURST_FRAMES; i++) {
+    length = 17 + 41 * i;  // Odd frames : ones only.
+    for(j=0; j<length; j++) {
+      seed = seed * 1103515245UL + 12345UL;
+      info[j] = (i & 1) ? (char) 0xFF : (char) (seed >> 16);
+    }
+    burst[i].frame = frames[i];
+    burst[i].lengthFrame = AX25_buildUIFrame(frames[i], info, length);
+  }
+
+  for(nbFrames=1; nbFrames<=TEST_BURST_FRAMES; nbFrames++) {
+    memset(expected, 0, sizeof(expected));
+    AX25_txSetTiming_r(&ctx, 2 + nbFrames, nbFrames);
+    AX25_txInitBurst_r(&ctx, burst, nbFrames);
+    nbExpected = 0;
+    do {  // The last bit is sent with a 0.
+      running = AX25_prepareNextBurstBit_r(&ctx);
+      if(nbExpected < TEST_BURST_MAX_BITS && ctx.bitToSend) {
+        expected[nbExpected >> 3] |= (unsigned char) (1 << (nbExpected & 7));
+      }
+      nbExpected++;
+    } while(running);
+    TEST_CHECK(ctx.txMode == TX_OFF && !AX25_prepareNextBurstBit_r(&ctx));
+
+    memset(bits, 0, sizeof(bits));
+    AX25_txLineInit(&line);
+    nbBits = AX25_txEncodeBurst(&line, burst, nbFrames, 2 + nbFrames, nbFrames, bits);
+    TEST_CHECK(nbBits == nbExpected);
+    TEST_CHECK((nbBits + 7) / 8 <= AX25_txBurstEncodedSize(burst, nbFrames, 2 + nbFrames, nbFrames));
+    TEST_CHECK(!memcmp(bits, expected, (nbBits + 7) / 8));
+
+    if(nbFrames == 1) {
+      nbExpected = testStateMachine(frames[0], burst[0].lengthFrame, 3, 1, expected);
+      TEST_CHECK(nbBits == nbExpected && !memcmp(bits, expected, (nbBits + 7) / 8));
+    }
+  }
+
+  // Empty burst.
+  AX25_txInitBurst_r(&ctx, burst, 0);
+  TEST_CHECK(!AX25_prepareNextBurstBit_r(&ctx));
+}
+
+int main(void) {
+  static unsigned char in[(TEST_BITS + 7) / 8];
+  static AX25_TxContext ctx;
+  unsigned long seed = 0x2545F491, i, nbErrors = 0;
+
+  // Line encoder, bit by bit.
+  for(i=0; i<sizeof(in); i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    in[i] = (unsigned char) (seed >> 16);
+  }
+  memset(in + 50, 0xFF, 20);
+  memset(in + 150, 0x00, 20);
+  AX25_txInitCfg_r(&ctx);
+  for(i=0; i<TEST_BITS; i++) {
+    AX25_txBit_r(&ctx, (char) testBit(in, i));
+    if(ctx.bitToSend != refTxBit((char) testBit(in, i))) nbErrors++;
+  }
+  TEST_CHECK(nbErrors == 0);
+
+  testFrames();
+  testBursts();
+  return TEST_END();
+}
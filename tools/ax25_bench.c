@@ -0,0 +1,636 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * ax25_bench.c
+ * Benchmarks of the FCS, of the Tx encoding and of the Rx decoding, from
+ * the per-bit state machines to the bulk paths and the codecs of the
+ * modem profiles, of the digipeater and of FX.25 (encoder and
+ * Reed-Solomon decoder).
+ *
+ *   ax25_bench [-j] [-t seconds] [-p payloads] [-f filter]
+ *
+ * -j            JSON output (one object, for the regression tracking).
+ * -t            min time of a measure (0.2 s by default).
+ * -p            sizes of the info field, separated by commas
+ *               (0,16,64,128,256 by default, INFO_MAX_SIZE at most).
+ * -f            only the benchmarks whose name contains the filter.
+ *
+ * The data is the same at every run (fixed seed). Every measure is done
+ * three times and the fastest one is kept. The bits are the bits on the
+ * air (flags and stuffed bits included) for the Tx and Rx benchmarks and
+ * the bytes under the FCS for the CRC ones, the bytes of the frames for
+ * digi_input and the bytes of the codeword for rs_decode. The fx25
+ * benchmarks are skipped when the frame does not fit in a codeword. The
+ * cycles are read with the time stamp counter (x86 only) : they are
+ * reference cycles, not the cycles of the core when its frequency changes.
+ *
+ * The FCS engines are checked against each other before the run (see
+ * AX25_crcSelfTest). Every benchmark checks its result, at every run : a
+ * wrong FCS or a frame not decoded stops the run with an error. The CRC
+ * benchmarks give the engine chosen at startup back to the other ones.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BENCH_TSC            1
+#else
+#define BENCH_TSC            0
+#endif
+
+#include "AX25_CRC.h"
+#include "AX25_Digi.h"
+#include "AX25_FX25.h"
+#include "AX25_Profile.h"
+#include "AX25_RS.h"
+#include "AX25_Stream.h"
+#include "AX25_Tx.h"
+
+#define BENCH_MAX_PAYLOADS   16
+#define BENCH_REPEATS        3
+#define BENCH_DELAY_FLAGS    4     // Flags before a frame (Rx and Tx).
+#define BENCH_TAIL_FLAGS     1
+#define BENCH_BURST          64    // Frames of the stream of rx_stream.
+#define BENCH_RING_SIZE      16
+
+// One benchmark : n frames processed (a multiple of BENCH_BURST), the bits
+// counted in *bits.
+typedef struct {
+  const char *name;
+  unsigned char engine;        // FCS engine (crc), modem profile (profile) or check bytes (fx25, rs).
+  char (*run)(unsigned char engine, unsigned long n, unsigned long long *bits);
+} BenchCase;
+
+// Data of the current payload size.
+static unsigned int payload;
+static char info[INFO_MAX_SIZE];
+static char frame[AX25_FRAME_MAX_SIZE];
+static unsigned int lengthFrame;
+static unsigned char *txBits;          // Legacy Tx bits, one per byte.
+static unsigned long nbTxBits;
+static unsigned char *encoded;         // Frame encoded by AX25_txEncodeFrame, packed.
+static unsigned long nbEncodedBits;
+static unsigned char *burst;           // Bulk encoded frames, packed.
+static unsigned long nbBurstBits;
+static AX25_FrameSlot slots[BENCH_RING_SIZE];
+static unsigned char *profileBursts[AX25_PROFILE_COUNT];  // Frames encoded for each profile.
+static unsigned long nbProfileBits[AX25_PROFILE_COUNT];
+static char digiFrame[AX25_FRAME_MAX_SIZE];  // Frame with a WIDE2-2 path.
+static unsigned int lengthDigiFrame;
+static char fx25Fits;                  // The frame fits in an FX.25 codeword.
+static volatile unsigned short sink;
+
+/*--------------------------------------------------------------------------*
+ * Time in seconds and time stamp counter.
+ *--------------------------------------------------------------------------*/
+static double benchTime(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static unsigned long long benchCycles(void) {
+#if BENCH_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static unsigned char benchBit(const unsigned char *bits, unsigned long i) {
+  return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * FCS of the frame with one engine.
+ *--------------------------------------------------------------------------*/
+static char benchCrc(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  unsigned short crc = 0;
+  unsigned long i;
+
+  AX25_crcSetEngine(engine);
+  for(i=0; i<n; i++) crc ^= AX25_computeCRC(frame, (unsigned short) lengthFrame);
+  sink = crc;
+  *bits = 8ULL * (lengthFrame - 4) * n;
+  return AX25_checkFrame(frame, (unsigned short) lengthFrame, 0) == 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Preparation of the frame (header, info field, FCS and flags).
+ *--------------------------------------------------------------------------*/
+static char benchTxPrepare(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  char buffer[AX25_FRAME_MAX_SIZE];
+  unsigned long i;
+
+  (void) engine;
+  for(i=0; i<n; i++) {
+    AX25_prepareUIFrame(buffer, info, payload);
+    sink ^= (unsigned short) buffer[payload + 16];
+  }
+  *bits = 8ULL * lengthFrame * n;
+  return !memcmp(buffer, frame, lengthFrame);
+}
+
+/*--------------------------------------------------------------------------*
+ * Legacy Tx state machine, one bit at a time (the frame is copied since
+ * the state machine consumes its buffer).
+ *--------------------------------------------------------------------------*/
+static char benchTxBits(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  static AX25_TxContext ctx;
+  char buffer[AX25_FRAME_MAX_SIZE];
+  unsigned long long count = 0;
+  unsigned long i, j;
+  char ok = 1;
+
+  (void) engine;
+  AX25_txSetTiming_r(&ctx, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS);
+  for(i=0; i<n; i++) {
+    memcpy(buffer, frame, lengthFrame);
+    AX25_txInitCfg_r(&ctx);
+    ctx.lengthFrame = lengthFrame;
+    j = 0;
+    while(AX25_prepareNextBitToSend_r(&ctx, buffer)) {
+      if(j < nbTxBits && ctx.bitToSend != txBits[j]) ok = 0;
+      j++;
+    }
+    count += j + 1;
+  }
+  *bits = count;
+  return ok;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bulk Tx encoder (bit stuffing, NRZI and scrambling by words). The bits
+ * of the last frame are the bits of the legacy Tx state machine.
+ *--------------------------------------------------------------------------*/
+static char benchTxEncode(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  unsigned char out[2 * AX25_FRAME_MAX_SIZE + BENCH_DELAY_FLAGS + BENCH_TAIL_FLAGS];
+  unsigned long long count = 0;
+  unsigned long i, nbBits = 0;
+  AX25_TxLine line;
+
+  (void) engine;
+  for(i=0; i<n; i++) {
+    AX25_txLineInit(&line);
+    nbBits = AX25_txEncodeFrame(&line, frame, lengthFrame, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS, out);
+    count += nbBits;
+    sink ^= out[0];
+  }
+  *bits = count;
+  if(nbBits != nbTxBits) return 0;
+  for(i=0; i<nbBits; i++) {
+    if(((out[i >> 3] >> (i & 7)) & 1) != txBits[i]) return 0;
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Legacy Rx state machine, one bit at a time, on the bits of the legacy
+ * Tx state machine.
+ *--------------------------------------------------------------------------*/
+static char benchRxBits(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  static AX25_RxContext ctx;
+  char buffer[AX25_FRAME_MAX_SIZE];
+  unsigned long long count = 0;
+  unsigned long i, j;
+  char ok = 1;
+
+  (void) engine;
+  for(i=0; i<n; i++) {
+    memset(&ctx, 0, sizeof(ctx));  // Descrambler in the state of the Tx one.
+    AX25_rxInitCfg_r(&ctx);
+    for(j=0; j<nbTxBits; j++) {
+      if(!AX25_analyzeNextBit_r(&ctx, buffer, (char) txBits[j])) break;
+    }
+    if(j == nbTxBits || memcmp(buffer + 1, frame + 1, lengthFrame - 1)) ok = 0;
+    count += j + 1;
+  }
+  *bits = count;
+  return ok;
+}
+
+/*--------------------------------------------------------------------------*
+ * Streaming receiver on a burst of frames separated by one flag.
+ *--------------------------------------------------------------------------*/
+static char benchRxStream(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  unsigned long long count = 0;
+  unsigned long i, nbFrames = 0, nbGood = 0;
+  unsigned long offset, size;
+
+  (void) engine;
+  AX25_ringInit(&ring, slots, BENCH_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  for(i=0; i<n; i+=BENCH_BURST) {
+    // Pieces too short to fill the ring.
+    for(offset=0; offset<nbBurstBits; offset+=size) {
+      size = 8UL * (AX25_FRAME_MIN_SIZE - 1) * (BENCH_RING_SIZE - 2);
+      if(size > nbBurstBits - offset) size = nbBurstBits - offset;
+      AX25_rxStreamBits(&stream, burst + offset / 8, size);
+      while((slot = AX25_ringPeek(&ring)) != NULL) {
+        nbFrames++;
+        if(slot->status == AX25_FRAME_FCS_OK && slot->lengthFrame == lengthFrame) nbGood++;
+        AX25_ringRelease(&ring);
+      }
+    }
+    count += nbBurstBits;
+  }
+  *bits = count;
+  return nbFrames == n && nbGood == n;
+}
+
+/*--------------------------------------------------------------------------*
+ * Encoder of a modem profile (see AX25_Profile.hpp). The bits of the last
+ * frame are the bits of AX25_txEncodeFrame, descrambled for a profile
+ * without scrambler (x17 + x12 + 1, register set to ones by
+ * AX25_txLineInit).
+ *--------------------------------------------------------------------------*/
+static char benchTxProfile(unsigned char profile, unsigned long n, unsigned long long *bits) {
+  unsigned char out[2 * AX25_FRAME_MAX_SIZE + BENCH_DELAY_FLAGS + BENCH_TAIL_FLAGS];
+  const AX25_ProfileInfo *profileInfo = AX25_profileInfo(profile);
+  unsigned long long count = 0;
+  unsigned long i, nbBits = 0;
+  AX25_ProfileTx tx;
+  unsigned char bit;
+
+  for(i=0; i<n; i++) {
+    AX25_profileTxInit(&tx, profile);
+    nbBits = AX25_profileTxEncodeFrame(&tx, frame, lengthFrame, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS, out);
+    count += nbBits;
+    sink ^= out[0];
+  }
+  *bits = count;
+  if(nbBits != nbEncodedBits || profileInfo->msbFirst) return 0;
+  for(i=0; i<nbBits; i++) {
+    bit = benchBit(encoded, i);
+    if(!profileInfo->scrambled) {
+      bit ^= (i >= 12) ? benchBit(encoded, i - 12) : 1;
+      bit ^= (i >= 17) ? benchBit(encoded, i - 17) : 1;
+    }
+    if(benchBit(out, i) != bit) return 0;
+  }
+  return 1;
+}
+
+// Frames received by rx_profile.
+typedef struct {
+  unsigned long nbFrames;
+  unsigned long nbGood;
+} BenchProfileFrames;
+
+static void benchProfileHandler(void *user, const char *frame, unsigned int length, unsigned char status) {
+  BenchProfileFrames *frames = (BenchProfileFrames *) user;
+
+  (void) frame;
+  frames->nbFrames++;
+  if(status == AX25_FRAME_FCS_OK && length == lengthFrame) frames->nbGood++;
+}
+
+/*--------------------------------------------------------------------------*
+ * Receiver of a modem profile on BENCH_BURST frames of the profile.
+ *--------------------------------------------------------------------------*/
+static char benchRxProfile(unsigned char profile, unsigned long n, unsigned long long *bits) {
+  BenchProfileFrames frames = { 0, 0 };
+  unsigned long long count = 0;
+  AX25_ProfileRx rx;
+  unsigned long i;
+
+  AX25_profileRxInit(&rx, profile, benchProfileHandler, &frames);
+  for(i=0; i<n; i+=BENCH_BURST) {
+    AX25_profileRxBits(&rx, profileBursts[profile], nbProfileBits[profile]);
+    count += nbProfileBits[profile];
+  }
+  *bits = count;
+  return frames.nbFrames == n && frames.nbGood == n;
+}
+
+static void benchDigiTx(void *user, unsigned int channel, const char *frame, unsigned int length) {
+  (void) channel;
+  (*(unsigned long *) user)++;
+  sink ^= (unsigned short) frame[length - 2];
+}
+
+/*--------------------------------------------------------------------------*
+ * Digipeater : every frame is received twice, the first copy is repeated
+ * (WIDE2-2 -> BENCH*,WIDE2-1) and the second one is a duplicate. The clock
+ * jumps over the window between the pairs, so every pair expires a key.
+ *--------------------------------------------------------------------------*/
+static char benchDigiInput(unsigned char engine, unsigned long n, unsigned long long *bits) {
+  AX25_Address call = { "BENCH", 0, 0 };
+  unsigned long nbSent = 0, i;
+  AX25_DigiStats stats;
+  AX25_Digi *digi;
+
+  (void) engine;
+  digi = AX25_digiCreate(&call, 4096, 1000, benchDigiTx, NULL, &nbSent);
+  if(!digi) return 0;
+  AX25_digiSetWide(digi, "WIDE", 2);
+  for(i=0; i<n; i++) AX25_digiInput(digi, 0, digiFrame, lengthDigiFrame, 1 + 1000 * (i / 2));
+  AX25_digiGetStats(digi, &stats);
+  AX25_digiDestroy(digi);
+  *bits = 8ULL * lengthDigiFrame * n;
+  return stats.nbRepeated == n / 2 && stats.nbDuplicates == n / 2 && nbSent == n / 2;
+}
+
+/*--------------------------------------------------------------------------*
+ * FX.25 encoder with nbCheck check bytes (tag, codeword and line
+ * encoding). The last frame encoded is received by an FX.25 stream.
+ *--------------------------------------------------------------------------*/
+static char benchFx25Encode(unsigned char nbCheck, unsigned long n, unsigned long long *bits) {
+  unsigned char out[AX25_RS_SIZE + 8 + BENCH_DELAY_FLAGS + BENCH_TAIL_FLAGS];
+  unsigned long long count = 0;
+  unsigned long i, nbBits = 0;
+  unsigned int nbFrames = 0, nbGood = 0;
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  AX25_TxLine line;
+
+  for(i=0; i<n; i++) {
+    AX25_txLineInit(&line);
+    nbBits = AX25_fx25EncodeFrame(&line, frame, lengthFrame, nbCheck, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS, out);
+    count += nbBits;
+    sink ^= out[0];
+  }
+  *bits = count;
+  if(!nbBits) return 0;
+
+  AX25_ringInit(&ring, slots, BENCH_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetFx25(&stream, 1);
+  AX25_rxStreamBits(&stream, out, nbBits);
+  while((slot = AX25_ringPeek(&ring)) != NULL) {
+    nbFrames++;
+    if(slot->status == AX25_FRAME_FCS_OK && slot->lengthFrame == lengthFrame) nbGood++;
+    AX25_ringRelease(&ring);
+  }
+  return nbFrames == 1 && nbGood == 1 && stream.nbFx25Codewords == 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Reed-Solomon decoder : a codeword of 255 bytes with nbCheck check bytes
+ * and nbCheck / 2 wrong bytes, corrected from a copy at every frame. The
+ * bits are the bits of the codeword.
+ *--------------------------------------------------------------------------*/
+static char benchRsDecode(unsigned char nbCheck, unsigned long n, unsigned long long *bits) {
+  unsigned char original[AX25_RS_SIZE], received[AX25_RS_SIZE], codeword[AX25_RS_SIZE];
+  unsigned int k = AX25_RS_SIZE - nbCheck, j;
+  unsigned long i;
+  char ok = 1;
+
+  for(j=0; j<AX25_RS_SIZE; j++) original[j] = (unsigned char) info[j % INFO_MAX_SIZE] ^ (unsigned char) j;
+  AX25_rsEncode(original, k, original + k, nbCheck);
+  memcpy(received, original, AX25_RS_SIZE);
+  for(j=0; j<nbCheck/2; j++) received[(j * 97 + 3) % AX25_RS_SIZE] ^= (unsigned char) (j + 1);  // Distinct positions.
+
+  for(i=0; i<n; i++) {
+    memcpy(codeword, received, AX25_RS_SIZE);
+    if(AX25_rsDecode(codeword, AX25_RS_SIZE, nbCheck) != nbCheck / 2) ok = 0;
+    sink ^= codeword[0];
+  }
+  *bits = 8ULL * AX25_RS_SIZE * n;
+  return ok && !memcmp(codeword, original, AX25_RS_SIZE);
+}
+
+static const BenchCase benchCases[] = {
+  { "crc_bitwise", AX25_CRC_BITWISE, benchCrc },
+  { "crc_table",   AX25_CRC_TABLE,   benchCrc },
+  { "crc_slice8",  AX25_CRC_SLICE8,  benchCrc },
+  { "crc_clmul",   AX25_CRC_CLMUL,   benchCrc },
+  { "tx_prepare",  0, benchTxPrepare },
+  { "tx_bits",     0, benchTxBits },
+  { "tx_encode",   0, benchTxEncode },
+  { "rx_bits",     0, benchRxBits },
+  { "rx_stream",   0, benchRxStream },
+  { "tx_profile_g3ruh9600", AX25_PROFILE_G3RUH_9600, benchTxProfile },
+  { "tx_profile_afsk1200",  AX25_PROFILE_AFSK_1200,  benchTxProfile },
+  { "rx_profile_g3ruh9600", AX25_PROFILE_G3RUH_9600, benchRxProfile },
+  { "rx_profile_afsk1200",  AX25_PROFILE_AFSK_1200,  benchRxProfile },
+  { "digi_input",  0, benchDigiInput },
+  { "fx25_encode16", 16, benchFx25Encode },
+  { "fx25_encode64", 64, benchFx25Encode },
+  { "rs_decode16",   16, benchRsDecode },
+  { "rs_decode64",   64, benchRsDecode },
+};
+
+/*--------------------------------------------------------------------------*
+ * Data of a payload size : the frame, its legacy Tx bits and a burst of
+ * bulk encoded frames.
+ *--------------------------------------------------------------------------*/
+static char benchPrepare(unsigned int size) {
+  static AX25_TxContext ctx;
+  unsigned char fx25[AX25_RS_SIZE + 8 + BENCH_DELAY_FLAGS + BENCH_TAIL_FLAGS];
+  AX25_TxFrame frames[BENCH_BURST];
+  char buffer[AX25_FRAME_MAX_SIZE];
+  AX25_TxLine line;
+  AX25_Address destination, source, wide;
+  AX25_FrameHeader header;
+  AX25_ProfileTx tx;
+  unsigned char profile;
+  unsigned int i;
+
+  payload = size;
+  srand(payload + 1);
+  for(i=0; i<payload; i++) info[i] = (char) rand();
+  lengthFrame = AX25_buildUIFrame(frame, info, payload);
+
+  // Frame of the digipeater.
+  AX25_addressParse(&destination, "APRS");
+  AX25_addressParse(&source, "ON0UL-1");
+  AX25_addressParse(&wide, "WIDE2-2");
+  if(!AX25_headerInit(&header, &destination, &source, &wide, 1, 0x03, 0xF0)) return 0;
+  lengthDigiFrame = AX25_frameBuild(&header, digiFrame, info, payload);
+
+  // Legacy Tx bits.
+  free(txBits);
+  txBits = malloc(AX25_txEncodedSize(lengthFrame, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS) * 8);
+  if(!txBits) return 0;
+  memcpy(buffer, frame, lengthFrame);
+  memset(&ctx, 0, sizeof(ctx));
+  AX25_txSetTiming_r(&ctx, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS);
+  AX25_txInitCfg_r(&ctx);
+  ctx.lengthFrame = lengthFrame;
+  nbTxBits = 0;
+  while(AX25_prepareNextBitToSend_r(&ctx, buffer)) txBits[nbTxBits++] = ctx.bitToSend;
+  txBits[nbTxBits++] = ctx.bitToSend;
+
+  // Frame of the bulk encoder.
+  free(encoded);
+  encoded = malloc(AX25_txEncodedSize(lengthFrame, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS));
+  if(!encoded) return 0;
+  AX25_txLineInit(&line);
+  nbEncodedBits = AX25_txEncodeFrame(&line, frame, lengthFrame, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS, encoded);
+
+  // Burst of the streaming receiver.
+  for(i=0; i<BENCH_BURST; i++) {
+    frames[i].frame = frame;
+    frames[i].lengthFrame = lengthFrame;
+  }
+  free(burst);
+  burst = malloc(AX25_txBurstEncodedSize(frames, BENCH_BURST, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS) + 8);
+  if(!burst) return 0;
+  AX25_txLineInit(&line);
+  nbBurstBits = AX25_txEncodeBurst(&line, frames, BENCH_BURST, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS, burst);
+  nbBurstBits &= ~7UL;  // Whole bytes (the padding falls in the tail).
+
+  // FX.25 (the largest codeword has 239 data bytes, flags and stuffed
+  // bits included).
+  AX25_txLineInit(&line);
+  fx25Fits = AX25_fx25EncodeFrame(&line, frame, lengthFrame, 16, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS, fx25) != 0;
+
+  // Frames of the profiles, each one from a whole byte.
+  for(profile=0; profile<AX25_PROFILE_COUNT; profile++) {
+    free(profileBursts[profile]);
+    profileBursts[profile] = malloc(BENCH_BURST * (AX25_profileEncodedSize(profile, lengthFrame, BENCH_DELAY_FLAGS,
+                                                                           BENCH_TAIL_FLAGS) + 1));
+    if(!profileBursts[profile]) return 0;
+    AX25_profileTxInit(&tx, profile);
+    nbProfileBits[profile] = 0;
+    for(i=0; i<BENCH_BURST; i++) {
+      nbProfileBits[profile] += AX25_profileTxEncodeFrame(&tx, frame, lengthFrame, BENCH_DELAY_FLAGS, BENCH_TAIL_FLAGS,
+                                                          profileBursts[profile] + nbProfileBits[profile] / 8);
+      nbProfileBits[profile] = (nbProfileBits[profile] + 7) & ~7UL;
+    }
+  }
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Measure of a benchmark : the number of frames is doubled until a run
+ * lasts minTime, then the run is repeated and the fastest one is kept.
+ *--------------------------------------------------------------------------*/
+static char benchMeasure(const BenchCase *bench, double minTime, unsigned long *nbFrames,
+                         double *seconds, unsigned long long *bits, unsigned long long *cycles) {
+  unsigned long long runBits, runCycles;
+  double start, elapsed;
+  unsigned long n = BENCH_BURST;
+  unsigned int i;
+
+  for(;;) {
+    start = benchTime();
+    if(!bench->run(bench->engine, n, &runBits)) return 0;
+    elapsed = benchTime() - start;
+    if(elapsed >= minTime / BENCH_REPEATS) break;
+    n *= (elapsed < minTime / BENCH_REPEATS / 8) ? 8 : 2;
+  }
+
+  *seconds = 0;
+  for(i=0; i<BENCH_REPEATS; i++) {
+    start = benchTime();
+    runCycles = benchCycles();
+    if(!bench->run(bench->engine, n, &runBits)) return 0;
+    runCycles = benchCycles() - runCycles;
+    elapsed = benchTime() - start;
+    if(!*seconds || elapsed < *seconds) {
+      *seconds = elapsed;
+      *bits = runBits;
+      *cycles = runCycles;
+    }
+  }
+  *nbFrames = n;
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Sizes of the info field given with -p.
+ *--------------------------------------------------------------------------*/
+static unsigned int benchPayloads(const char *list, unsigned int *payloads) {
+  unsigned int nbPayloads = 0;
+  unsigned long size;
+  char *end;
+
+  while(*list && nbPayloads < BENCH_MAX_PAYLOADS) {
+    size = strtoul(list, &end, 10);
+    if(end == list || size > INFO_MAX_SIZE) return 0;
+    payloads[nbPayloads++] = (unsigned int) size;
+    list = (*end == ',') ? end + 1 : end;
+    if(*end && *end != ',') return 0;
+  }
+  return nbPayloads;
+}
+
+int main(int argc, char **argv) {
+  static const unsigned int defaults[] = { 0, 16, 64, 128, 256 };
+  unsigned int payloads[BENCH_MAX_PAYLOADS], nbPayloads = 5, i, j;
+  unsigned long long bits = 0, cycles = 0;
+  unsigned long nbFrames;
+  unsigned char engine;
+  const char *filter = NULL;
+  double minTime = 0.2, seconds;
+  char json = 0, first = 1, ok = 1;
+  int option;
+
+  memcpy(payloads, defaults, sizeof(defaults));
+  while((option = getopt(argc, argv, "jt:p:f:")) != -1) {
+    switch(option) {
+      case 'j': json = 1; break;
+      case 't': minTime = atof(optarg); break;
+      case 'p': nbPayloads = benchPayloads(optarg, payloads); ok = nbPayloads != 0; break;
+      case 'f': filter = optarg; break;
+      default: ok = 0;
+    }
+  }
+  if(!ok || optind < argc || minTime <= 0) {
+    fprintf(stderr, "usage: %s [-j] [-t seconds] [-p payloads] [-f filter]\n", argv[0]);
+    return 2;
+  }
+
+  // The engines measured must agree first.
+  if(!AX25_crcSelfTest()) {
+    fprintf(stderr, "%s: the FCS engines do not agree\n", argv[0]);
+    return 1;
+  }
+  engine = AX25_crcGetEngine();
+  if(json) printf("{\n  \"tool\": \"ax25_bench\",\n  \"min_time\": %g,\n  \"tsc\": %s,\n  \"results\": [",
+                  minTime, BENCH_TSC ? "true" : "false");
+  else printf("%-20s %7s %12s %10s %11s %10s\n", "benchmark", "payload", "frames/s", "Mbit/s", "ns/frame", "cycles/bit");
+
+  for(i=0; i<nbPayloads; i++) {
+    if(!benchPrepare(payloads[i])) {
+      fprintf(stderr, "%s: out of memory\n", argv[0]);
+      return 1;
+    }
+    for(j=0; j<sizeof(benchCases) / sizeof(benchCases[0]); j++) {
+      if(filter && !strstr(benchCases[j].name, filter)) continue;
+      if(benchCases[j].run == benchCrc && !AX25_crcSetEngine(benchCases[j].engine)) continue;  // Not supported.
+      if(benchCases[j].run == benchFx25Encode && !fx25Fits) continue;  // Too long for a codeword.
+      ok = benchMeasure(&benchCases[j], minTime, &nbFrames, &seconds, &bits, &cycles);
+      AX25_crcSetEngine(engine);  // Back to the engine of the Tx and Rx benchmarks.
+      if(!ok) {
+        fprintf(stderr, "%s: %s failed with a payload of %u bytes\n", argv[0], benchCases[j].name, payload);
+        return 1;
+      }
+      if(json) {
+        printf("%s\n    { \"name\": \"%s\", \"payload\": %u, \"frame_bytes\": %u, \"frames\": %lu, \"seconds\": %.6f, "
+               "\"frames_per_s\": %.1f, \"bits_per_s\": %.1f, \"ns_per_frame\": %.2f, \"cycles_per_bit\": ",
+               first ? "" : ",", benchCases[j].name, payload, lengthFrame, nbFrames, seconds,
+               nbFrames / seconds, bits / seconds, seconds * 1e9 / nbFrames);
+        if(BENCH_TSC && bits) printf("%.3f }", (double) cycles / bits);
+        else printf("null }");
+        first = 0;
+      }
+      else {
+        printf("%-20s %7u %12.0f %10.2f %11.1f", benchCases[j].name, payload, nbFrames / seconds,
+               bits / seconds * 1e-6, seconds * 1e9 / nbFrames);
+        if(BENCH_TSC && bits) printf(" %10.3f\n", (double) cycles / bits);
+        else printf(" %10s\n", "-");
+      }
+      fflush(stdout);
+    }
+  }
+  if(json) printf("\n  ]\n}\n");
+
+  free(txBits);
+  free(encoded);
+  free(burst);
+  return 0;
+}
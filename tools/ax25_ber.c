@@ -0,0 +1,571 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * ax25_ber.c
+ * Loopback of the codec through a simulated channel : random frames are
+ * encoded, impaired (see AX25_Channel.c) and decoded on several threads,
+ * and the frame error rate is measured for every bit error rate.
+ *
+ *   ax25_ber [-n frames] [-j threads] [-e ber,...] [-b rate] [-L bits]
+ *            [-s rate] [-i] [-m legacy|stream|fx25|both|all] [-p payload]
+ *            [-c errors] [-k bytes] [-d flags] [-t flags] [-r seed]
+ *   ax25_ber -z [-n inputs] [-r seed] [file...]
+ *
+ * -n            frames per point (100000 by default).
+ * -j            threads (one per processor by default).
+ * -e            bit error rates (0,1e-5,1e-4,3e-4,1e-3,3e-3 by default).
+ * -b            probability of a burst of errors at each bit (0 : none).
+ * -L            length of the bursts (16 bits by default).
+ * -s            probability of a bit slip at each bit (0 : none).
+ * -i            polarity inversion of the channel.
+ * -m            codec : the legacy state machines (AX25_prepareNextBitToSend
+ *               into AX25_analyzeNextBit, one frame at a time), the bulk
+ *               encoder into the streaming receiver (bursts of frames), both
+ *               (by default), FX.25 (one frame per codeword, into the
+ *               streaming receiver with FX.25 decoding) or all of them.
+ * -p            max size of the info field (random from 0, INFO_MAX_SIZE
+ *               by default).
+ * -c            correction of 1 or 2 wrong bits on the air with the FCS (2 :
+ *               frames of 18 bytes at most).
+ * -k            check bytes of the FX.25 codewords (16, 32 or 64, 0 : the
+ *               shortest codeword, by default). The frames too long for a
+ *               codeword are sent as plain AX.25.
+ * -d, -t        flags before and after the frames (8 and 2 by default).
+ * -r            seed of the run (the same seed and the same number of
+ *               threads give the same frames and the same impairments).
+ * -z            fuzzing of the receivers : the files (or random inputs,
+ *               half of them damaged frames) are given to both Rx state
+ *               machines, which must stay in their bounds.
+ *
+ * For every point : frames sent, frame error rate (frames not received
+ * intact), FER expected for independent bit errors, frames received with
+ * a bad FCS, frames accepted with a wrong content (FCS fooled), frames
+ * and bits per second. The run fails when a frame is lost without any
+ * impairment.
+ *
+ * Built with -DAX25_FUZZ_LIBFUZZER, the file is a libFuzzer target (see
+ * LLVMFuzzerTestOneInput) instead of the harness.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Channel.h"
+#include "AX25_FX25.h"
+#include "AX25_Stream.h"
+#include "AX25_Tx.h"
+
+#define BER_MAX_THREADS      64
+#define BER_MAX_POINTS       32
+#define BER_BURST            32    // Frames per burst of the streaming path.
+#define BER_RING_SIZE        16
+#define BER_BURST_BYTES      (BER_BURST * (2 * AX25_FRAME_MAX_SIZE) + 2 * 256 + 64)
+
+#define BER_LEGACY           0x01
+#define BER_STREAM           0x02
+#define BER_FX25             0x04
+
+// Options of a run.
+typedef struct {
+  unsigned long nbFrames;
+  unsigned int nbThreads;
+  unsigned int maxPayload;
+  unsigned int nbDelayFlags, nbTailFlags;
+  unsigned char correction;
+  unsigned int nbCheck;        // FX.25 check bytes (0 : any).
+  unsigned long seed;
+  AX25_ChannelParams channel;
+} BerOptions;
+
+// Counters of a point (one worker, then the sum).
+typedef struct {
+  unsigned long nbFrames;
+  unsigned long nbGood;        // Received intact.
+  unsigned long nbFixed;       // Among them, corrected with the FCS.
+  unsigned long nbBadFcs;      // Received with a bad FCS.
+  unsigned long nbUndetected;  // FCS matching but wrong content.
+  unsigned long long nbBits;   // Bits on the air.
+  unsigned long long nbFrameBits;  // Bits of the frames (without the flags of the preamble and the tail).
+  unsigned long long nbErrors; // Wrong bits of the channel.
+  unsigned long nbSlips;
+} BerResult;
+
+typedef struct {
+  const BerOptions *options;
+  unsigned char mode;
+  unsigned int index;
+  unsigned long nbFrames;
+  BerResult result;
+  pthread_t thread;
+} BerWorker;
+
+/*--------------------------------------------------------------------------*
+ * Random frame of a worker (the info field comes from the generator of
+ * the channel, so the run only depends on the seed).
+ *--------------------------------------------------------------------------*/
+static unsigned int berFrame(AX25_Channel *channel, unsigned int maxPayload, char *frame) {
+  char info[INFO_MAX_SIZE];
+  unsigned int length, i;
+  uint64_t random = 0;
+
+  length = (unsigned int) (AX25_channelRandom(channel) % (maxPayload + 1));
+  for(i=0; i<length; i++) {
+    if(!(i & 7)) random = AX25_channelRandom(channel);
+    info[i] = (char) random;
+    random >>= 8;
+  }
+  return AX25_buildUIFrame(frame, info, length);
+}
+
+/*--------------------------------------------------------------------------*
+ * Legacy path : the frames are sent one at a time by the Tx state machine
+ * and received by the Rx state machine, both from a cleared context.
+ *--------------------------------------------------------------------------*/
+static void berLegacy(BerWorker *worker, AX25_Channel *channel, unsigned char *bits, unsigned char *out) {
+  const BerOptions *options = worker->options;
+  AX25_TxContext tx;
+  AX25_RxContext rx;
+  char frame[AX25_FRAME_MAX_SIZE], buffer[AX25_FRAME_MAX_SIZE], received[AX25_FRAME_MAX_SIZE];
+  unsigned long i, n, nbOut;
+  unsigned int lengthFrame, length;
+  unsigned char errors;
+  char ended;
+
+  for(i=0; i<worker->nbFrames; i++) {
+    lengthFrame = berFrame(channel, options->maxPayload, frame);
+    memcpy(buffer, frame, lengthFrame);  // Consumed by the state machine.
+    memset(&tx, 0, sizeof(tx));
+    AX25_txSetTiming_r(&tx, options->nbDelayFlags, options->nbTailFlags);
+    AX25_txInitCfg_r(&tx);
+    tx.lengthFrame = lengthFrame;
+    n = 0;
+    do {
+      ended = !AX25_prepareNextBitToSend_r(&tx, buffer);
+      if(tx.bitToSend) bits[n >> 3] |= (unsigned char) (1 << (n & 7));
+      else bits[n >> 3] &= (unsigned char) ~(1 << (n & 7));
+      n++;
+    } while(!ended);
+    worker->result.nbBits += n;
+    worker->result.nbFrameBits += n - 8UL * (options->nbDelayFlags + options->nbTailFlags);
+
+    nbOut = AX25_channelBits(channel, bits, n, out, 8UL * BER_BURST_BYTES);
+
+    memset(&rx, 0, sizeof(rx));
+    AX25_rxInitCfg_r(&rx);
+    ended = 0;
+    for(n=0; n<nbOut && !ended; n++) {
+      ended = !AX25_analyzeNextBit_r(&rx, received, (char) ((out[n >> 3] >> (n & 7)) & 1));
+    }
+    worker->result.nbFrames++;
+    if(!ended) continue;  // Lost.
+    length = rx.byteCounter + 1;
+    errors = (length >= AX25_FRAME_MIN_SIZE) ? AX25_checkFrame(received, (unsigned short) length, options->correction)
+                                             : AX25_CRC_UNCORRECTABLE;
+    if(errors == AX25_CRC_UNCORRECTABLE) worker->result.nbBadFcs++;
+    else if(length == lengthFrame && !memcmp(received + 1, frame + 1, lengthFrame - 2)) {
+      worker->result.nbGood++;
+      if(errors) worker->result.nbFixed++;
+    }
+    else worker->result.nbUndetected++;
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Streaming path : bursts of frames encoded back to back by the bulk
+ * encoder into a continuous bitstream, received by the streaming receiver.
+ * The frames received are matched in order with the frames sent.
+ *--------------------------------------------------------------------------*/
+static void berStream(BerWorker *worker, AX25_Channel *channel, unsigned char *bits, unsigned char *out) {
+  const BerOptions *options = worker->options;
+  static __thread char frames[BER_BURST][AX25_FRAME_MAX_SIZE];
+  static __thread AX25_FrameSlot slots[BER_RING_SIZE];
+  AX25_TxFrame burst[BER_BURST];
+  AX25_TxLine line;
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  unsigned long i, nbBits, nbOut, offset, size;
+  unsigned int k, j, next;
+
+  AX25_txLineInit(&line);
+  AX25_ringInit(&ring, slots, BER_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetCorrection(&stream, options->correction);
+
+  for(i=0; i<worker->nbFrames; i+=k) {
+    k = (worker->nbFrames - i < BER_BURST) ? (unsigned int) (worker->nbFrames - i) : BER_BURST;
+    for(j=0; j<k; j++) {
+      burst[j].frame = frames[j];
+      burst[j].lengthFrame = berFrame(channel, options->maxPayload, frames[j]);
+    }
+    nbBits = AX25_txEncodeBurst(&line, burst, k, options->nbDelayFlags, options->nbTailFlags, bits);
+    worker->result.nbBits += nbBits;
+    worker->result.nbFrameBits += nbBits - 8UL * (options->nbDelayFlags + options->nbTailFlags);
+    worker->result.nbFrames += k;
+
+    nbOut = AX25_channelBits(channel, bits, nbBits, out, 8UL * BER_BURST_BYTES);
+
+    next = 0;
+    for(offset=0; offset<nbOut; offset+=size) {
+      // Pieces too short to fill the ring.
+      size = 8UL * (AX25_FRAME_MIN_SIZE - 1) * (BER_RING_SIZE - 2);
+      if(size > nbOut - offset) size = nbOut - offset;
+      AX25_rxStreamBits(&stream, out + offset / 8, size);
+      while((slot = AX25_ringPeek(&ring)) != NULL) {
+        if(slot->status == AX25_FRAME_FCS_BAD) worker->result.nbBadFcs++;
+        else {
+          for(j=next; j<k; j++) {
+            if(slot->lengthFrame == burst[j].lengthFrame && !memcmp(slot->frame, frames[j], slot->lengthFrame)) break;
+          }
+          if(j == k) worker->result.nbUndetected++;
+          else {
+            worker->result.nbGood++;
+            if(slot->status == AX25_FRAME_FCS_FIXED) worker->result.nbFixed++;
+            next = j + 1;
+          }
+        }
+        AX25_ringRelease(&ring);
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * FX.25 path : every frame is sent alone in a codeword (or as plain AX.25
+ * when it is too long), one transmission after the other on the same
+ * line, and received by the streaming receiver with FX.25 decoding.
+ *--------------------------------------------------------------------------*/
+static void berFx25(BerWorker *worker, AX25_Channel *channel, unsigned char *bits, unsigned char *out) {
+  const BerOptions *options = worker->options;
+  static __thread AX25_FrameSlot slots[BER_RING_SIZE];
+  char frame[AX25_FRAME_MAX_SIZE];
+  AX25_TxLine line;
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  unsigned long i, nbBits, nbOut;
+  unsigned int lengthFrame;
+  char received;
+
+  AX25_txLineInit(&line);
+  AX25_ringInit(&ring, slots, BER_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetCorrection(&stream, options->correction);
+  AX25_rxStreamSetFx25(&stream, 1);
+
+  for(i=0; i<worker->nbFrames; i++) {
+    lengthFrame = berFrame(channel, options->maxPayload, frame);
+    nbBits = AX25_fx25EncodeFrame(&line, frame, lengthFrame, options->nbCheck, options->nbDelayFlags,
+                                  options->nbTailFlags, bits);
+    if(!nbBits) nbBits = AX25_txEncodeFrame(&line, frame, lengthFrame, options->nbDelayFlags, options->nbTailFlags, bits);
+    worker->result.nbBits += nbBits;
+    worker->result.nbFrameBits += nbBits - 8UL * (options->nbDelayFlags + options->nbTailFlags);
+    worker->result.nbFrames++;
+
+    nbOut = AX25_channelBits(channel, bits, nbBits, out, 8UL * BER_BURST_BYTES);
+    AX25_rxStreamBits(&stream, out, nbOut);
+
+    received = 0;
+    while((slot = AX25_ringPeek(&ring)) != NULL) {
+      if(slot->status == AX25_FRAME_FCS_BAD) worker->result.nbBadFcs++;
+      else if(!received && slot->lengthFrame == lengthFrame && !memcmp(slot->frame, frame, lengthFrame)) {
+        worker->result.nbGood++;
+        if(slot->status == AX25_FRAME_FCS_FIXED) worker->result.nbFixed++;
+        received = 1;
+      }
+      else worker->result.nbUndetected++;
+      AX25_ringRelease(&ring);
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Worker thread : its share of the frames with its own channel.
+ *--------------------------------------------------------------------------*/
+static void *berWorker(void *arg) {
+  BerWorker *worker = (BerWorker *) arg;
+  AX25_Channel channel;
+  unsigned char *bits, *out;
+
+  memset(&worker->result, 0, sizeof(worker->result));
+  bits = calloc(2, BER_BURST_BYTES);
+  if(!bits) return NULL;
+  out = bits + BER_BURST_BYTES;
+  AX25_channelInit(&channel, &worker->options->channel, worker->options->seed * BER_MAX_THREADS + worker->index);
+  if(worker->mode == BER_LEGACY) berLegacy(worker, &channel, bits, out);
+  else if(worker->mode == BER_FX25) berFx25(worker, &channel, bits, out);
+  else berStream(worker, &channel, bits, out);
+  worker->result.nbErrors = channel.nbErrors;
+  worker->result.nbSlips = channel.nbSlips;
+  free(bits);
+  return NULL;
+}
+
+/*--------------------------------------------------------------------------*
+ * One point : the frames are shared by the threads and the counters of
+ * the threads are added.
+ *--------------------------------------------------------------------------*/
+static double berPoint(const BerOptions *options, unsigned char mode, BerResult *result) {
+  static BerWorker workers[BER_MAX_THREADS];
+  struct timespec start, end;
+  unsigned int i, nbStarted;
+
+  for(i=0; i<options->nbThreads; i++) {
+    workers[i].options = options;
+    workers[i].mode = mode;
+    workers[i].index = i;
+    workers[i].nbFrames = options->nbFrames / options->nbThreads + (i < options->nbFrames % options->nbThreads);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(nbStarted=1; nbStarted<options->nbThreads; nbStarted++) {
+    if(pthread_create(&workers[nbStarted].thread, NULL, berWorker, &workers[nbStarted])) break;
+  }
+  berWorker(&workers[0]);  // The calling thread is one of the workers.
+  for(i=1; i<nbStarted; i++) pthread_join(workers[i].thread, NULL);
+  for(; i<options->nbThreads; i++) berWorker(&workers[i]);  // Not started.
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  memset(result, 0, sizeof(*result));
+  for(i=0; i<options->nbThreads; i++) {
+    result->nbFrames += workers[i].result.nbFrames;
+    result->nbGood += workers[i].result.nbGood;
+    result->nbFixed += workers[i].result.nbFixed;
+    result->nbBadFcs += workers[i].result.nbBadFcs;
+    result->nbUndetected += workers[i].result.nbUndetected;
+    result->nbBits += workers[i].result.nbBits;
+    result->nbFrameBits += workers[i].result.nbFrameBits;
+    result->nbErrors += workers[i].result.nbErrors;
+    result->nbSlips += workers[i].result.nbSlips;
+  }
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+/*--------------------------------------------------------------------------*
+ * Fuzzing of the receivers. The first byte selects the options of the
+ * streaming receiver (correction, FX.25, size of the pieces), the other
+ * bytes are the bits from the demodulator. Any frame given by a receiver
+ * must fit in its buffer, and a frame published with a matching FCS must
+ * really match.
+ *--------------------------------------------------------------------------*/
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static AX25_FrameSlot slots[BER_RING_SIZE];
+  AX25_RxContext rx;
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_FrameSlot *slot;
+  char buffer[AX25_FRAME_MAX_SIZE];
+  unsigned long nbBits, offset, piece, n, i;
+  unsigned char options;
+
+  if(!size) return 0;
+  options = data[0];
+  data++;
+  nbBits = 8UL * (size - 1);
+
+  // Legacy state machine, a new frame after every end flag.
+  memset(&rx, 0, sizeof(rx));
+  AX25_rxInitCfg_r(&rx);
+  for(i=0; i<nbBits; i++) {
+    if(!AX25_analyzeNextBit_r(&rx, buffer, (char) ((data[i >> 3] >> (i & 7)) & 1))) {
+      if(rx.byteCounter + 1 > AX25_FRAME_MAX_SIZE) abort();
+      AX25_checkFrame(buffer, (unsigned short) (rx.byteCounter + 1), options & 3);
+      AX25_rxInitCfg_r(&rx);
+    }
+    if(rx.byteCounter >= AX25_FRAME_MAX_SIZE) abort();
+  }
+
+  // Streaming receiver.
+  AX25_ringInit(&ring, slots, BER_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetCorrection(&stream, options & 3);
+  AX25_rxStreamSetFx25(&stream, (options >> 2) & 1);
+  piece = 8UL * ((options >> 3) + 1);  // Bytes of every call (1 to 32).
+  for(offset=0; offset<nbBits; offset+=n) {
+    n = (nbBits - offset < piece) ? nbBits - offset : piece;
+    AX25_rxStreamBits(&stream, data + offset / 8, n);
+    while((slot = AX25_ringPeek(&ring)) != NULL) {
+      if(slot->lengthFrame < AX25_FRAME_MIN_SIZE || slot->lengthFrame > AX25_FRAME_MAX_SIZE) abort();
+      if(slot->frame[0] != 0x7E || slot->frame[slot->lengthFrame - 1] != 0x7E) abort();
+      if(slot->status != AX25_FRAME_FCS_BAD) {
+        memcpy(buffer, slot->frame, slot->lengthFrame);
+        if(AX25_checkFrame(buffer, (unsigned short) slot->lengthFrame, 0) != 0) abort();
+      }
+      AX25_ringRelease(&ring);
+    }
+  }
+  return 0;
+}
+
+#ifndef AX25_FUZZ_LIBFUZZER
+
+/*--------------------------------------------------------------------------*
+ * Fuzzing without libFuzzer : the files given, or random inputs (noise,
+ * or frames encoded by the bulk encoder with a few wrong bits).
+ *--------------------------------------------------------------------------*/
+static int berFuzz(const BerOptions *options, char **paths, int nbPaths) {
+  static unsigned char input[8192];
+  AX25_ChannelParams params = { 0 };
+  AX25_Channel channel;
+  AX25_TxFrame frames[4];
+  char buffers[4][AX25_FRAME_MAX_SIZE];
+  AX25_TxLine line;
+  unsigned long i, size, nbBits;
+  unsigned int j;
+  FILE *file;
+  int k;
+
+  for(k=0; k<nbPaths; k++) {
+    file = fopen(paths[k], "rb");
+    if(!file) {
+      perror(paths[k]);
+      return 1;
+    }
+    size = fread(input, 1, sizeof(input), file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(input, size);
+  }
+  if(nbPaths) {
+    printf("%d inputs OK\n", nbPaths);
+    return 0;
+  }
+
+  params.ber = 1e-3;
+  AX25_channelInit(&channel, &params, options->seed);
+  for(i=0; i<options->nbFrames; i++) {
+    size = 1 + AX25_channelRandom(&channel) % (sizeof(input) / 2);
+    if(i & 1) {
+      for(j=0; j<size; j++) input[j] = (unsigned char) AX25_channelRandom(&channel);
+    }
+    else {
+      // Frames on the air, then a few wrong bits.
+      for(j=0; j<4; j++) {
+        frames[j].frame = buffers[j];
+        frames[j].lengthFrame = berFrame(&channel, INFO_MAX_SIZE, buffers[j]);
+      }
+      AX25_txLineInit(&line);
+      input[0] = (unsigned char) AX25_channelRandom(&channel);
+      nbBits = AX25_txEncodeBurst(&line, frames, 4, 4, 2, input + sizeof(input) / 2);
+      nbBits = AX25_channelBits(&channel, input + sizeof(input) / 2, nbBits, input + 1, 8 * (sizeof(input) / 2 - 1));
+      size = 1 + (nbBits + 7) / 8;
+    }
+    LLVMFuzzerTestOneInput(input, size);
+  }
+  printf("%lu random inputs OK\n", options->nbFrames);
+  return 0;
+}
+
+/*--------------------------------------------------------------------------*
+ * Bit error rates given with -e.
+ *--------------------------------------------------------------------------*/
+static unsigned int berRates(const char *list, double *rates) {
+  unsigned int nbRates = 0;
+  char *end;
+
+  while(*list && nbRates < BER_MAX_POINTS) {
+    rates[nbRates] = strtod(list, &end);
+    if(end == list || rates[nbRates] < 0 || rates[nbRates] > 0.5) return 0;
+    nbRates++;
+    if(*end && *end != ',') return 0;
+    list = (*end == ',') ? end + 1 : end;
+  }
+  return nbRates;
+}
+
+int main(int argc, char **argv) {
+  static const char *names[] = { "", "legacy", "stream", "", "fx25" };
+  BerOptions options;
+  BerResult result;
+  double rates[BER_MAX_POINTS], seconds, bitsPerFrame, expected;
+  unsigned int nbRates, i;
+  unsigned char modes = BER_LEGACY | BER_STREAM, mode;
+  char fuzz = 0, failed = 0, ok = 1;
+  long nbCpus;
+  int option;
+
+  memset(&options, 0, sizeof(options));
+  options.nbFrames = 100000;
+  nbCpus = sysconf(_SC_NPROCESSORS_ONLN);
+  options.nbThreads = (nbCpus > 0) ? (unsigned int) nbCpus : 1;
+  options.maxPayload = INFO_MAX_SIZE;
+  options.nbDelayFlags = 8;
+  options.nbTailFlags = 2;
+  options.seed = 1;
+  options.channel.burstLength = 16;
+  nbRates = berRates("0,1e-5,1e-4,3e-4,1e-3,3e-3", rates);
+
+  while((option = getopt(argc, argv, "n:j:e:b:L:s:im:p:c:k:d:t:r:z")) != -1) {
+    switch(option) {
+      case 'n': options.nbFrames = strtoul(optarg, NULL, 10); break;
+      case 'j': options.nbThreads = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 'e': nbRates = berRates(optarg, rates); ok = nbRates != 0; break;
+      case 'b': options.channel.burstRate = atof(optarg); break;
+      case 'L': options.channel.burstLength = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 's': options.channel.slipRate = atof(optarg); break;
+      case 'i': options.channel.invert = 1; break;
+      case 'm':
+        if(!strcmp(optarg, "legacy")) modes = BER_LEGACY;
+        else if(!strcmp(optarg, "stream")) modes = BER_STREAM;
+        else if(!strcmp(optarg, "fx25")) modes = BER_FX25;
+        else if(!strcmp(optarg, "both")) modes = BER_LEGACY | BER_STREAM;
+        else if(!strcmp(optarg, "all")) modes = BER_LEGACY | BER_STREAM | BER_FX25;
+        else ok = 0;
+        break;
+      case 'p': options.maxPayload = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 'c': options.correction = (unsigned char) strtoul(optarg, NULL, 10); break;
+      case 'k': options.nbCheck = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 'd': options.nbDelayFlags = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 't': options.nbTailFlags = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 'r': options.seed = strtoul(optarg, NULL, 10); break;
+      case 'z': fuzz = 1; break;
+      default: ok = 0;
+    }
+  }
+  if(!ok || (optind < argc && !fuzz) || options.maxPayload > INFO_MAX_SIZE || !options.nbDelayFlags ||
+     !options.nbTailFlags || options.correction > 2 || (options.nbCheck && options.nbCheck != 16 &&
+     options.nbCheck != 32 && options.nbCheck != 64)) {
+    fprintf(stderr, "usage: %s [-n frames] [-j threads] [-e ber,...] [-b rate] [-L bits] [-s rate] [-i]\n"
+                    "          [-m legacy|stream|fx25|both|all] [-p payload] [-c errors] [-k bytes] [-d flags] [-t flags]\n"
+                    "          [-r seed]\n"
+                    "       %s -z [-n inputs] [-r seed] [file...]\n", argv[0], argv[0]);
+    return 2;
+  }
+  if(options.nbThreads < 1) options.nbThreads = 1;
+  if(options.nbThreads > BER_MAX_THREADS) options.nbThreads = BER_MAX_THREADS;
+
+  AX25_crcInitEngine();
+  if(fuzz) return berFuzz(&options, argv + optind, argc - optind);
+
+  printf("%-7s %8s %10s %10s %10s %8s %8s %8s %10s %8s\n", "codec", "BER", "frames", "FER", "FER ind.",
+         "bad FCS", "fixed", "fooled", "frames/s", "Mbit/s");
+  for(mode=BER_LEGACY; mode<=BER_FX25; mode<<=1) {
+    if(!(modes & mode)) continue;
+    for(i=0; i<nbRates; i++) {
+      options.channel.ber = rates[i];
+      seconds = berPoint(&options, mode, &result);
+      if(!result.nbFrames) continue;
+      bitsPerFrame = (double) result.nbFrameBits / result.nbFrames;
+      expected = 1 - pow(1 - rates[i], bitsPerFrame);
+      printf("%-7s %8.1e %10lu %10.3e %10.3e %8lu %8lu %8lu %10.0f %8.2f\n", names[mode], rates[i], result.nbFrames,
+             1 - (double) result.nbGood / result.nbFrames, expected, result.nbBadFcs, result.nbFixed,
+             result.nbUndetected, seconds > 0 ? result.nbFrames / seconds : 0,
+             seconds > 0 ? result.nbBits / seconds * 1e-6 : 0);
+      fflush(stdout);
+      if(!rates[i] && !options.channel.burstRate && !options.channel.slipRate && result.nbGood != result.nbFrames) {
+        fprintf(stderr, "%s: %s codec : %lu frames lost without impairment\n", argv[0], names[mode],
+                result.nbFrames - result.nbGood);
+        failed = 1;
+      }
+    }
+  }
+  return failed ? 1 : 0;
+}
+
+#endif /* AX25_FUZZ_LIBFUZZER */
@@ -0,0 +1,271 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * ax25_decode.c
+ * Offline decoding of the recordings of the passes.
+ *
+ *   ax25_decode [-f wav|s16|f32] [-r rate] [-q] [-c errors] [-F] [-s] [-x] file...
+ *   ax25_decode -b [-j threads] [-c errors] [-F] [-i] [-x] file...
+ *
+ * -f            format of the files (wav by default, s16 and f32 are raw).
+ * -r            sample rate of the raw files (Hz).
+ * -q            the raw files are IQ (interleaved I and Q).
+ * -b            the files are raw bit captures (bits from the demodulator,
+ *               packed LSB first), decoded in parallel.
+ * -j            threads for the bit captures (one per processor by default).
+ * -c            correction of 1 or 2 wrong bits on the air with the FCS (2 :
+ *               frames of 18 bytes at most).
+ * -F            decoding of the FX.25 codewords.
+ * -i            the index of every bit capture is written in <file>.idx
+ *               (bit offset of the end flag, length, FCS status).
+ * -s            counters of the receiver (flags, stuffed bits, FCS, frame
+ *               lengths and decode latency), except for the bit captures.
+ * -x            hexadecimal dump of the frames.
+ *
+ * One line is printed per frame : time in the recording (bit offset of
+ * the end flag for a bit capture), length (FCS included), FCS status,
+ * addresses and information field.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AX25_Capture.h"
+#include "AX25_Demod.h"
+#include "AX25_Samples.h"
+
+#define DECODE_BLOCK         4096  // Frames of samples read at once.
+#define DECODE_RING_SIZE     32
+
+static float samples[2 * DECODE_BLOCK];
+static AX25_FrameSlot slots[DECODE_RING_SIZE];
+static unsigned long nbGood, nbFixed, nbBad;
+static unsigned char correction, fx25, stats, writeIndex;
+
+/*--------------------------------------------------------------------------*
+ * Prints an address field (callsign-SSID).
+ *--------------------------------------------------------------------------*/
+static void decodePrintAddress(const unsigned char *address) {
+  unsigned int i;
+  char c;
+
+  for(i=0; i<6; i++) {
+    c = address[i] >> 1;
+    if(c != ' ') putchar(c);
+  }
+  if((address[6] >> 1) & 0x0F) printf("-%u", (address[6] >> 1) & 0x0F);
+}
+
+/*--------------------------------------------------------------------------*
+ * Prints a frame (flags included), after its position.
+ *--------------------------------------------------------------------------*/
+static void decodePrintFrame(const char *flagged, unsigned int lengthFrame, unsigned char status, char hex) {
+  const unsigned char *frame = (const unsigned char *) flagged + 1;
+  unsigned int length = lengthFrame - 2, header = 14, i;
+
+  if(status == AX25_FRAME_FCS_OK) nbGood++;
+  else if(status == AX25_FRAME_FCS_FIXED) nbFixed++;
+  else nbBad++;
+  printf(" %4u %s  ", length, status == AX25_FRAME_FCS_OK ? "OK " : status == AX25_FRAME_FCS_FIXED ? "FIX" : "BAD");
+
+  while(header + 7 <= length - 2 && !(frame[header - 1] & 0x01)) header += 7;  // Digipeaters.
+  decodePrintAddress(frame + 7);
+  putchar('>');
+  decodePrintAddress(frame);
+  for(i=14; i<header; i+=7) {
+    putchar(',');
+    decodePrintAddress(frame + i);
+  }
+  putchar(':');
+
+  for(i=header+2; i<length-2; i++) putchar(frame[i] >= 0x20 && frame[i] < 0x7F ? frame[i] : '.');
+  putchar('\n');
+
+  if(hex) {
+    for(i=0; i<length; i++) printf("%02X%c", frame[i], (i % 16 == 15 || i == length - 1) ? '\n' : ' ');
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Prints the counters of a receiver.
+ *--------------------------------------------------------------------------*/
+static void decodePrintStats(const char *path, const AX25_StatsSnapshot *snapshot) {
+  const unsigned long *counters = snapshot->counters;
+  unsigned int i;
+
+  fprintf(stderr, "%s: flags %lu hunted, %lu sync ; %lu stuffed bits ; %lu aborts, %lu oversizes, %lu overruns\n",
+          path, counters[AX25_STAT_FLAGS_HUNTED], counters[AX25_STAT_FLAGS_SYNC], counters[AX25_STAT_STUFF_REMOVED],
+          counters[AX25_STAT_ABORTS], counters[AX25_STAT_OVERSIZES], counters[AX25_STAT_OVERRUNS]);
+  fprintf(stderr, "%s: FCS %lu OK, %lu bad, %lu corrected ; lengths", path,
+          counters[AX25_STAT_FCS_OK], counters[AX25_STAT_FCS_BAD], counters[AX25_STAT_FCS_FIXED]);
+  for(i=0; i<AX25_STAT_LENGTH_BINS; i++) {
+    if(snapshot->lengths[i]) fprintf(stderr, " %u-%u:%lu", i * AX25_STAT_LENGTH_STEP,
+                                     (i + 1) * AX25_STAT_LENGTH_STEP - 1, snapshot->lengths[i]);
+  }
+  fputc('\n', stderr);
+  if(counters[AX25_STAT_DELIVERED]) {
+    fprintf(stderr, "%s: latency %.1f us mean, %.1f us p50, %.1f us p99, %.1f us max\n", path,
+            snapshot->latencySum * 1e-3 / counters[AX25_STAT_DELIVERED],
+            AX25_statsLatencyPercentile(snapshot, 50) * 1e-3, AX25_statsLatencyPercentile(snapshot, 99) * 1e-3,
+            snapshot->latencyMax * 1e-3);
+  }
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of one file.
+ *--------------------------------------------------------------------------*/
+static char decodeFile(const char *path, unsigned char format, unsigned int sampleRate, unsigned int channels, char hex) {
+  AX25_SampleFile *file = malloc(sizeof(AX25_SampleFile));
+  AX25_FrameRing ring;
+  AX25_RxStream stream;
+  AX25_Demod demod;
+  AX25_Stats counters;
+  AX25_StatsSnapshot snapshot;
+  AX25_FrameSlot *slot;
+  unsigned long n;
+  struct timespec start, end;
+  double seconds, elapsed;
+
+  if(!file || !AX25_samplesOpen(file, path, format, sampleRate, channels)) {
+    fprintf(stderr, "%s: cannot open or unsupported format\n", path);
+    free(file);
+    return 0;
+  }
+
+  AX25_ringInit(&ring, slots, DECODE_RING_SIZE);
+  AX25_rxStreamInit(&stream, &ring);
+  AX25_rxStreamSetCorrection(&stream, correction);
+  AX25_rxStreamSetFx25(&stream, fx25);
+  AX25_statsInit(&counters);
+  if(stats) AX25_rxStreamSetStats(&stream, &counters);
+  if(!AX25_demodInit(&demod, &stream, file->sampleRate, file->channels == 2 ? AX25_DEMOD_IQ : AX25_DEMOD_AUDIO)) {
+    fprintf(stderr, "%s: sample rate too low (%u Hz)\n", path, file->sampleRate);
+    AX25_samplesClose(file);
+    free(file);
+    return 0;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  do {
+    n = AX25_samplesRead(file, samples, DECODE_BLOCK);
+    if(n) AX25_demodSamples(&demod, samples, n);
+    else AX25_demodFinish(&demod);
+
+    while((slot = AX25_ringPeek(&ring))) {
+      AX25_statsDelivered(stream.stats, slot->timestamp);
+      printf("%10.3f", (double) slot->bitOffset / AX25_DEMOD_BAUD);
+      decodePrintFrame(slot->frame, slot->lengthFrame, slot->status, hex);
+      AX25_ringRelease(&ring);
+    }
+  } while(n);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  seconds = (double) demod.nbSamples / file->sampleRate;
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+  fprintf(stderr, "%s: %.1f s decoded in %.3f s (%.0fx real-time), %lu frames, %lu aborts, %lu overruns\n",
+          path, seconds, elapsed, elapsed > 0 ? seconds / elapsed : 0, stream.nbFrames, stream.nbAborts, stream.nbOverruns);
+  if(fx25) fprintf(stderr, "%s: %lu FX.25 codewords, %lu corrected, %lu uncorrectable\n",
+                  path, stream.nbFx25Codewords, stream.nbFx25Corrected, stream.nbFx25Failed);
+  if(stats) {
+    AX25_statsSnapshot(&counters, &snapshot);
+    decodePrintStats(path, &snapshot);
+  }
+
+  AX25_samplesClose(file);
+  free(file);
+  return 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Decoding of one raw bit capture.
+ *--------------------------------------------------------------------------*/
+static char decodeCapture(const char *path, unsigned int nbThreads, char hex) {
+  AX25_Capture capture;
+  unsigned long i;
+  char *indexPath;
+  struct timespec start, end;
+  double elapsed;
+
+  if(!AX25_captureOpen(&capture, path)) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return 0;
+  }
+
+  capture.correction = correction;
+  capture.fx25 = fx25;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if(!AX25_captureDecode(&capture, nbThreads)) {
+    fprintf(stderr, "%s: out of memory\n", path);
+    AX25_captureClose(&capture);
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  for(i=0; i<capture.nbFrames; i++) {
+    printf("%12llu", capture.frames[i].bitOffset);
+    decodePrintFrame(capture.frames[i].frame, capture.frames[i].lengthFrame, capture.frames[i].status, hex);
+  }
+
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+  fprintf(stderr, "%s: %zu bytes decoded in %.3f s (%.0f MB/s, %u chunks), %lu frames\n",
+          path, capture.size, elapsed, elapsed > 0 ? capture.size / elapsed * 1e-6 : 0, capture.nbChunks, capture.nbFrames);
+
+  if(writeIndex) {
+    indexPath = malloc(strlen(path) + 5);
+    if(indexPath) sprintf(indexPath, "%s.idx", path);
+    if(!indexPath || !AX25_captureWriteIndex(&capture, indexPath)) {
+      fprintf(stderr, "%s: cannot write the index\n", path);
+      free(indexPath);
+      AX25_captureClose(&capture);
+      return 0;
+    }
+    free(indexPath);
+  }
+
+  AX25_captureClose(&capture);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  unsigned char format = AX25_SAMPLES_WAV;
+  unsigned int sampleRate = 48000, channels = 1, nbThreads = 0;
+  char hex = 0, bits = 0, ok = 1;
+  int option;
+
+  while((option = getopt(argc, argv, "f:r:qbj:c:Fisx")) != -1) {
+    switch(option) {
+      case 'f':
+        if(!strcmp(optarg, "wav")) format = AX25_SAMPLES_WAV;
+        else if(!strcmp(optarg, "s16")) format = AX25_SAMPLES_S16;
+        else if(!strcmp(optarg, "f32")) format = AX25_SAMPLES_F32;
+        else ok = 0;
+        break;
+      case 'r': sampleRate = strtoul(optarg, NULL, 10); break;
+      case 'q': channels = 2; break;
+      case 'b': bits = 1; break;
+      case 'j': nbThreads = strtoul(optarg, NULL, 10); break;
+      case 'c': correction = (unsigned char) strtoul(optarg, NULL, 10); break;
+      case 'F': fx25 = 1; break;
+      case 'i': writeIndex = 1; break;
+      case 's': stats = 1; break;
+      case 'x': hex = 1; break;
+      default: ok = 0;
+    }
+  }
+  if(!ok || optind >= argc) {
+    fprintf(stderr, "usage: %s [-f wav|s16|f32] [-r rate] [-q] [-c errors] [-F] [-s] [-x] file...\n"
+                    "       %s -b [-j threads] [-c errors] [-F] [-i] [-x] file...\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  for(; optind<argc; optind++) {
+    if(bits) ok &= decodeCapture(argv[optind], nbThreads, hex);
+    else ok &= decodeFile(argv[optind], format, sampleRate, channels, hex);
+  }
+  fprintf(stderr, "%lu frames OK, %lu corrected, %lu with a bad FCS\n", nbGood, nbFixed, nbBad);
+  return ok ? 0 : 1;
+}
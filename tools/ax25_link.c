@@ -0,0 +1,197 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * ax25_link.c
+ * Transfer over a simulated lossy link, between two stations in connected
+ * mode : the behaviour of the windows, of SREJ and of the timers can be
+ * seen offline, without a radio.
+ *
+ *   ax25_link [-n bytes] [-b baud] [-d delay] [-l loss] [-m 8|128]
+ *             [-s 0|1] [-k window] [-p paclen] [-r seed]
+ *
+ * -n            bytes to transfer (100000 by default).
+ * -b            bit rate of each direction (9600 bit/s by default).
+ * -d            one-way propagation delay (250 ms by default).
+ * -l            probability of losing a frame (0.01 by default).
+ * -m            modulo of the sequence numbers (128 by default).
+ * -s            selective reject (by default with modulo 128 only).
+ * -k            window (32 by default with modulo 128, 7 with modulo 8).
+ * -p            bytes of info per I frame (256 by default).
+ * -r            seed of the losses.
+ *
+ * The time is simulated by steps of 1 ms. The frames are checked (FCS)
+ * when they arrive and the data received is compared with the data sent.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AX25_CRC.h"
+#include "AX25_Link.h"
+
+#define SIM_QUEUE_SIZE       4096       // Frames in flight per direction.
+#define SIM_TIME_LIMIT       86400000   // One day (ms).
+
+// One direction of the link.
+typedef struct {
+  unsigned long long arrival[SIM_QUEUE_SIZE];
+  unsigned int lengths[SIM_QUEUE_SIZE];
+  char frames[SIM_QUEUE_SIZE][AX25_FRAME_MAX_SIZE];
+  unsigned int head, tail;
+  unsigned long long free;     // End of the frame on the air (ms).
+  unsigned long nbFrames, nbLost;
+} SimChannel;
+
+typedef struct {
+  AX25_Link link;
+  SimChannel *channel;         // Channel of the frames sent.
+} SimStation;
+
+static SimStation stations[2];
+static SimChannel channels[2];
+static unsigned long long now;
+static unsigned long baud = 9600, delay = 250;
+static double loss = 0.01;
+static unsigned long received, errors;
+
+/*--------------------------------------------------------------------------*
+ * Byte number i of the data transferred.
+ *--------------------------------------------------------------------------*/
+static unsigned char simByte(unsigned long i) {
+  return (unsigned char) ((i * 2654435761UL) >> 13);
+}
+
+/*--------------------------------------------------------------------------*
+ * Frame sent by a station : on the air after the frames before it, then
+ * lost or received after the delay.
+ *--------------------------------------------------------------------------*/
+static void simSend(void *user, const char *frame, unsigned int length) {
+  SimChannel *channel = ((SimStation *) user)->channel;
+  unsigned int slot;
+
+  if(channel->free < now) channel->free = now;
+  channel->free += (length * 8UL * 1000 + baud - 1) / baud;
+  channel->nbFrames++;
+  if((double) rand() / RAND_MAX < loss || channel->tail - channel->head == SIM_QUEUE_SIZE) {
+    channel->nbLost++;
+    return;
+  }
+  slot = channel->tail++ % SIM_QUEUE_SIZE;
+  channel->arrival[slot] = channel->free + delay;
+  channel->lengths[slot] = length;
+  memcpy(channel->frames[slot], frame, length);
+}
+
+/*--------------------------------------------------------------------------*
+ * Data received by the second station.
+ *--------------------------------------------------------------------------*/
+static void simReceive(void *user, const unsigned char *data, unsigned int length) {
+  unsigned int i;
+
+  (void) user;
+  for(i=0; i<length; i++) {
+    if(data[i] != simByte(received + i)) errors++;
+  }
+  received += length;
+}
+
+/*--------------------------------------------------------------------------*
+ * Frames arrived at a station.
+ *--------------------------------------------------------------------------*/
+static void simDeliver(SimChannel *channel, SimStation *station) {
+  unsigned int slot;
+
+  while(channel->head != channel->tail && channel->arrival[channel->head % SIM_QUEUE_SIZE] <= now) {
+    slot = channel->head++ % SIM_QUEUE_SIZE;
+    if(AX25_checkFrame(channel->frames[slot], (unsigned short) channel->lengths[slot], 0) != 0) {
+      errors++;
+      continue;
+    }
+    AX25_linkFrame(&station->link, channel->frames[slot], channel->lengths[slot], now);
+  }
+}
+
+int main(int argc, char **argv) {
+  AX25_Address addresses[2];
+  AX25_LinkParams params;
+  AX25_Link *sender = &stations[0].link, *receiver = &stations[1].link;
+  unsigned long nbBytes = 100000, queued = 0, window = 0, paclen = 0;
+  unsigned char chunk[4096];
+  unsigned int modulo = 128, i, n;
+  int option, srej = -1, ok = 1;
+  char disconnecting = 0;
+
+  while((option = getopt(argc, argv, "n:b:d:l:m:s:k:p:r:")) != -1) {
+    switch(option) {
+      case 'n': nbBytes = strtoul(optarg, NULL, 10); break;
+      case 'b': baud = strtoul(optarg, NULL, 10); break;
+      case 'd': delay = strtoul(optarg, NULL, 10); break;
+      case 'l': loss = atof(optarg); break;
+      case 'm': modulo = (unsigned int) strtoul(optarg, NULL, 10); break;
+      case 's': srej = atoi(optarg); break;
+      case 'k': window = strtoul(optarg, NULL, 10); break;
+      case 'p': paclen = strtoul(optarg, NULL, 10); break;
+      case 'r': srand((unsigned int) strtoul(optarg, NULL, 10)); break;
+      default: ok = 0;
+    }
+  }
+  if(!ok || optind < argc || !baud || (modulo != 8 && modulo != 128)) {
+    fprintf(stderr, "usage: %s [-n bytes] [-b baud] [-d delay] [-l loss] [-m 8|128] [-s 0|1] [-k window] [-p paclen] [-r seed]\n", argv[0]);
+    return 2;
+  }
+
+  AX25_crcInitEngine();
+  AX25_linkDefaults(&params, modulo == 128);
+  if(srej >= 0) params.srej = srej ? 1 : 0;
+  if(window) params.window = (unsigned int) window;
+  if(paclen) params.paclen = (unsigned int) paclen;
+  AX25_addressParse(&addresses[0], "ON0ULG");
+  AX25_addressParse(&addresses[1], "ON0FTI-1");
+  for(i=0; i<2; i++) {
+    stations[i].channel = &channels[i];
+    if(!AX25_linkInit(&stations[i].link, &params, &addresses[i], &addresses[1 - i], NULL, 0,
+                      simSend, simReceive, &stations[i])) {
+      fprintf(stderr, "%s: invalid parameters\n", argv[0]);
+      return 2;
+    }
+  }
+
+  AX25_linkConnect(sender, now);
+  for(; now<SIM_TIME_LIMIT; now++) {
+    simDeliver(&channels[0], &stations[1]);
+    simDeliver(&channels[1], &stations[0]);
+
+    if(sender->state == AX25_LINK_CONNECTED) {
+      while(queued < nbBytes) {
+        n = nbBytes - queued < sizeof(chunk) ? (unsigned int) (nbBytes - queued) : (unsigned int) sizeof(chunk);
+        for(i=0; i<n; i++) chunk[i] = simByte(queued + i);
+        n = AX25_linkSendData(sender, chunk, n);
+        if(!n) break;
+        queued += n;
+      }
+      if(queued == nbBytes && !AX25_linkPending(sender) && !disconnecting) {
+        AX25_linkDisconnect(sender, now);
+        disconnecting = 1;
+      }
+    }
+    else if(sender->state == AX25_LINK_DISCONNECTED) break;
+
+    AX25_linkPoll(sender, now);
+    AX25_linkPoll(receiver, now);
+  }
+
+  printf("%lu bytes received in %.1f s : %.0f bit/s (%.0f %% of %lu bit/s)\n", received, now / 1000.0,
+         now ? received * 8000.0 / now : 0.0, now ? received * 8000.0 / now * 100.0 / baud : 0.0, baud);
+  printf("frames : %lu sent, %lu lost ; I frames %lu, retransmitted %lu ; SREJ %lu, REJ %lu ; T1 expired %lu\n",
+         channels[0].nbFrames + channels[1].nbFrames, channels[0].nbLost + channels[1].nbLost,
+         sender->nbIFrames, sender->nbRetransmits, receiver->nbSrej, receiver->nbRej, sender->nbTimeouts);
+  printf("T1 %lu ms, SRTT %lu ms, duplicates %lu\n", sender->t1, sender->srtt >> 3, receiver->nbDuplicates);
+  if(received != nbBytes || errors) {
+    printf("transfer failed : %lu bytes of %lu, %lu errors\n", received, nbBytes, errors);
+    return 1;
+  }
+  return 0;
+}
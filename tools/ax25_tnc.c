@@ -0,0 +1,175 @@
+/*--------------------------------------------------------------------------*
+ * OUFTI-1 Ground station software
+ *--------------------------------------------------------------------------*
+ * ax25_tnc.c
+ * Software TNC : the applications talk KISS to it over TCP or through a
+ * pseudo-terminal instead of owning the serial port of a hardware TNC.
+ *
+ *   ax25_tnc [-a address] [-t port] [-p] [-m rx,tx] [-l] [-D call [-A alias] [-W hops]] ...
+ *
+ * -a            address of the TCP server (127.0.0.1 by default).
+ * -t            TCP port of the server (8001 by default, 0 : no server).
+ * -p            creation of a pseudo-terminal (its path is printed).
+ * -m            new KISS port on a modem : fifos (or devices) of the bits
+ *               from the demodulator and to the modulator, packed LSB
+ *               first ("-" : none).
+ * -l            new KISS port looped back on itself (for the tests).
+ * -D            digipeater call : the duplicates are suppressed and the
+ *               frames for the call are repeated on their port.
+ * -A            alias of the digipeater (several -A : several aliases).
+ * -W            highest n of the WIDEn-N paths repeated (2 by default,
+ *               0 : none).
+ *
+ * The KISS ports are numbered in the order of the options. Without -m
+ * nor -l, the TNC has one loopback port. The counters of the TNC and of
+ * every port are printed when it stops.
+ *
+ *--------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AX25_TNC.h"
+
+static volatile sig_atomic_t stop;
+
+/*--------------------------------------------------------------------------*
+ * SIGINT and SIGTERM end the loop.
+ *--------------------------------------------------------------------------*/
+static void tncSignal(int signal) {
+  (void) signal;
+  stop = 1;
+}
+
+/*--------------------------------------------------------------------------*
+ * Opening of the files of a modem ("rx,tx").
+ *--------------------------------------------------------------------------*/
+static char tncAddModem(AX25_Tnc *tnc, char *paths) {
+  char *comma = strchr(paths, ',');
+  int rxFd = -1, txFd = -1;
+
+  if(!comma) return 0;
+  *comma = '\0';
+  if(strcmp(paths, "-") && (rxFd = open(paths, O_RDONLY | O_NONBLOCK)) < 0) return 0;
+  if(strcmp(comma + 1, "-") && (txFd = open(comma + 1, O_RDWR)) < 0) {  // RDWR : a fifo opens at once.
+    if(rxFd >= 0) close(rxFd);
+    return 0;
+  }
+  if(rxFd < 0 && txFd < 0) return 0;
+  return AX25_tncAddPort(tnc, rxFd, txFd) >= 0;
+}
+
+int main(int argc, char **argv) {
+  const char *address = NULL;
+  unsigned int tcpPort = 8001, nbAliases = 0, maxHops = 2;
+  AX25_Address call, aliases[AX25_DIGI_MAX_ALIASES];
+  AX25_TncStats stats;
+  AX25_StatsSnapshot snapshot;
+  AX25_DigiStats digiStats;
+  AX25_Digi *digi = NULL;
+  AX25_Tnc *tnc;
+  unsigned int i;
+  char digipeater = 0;
+  char name[64];
+  int option, ok = 1, ports = 0;
+
+  tnc = AX25_tncCreate();
+  if(!tnc) {
+    fprintf(stderr, "%s: cannot create the TNC\n", argv[0]);
+    return 1;
+  }
+
+  while((option = getopt(argc, argv, "a:t:pm:lD:A:W:")) != -1) {
+    switch(option) {
+      case 'a': address = optarg; break;
+      case 't': tcpPort = strtoul(optarg, NULL, 10); break;
+      case 'p':
+        if(AX25_tncOpenPty(tnc, name, sizeof(name)) < 0) {
+          perror("pseudo-terminal");
+          ok = 0;
+        }
+        else printf("KISS pseudo-terminal: %s\n", name);
+        break;
+      case 'm':
+        if(!tncAddModem(tnc, optarg)) {
+          fprintf(stderr, "%s: cannot open the modem %s\n", argv[0], optarg);
+          ok = 0;
+        }
+        ports++;
+        break;
+      case 'l':
+        if(AX25_tncAddPort(tnc, -1, -1) < 0) ok = 0;
+        ports++;
+        break;
+      case 'D':
+        digipeater = AX25_addressParse(&call, optarg);
+        if(!digipeater) ok = 0;
+        break;
+      case 'A':
+        if(nbAliases == AX25_DIGI_MAX_ALIASES || !AX25_addressParse(&aliases[nbAliases++], optarg)) ok = 0;
+        break;
+      case 'W': maxHops = strtoul(optarg, NULL, 10); break;
+      default: ok = 0;
+    }
+  }
+  if(!ok || optind < argc || tcpPort > 65535 || maxHops > 7 || (nbAliases && !digipeater)) {
+    fprintf(stderr, "usage: %s [-a address] [-t port] [-p] [-m rx,tx] [-l] [-D call [-A alias] [-W hops]] ...\n",
+            argv[0]);
+    AX25_tncDestroy(tnc);
+    return 2;
+  }
+  if(!ports) AX25_tncAddPort(tnc, -1, -1);
+  if(digipeater) {
+    digi = AX25_tncEnableDigi(tnc, &call, 4096, 0);
+    if(!digi) {
+      fprintf(stderr, "%s: cannot create the digipeater\n", argv[0]);
+      AX25_tncDestroy(tnc);
+      return 1;
+    }
+    for(i=0; i<nbAliases; i++) AX25_digiAddAlias(digi, &aliases[i]);
+    AX25_digiSetWide(digi, "WIDE", (unsigned char) maxHops);
+  }
+  if(tcpPort) {
+    if(AX25_tncListen(tnc, address, (unsigned short) tcpPort) < 0) {
+      perror("listen");
+      AX25_tncDestroy(tnc);
+      return 1;
+    }
+    printf("KISS over TCP: %s:%u\n", address ? address : "127.0.0.1", tcpPort);
+  }
+  fflush(stdout);
+
+  signal(SIGINT, tncSignal);
+  signal(SIGTERM, tncSignal);
+  signal(SIGPIPE, SIG_IGN);
+  while(!stop) {
+    if(AX25_tncRun(tnc, 1000) < 0) {
+      perror("epoll");
+      break;
+    }
+  }
+
+  AX25_tncGetStats(tnc, &stats);
+  fprintf(stderr, "%lu frames received, %lu sent, %lu dropped for slow clients, %lu not sent\n",
+          stats.nbRxFrames, stats.nbTxFrames, stats.nbClientDrops, stats.nbTxDrops);
+  for(i=0; AX25_tncGetPortStats(tnc, i, &snapshot); i++) {
+    fprintf(stderr, "port %u: rx FCS %lu OK, %lu bad, %lu aborts, %lu overruns, latency %.1f us max ; "
+                    "tx %lu frames, %lu delay flags, %lu tail flags\n", i,
+            snapshot.counters[AX25_STAT_FCS_OK], snapshot.counters[AX25_STAT_FCS_BAD],
+            snapshot.counters[AX25_STAT_ABORTS], snapshot.counters[AX25_STAT_OVERRUNS], snapshot.latencyMax * 1e-3,
+            snapshot.counters[AX25_STAT_TX_FRAMES], snapshot.counters[AX25_STAT_TX_DELAY_FLAGS],
+            snapshot.counters[AX25_STAT_TX_TAIL_FLAGS]);
+  }
+  if(digi) {
+    AX25_digiGetStats(digi, &digiStats);
+    fprintf(stderr, "digipeater: %lu frames, %lu invalid, %lu duplicates, %lu repeated (%lu untraced), "
+                    "%lu not for us, %lu evicted\n", digiStats.nbFrames, digiStats.nbInvalid, digiStats.nbDuplicates,
+            digiStats.nbRepeated, digiStats.nbUntraced, digiStats.nbNotForUs, digiStats.nbEvicted);
+  }
+  AX25_tncDestroy(tnc);
+  return 0;
+}